@@ -233,11 +233,11 @@ extern RLSTATUS FreeRTOS_CreateThread(void *pHandlerFcn, ubyte* TaskName,
 	
 	if ((0==priority)||(255<priority))
 	{
-		status = xTaskCreate( (pdTASK_CODE)pHandlerFcn, (signed char const *)TaskName, kSTANDARD_RC_THREAD_STACK_SIZE, pArg, kSTANDARD_RC_THREAD_PRIO, ext2 );
+		status = xTaskCreate( (pdTASK_CODE)pHandlerFcn, (signed char const *)TaskName, kSTANDARD_RC_THREAD_STACK_SIZE + LWIP_API_STACK_EXTRA, pArg, kSTANDARD_RC_THREAD_PRIO, ext2 );
 	}
 	else
 	{
-		status = xTaskCreate( (pdTASK_CODE)pHandlerFcn, (signed char const *)TaskName, kSTANDARD_RC_THREAD_STACK_SIZE, pArg, priority, ext2 );
+		status = xTaskCreate( (pdTASK_CODE)pHandlerFcn, (signed char const *)TaskName, kSTANDARD_RC_THREAD_STACK_SIZE + LWIP_API_STACK_EXTRA, pArg, priority, ext2 );
 	}
 
     if (ERROR == status)
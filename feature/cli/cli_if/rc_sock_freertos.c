@@ -393,7 +393,7 @@ extern RLSTATUS SOCKET_CreateTask(ProcessComChannel* pPCC)
 
     CONVERT_ToStr(&pPCC->index, &(pPCC->Name[STRLEN(pPCC->Name)]), kDTinteger);
 
-	status = xTaskCreate( (pdTASK_CODE)PersistentConnectionHandler, (signed char const *)pPCC->Name, kSTANDARD_RC_THREAD_STACK_SIZE, pPCC, kSTANDARD_RC_THREAD_PRIO, 0 );
+	status = xTaskCreate( (pdTASK_CODE)PersistentConnectionHandler, (signed char const *)pPCC->Name, kSTANDARD_RC_THREAD_STACK_SIZE + LWIP_API_STACK_EXTRA, pPCC, kSTANDARD_RC_THREAD_PRIO, 0 );
 	
     if (pdPASS != status)
         return SYS_ERROR_SOCKET_CREATE_TASK;
@@ -511,6 +511,7 @@ RLSTATUS cli_show_port_status_handler(cli_env *pCliEnv, paramList *pParams, sbyt
     RLSTATUS    status = OK;
 
 	hal_swif_port_show_status(pCliEnv);
+	hal_swif_port_show_dampen(pCliEnv);
 	hal_swif_aggr_show_status(pCliEnv);
     return status;
 }
@@ -1173,3 +1174,41 @@ end:
     return status;
 }
 
+RLSTATUS cli_config_traffic_window_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
+{
+    RLSTATUS    status = OK;
+    sbyte       *pVal[TRAFFIC_WIN_NUM] = {NULL, NULL, NULL};
+    paramDescr  *pParamDescr;
+
+    /* get optional parameter */
+    if (OK == RCC_DB_RetrieveParam(pParams, "short", mConfigTraffic_window_Short, &pParamDescr ))
+        pVal[TRAFFIC_WIN_SHORT] = (sbyte*)(pParamDescr->pValue);
+    if (OK == RCC_DB_RetrieveParam(pParams, "medium", mConfigTraffic_window_Medium, &pParamDescr ))
+        pVal[TRAFFIC_WIN_MEDIUM] = (sbyte*)(pParamDescr->pValue);
+    if (OK == RCC_DB_RetrieveParam(pParams, "long", mConfigTraffic_window_Long, &pParamDescr ))
+        pVal[TRAFFIC_WIN_LONG] = (sbyte*)(pParamDescr->pValue);
+
+    /* TO DO: Add your handler code here */
+    {
+		ubyte win;
+		ubyte samples;
+
+		for(win=0; win<TRAFFIC_WIN_NUM; win++) {
+			if(pVal[win] == NULL)
+				continue;
+			CONVERT_StrTo(pVal[win], &samples, kDTuchar);
+			if(hal_swif_traffic_window_set(win, samples) != HAL_SWIF_SUCCESS) {
+				cli_printf(pCliEnv, "\r\nError: Invalid window, range <1-255> s\r\n\r\n");
+				return STATUS_RCC_NO_ERROR;
+			}
+		}
+
+		cli_printf(pCliEnv, "Traffic average windows: short %d s, medium %d s, long %d s\r\n",
+					hal_swif_traffic_window_get(TRAFFIC_WIN_SHORT) * HAL_TRAFFIC_SAMPLE_INTERVAL,
+					hal_swif_traffic_window_get(TRAFFIC_WIN_MEDIUM) * HAL_TRAFFIC_SAMPLE_INTERVAL,
+					hal_swif_traffic_window_get(TRAFFIC_WIN_LONG) * HAL_TRAFFIC_SAMPLE_INTERVAL);
+    }
+
+    return status;
+}
+
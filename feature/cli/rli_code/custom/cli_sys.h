@@ -48,6 +48,7 @@ RLSTATUS cli_show_counters_handler(cli_env *pCliEnv, paramList *pParams, sbyte *
 RLSTATUS cli_clear_counters_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 RLSTATUS cli_clear_mac_addr_table_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 RLSTATUS cli_config_traffic_statistic_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
+RLSTATUS cli_config_traffic_window_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 
 /* cli_ping.c */
 RLSTATUS cli_exec_ping_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
@@ -69,6 +70,7 @@ RLSTATUS cli_debug_diag_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAu
 #if MODULE_UART_SERVER
 /* cli_uart.c */
 RLSTATUS cli_show_uart_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
+RLSTATUS cli_config_uart_framegap_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 #endif
 
 
@@ -5,6 +5,8 @@
  * Email        : hejianguo@obtelecom.com
  *************************************************************/
 
+#include "mconfig.h"
+
 /* Standard includes */
 #include <stdlib.h>
 #include <string.h>
@@ -14,12 +16,18 @@
 #include "lwip/ip_addr.h"   
 #include "lwip/inet.h"
 
+/* FreeRTOS includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
 /* BSP includes */
 #include "flash_if.h"
 
 /* Other includes */
 #include "cli_sys.h"
 #include "cli_util.h"
+#include "tftp_rx.h"
 
 #include "conf_sys.h"
 #include "ob_image.h"
@@ -53,155 +61,504 @@
 #define TFTP_OACK			6	/* OACK */
 
 #define TFTP_PORT			69
+#define FLASH_SECTOR_SIZE	0x20000
+#if BOOT_AB_SLOT
+/* A/B boot slots, the image goes to the slot which is not running */
+#define TFTP_RUNNING_SLOT	((SCB->VTOR >= OB_SLOT_B_ADDRESS) ? OB_SLOT_B : OB_SLOT_A)
+#define FLASH_WRITE_START	((TFTP_RUNNING_SLOT == OB_SLOT_A) ? OB_SLOT_B_ADDRESS : OB_SLOT_A_ADDRESS)
+#define FLASH_WRITE_SIZE	((TFTP_RUNNING_SLOT == OB_SLOT_A) ? OB_SLOT_B_SIZE : OB_SLOT_A_SIZE)
+#else
 #define FLASH_WRITE_START	ADDR_FLASH_SECTOR_8
 #define FLASH_WRITE_END		ADDR_FLASH_SECTOR_11
-#define FLASH_SECTOR_SIZE	0x20000
-#define TFTP_BUFFER_SIZE	516	/* 512 + 4 */
+#define FLASH_WRITE_SIZE	(FLASH_WRITE_END + FLASH_SECTOR_SIZE - FLASH_WRITE_START)
+#endif
 
-unsigned char tftp_buffer[TFTP_BUFFER_SIZE];
+/* Negotiated options (RFC 2347/2348/2349/7440). A 1024 bytes block is
+   carried by 5 pool pbufs, so a full window stays well inside PBUF_POOL_SIZE */
+#define TFTP_BLKSIZE		1024
+#define TFTP_WINDOWSIZE		4
+#define TFTP_TIMEOUT		3	/* seconds */
+#define TFTP_RETRY_MAX		5
+#define TFTP_REQUEST_MAX	3	/* RRQ attempts, later ones resume */
+#define TFTP_BUFFER_SIZE	(TFTP_BLKSIZE + 4)
+#define TFTP_STAGE_SIZE		(TFTP_BLKSIZE * TFTP_WINDOWSIZE)
+#define TFTP_MARK_BYTES		5120	/* print '#' every 5k bytes */
 
-int tftp_get(cli_env *pCliEnv, sbyte *tftp_server, sbyte *filename)
+#define TFTP_SESSION_DONE		0
+#define TFTP_SESSION_TIMEOUT	1
+#define TFTP_SESSION_ERROR		2
+
+typedef struct {
+	unsigned int server;		/* server of the interrupted transfer */
+	char filename[64];
+	unsigned int tsize;			/* 0: server did not report the size */
+	unsigned int committed;		/* bytes programmed in flash */
+	unsigned int erased;		/* bytes erased from FLASH_WRITE_START */
+} tftp_resume_t;
+
+typedef struct {
+	unsigned char *buf;
+	unsigned int offset;
+	unsigned int length;
+	unsigned int status;
+} tftp_flash_job_t;
+
+unsigned char tftp_buffer[TFTP_BUFFER_SIZE + 1];	/* +1 to terminate option strings */
+
+static tftp_resume_t TftpResume;
+static tftp_flash_job_t TftpFlashJob;
+static xSemaphoreHandle xSemTftpWrite = NULL;
+static xSemaphoreHandle xSemTftpIdle = NULL;
+
+/**************************************************************************
+  * @brief  program staged image data behind the receiver
+  * @param  arg
+  * @retval None
+  *************************************************************************/
+static void tftp_flash_task(void *arg)
 {
-	int ret, tftp_sock, timeout;
-	struct sockaddr_in tftp_addr, from_addr;
-	unsigned int length, totalsize;
-	unsigned short rxblk_num, tftpblock, barlen;
-	socklen_t fromlen;
 	unsigned int write_address;
-	unsigned int flash_sector_idx, flash_sector_erase_ready;
-	unsigned int repeat, continue_flag;
-	
+
+	while(1) {
+		xSemaphoreTake(xSemTftpWrite, portMAX_DELAY);
+
+		write_address = FLASH_WRITE_START + TftpFlashJob.offset;
+		TftpFlashJob.status = FLASH_If_Write((uint32_t *)&write_address, (uint32_t *)TftpFlashJob.buf, TftpFlashJob.length);
+		if(TftpFlashJob.status == 0)
+			TftpResume.committed = TftpFlashJob.offset + TftpFlashJob.length;
+
+		xSemaphoreGive(xSemTftpIdle);
+	}
+}
+
+static int tftp_flash_init(void)
+{
+	if(xSemTftpWrite != NULL)
+		return 0;
+
+	vSemaphoreCreateBinary(xSemTftpWrite);
+	vSemaphoreCreateBinary(xSemTftpIdle);
+	if((xSemTftpWrite == NULL) || (xSemTftpIdle == NULL))
+		return -1;
+	xSemaphoreTake(xSemTftpWrite, 0);
+
+	if(xTaskCreate(tftp_flash_task, "tTftpW", configMINIMAL_STACK_SIZE*2, NULL, tskIDLE_PRIORITY + 2, NULL) != pdPASS)
+		return -1;
+
+	return 0;
+}
+
+/* Wait the writer idle, return the status of the last job */
+static unsigned int tftp_flash_wait(void)
+{
+	xSemaphoreTake(xSemTftpIdle, portMAX_DELAY);
+	xSemaphoreGive(xSemTftpIdle);
+	return TftpFlashJob.status;
+}
+
+static unsigned int tftp_flash_post(unsigned char *buf, unsigned int offset, unsigned int length)
+{
+	unsigned int status;
+
+	xSemaphoreTake(xSemTftpIdle, portMAX_DELAY);
+	if((status = TftpFlashJob.status) != 0) {
+		xSemaphoreGive(xSemTftpIdle);
+		return status;
+	}
+	TftpFlashJob.buf = buf;
+	TftpFlashJob.offset = offset;
+	TftpFlashJob.length = length;
+	xSemaphoreGive(xSemTftpWrite);
+
+	return 0;
+}
+
+static int tftp_flash_stage(unsigned char *buf, unsigned int offset, unsigned int length)
+{
+	return (tftp_flash_post(buf, offset, length) == 0) ? 0 : -1;
+}
+
+static int tftp_flash_verify(unsigned int offset, const unsigned char *data, unsigned int length)
+{
+	return memcmp((void *)(FLASH_WRITE_START + offset), data, length);
+}
+
+static const tftp_rx_port_t TftpRxPort = {
+	tftp_flash_verify,
+	tftp_flash_stage
+};
+
+/* Erase the sectors needed by an image of 'size' bytes which are not erased yet */
+static void tftp_flash_prepare(cli_env *pCliEnv, unsigned int size)
+{
+	unsigned int need;
+
+	need = tftp_rx_erase_size(size, FLASH_WRITE_SIZE, FLASH_SECTOR_SIZE);
+	if(need <= TftpResume.erased)
+		return;
+
+	cli_printf(pCliEnv, "Erase flash ... ");
+	FLASH_If_Init();
+	FLASH_If_Erase(FLASH_WRITE_START + TftpResume.erased, FLASH_WRITE_START + need - 1);
+	TftpResume.erased = need;
+	cli_printf(pCliEnv, "done\r\n");
+}
+
+static void tftp_resume_reset(void)
+{
+	TftpResume.server = 0;
+	TftpResume.filename[0] = 0;
+	TftpResume.tsize = 0;
+	TftpResume.committed = 0;
+	TftpResume.erased = 0;
+}
+
+static void tftp_send_ack(int sock, unsigned short block, struct sockaddr_in *to)
+{
+	unsigned char ack[4];
+
+	ack[0] = 0; ack[1] = TFTP_ACK; /* opcode */
+	ack[2] = (unsigned char)((block >> 8) & 0xff);
+	ack[3] = (unsigned char)(block & 0xff);
+	lwip_sendto(sock, ack, 4, 0, (struct sockaddr *)to, sizeof(struct sockaddr_in));
+}
+
+static void tftp_send_error(int sock, unsigned short code, char *msg, struct sockaddr_in *to)
+{
+	unsigned int length;
+
+	tftp_buffer[0] = 0; tftp_buffer[1] = TFTP_ERROR; /* opcode */
+	tftp_buffer[2] = (unsigned char)((code >> 8) & 0xff);
+	tftp_buffer[3] = (unsigned char)(code & 0xff);
+	length = sprintf((char *)&tftp_buffer[4], "%s", msg) + 4;
+	tftp_buffer[length] = 0; length ++;
+	lwip_sendto(sock, tftp_buffer, length, 0, (struct sockaddr *)to, sizeof(struct sockaddr_in));
+}
+
+static unsigned int tftp_build_request(char *filename)
+{
+	unsigned int length;
+
+	tftp_buffer[0] = 0;			/* Opcode */
+	tftp_buffer[1] = TFTP_RRQ; 	/* TFTP Request */
+	length = sprintf((char *)&tftp_buffer[2], "%s", filename) + 2;
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%s", "octet");
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%s", "blksize");
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%d", TFTP_BLKSIZE);
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%s", "windowsize");
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%d", TFTP_WINDOWSIZE);
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%s", "tsize");
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%d", 0);
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%s", "timeout");
+	tftp_buffer[length] = 0; length ++;
+	length += sprintf((char*)&tftp_buffer[length], "%d", TFTP_TIMEOUT);
+	tftp_buffer[length] = 0; length ++;
+
+	return length;
+}
+
+/**************************************************************************
+  * @brief  parse the option acknowledgment
+  * @param  length of the OACK packet
+  * @retval 0: ok, -1: unacceptable option value
+  *************************************************************************/
+static int tftp_parse_oack(unsigned int length, unsigned int *blksize, unsigned int *windowsize,
+	unsigned int *tsize, unsigned int *timeout)
+{
+	char *opt, *val, *end;
+	unsigned int value;
+
+	tftp_buffer[length] = 0;
+	opt = (char *)&tftp_buffer[2];
+	end = (char *)&tftp_buffer[length];
+	while(opt < end) {
+		val = opt + strlen(opt) + 1;
+		if(val >= end)
+			break;
+		value = strtoul(val, NULL, 10);
+		if(!STRICMP((sbyte *)opt, "blksize")) {
+			if((value < 8) || (value > TFTP_BLKSIZE))
+				return -1;
+			*blksize = value;
+		} else if(!STRICMP((sbyte *)opt, "windowsize")) {
+			if((value < 1) || (value > TFTP_WINDOWSIZE))
+				return -1;
+			*windowsize = value;
+		} else if(!STRICMP((sbyte *)opt, "tsize")) {
+			*tsize = value;
+		} else if(!STRICMP((sbyte *)opt, "timeout")) {
+			if((value < 1) || (value > 255))
+				return -1;
+			*timeout = value;
+		}
+		opt = val + strlen(val) + 1;
+	}
+
+	return 0;
+}
+
+/**************************************************************************
+  * @brief  run one RRQ, blocks below TftpResume.committed are verified
+  *         against the flash instead of being programmed again
+  * @param  
+  * @retval TFTP_SESSION_xxx
+  *************************************************************************/
+static int tftp_session(cli_env *pCliEnv, int tftp_sock, struct sockaddr_in *tftp_addr, sbyte *filename,
+	unsigned char *stage, unsigned int *totalsize, unsigned int *barbytes)
+{
+	struct sockaddr_in from_addr, peer_addr;
+	socklen_t fromlen;
+	unsigned int length, reqlen, retry, timeout;
+	unsigned int blksize, windowsize, tsize, established;
+	unsigned short ack, barlen;
+	tftp_rx_t rx;
+	int result, ret;
+
+	tftp_rx_start(&rx, stage, TFTP_STAGE_SIZE, TftpResume.committed, FLASH_WRITE_SIZE);
+	blksize = rx.blksize;
+	windowsize = rx.windowsize;
+	tsize = 0;
+	timeout = TFTP_TIMEOUT;
+	established = 0;
+	barlen = 0;
+	retry = 0;
+	result = TFTP_SESSION_TIMEOUT;
+
+	/* send request */
+	reqlen = tftp_build_request((char *)filename);
+	lwip_sendto(tftp_sock, tftp_buffer, reqlen, 0, (struct sockaddr *)tftp_addr, sizeof(struct sockaddr_in));
+
+	while(1) {
+		fromlen = sizeof(struct sockaddr_in);
+		length = lwip_recvfrom(tftp_sock, tftp_buffer, TFTP_BUFFER_SIZE, 0, (struct sockaddr *)&from_addr, &fromlen);
+		if((length == 0) || (length > TFTP_BUFFER_SIZE)) {
+			/* Timeout, restart the window from the last block received in order */
+			if(++retry > TFTP_RETRY_MAX)
+				break;
+			ack = tftp_rx_timeout(&rx);
+			if(established)
+				tftp_send_ack(tftp_sock, ack, &peer_addr);
+			else {
+				reqlen = tftp_build_request((char *)filename);
+				lwip_sendto(tftp_sock, tftp_buffer, reqlen, 0, (struct sockaddr *)tftp_addr, sizeof(struct sockaddr_in));
+			}
+			continue;
+		}
+		if(length < 4)
+			continue;
+
+		if(!established) {
+			memcpy(&peer_addr, &from_addr, sizeof(struct sockaddr_in));
+		} else if((from_addr.sin_port != peer_addr.sin_port) || (from_addr.sin_addr.s_addr != peer_addr.sin_addr.s_addr)) {
+			tftp_send_error(tftp_sock, 5, "Unknown transfer ID", &from_addr);
+			continue;
+		}
+
+		if((tftp_buffer[0] == 0) && (tftp_buffer[1] == TFTP_OACK)) {
+			if(established)
+				continue;	/* retransmitted OACK, ACK 0 was sent already */
+			if(tftp_parse_oack(length, &blksize, &windowsize, &tsize, &timeout) < 0) {
+				tftp_send_error(tftp_sock, 8, "Option negotiation failed", &peer_addr);
+				cli_printf(pCliEnv, "TFTP option negotiation failed.\r\n");
+				result = TFTP_SESSION_ERROR;
+				break;
+			}
+			if(tsize > FLASH_WRITE_SIZE) {
+				tftp_send_error(tftp_sock, 3, "Image too large", &peer_addr);
+				cli_printf(pCliEnv, "Error: Image size %d exceeds %d bytes\r\n", tsize, FLASH_WRITE_SIZE);
+				result = TFTP_SESSION_ERROR;
+				break;
+			}
+			if((rx.base > 0) && (tsize != 0) && (TftpResume.tsize != 0) && (tsize != TftpResume.tsize)) {
+				/* The image changed on the server, start over */
+				cli_printf(pCliEnv, "Image size changed, restart transfer\r\n");
+				TftpResume.committed = 0;
+				TftpResume.erased = 0;
+				tftp_rx_start(&rx, stage, TFTP_STAGE_SIZE, 0, FLASH_WRITE_SIZE);
+			}
+			tftp_rx_options(&rx, blksize, windowsize);
+			TftpResume.tsize = tsize;
+			timeout *= 1000;
+			lwip_setsockopt(tftp_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+			tftp_flash_prepare(pCliEnv, tsize);
+			established = 1;
+			retry = 0;
+			tftp_send_ack(tftp_sock, 0, &peer_addr);
+		} else if((tftp_buffer[0] == 0) && (tftp_buffer[1] == TFTP_DATA)) {
+			if(!established) {
+				/* Server ignored the options, plain RFC 1350 transfer */
+				tftp_flash_prepare(pCliEnv, 0);
+				established = 1;
+			}
+			retry = 0;
+			ret = tftp_rx_data(&rx, &TftpRxPort, ntohs(*(unsigned short *)&tftp_buffer[2]), &tftp_buffer[4], length - 4, &ack);
+			if(ret == TFTP_RX_ERR_SIZE) {
+				tftp_send_error(tftp_sock, 3, "Image too large", &peer_addr);
+				cli_printf(pCliEnv, "\r\nError: Image exceeds %d bytes\r\n", FLASH_WRITE_SIZE);
+				result = TFTP_SESSION_ERROR;
+				break;
+			} else if(ret == TFTP_RX_ERR_CHANGED) {
+				tftp_send_error(tftp_sock, 0, "Image changed", &peer_addr);
+				cli_printf(pCliEnv, "\r\nError: Image differs from the interrupted transfer\r\n");
+				tftp_resume_reset();
+				result = TFTP_SESSION_ERROR;
+				break;
+			} else if(ret == TFTP_RX_ERR_FLASH) {
+				tftp_send_error(tftp_sock, 3, "Flash write error", &peer_addr);
+				cli_printf(pCliEnv, "\r\nError: Flash write failed\r\n");
+				result = TFTP_SESSION_ERROR;
+				break;
+			}
+
+			if(ret >= TFTP_RX_ACCEPT) {
+				*totalsize = rx.received;
+				*barbytes += length - 4;
+				while(*barbytes >= TFTP_MARK_BYTES) {
+					cli_printf(pCliEnv, "#");
+					*barbytes -= TFTP_MARK_BYTES;
+					if(++barlen >= 50) {	/* Max 50 '#' in a line */
+						cli_printf(pCliEnv, "\r\n");
+						barlen = 0;
+					}
+				}
+			}
+			if((ret != TFTP_RX_IGNORE) && (ret != TFTP_RX_ACCEPT))
+				tftp_send_ack(tftp_sock, ack, &peer_addr);
+			if(ret == TFTP_RX_LAST) {
+				result = TFTP_SESSION_DONE;
+				break;
+			}
+		} else if ((tftp_buffer[0] == 0) && (tftp_buffer[1] == TFTP_ERROR)) {
+			tftp_buffer[length] = 0;
+			if(*totalsize > 0)
+				cli_printf(pCliEnv, "\r\n");
+			cli_printf(pCliEnv, "TFTP error %d, %s.\r\n", ((tftp_buffer[2]<<8)|tftp_buffer[3]), &tftp_buffer[4]);
+			result = TFTP_SESSION_ERROR;
+			break;
+		} else {
+			if(*totalsize > 0)
+				cli_printf(pCliEnv, "\r\n");
+			cli_printf(pCliEnv, "TFTP error %d, don't know why.\r\n", tftp_buffer[1]);
+			result = TFTP_SESSION_ERROR;
+			break;
+		}
+	}
+
+	/* Flush the partial half, every block received in order is kept for resume */
+	if((result != TFTP_SESSION_ERROR) && (tftp_rx_flush(&rx, &TftpRxPort) != 0))
+		result = TFTP_SESSION_ERROR;
+	if((tftp_flash_wait() != 0) && (result != TFTP_SESSION_ERROR)) {
+		cli_printf(pCliEnv, "\r\nError: Flash write failed\r\n");
+		result = TFTP_SESSION_ERROR;
+	}
+
+	return result;
+}
+
+int tftp_get(cli_env *pCliEnv, sbyte *tftp_server, sbyte *filename)
+{
+	int ret, tftp_sock, timeout, result;
+	struct sockaddr_in tftp_addr;
+	unsigned int totalsize, barbytes;
+	unsigned int repeat;
+	unsigned char *stage;
+
 	/* connect to tftp server */
+	memset(&tftp_addr, 0, sizeof(tftp_addr));
     inet_aton(tftp_server, (struct in_addr *)&(tftp_addr.sin_addr));
     tftp_addr.sin_family = AF_INET;
     tftp_addr.sin_port = htons(TFTP_PORT);
 
+	if(tftp_flash_init() < 0) {
+		cli_printf(pCliEnv, "flash writer create failed!\r\n");
+		return -1;
+	}
+	tftp_flash_wait();
+	TftpFlashJob.status = 0;
+	if((stage = (unsigned char *)pvPortMalloc(TFTP_STAGE_SIZE * 2)) == NULL) {
+		cli_printf(pCliEnv, "memory alloc failed!\r\n");
+		return -1;
+	}
+
 	if((tftp_sock = lwip_socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) < 0) {
 		cli_printf(pCliEnv, "socket create failed!\r\n");
+		vPortFree(stage);
 		return -1;
 	}
-	timeout = 8000; /* 8 seconds */
-	lwip_setsockopt(tftp_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 
-	repeat = 3;
-	while(repeat-- > 0) {
-		cli_printf(pCliEnv, "Erase flash ... ");
-		FLASH_If_Init();
-		FLASH_If_Erase(FLASH_WRITE_START, FLASH_WRITE_END);
-		cli_printf(pCliEnv, "done\r\n");
-		
-		/* TFTP request */
-		tftp_buffer[0] = 0;			/* Opcode */
-		tftp_buffer[1] = TFTP_RRQ; 	/* TFTP Request */
-		length = sprintf((char *)&tftp_buffer[2], "%s", filename) + 2;
-		tftp_buffer[length] = 0; length ++;
-		length += sprintf((char*)&tftp_buffer[length], "%s", "binary");
-		tftp_buffer[length] = 0; length ++;
-		#if 1
-		length += sprintf((char*)&tftp_buffer[length], "%s", "timeout");
-		tftp_buffer[length] = 0; length ++;
-		length += sprintf((char*)&tftp_buffer[length], "%d", 8);
-		tftp_buffer[length] = 0; length ++;
-		#endif
-		
-		fromlen = sizeof(struct sockaddr_in);
+	/* Resume only the same image from the same server */
+	if((TftpResume.server != tftp_addr.sin_addr.s_addr) || (strncmp(TftpResume.filename, (char *)filename, sizeof(TftpResume.filename)) != 0)) {
+		tftp_resume_reset();
+		TftpResume.server = tftp_addr.sin_addr.s_addr;
+		strncpy(TftpResume.filename, (char *)filename, sizeof(TftpResume.filename) - 1);
+		TftpResume.filename[sizeof(TftpResume.filename) - 1] = 0;
+	} else if(TftpResume.committed > 0) {
+		cli_printf(pCliEnv, "Resume transfer at %d bytes\r\n", TftpResume.committed);
+	}
+	FLASH_If_Init();
 
+	totalsize = 0;
+	barbytes = 0;
+	repeat = TFTP_REQUEST_MAX;
+	while(repeat-- > 0) {
+		timeout = TFTP_TIMEOUT * 1000;
+		lwip_setsockopt(tftp_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 
-		//cli_printf(pCliEnv, "TFTP transfer start ...\r\n");
-		/* send request */	
-		lwip_sendto(tftp_sock, tftp_buffer, length, 0, (struct sockaddr *)&tftp_addr, sizeof(struct sockaddr_in));
-		totalsize = 0;
-		rxblk_num = 0;
-		tftpblock = 0;
-		barlen = 0;
-		flash_sector_idx = 0;
-		flash_sector_erase_ready = 0;
-		do {
-			continue_flag = 0;
-			length = lwip_recvfrom(tftp_sock, tftp_buffer, sizeof(tftp_buffer), 0, (struct sockaddr *)&from_addr, &fromlen);
-			if (length >= 4) {
-				if((tftp_buffer[0] == 0) && (tftp_buffer[1] == TFTP_DATA)) {
-					write_address = FLASH_WRITE_START + totalsize;
-					totalsize = totalsize + length - 4;
-					if(totalsize > FLASH_SECTOR_SIZE * (flash_sector_idx + 1)) {
-						flash_sector_erase_ready = 0;
-						flash_sector_idx++;
-					}
-						
-					if(flash_sector_erase_ready == 0) {
-						//cli_printf(pCliEnv, "Erase address 0x%08x\r\n", FLASH_WRITE_START + FLASH_SECTOR_SIZE*flash_sector_idx);
-						//FLASH_If_Init();
-						//FLASH_If_Erase(FLASH_WRITE_START + FLASH_SECTOR_SIZE*flash_sector_idx, FLASH_WRITE_START + FLASH_SECTOR_SIZE*(flash_sector_idx+1) - 1);
-						flash_sector_erase_ready = 1;
-					}
-					FLASH_If_Write((uint32_t *)&write_address, (uint32_t *)&tftp_buffer[4], length-4);
-
-					tftpblock = ntohs(*(unsigned short *)&tftp_buffer[2]);
-					rxblk_num++; 
-					if(rxblk_num >= 10) {	/* Receive 5k bytes, will print '#' */
-						cli_printf(pCliEnv, "#");
-						rxblk_num = 0;
-						barlen++;
-						if(barlen>=50) {	/* Max 50 '#' in a line */
-							cli_printf(pCliEnv, "\r\n");
-							barlen = 0;
-						}
-					}
-					tftp_buffer[0] = 0; tftp_buffer[1] = TFTP_ACK; /* opcode */	
-					tftp_buffer[2] = (unsigned char)((tftpblock >> 8) & 0xff);
-					tftp_buffer[3] = (unsigned char)(tftpblock & 0xff);					
-					lwip_sendto(tftp_sock, tftp_buffer, 4, 0, (struct sockaddr *)&from_addr, fromlen);
-				} else if ((tftp_buffer[0] == 0) && (tftp_buffer[1] == TFTP_ERROR)) {
-					unsigned short errcode;
-					if(totalsize > 0)
-						cli_printf(pCliEnv, "\r\n");
-					cli_printf(pCliEnv, "TFTP error %d, %s.\r\n", (((errcode=tftp_buffer[2])<<8)|tftp_buffer[3]), &tftp_buffer[4]);
-					goto exit;
-				} else if ((tftp_buffer[0] == 0) && (tftp_buffer[1] == TFTP_OACK)) {
-					tftp_buffer[0] = 0; tftp_buffer[1] = TFTP_ACK; /* opcode */	
-					tftp_buffer[2] = (unsigned char)((tftpblock >> 8) & 0xff);
-					tftp_buffer[3] = (unsigned char)(tftpblock & 0xff);
-					lwip_sendto(tftp_sock, tftp_buffer, 4, 0, (struct sockaddr *)&from_addr, fromlen);
-					continue_flag = 1;
-				} else {
-					if(totalsize > 0)
-						cli_printf(pCliEnv, "\r\n");
-					cli_printf(pCliEnv, "TFTP error %d, don't know why.\r\n", tftp_buffer[1]);
-					goto exit;
-				}
+		result = tftp_session(pCliEnv, tftp_sock, &tftp_addr, filename, stage, &totalsize, &barbytes);
+		if(result == TFTP_SESSION_ERROR) {
+			tftp_resume_reset();
+			goto exit;
+		} else if(result == TFTP_SESSION_TIMEOUT) {
+			if(totalsize > 0)
+				cli_printf(pCliEnv, "\r\n");
+			if(TftpResume.committed == 0) {
+				cli_printf(pCliEnv, "TFTP request timeout.\r\n");
+				continue;
 			}
+			cli_printf(pCliEnv, "TFTP timeout, resume at %d bytes\r\n", TftpResume.committed);
+			continue;
+		}
 
-		} while ((length == TFTP_BUFFER_SIZE) || (continue_flag == 1));
-
-		if(length == 0) {
-			cli_printf(pCliEnv, "TFTP request timeout.\r\n");
-		} else {
-			
-			if((ret = OB_Check_Upgrade_Image(FLASH_WRITE_START, NULL, NULL)) == IHCHK_OK) {
-				conf_set_upgrade_flag();
-				cli_printf(pCliEnv, "\r\nReceived %d bytes and verify successfully\r\n", totalsize);
+		if((ret = OB_Check_Upgrade_Image(FLASH_WRITE_START, NULL, NULL)) == IHCHK_OK) {
+#if BOOT_AB_SLOT
+			if(ntohl(((OB_Image_Header_t *)FLASH_WRITE_START)->LoadAddress) != FLASH_WRITE_START + OB_SLOT_VECTOR_OFFSET) {
+				cli_printf(pCliEnv, "\r\nError: Image is not linked for slot %c\r\n", (TFTP_RUNNING_SLOT == OB_SLOT_A) ? 'B' : 'A');
+				tftp_resume_reset();
 				break;
-			} else {
-                conf_clear_upgrade_flag();
-				//cli_printf(pCliEnv, "\r\nError: Invalid image%s\r\n", (repeat>0)? ", repeat tftp":"");
-				if(ret == IHCHK_ERR_MAGIC)
-					cli_printf(pCliEnv, "\r\nError: Image magic check failed\r\n");
-				else if(ret == IHCHK_ERR_HCRC)
-					cli_printf(pCliEnv, "\r\nError: Image head crc check failed\r\n");
-				else if(ret == IHCHK_ERR_DCRC)
-					cli_printf(pCliEnv, "\r\nError: Image data crc check failed\r\n");	
-				else if(ret == IHCHK_ERR_NAME)
-					cli_printf(pCliEnv, "\r\nError: Image name check failed\r\n");
-				else
-					cli_printf(pCliEnv, "\r\nError: don't kown why!\r\n");
-				
-				goto exit;
 			}
+			conf_set_upgrade_slot((TFTP_RUNNING_SLOT == OB_SLOT_A) ? OB_SLOT_B : OB_SLOT_A);
+#else
+			conf_set_upgrade_flag();
+#endif
+			cli_printf(pCliEnv, "\r\nReceived %d bytes and verify successfully\r\n", totalsize);
+		} else {
+			conf_clear_upgrade_flag();
+			if(ret == IHCHK_ERR_MAGIC)
+				cli_printf(pCliEnv, "\r\nError: Image magic check failed\r\n");
+			else if(ret == IHCHK_ERR_HCRC)
+				cli_printf(pCliEnv, "\r\nError: Image head crc check failed\r\n");
+			else if(ret == IHCHK_ERR_DCRC)
+				cli_printf(pCliEnv, "\r\nError: Image data crc check failed\r\n");	
+			else if(ret == IHCHK_ERR_NAME)
+				cli_printf(pCliEnv, "\r\nError: Image name check failed\r\n");
+			else
+				cli_printf(pCliEnv, "\r\nError: don't kown why!\r\n");
 		}
+		tftp_resume_reset();
+		break;
 	}
 	
 exit:	
 	lwip_close(tftp_sock);
+	vPortFree(stage);
 	
     return 0;
 	
@@ -44,6 +44,7 @@ void show_uart_running_stats(cli_env *pCliEnv, ubyte uart_port)
 	uart_dev_t	*pUartDev;
 	ubyte2 listen_port;
 	struct sockaddr_in client_addr;
+	uart_sock_stat_t client_stat;
 	ubyte4 i, conn_num;
 	uartcfg_udp_t udpcfg;
 	uartcfg_udp_multicast_t udpmulticfg;
@@ -94,12 +95,13 @@ void show_uart_running_stats(cli_env *pCliEnv, ubyte uart_port)
 
 			conn_num = 0;
 			for(i=0; i<SOCKET_LIST_SIZE; i++) {
-				if(uart_get_socket_connect(uart_port, i, &client_addr) < 0)
+				if((uart_get_socket_connect(uart_port, i, &client_addr) < 0) || (uart_get_socket_stat(uart_port, i, &client_stat) < 0))
 					continue;
 				if(conn_num == 0)
-					cli_printf(pCliEnv, "%s:%d\r\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+					cli_printf(pCliEnv, "%s:%d", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
 				else
-					cli_printf(pCliEnv, "                       : %s:%d\r\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+					cli_printf(pCliEnv, "                       : %s:%d", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+				cli_printf(pCliEnv, " (tx %d frames, %d drops)\r\n", client_stat.tx_frames, client_stat.tx_drops);
 				conn_num++;
 			}
 			if(conn_num == 0)
@@ -111,12 +113,13 @@ void show_uart_running_stats(cli_env *pCliEnv, ubyte uart_port)
 
 			conn_num = 0;
 			for(i=0; i<SOCKET_LIST_SIZE; i++) {
-				if(uart_get_socket_connect(uart_port, i, &client_addr) < 0)
+				if((uart_get_socket_connect(uart_port, i, &client_addr) < 0) || (uart_get_socket_stat(uart_port, i, &client_stat) < 0))
 					continue;
 				if(conn_num == 0)
-					cli_printf(pCliEnv, "%s:%d\r\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+					cli_printf(pCliEnv, "%s:%d", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
 				else
-					cli_printf(pCliEnv, "                       : %s:%d\r\n", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+					cli_printf(pCliEnv, "                       : %s:%d", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
+				cli_printf(pCliEnv, " (tx %d frames, %d drops)\r\n", client_stat.tx_frames, client_stat.tx_drops);
 				conn_num++;
 			}
 			if(conn_num == 0)
@@ -154,11 +157,18 @@ void show_uart_running_stats(cli_env *pCliEnv, ubyte uart_port)
 	
 	cli_printf(pCliEnv, "   Uart rx fifo size   : %d\r\n", pUartDev->fifo.rxSize);
 	cli_printf(pCliEnv, "   Uart tx fifo size   : %d\r\n", pUartDev->fifo.txSize);
+	cli_printf(pCliEnv, "   Uart frame gap (ms) : %d\r\n", UartGetFrameGap(uart_port));
 	cli_printf(pCliEnv, "   Count txdone event  : %d\r\n", pUartDev->stat.count_txdone);
 	cli_printf(pCliEnv, "   Count rxidle event  : %d\r\n", pUartDev->stat.count_rxidle);
 	cli_printf(pCliEnv, "   Count rxovf  event  : %d\r\n", pUartDev->stat.count_rxovf);
 	cli_printf(pCliEnv, "   Count rxfull event  : %d\r\n", pUartDev->stat.count_rxfull);
 	cli_printf(pCliEnv, "   Count OverRun error : %d\r\n", pUartDev->stat.count_overrun);
+	cli_printf(pCliEnv, "   Count rxdrop bytes  : %d\r\n", pUartDev->stat.count_rxdrop);
+	cli_printf(pCliEnv, "   Uart rx highwater   : %d\r\n", pUartDev->stat.rx_highwater);
+#if UART_DMA_ENABLE
+	cli_printf(pCliEnv, "   Count rx dma half   : %d\r\n", pUartDev->stat.count_dma_ht);
+	cli_printf(pCliEnv, "   Count rx dma wrap   : %d\r\n", pUartDev->stat.count_dma_tc);
+#endif
 	cli_printf(pCliEnv, "   Count uart tx bytes : %d\r\n", pUartDev->stat.tx_bytes);
 	cli_printf(pCliEnv, "   Count uart rx bytes : %d\r\n", pUartDev->stat.rx_bytes);
 	cli_printf(pCliEnv, "   Count timeout ethtx : %d\r\n", pUartDev->stat.count_tim_ethtx);	
@@ -201,6 +211,62 @@ RLSTATUS cli_show_uart_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAux
 	return status;
 }
 
+RLSTATUS cli_config_uart_framegap_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
+{
+    RLSTATUS    status = OK;
+    sbyte       *pVal1 = NULL;
+    paramDescr  *pParamDescr1;
+    sbyte       *pVal2 = NULL;
+    paramDescr  *pParamDescr2;
+
+    /* get required parameter */
+    status = RCC_DB_RetrieveParam(pParams, "port", mConfigUart_framegap_Port, &pParamDescr1);
+    if (OK != status)
+        return status;
+    pVal1 = (sbyte*)(pParamDescr1->pValue);
+
+    /* get optional parameter */
+    if (OK == RCC_DB_RetrieveParam(pParams, "gap", mConfigUart_framegap_Gap, &pParamDescr2 ))
+    {
+        pVal2 = (sbyte*)(pParamDescr2->pValue);
+    }
+
+    /* TO DO: Add your handler code here */
+    {
+		ubyte uart_port;
+		ubyte2 frame_gap;
+
+		CONVERT_StrTo(pVal1, &uart_port, kDTuchar);
+		if(uart_port > 1) {
+			cli_printf(pCliEnv, "\r\nError: Invalid port number, should be 0 or 1\r\n\r\n");
+			return STATUS_RCC_NO_ERROR;
+		}
+
+		if(pVal2 == NULL) {
+			if(GetUartFrameGap(uart_port, &frame_gap) != CONF_ERR_NONE) {
+				cli_printf(pCliEnv, "Error: read eeprom failed!\r\n");
+				return STATUS_RCC_NO_ERROR;
+			}
+			if(frame_gap == 0)
+				cli_printf(pCliEnv, "UART port %d frames end at the idle line\r\n", uart_port);
+			else
+				cli_printf(pCliEnv, "UART port %d frame gap is %d ms\r\n", uart_port, frame_gap);
+			return status;
+		}
+
+		CONVERT_StrTo(pVal2, &frame_gap, kDTushort);
+
+		if(SetUartFrameGap(uart_port, frame_gap) != CONF_ERR_NONE) {
+			cli_printf(pCliEnv, "Error: write eeprom failed!\r\n");
+			return STATUS_RCC_NO_ERROR;
+		}
+		/* Takes effect on the next received frame */
+		UartSetFrameGap(uart_port, frame_gap);
+	}
+	
+	return status;
+}
+
 #else
 #include "cli_sys.h"
 
@@ -211,5 +277,12 @@ RLSTATUS cli_show_uart_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAux
 	return status;
 }
 
+RLSTATUS cli_config_uart_framegap_handler(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
+{
+    RLSTATUS    status = OK;
+	
+	return status;
+}
+
 #endif
 
@@ -0,0 +1,137 @@
+/*************************************************************
+ * Filename     : tftp_rx.c
+ * Description  : TFTP download window, resume and staging. The
+ *                flash is reached through tftp_rx_port_t, the
+ *                socket stays with cli_tftp.c
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+/* Standard includes */
+#include <string.h>
+
+#include "tftp_rx.h"
+
+#define TFTP_BLKSIZE_DEFAULT	512
+
+/**************************************************************************
+  * @brief  start a transfer, plain RFC 1350 until options are agreed
+  * @param  stage: 2 * stage_size bytes, base: bytes already in flash,
+  *         limit: size of the upgrade area
+  * @retval None
+  *************************************************************************/
+void tftp_rx_start(tftp_rx_t *pRx, unsigned char *stage, unsigned int stage_size, unsigned int base, unsigned int limit)
+{
+	memset(pRx, 0, sizeof(tftp_rx_t));
+	pRx->blksize = TFTP_BLKSIZE_DEFAULT;
+	pRx->windowsize = 1;
+	pRx->expect = 1;
+	pRx->base = base;
+	pRx->limit = limit;
+	pRx->stage = stage;
+	pRx->stage_size = stage_size;
+	pRx->stage_off = base;
+}
+
+void tftp_rx_options(tftp_rx_t *pRx, unsigned int blksize, unsigned int windowsize)
+{
+	pRx->blksize = blksize;
+	pRx->windowsize = windowsize;
+}
+
+/**************************************************************************
+  * @brief  take one DATA packet. Only the last block of a window is ACKed,
+  *         a lost or reordered block ACKs the last block in order once,
+  *         which restarts the window. Data below base is compared with the
+  *         flash, the rest is staged and a full half handed to the writer.
+  * @param  block, pData, length: block number and payload of the packet
+  *         ack: block to ACK for TFTP_RX_RESYNC/ACK/LAST
+  * @retval TFTP_RX_xxx
+  *************************************************************************/
+int tftp_rx_data(tftp_rx_t *pRx, const tftp_rx_port_t *pPort, unsigned short block,
+	const unsigned char *pData, unsigned int length, unsigned short *ack)
+{
+	unsigned int offset, skip, count;
+
+	if(block != (unsigned short)pRx->expect) {
+		if(pRx->nak_sent)
+			return TFTP_RX_IGNORE;
+		*ack = (unsigned short)(pRx->expect - 1);
+		pRx->nak_sent = 1;
+		pRx->wincnt = 0;
+		return TFTP_RX_RESYNC;
+	}
+	pRx->nak_sent = 0;
+
+	offset = (pRx->expect - 1) * pRx->blksize;
+	if(offset + length > pRx->limit)
+		return TFTP_RX_ERR_SIZE;
+
+	/* Data already in flash from an interrupted transfer is only verified */
+	skip = 0;
+	if(offset < pRx->base) {
+		skip = (pRx->base - offset < length) ? (pRx->base - offset) : length;
+		if(pPort->Verify(offset, pData, skip) != 0)
+			return TFTP_RX_ERR_CHANGED;
+	}
+	while(skip < length) {
+		count = pRx->stage_size - pRx->stage_len;
+		if(count > length - skip)
+			count = length - skip;
+		memcpy(&pRx->stage[pRx->stage_idx * pRx->stage_size + pRx->stage_len], &pData[skip], count);
+		pRx->stage_len += count;
+		skip += count;
+		if(pRx->stage_len == pRx->stage_size) {
+			/* Hand the full half to the writer and keep receiving into the other one */
+			if(pPort->Post(&pRx->stage[pRx->stage_idx * pRx->stage_size], pRx->stage_off, pRx->stage_len) != 0)
+				return TFTP_RX_ERR_FLASH;
+			pRx->stage_idx ^= 1;
+			pRx->stage_off += pRx->stage_len;
+			pRx->stage_len = 0;
+		}
+	}
+	pRx->received = offset + length;
+
+	*ack = block;
+	if(length < pRx->blksize)
+		return TFTP_RX_LAST;
+	pRx->expect++;
+	if(++pRx->wincnt >= pRx->windowsize) {
+		pRx->wincnt = 0;
+		return TFTP_RX_ACK;
+	}
+	return TFTP_RX_ACCEPT;
+}
+
+/* Nothing came, the block to ACK so the window restarts after the last one in order */
+unsigned short tftp_rx_timeout(tftp_rx_t *pRx)
+{
+	pRx->wincnt = 0;
+	pRx->nak_sent = 0;
+	return (unsigned short)(pRx->expect - 1);
+}
+
+/* Hand the partial half to the writer, every block received in order is kept for resume */
+int tftp_rx_flush(tftp_rx_t *pRx, const tftp_rx_port_t *pPort)
+{
+	if(pRx->stage_len == 0)
+		return 0;
+	if(pPort->Post(&pRx->stage[pRx->stage_idx * pRx->stage_size], pRx->stage_off, pRx->stage_len) != 0)
+		return TFTP_RX_ERR_FLASH;
+	pRx->stage_idx ^= 1;
+	pRx->stage_off += pRx->stage_len;
+	pRx->stage_len = 0;
+	return 0;
+}
+
+/* Bytes to erase for an image of 'size' bytes, whole sectors, 0: size unknown */
+unsigned int tftp_rx_erase_size(unsigned int size, unsigned int limit, unsigned int sector)
+{
+	unsigned int need;
+
+	if((size == 0) || (size > limit))
+		size = limit;
+	need = (size + sector - 1) & ~(sector - 1);
+	if(need > limit)
+		need = limit;
+	return need;
+}
@@ -0,0 +1,50 @@
+/*************************************************************
+ * Filename     : tftp_rx.h
+ * Description  : TFTP download window, resume and staging
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#ifndef _TFTP_RX_H
+#define _TFTP_RX_H
+
+/* Result of one DATA packet, what to send back */
+#define TFTP_RX_IGNORE			0	/* out of order, already ACKed in this window */
+#define TFTP_RX_RESYNC			1	/* out of order, ACK the last block in order */
+#define TFTP_RX_ACCEPT			2	/* in order */
+#define TFTP_RX_ACK				3	/* in order and the window is full, ACK it */
+#define TFTP_RX_LAST			4	/* in order and the last one, ACK it */
+#define TFTP_RX_ERR_SIZE		-1	/* beyond the upgrade area */
+#define TFTP_RX_ERR_CHANGED		-2	/* differs from the data in flash */
+#define TFTP_RX_ERR_FLASH		-3	/* the writer failed */
+
+/* What the receiver needs from the board */
+typedef struct {
+	int (*Verify)(unsigned int offset, const unsigned char *pData, unsigned int len);	/* 0 when flash holds it */
+	int (*Post)(unsigned char *pBuf, unsigned int offset, unsigned int len);			/* 0 when taken by the writer */
+} tftp_rx_port_t;
+
+typedef struct {
+	unsigned int blksize;
+	unsigned int windowsize;
+	unsigned int expect;		/* next block number in order */
+	unsigned int wincnt;		/* blocks in order since the last ACK */
+	unsigned int nak_sent;		/* out of order ACK sent in this window */
+	unsigned int base;			/* bytes in flash from an interrupted transfer */
+	unsigned int limit;			/* size of the upgrade area */
+	unsigned int received;		/* bytes received in order */
+	unsigned char *stage;		/* two halves of stage_size */
+	unsigned int stage_size;
+	unsigned int stage_idx;
+	unsigned int stage_len;
+	unsigned int stage_off;		/* image offset of the half being filled */
+} tftp_rx_t;
+
+void tftp_rx_start(tftp_rx_t *pRx, unsigned char *stage, unsigned int stage_size, unsigned int base, unsigned int limit);
+void tftp_rx_options(tftp_rx_t *pRx, unsigned int blksize, unsigned int windowsize);
+int tftp_rx_data(tftp_rx_t *pRx, const tftp_rx_port_t *pPort, unsigned short block,
+	const unsigned char *pData, unsigned int length, unsigned short *ack);
+unsigned short tftp_rx_timeout(tftp_rx_t *pRx);
+int tftp_rx_flush(tftp_rx_t *pRx, const tftp_rx_port_t *pPort);
+unsigned int tftp_rx_erase_size(unsigned int size, unsigned int limit, unsigned int sector);
+
+#endif	/* _TFTP_RX_H */
@@ -1146,6 +1146,65 @@ static handlerDefn mConfigTraffic_statisticHandlers[] =
 Traffic statistic configuration\
 "
 
+static DTTypeInfo mConfigTraffic_window_ShortInfo =
+{
+    "Short average window, range <1-255> s",
+    NULL,
+    kDTuchar,
+    "L=1 U=255",
+    0,
+    NULL,
+    NULL,
+    NULL
+};
+
+static DTTypeInfo mConfigTraffic_window_MediumInfo =
+{
+    "Medium average window, range <1-255> s",
+    NULL,
+    kDTuchar,
+    "L=1 U=255",
+    0,
+    NULL,
+    NULL,
+    NULL
+};
+
+static DTTypeInfo mConfigTraffic_window_LongInfo =
+{
+    "Long average window, range <1-255> s",
+    NULL,
+    kDTuchar,
+    "L=1 U=255",
+    0,
+    NULL,
+    NULL,
+    NULL
+};
+
+static paramDefn mConfigTraffic_windowParams[] =
+{
+    { "short", kDTuchar, mConfigTraffic_window_Short, 0|kRCC_PARAMETER_NOKEYWORD, &mConfigTraffic_window_ShortInfo },
+    { "medium", kDTuchar, mConfigTraffic_window_Medium, 0|kRCC_PARAMETER_NOKEYWORD, &mConfigTraffic_window_MediumInfo },
+    { "long", kDTuchar, mConfigTraffic_window_Long, 0|kRCC_PARAMETER_NOKEYWORD, &mConfigTraffic_window_LongInfo }
+};
+
+static paramEntry mConfigTraffic_windowParamArray[] =
+{
+    {mConfigTraffic_window_Short, kRCC_PARAMETER_OPTIONAL },
+    {mConfigTraffic_window_Medium, kRCC_PARAMETER_OPTIONAL },
+    {mConfigTraffic_window_Long, kRCC_PARAMETER_OPTIONAL }
+};
+
+static handlerDefn mConfigTraffic_windowHandlers[] =
+{
+    { 0, rcc_config_traffic_window, 3, mConfigTraffic_windowParamArray }
+};
+
+#define kConfigTraffic_windowHelp "\
+Config the traffic average windows(s)\
+"
+
 static DTEnumInfo mConfigTrapAdd_TrapTypeTbl[] =
 {
     {"REBOOT",ENUM_CONFIGTRAPADDTRAPTYPE_REBOOT,ENMA_CONFIGTRAPADDTRAPTYPE_REBOOT},
@@ -1289,6 +1348,51 @@ static cmdNode mConfigTrapChildren[] =
 Local trap configuration\
 "
 
+static DTTypeInfo mConfigUart_framegap_PortInfo =
+{
+    "Uart port (port=0,1)",
+    NULL,
+    kDTuchar,
+    "L=0 U=1",
+    0,
+    NULL,
+    NULL,
+    NULL
+};
+
+static DTTypeInfo mConfigUart_framegap_GapInfo =
+{
+    "Inter-character frame gap, range <0-1000> ms, 0 = idle line",
+    NULL,
+    kDTushort,
+    "L=0 U=1000",
+    0,
+    NULL,
+    NULL,
+    NULL
+};
+
+static paramDefn mConfigUart_framegapParams[] =
+{
+    { "port", kDTuchar, mConfigUart_framegap_Port, 0|kRCC_PARAMETER_NOKEYWORD, &mConfigUart_framegap_PortInfo },
+    { "gap", kDTushort, mConfigUart_framegap_Gap, 0|kRCC_PARAMETER_NOKEYWORD, &mConfigUart_framegap_GapInfo }
+};
+
+static paramEntry mConfigUart_framegapParamArray[] =
+{
+    {mConfigUart_framegap_Port, kRCC_PARAMETER_REQUIRED },
+    {mConfigUart_framegap_Gap, kRCC_PARAMETER_OPTIONAL }
+};
+
+static handlerDefn mConfigUart_framegapHandlers[] =
+{
+    { 0, rcc_config_uart_framegap, 2, mConfigUart_framegapParamArray }
+};
+
+#define kConfigUart_framegapHelp "\
+Config the uart server frame gap(ms)\
+"
+
 static DTTypeInfo mConfigUserAccess_NameInfo =
 {
     "Login",
@@ -1462,7 +1566,9 @@ static cmdNode mConfigChildren[] =
     { "rate-limit", kConfigRate_limitHelp, NULL, 0, NULL, 0, 0, NULL, 0, NULL, 0, NULL },
     { "signal", kConfigSignalHelp, NULL, kRCC_COMMAND_MODE, "config-signal", 0, 7, mConfigSignalChildren, 0, NULL, 1, mConfigSignalHandlers },
     { "traffic-statistic", kConfigTraffic_statisticHelp, NULL, kRCC_COMMAND_CUSTOM1, NULL, 0, 0, NULL, 1, mConfigTraffic_statisticParams, 1, mConfigTraffic_statisticHandlers },
+    { "traffic-window", kConfigTraffic_windowHelp, NULL, kRCC_COMMAND_CUSTOM1, NULL, 0, 0, NULL, 3, mConfigTraffic_windowParams, 1, mConfigTraffic_windowHandlers },
     { "trap", kConfigTrapHelp, NULL, 0, NULL, 0, 5, mConfigTrapChildren, 0, NULL, 0, NULL },
+    { "uart-framegap", kConfigUart_framegapHelp, NULL, kRCC_COMMAND_CUSTOM1, NULL, 0, 0, NULL, 2, mConfigUart_framegapParams, 1, mConfigUart_framegapHandlers },
     { "user", kConfigUserHelp, NULL, 0, NULL, 0, 5, mConfigUserChildren, 0, NULL, 0, NULL }
 };
 
@@ -2591,7 +2697,7 @@ Show command tree\
 static cmdNode mRootChildren[] =
 { 
     { "clear", kClearHelp, NULL, 0, NULL, 0 |ENUM_ACCESS_ENABLE, 2, mClearChildren, 0, NULL, 0, NULL },
-    { "config", kConfigHelp, NULL, kRCC_COMMAND_MODE, "config", 0 |ENUM_ACCESS_ENABLE, 11, mConfigChildren, 0, NULL, 0, NULL },
+    { "config", kConfigHelp, NULL, kRCC_COMMAND_MODE, "config", 0 |ENUM_ACCESS_ENABLE, 13, mConfigChildren, 0, NULL, 0, NULL },
     { "debug", kDebugHelp, NULL, kRCC_COMMAND_MODE, "debug", 0 |ENUM_ACCESS_ENABLE, 6, mDebugChildren, 0, NULL, 0, NULL },
     { "enable", kEnableHelp, NULL, kRCC_COMMAND_NO|kRCC_COMMAND_CUSTOM1, NULL, 0, 0, NULL, 0, NULL, 1, mEnableHandlers },
     { "exit", kExitHelp, NULL, kRCC_COMMAND_GLOBAL|kRCC_COMMAND_CUSTOM1, NULL, 0, 0, NULL, 1, mExitParams, 1, mExitHandlers },
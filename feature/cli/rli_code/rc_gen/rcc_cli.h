@@ -92,6 +92,9 @@
 #define ENUM_CONFIGSIGNALWORKMODEMODE_TCP (ENUM_CONFIGSIGNALWORKMODEMODE_UDP + 1)
 #define ENMA_CONFIGSIGNALWORKMODEMODE_TCP 0
 #define mConfigTraffic_statistic_Port_list 1
+#define mConfigTraffic_window_Short    1
+#define mConfigTraffic_window_Medium   2
+#define mConfigTraffic_window_Long     3
 #define mConfigTrapAdd_TrapType        1
 #define ENUM_CONFIGTRAPADDTRAPTYPE_REBOOT 1
 #define ENMA_CONFIGTRAPADDTRAPTYPE_REBOOT 0
@@ -115,6 +118,8 @@
 #define ENUM_CONFIGTRAPDELETETRAPTYPE_TRAFFIC (ENUM_CONFIGTRAPDELETETRAPTYPE_VOL + 1)
 #define ENMA_CONFIGTRAPDELETETRAPTYPE_TRAFFIC 0
 #define mConfigTrapServer_mac_Mac_addr 1
+#define mConfigUart_framegap_Port      1
+#define mConfigUart_framegap_Gap       2
 #define mConfigUserAccess_Name         1
 #define mConfigUserAccess_Access       2
 #define mConfigUserAdd_Name            1
@@ -545,6 +545,18 @@ rcc_config_traffic_statistic(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBu
 
 /*-----------------------------------------------------------------------------------*/
 
+extern RLSTATUS 
+rcc_config_traffic_window(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
+{
+    RLSTATUS    status = OK;
+
+    status = cli_config_traffic_window_handler(pCliEnv, pParams, pAuxBuf);
+
+    return status;
+}
+
+/*-----------------------------------------------------------------------------------*/
+
 extern RLSTATUS 
 rcc_config_trap_add(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
 {
@@ -617,6 +629,20 @@ rcc_config_trap_show(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
 
 /*-----------------------------------------------------------------------------------*/
 
+extern RLSTATUS 
+rcc_config_uart_framegap(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
+{
+    RLSTATUS    status = OK;
+
+#if MODULE_UART_SERVER
+    status = cli_config_uart_framegap_handler(pCliEnv, pParams, pAuxBuf);
+#endif
+
+    return status;
+}
+
+/*-----------------------------------------------------------------------------------*/
+
 extern RLSTATUS 
 RCC_EXEC_UserAccess(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf)
 {
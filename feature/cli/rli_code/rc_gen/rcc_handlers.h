@@ -51,12 +51,14 @@ extern RLSTATUS rcc_samp_cycle_config(cli_env *pCliEnv, paramList *pParams, sbyt
 extern RLSTATUS rcc_config_signal_show(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_work_mode_cofig(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_config_traffic_statistic(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
+extern RLSTATUS rcc_config_traffic_window(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_config_trap_add(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_config_trap_delete(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_config_trap_enable(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_config_trap_no_enable(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_config_trap_server_mac(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS rcc_config_trap_show(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
+extern RLSTATUS rcc_config_uart_framegap(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS RCC_EXEC_UserAccess(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS RCC_EXEC_UserAdd(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
 extern RLSTATUS RCC_EXEC_UserDelete(cli_env *pCliEnv, paramList *pParams, sbyte *pAuxBuf);
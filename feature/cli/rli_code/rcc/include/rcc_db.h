@@ -70,6 +70,7 @@ extern sbyte4   RCC_DB_GetParamCount(cli_env *pCliEnv, cmdNode *pNode);
 extern cmdNode *RCC_DB_GetParentNode(cli_env *pCliEnv, cmdNode *pNode);
 extern cmdNode *RCC_DB_GetRootNode(void);
 extern RLSTATUS RCC_DB_InitTasks(void);
+extern RLSTATUS RCC_DB_IndexTree(void);
 extern void     RCC_DB_InvalidParam(cli_env *pCliEnv, BitMask paramMask);
 extern Boolean  RCC_DB_IsAssigned(cli_env *pCliEnv, void *item);
 extern Boolean  RCC_DB_IsNoCommand(paramList  *pParamList);
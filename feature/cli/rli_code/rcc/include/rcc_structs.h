@@ -208,6 +208,7 @@ typedef struct cmdNode
     paramDefn      *pParams;  
     sbyte2          numHandlers;
     handlerDefn    *pHandlers;
+    sbyte2         *pIndex;     /* children by keyword, see RCC_DB_IndexTree */
 } cmdNode;
 
 /*-----------------------------------------------------------------------*/
@@ -131,6 +131,7 @@ extern RLSTATUS  RCC_TELNET_Init(cli_env *pCliEnv);
 extern Boolean   RCC_TELNET_Process(cli_env *pCliEnv, cliChar data);
 extern RLSTATUS  RCC_TELNET_Recv(cli_env *pEnv, cliChar *charIn);
 extern RLSTATUS  RCC_TELNET_Send(cli_env *pEnv, sbyte *pBuf, sbyte4  bufLen);
+extern RLSTATUS  RCC_TELNET_Flush(cli_env *pEnv);
 extern optAction RCC_TELNET_StateChange(cli_env *pCliEnv, sbyte from, optType option, optAction action);
 extern void      RCC_TELNET_StartSession(void * socketPtr);
 extern void      RCC_TELNET_Status(cli_env *pCliEnv);
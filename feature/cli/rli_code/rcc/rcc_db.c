@@ -91,6 +91,13 @@
 
 #define DB_ERROR(x)     ((OK != x) && (STATUS_RCC_TOKEN_MATCH != x))
 
+/* child lists at least this long get a sorted keyword index */
+#ifndef kRCC_NODE_INDEX_MIN
+#define kRCC_NODE_INDEX_MIN     4
+#endif
+#define kRCC_NODE_INDEX_DEPTH   32
+#define kRCC_NODE_MATCH_MAX     16
+
 typedef struct cliTask
 {
     sbyte4              count;
@@ -821,6 +828,68 @@ extern RLSTATUS RCC_DB_InitTasks(void)
 
 /*-----------------------------------------------------------------------*/
 
+/*
+ * The index of a node lists the children with a keyword sorted by
+ * keyword, ties in declaration order. pIndex[0] is the entry count.
+ */
+RL_STATIC RLSTATUS
+DB_IndexNode(cmdNode *pNode, sbyte4 depth)
+{
+    RLSTATUS  status = OK;
+    sbyte2   *pOrder;
+    sbyte2    count  = 0;
+    sbyte2    entry;
+    sbyte4    index;
+    sbyte4    slot;
+
+    if ((NULL == pNode) || (kRCC_NODE_INDEX_DEPTH < depth))
+        return OK;
+
+    if ((NULL == pNode->pIndex) && (kRCC_NODE_INDEX_MIN <= pNode->numChildren))
+    {
+        if (NULL == (pOrder = RC_MALLOC(sizeof(sbyte2) * (pNode->numChildren + 1))))
+            return RCC_ERROR_THROW(SYS_ERROR_NO_MEMORY);
+
+        /* insertion sort, the lists are short and built once */
+        for (index = 0; index < pNode->numChildren; index++)
+        {
+            if (NULL == pNode->pChildren[index].pKeyword)
+                continue;
+
+            for (slot = count; 0 < slot; slot--)
+            {
+                entry = pOrder[slot];
+                if (0 >= COMPARE(pNode->pChildren[entry].pKeyword, 
+                                 pNode->pChildren[index].pKeyword))
+                    break;
+                pOrder[slot + 1] = entry;
+            }
+            pOrder[slot + 1] = (sbyte2) index;
+            count++;
+        }
+        pOrder[0]      = count;
+        pNode->pIndex  = pOrder;
+    }
+
+    for (index = 0; index < pNode->numChildren; index++)
+    {
+        if (OK != (status = DB_IndexNode(&pNode->pChildren[index], depth + 1)))
+            break;
+    }
+
+    return status;
+}
+
+/*-----------------------------------------------------------------------*/
+
+extern RLSTATUS 
+RCC_DB_IndexTree(void)
+{
+    return DB_IndexNode(RCC_DB_GetRootNode(), 0);
+}
+
+/*-----------------------------------------------------------------------*/
+
 extern void 
 RCC_DB_FreeTasks(void)
 {
@@ -1671,9 +1740,117 @@ DB_MemberElement(paramDefn *pParam, sbyte *pText, Boolean exact)
 
 /*-----------------------------------------------------------------------*/
 
-RL_STATIC cmdNode *
-DB_NodeMatch(cli_env *pCliEnv, cmdNode *pParent, 
-             Boolean global, Boolean exact, sbyte4 *matchCount)
+/* first index position whose keyword does not sort below pText */
+
+RL_STATIC sbyte4
+DB_IndexLowerBound(cmdNode *pParent, sbyte *pText)
+{
+    sbyte2 *pOrder = &pParent->pIndex[1];
+    sbyte4  low    = 0;
+    sbyte4  high   = pParent->pIndex[0];
+    sbyte4  middle;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+        if (0 > COMPARE(pParent->pChildren[pOrder[middle]].pKeyword, pText))
+            low  = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/*-----------------------------------------------------------------------*/
+
+/*
+ * Same result as the linear walk in DB_NodeMatch, through the keyword index.
+ * Keywords beginning with the token are contiguous from the lower bound. 
+ * Partial matches are reported in declaration order as before.
+ * Returns FALSE if the node has no index, the caller walks the list then.
+ */
+RL_STATIC Boolean
+DB_IndexMatch(cli_env *pCliEnv, cmdNode *pParent, Boolean global, 
+              Boolean exact, sbyte4 *matchCount, cmdNode **ppMatchNode)
+{
+    tokenTable *pTokens  = DB_GetTokenTable(pCliEnv);
+    sbyte2     *pOrder;
+    sbyte      *pText;
+    cmdNode    *pChild;
+    sbyte4      count;
+    sbyte4      position;
+    sbyte4      length;
+    sbyte4      found    = 0;
+    sbyte4      slot;
+    sbyte2      matches[kRCC_NODE_MATCH_MAX];
+
+    if ((NULL == pParent->pIndex) || (NULL == pTokens))
+        return FALSE;
+
+    if (NULL == (pText = DB_TokenString(pTokens)))
+        return FALSE;
+
+    pOrder   = &pParent->pIndex[1];
+    count    = pParent->pIndex[0];
+    length   = DB_TokenLength(pTokens);
+    position = DB_IndexLowerBound(pParent, pText);
+
+    for (; position < count; position++)
+    {
+        pChild = &pParent->pChildren[pOrder[position]];
+
+        if (exact)
+        {
+            if (0 != COMPARE(pText, pChild->pKeyword))
+                break;
+        }
+        else
+        {
+            if (0 != NCOMPARE(pText, pChild->pKeyword, length))
+                break;
+            if (0 == COMPARE(pText, pChild->pKeyword))
+                continue;
+        }
+
+        if (! MMISC_ValidGlobal(pChild, global))
+            continue;
+
+        if (! RC_ACCESS_Allowed(pChild->accessLvl, MMISC_GetAccess(pCliEnv)))
+		    continue;
+
+        if (exact)
+        {
+            /* ties are in declaration order, first one wins */
+            (*matchCount)++;
+            *ppMatchNode = pChild;
+            return TRUE;
+        }
+
+        if (kRCC_NODE_MATCH_MAX == found)
+            return FALSE;
+
+        for (slot = found; (0 < slot) && (matches[slot - 1] > pOrder[position]); slot--)
+            matches[slot] = matches[slot - 1];
+        matches[slot] = pOrder[position];
+        found++;
+    }
+
+    for (slot = 0; slot < found; slot++)
+    {
+        pChild = &pParent->pChildren[matches[slot]];
+        (*matchCount)++;
+        *ppMatchNode = pChild;
+        DB_AddMatch(pCliEnv, pChild->pKeyword);
+    }
+
+    return TRUE;
+}
+
+/*-----------------------------------------------------------------------*/
+
+RL_STATIC cmdNode *
+DB_NodeMatch(cli_env *pCliEnv, cmdNode *pParent, 
+             Boolean global, Boolean exact, sbyte4 *matchCount)
 { 
     sbyte4      index;
     sbyte4      globalMatch;
@@ -1691,31 +1868,34 @@ DB_NodeMatch(cli_env *pCliEnv, cmdNode *pParent,
     if (! exact && FLAG_SET(pParent, kRCC_COMMAND_EXACT_NODE))
         return NULL;
 
-    for (index = 0; index < pParent->numChildren; index++, pChild++) 
+    if (! DB_IndexMatch(pCliEnv, pParent, global, exact, matchCount, &pMatchNode))
     {
-        if (! MMISC_ValidGlobal(pChild, global))
-            continue;
+        for (index = 0; index < pParent->numChildren; index++, pChild++) 
+        {
+            if (! MMISC_ValidGlobal(pChild, global))
+                continue;
 
-        if (! RC_ACCESS_Allowed(pChild->accessLvl, MMISC_GetAccess(pCliEnv)))
-		    continue;
+            if (! RC_ACCESS_Allowed(pChild->accessLvl, MMISC_GetAccess(pCliEnv)))
+    		    continue;
 
-        if (exact)
-        {
-            if (DB_TokenMatches(pTokens, pChild->pKeyword))
+            if (exact)
             {
-                (*matchCount)++;
-                pMatchNode = pChild;
-                break;
+                if (DB_TokenMatches(pTokens, pChild->pKeyword))
+                {
+                    (*matchCount)++;
+                    pMatchNode = pChild;
+                    break;
+                }
             }
-        }
-        else
-        {
-            if (  DB_TokenBegins(pTokens, pChild->pKeyword) &&
-                ! DB_TokenMatches(pTokens, pChild->pKeyword))
+            else
             {
-                (*matchCount)++;
-                pMatchNode = pChild;
-                DB_AddMatch(pCliEnv, pChild->pKeyword);
+                if (  DB_TokenBegins(pTokens, pChild->pKeyword) &&
+                    ! DB_TokenMatches(pTokens, pChild->pKeyword))
+                {
+                    (*matchCount)++;
+                    pMatchNode = pChild;
+                    DB_AddMatch(pCliEnv, pChild->pKeyword);
+                }
             }
         }
     }
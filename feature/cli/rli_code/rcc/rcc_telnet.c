@@ -23,6 +23,9 @@
 #include "task.h"
 #include "queue.h"
 #include "semphr.h"
+
+/* LwIP include */
+#include "lwip/opt.h"
 #endif
 
 #ifndef __USE_OTHER_TELNETD__
@@ -40,6 +43,33 @@
 static FILE *telnetDebug;
 #endif /* __RCC_DEBUG_TELNET__ */
 
+#ifdef __FreeRTOS_OS__
+/* 
+ * Telnet output is coalesced per session up to one TCP segment. It is sent
+ * when the buffer is full, before the session waits for input (prompt, more),
+ * kRCC_TELNET_FLUSH_MS after the first byte was buffered and at logout. 
+ * A full buffer is sent by the writer itself, so a slow peer holds back the 
+ * producing command instead of losing output.
+ */
+#define kRCC_TELNET_OUT_SIZE    TCP_MSS
+#define kRCC_TELNET_FLUSH_MS    20
+
+typedef struct TelnetOutput
+{
+    OS_SPECIFIC_MUTEX           mutex;
+    OS_SPECIFIC_SOCKET_HANDLE   sock;
+    Boolean                     active;
+    sbyte4                      length;
+    sbyte                       buffer[kRCC_TELNET_OUT_SIZE];
+} TelnetOutput;
+
+static TelnetOutput     mTelnetOutput[kRCC_MAX_CLI_TASK];
+static xSemaphoreHandle xTelnetFlushSem = NULL;
+
+RL_STATIC RLSTATUS TELNET_OutputOpen(CliChannel *pChannel);
+RL_STATIC void     TELNET_OutputClose(CliChannel *pChannel);
+#endif /* __FreeRTOS_OS__ */
+
 typedef struct OptInit
 {
     optType   option;
@@ -534,6 +564,10 @@ extern RLSTATUS RCC_TELNET_Init(cli_env *pCliEnv)
 
     MEMSET(MMISC_GetOptHandled(pCliEnv), 0, optSize);
 
+#ifdef __FreeRTOS_OS__
+    TELNET_OutputOpen(MMISC_GetChannel(pCliEnv));
+#endif
+
     TELNET_Required(pCliEnv);
 
     return OK;
@@ -591,6 +625,193 @@ TELNET_SaveOption(cli_env *pCliEnv)
 
 /*-----------------------------------------------------------------------*/
 
+#ifdef __FreeRTOS_OS__
+
+RL_STATIC TelnetOutput *
+TELNET_OutputPtr(CliChannel *pChannel)
+{
+    if ((NULL == pChannel) || (1 > pChannel->index) || 
+        (kRCC_MAX_CLI_TASK < pChannel->index))
+        return NULL;
+
+    return &mTelnetOutput[pChannel->index - 1];
+}
+
+/*-----------------------------------------------------------------------*/
+
+/* call with the output mutex held */
+
+RL_STATIC RLSTATUS
+TELNET_OutputFlush(TelnetOutput *pOutput)
+{
+    RLSTATUS status = OK;
+
+    if (0 < pOutput->length)
+        status = OS_SPECIFIC_SOCKET_WRITE(pOutput->sock, pOutput->buffer, 
+                                          pOutput->length);
+    pOutput->length = 0;
+
+    return status;
+}
+
+/*-----------------------------------------------------------------------*/
+
+RL_STATIC void
+TELNET_FlushTask(void *pArg)
+{
+    sbyte4        index;
+    TelnetOutput *pOutput;
+
+    while (1)
+    {
+        /* armed by the first byte put into an empty buffer */
+        xSemaphoreTake(xTelnetFlushSem, portMAX_DELAY);
+        vTaskDelay(kRCC_TELNET_FLUSH_MS / portTICK_RATE_MS);
+
+        for (index = 0; index < kRCC_MAX_CLI_TASK; index++)
+        {
+            pOutput = &mTelnetOutput[index];
+
+            if (NULL == pOutput->mutex)
+                continue;
+
+            OS_SPECIFIC_MUTEX_WAIT(pOutput->mutex);
+            if (pOutput->active)
+                TELNET_OutputFlush(pOutput);
+            OS_SPECIFIC_MUTEX_RELEASE(pOutput->mutex);
+        }
+    }
+}
+
+/*-----------------------------------------------------------------------*/
+
+RL_STATIC RLSTATUS
+TELNET_OutputOpen(CliChannel *pChannel)
+{
+    TelnetOutput *pOutput = TELNET_OutputPtr(pChannel);
+
+    if (NULL == pOutput)
+        return OK;
+
+    if (NULL == xTelnetFlushSem)
+    {
+        vSemaphoreCreateBinary(xTelnetFlushSem);
+        if (NULL == xTelnetFlushSem)
+            return RCC_ERROR_THROW(SYS_ERROR_NO_MEMORY);
+        xSemaphoreTake(xTelnetFlushSem, 0);
+
+        if (pdPASS != xTaskCreate(TELNET_FlushTask, (signed char const *) "tTelOut", 
+                                  configMINIMAL_STACK_SIZE * 2 + LWIP_API_STACK_EXTRA, NULL, 
+                                  kSTANDARD_RC_THREAD_PRIO, NULL))
+            return RCC_ERROR_THROW(ERROR_GENERAL_CREATE_TASK);
+    }
+
+    if (NULL == pOutput->mutex)
+    {
+        if (OK != OS_SPECIFIC_MUTEX_CREATE(&pOutput->mutex))
+            return RCC_ERROR_THROW(SYS_ERROR_MUTEX_CREATE);
+    }
+
+    OS_SPECIFIC_MUTEX_WAIT(pOutput->mutex);
+    pOutput->sock   = pChannel->sock;
+    pOutput->length = 0;
+    pOutput->active = TRUE;
+    OS_SPECIFIC_MUTEX_RELEASE(pOutput->mutex);
+
+    return OK;
+}
+
+/*-----------------------------------------------------------------------*/
+
+RL_STATIC void
+TELNET_OutputClose(CliChannel *pChannel)
+{
+    TelnetOutput *pOutput = TELNET_OutputPtr(pChannel);
+
+    if ((NULL == pOutput) || (NULL == pOutput->mutex))
+        return;
+
+    OS_SPECIFIC_MUTEX_WAIT(pOutput->mutex);
+    if (pOutput->active)
+        TELNET_OutputFlush(pOutput);
+    pOutput->active = FALSE;
+    OS_SPECIFIC_MUTEX_RELEASE(pOutput->mutex);
+}
+
+/*-----------------------------------------------------------------------*/
+
+extern RLSTATUS 
+RCC_TELNET_Flush(cli_env *pEnv)
+{
+    TelnetOutput *pOutput = TELNET_OutputPtr(MMISC_GetChannel(pEnv));
+    RLSTATUS      status  = OK;
+
+    if ((NULL == pOutput) || (NULL == pOutput->mutex))
+        return OK;
+
+    OS_SPECIFIC_MUTEX_WAIT(pOutput->mutex);
+    if (pOutput->active)
+        status = TELNET_OutputFlush(pOutput);
+    OS_SPECIFIC_MUTEX_RELEASE(pOutput->mutex);
+
+    return status;
+}
+
+/*-----------------------------------------------------------------------*/
+
+extern RLSTATUS 
+RCC_TELNET_Send(cli_env *pEnv, sbyte *pBuf, sbyte4 BufLen)
+{
+    CliChannel   *pChannel = MMISC_GetChannel(pEnv);
+    TelnetOutput *pOutput  = TELNET_OutputPtr(pChannel);
+    RLSTATUS      status   = OK;
+    Boolean       arm      = FALSE;
+    sbyte4        chunk;
+
+    if ((NULL == pOutput) || (NULL == pOutput->mutex) || !pOutput->active)
+        return OS_SPECIFIC_SOCKET_WRITE(pChannel->sock, pBuf, BufLen);
+
+    OS_SPECIFIC_MUTEX_WAIT(pOutput->mutex);
+
+    while (0 < BufLen)
+    {
+        if (kRCC_TELNET_OUT_SIZE == pOutput->length)
+        {
+            if (OK != (status = TELNET_OutputFlush(pOutput)))
+                break;
+        }
+
+        /* nothing to coalesce with, a full segment goes out as is */
+        if ((0 == pOutput->length) && (kRCC_TELNET_OUT_SIZE <= BufLen))
+        {
+            chunk  = BufLen - (BufLen % kRCC_TELNET_OUT_SIZE);
+            if (OK != (status = OS_SPECIFIC_SOCKET_WRITE(pOutput->sock, pBuf, chunk)))
+                break;
+            pBuf   += chunk;
+            BufLen -= chunk;
+            continue;
+        }
+
+        if (0 == pOutput->length)
+            arm = TRUE;
+
+        chunk = RC_MIN(BufLen, kRCC_TELNET_OUT_SIZE - pOutput->length);
+        MEMCPY(&pOutput->buffer[pOutput->length], pBuf, chunk);
+        pOutput->length += chunk;
+        pBuf            += chunk;
+        BufLen          -= chunk;
+    }
+
+    OS_SPECIFIC_MUTEX_RELEASE(pOutput->mutex);
+
+    if (arm)
+        xSemaphoreGive(xTelnetFlushSem);
+
+    return status;
+}
+
+#else /* ! __FreeRTOS_OS__ */
+
 extern RLSTATUS 
 RCC_TELNET_Send(cli_env *pEnv, sbyte *pBuf, sbyte4 BufLen)
 {
@@ -600,12 +821,19 @@ RCC_TELNET_Send(cli_env *pEnv, sbyte *pBuf, sbyte4 BufLen)
     return OS_SPECIFIC_SOCKET_WRITE(sock, pBuf, BufLen);
 }
 
+extern RLSTATUS 
+RCC_TELNET_Flush(cli_env *pEnv)
+{
+    return OK;
+}
+
+#endif /* __FreeRTOS_OS__ */
+
 /*-----------------------------------------------------------------------*/
 
 RL_STATIC void 
 TELNET_Request(cli_env *pCliEnv, optType option)
 {
-    CliChannel *pChannel  = MMISC_GetChannel(pCliEnv);
     ubyte       command[] = {kRCC_TC_IAC, kRCC_TC_SB, 0, 
                              1, kRCC_TC_IAC, kRCC_TC_SE};
 
@@ -620,7 +848,7 @@ TELNET_Request(cli_env *pCliEnv, optType option)
 
     command[2] = option;
 
-    OS_SPECIFIC_SOCKET_WRITE(pChannel->sock, (sbyte *) command, sizeof(command));
+    RCC_TELNET_Send(pCliEnv, (sbyte *) command, sizeof(command));
 }
 
 /*-----------------------------------------------------------------------*/
@@ -757,6 +985,11 @@ RCC_TELNET_Recv(cli_env *pCliEnv, cliChar *charReceived)
     sbyte4                      timeout = MCONN_GetTimeOut(pCliEnv);
     OS_SPECIFIC_SOCKET_HANDLE   sock    = MCONN_GetSock(pCliEnv);
 
+#ifdef __FreeRTOS_OS__
+    /* whatever is pending (prompt, echo, more) is due before waiting */
+    RCC_TELNET_Flush(pCliEnv);
+#endif
+
     while (1)
     {
     	status = OS_SPECIFIC_SOCKET_DATA_AVAILABLE (sock, timeout);
@@ -1038,6 +1271,9 @@ RCC_TELNET_StartSession(void * pSession)
                               TELNET_RECV_FN, TELNET_SEND_FN, 
                                   kRCC_CONN_TELNET, "telnet");
 
+#ifdef __FreeRTOS_OS__
+    TELNET_OutputClose(pTelnetSession);
+#endif
     SOCKET_Close(pTelnetSession->sock);
 #ifdef __FreeRTOS_OS__
 	vTaskDelete(xTelnetHandle);
@@ -585,6 +585,9 @@ extern void RCC_TELNETD()
 
     RCC_DB_InitTasks();
 
+    /* keyword lookup index, nodes left without one are walked linearly */
+    RCC_DB_IndexTree();
+
 #ifdef __RCC_CONSOLE_ENABLED__
     /* start a console thread */
     if (OK != OS_SPECIFIC_CREATE_THREAD(
@@ -12,6 +12,7 @@
 #define NVRAM_BOOT_DELAY						(NVRAM_ADDR_SPECIAL + 0x41)
 #define NVRAM_CONSOLE_ENABLE					(NVRAM_ADDR_SPECIAL + 0x42)
 #define NVRAM_CLI_LOGIN_DISABLE					(NVRAM_ADDR_SPECIAL + 0x43)
+#define NVRAM_BOOT_STATE						(NVRAM_ADDR_SPECIAL + 0x44)
 #define NVRAM_LOADER_VERSION					(NVRAM_ADDR_SPECIAL + 0x48)
 #define NVRAM_FIRMWARE_SIZE						(NVRAM_ADDR_SPECIAL + 0x50)
 #define NVRAM_FIRMWARE_CRC32					(NVRAM_ADDR_SPECIAL + 0x54)	
@@ -47,6 +48,7 @@
 #define NVRAM_STOPBITS(port)					(NVRAM_UART_CFG_BASE+0x80*port+0x0003)	
 #define NVRAM_PARITY(port)						(NVRAM_UART_CFG_BASE+0x80*port+0x0004)	
 #define NVRAM_FLOWCTRL(port)					(NVRAM_UART_CFG_BASE+0x80*port+0x0005)	
+#define NVRAM_FRAME_GAP(port)					(NVRAM_UART_CFG_BASE+0x80*port+0x0006)
 #define NVRAM_WORK_MODE(port)					(NVRAM_UART_CFG_BASE+0x80*port+0x0008)	
 #define NVRAM_UARTCFG_MODE_BASE(port)			(NVRAM_UART_CFG_BASE+0x80*port+0x0010)
 
@@ -18,6 +18,7 @@
 #include "conf_comm.h"
 #include "conf_map.h"
 #include "conf_sys.h"
+#include "ob_image.h"
 
 int conf_set_upgrade_flag(void)
 {
@@ -41,6 +42,35 @@ int conf_clear_upgrade_flag(void)
 	return CONF_ERR_NONE;
 }
 
+/* A/B boot slots: the new image is in 'slot' */
+int conf_set_upgrade_slot(u8 slot)
+{
+	u8 upgrade_flag;
+	
+	upgrade_flag = (slot == OB_SLOT_A) ? OB_UPGRADE_FLAG_SLOT_A : OB_UPGRADE_FLAG_SLOT_B;
+	if(eeprom_write(NVRAM_UPGRADE_FLAG, &upgrade_flag, 1) == I2C_FAILURE)
+		return CONF_ERR_I2C;
+	
+	return CONF_ERR_NONE;
+}
+
+/* A/B boot slots: the running slot works, stop the bootloader falling back */
+int conf_confirm_boot(void)
+{
+	u8 state;
+	
+	if(eeprom_read(NVRAM_BOOT_STATE, &state, 1) == I2C_FAILURE)
+		return CONF_ERR_I2C;
+	if(!OB_BOOT_STATE_VALID(state) || (OB_BOOT_STATE_TRIES(state) == 0))
+		return CONF_ERR_NONE;
+
+	state = OB_BOOT_STATE(OB_BOOT_STATE_SLOT(state), 0);
+	if(eeprom_write(NVRAM_BOOT_STATE, &state, 1) == I2C_FAILURE)
+		return CONF_ERR_I2C;
+	
+	return CONF_ERR_NONE;
+}
+
 int conf_cli_login_disable(void)
 {
 	u8 disable;
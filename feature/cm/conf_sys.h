@@ -8,6 +8,8 @@
 
 int conf_set_upgrade_flag(void);
 int conf_clear_upgrade_flag(void);
+int conf_set_upgrade_slot(u8 slot);
+int conf_confirm_boot(void);
 int conf_cli_login_disable(void);
 int conf_cli_login_enable(void);
 int conf_get_cli_login_switch(u8 *disable);
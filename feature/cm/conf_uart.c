@@ -116,6 +116,29 @@ int GetUartFrameSplit(u8 port, u16 *max_interval, u16 *max_datalen)
 	return CONF_ERR_I2C;
 }
 
+int GetUartFrameGap(u8 port, u16 *gap_ms)
+{
+	u16	CfgFrameGap=0;
+
+	if(eeprom_read(NVRAM_FRAME_GAP(port), (u8 *)&CfgFrameGap, 2) == I2C_SUCCESS) {
+		/* Blank eeprom, keep idle line framing */
+		if(CfgFrameGap == 0xFFFF)
+			CfgFrameGap = 0;
+		*gap_ms = CfgFrameGap;
+		return CONF_ERR_NONE;
+	} else {
+		return CONF_ERR_I2C;
+	}
+}
+
+int SetUartFrameGap(u8 port, u16 gap_ms)
+{
+	if(eeprom_write(NVRAM_FRAME_GAP(port), (u8 *)&gap_ms, 2) == I2C_SUCCESS) {
+		return CONF_ERR_NONE;
+	}
+	return CONF_ERR_I2C;
+}
+
 int GetUartModeTcpServer(u8 port, u16 *listen_port)
 {
 	if(eeprom_read(NVRAM_UARTCFG_MODE_BASE(port), (u8 *)listen_port, 2) == I2C_SUCCESS) {
@@ -51,7 +51,7 @@ typedef __packed struct _uartcfg
 	u8	StopBits;
 	u8	Parity;
 	u8	FlowCtrl;
-	u8	Reserved1[2];
+	u16	FrameGap;				/* Inter-character frame gap (ms), 0 = idle line */
 	
 	u8	WorkMode;
 	u8	Reserved2[7];
@@ -72,6 +72,8 @@ int GetUartParity(u8 port, u16 *uart_parity);
 int GetUartFlowCtrl(u8 port, u16 *uart_flow_control);
 int GetUartWorkMode(u8 port, u8 *uart_work_mode);
 int GetUartFrameSplit(u8 port, u16 *max_interval, u16 *max_datalen);
+int GetUartFrameGap(u8 port, u16 *gap_ms);
+int SetUartFrameGap(u8 port, u16 gap_ms);
 
 int GetUartModeTcpServer(u8 port, u16 *listen_port);
 int GetUartModeTcpClient(u8 port, uartcfg_tcpclient_t *pServersInfo, u8 info_num);
@@ -41,21 +41,32 @@ struct socket_conn {
     int used;
     int socket;
     struct sockaddr_in remote;
+    u32 tx_frames;
+    u32 tx_bytes;
+    u32 tx_drops;		/* Frames skipped while the client send window was full */
 } socket_conn_t;
 
 #define UART_RX_BUFFER_SIZE 1024
 #define UART_TX_BUFFER_SIZE 1024
 
+/* Reconnect interval (ms) of tcp client mode, doubled on each failure */
+#define TCP_CONNECT_BACKOFF_MIN		1000
+#define TCP_CONNECT_BACKOFF_MAX		32000
+
 extern uart_dev_t UartDevice[];
 struct socket_conn socket_list[COM_PORT_MAX][SOCKET_LIST_SIZE];
 static u8 UartRxBuffer[COM_PORT_MAX][UART_RX_BUFFER_SIZE];
 static u8 UartTxBuffer[COM_PORT_MAX][UART_TX_BUFFER_SIZE];
+/* Ends the select of uart_send_task only, on a change of socket_list */
+static struct lwip_select_waker SelectWaker[COM_PORT_MAX];
 static u8 ComPort[COM_PORT_MAX] = {0, 1};
 xSemaphoreHandle xSemUartTx[COM_PORT_MAX] = { NULL };
 xSemaphoreHandle xSemUartRx[COM_PORT_MAX] = { NULL };
 static u8 UartWorkingMode[COM_PORT_MAX] = {0};
 static u16 TcpSrvListenPort[COM_PORT_MAX] = {0};
 static uartcfg_tcpclient_t TcpServerList[COM_PORT_MAX][SOCKET_LIST_SIZE];
+static u32 TcpConnBackoff[COM_PORT_MAX][MAX_SERVER_NUMBER];
+static portTickType TcpConnNextTry[COM_PORT_MAX][MAX_SERVER_NUMBER];
 static u8 usEthRxBuffer[COM_PORT_MAX][UART_RX_BUFFER_SIZE];
 static u8 usEthTxBuffer[COM_PORT_MAX][UART_TX_BUFFER_SIZE];
 static uartcfg_udp_multicast_t UdpMulticastInfo[COM_PORT_MAX] = {0};
@@ -76,6 +87,17 @@ void socket_conn_init(void)
 	}
 }
 
+/* Caller holds sock_mutex, and calls lwip_select_wakeup() on the port's
+   SelectWaker after unlocking so uart_send_task picks up the new socket
+   at once. */
+static void socket_conn_attach(struct socket_conn *conn)
+{
+	conn->tx_frames = 0;
+	conn->tx_bytes = 0;
+	conn->tx_drops = 0;
+	conn->used = 1;
+}
+
 
 void tcp_listen_task(void *arg)
 {
@@ -134,11 +156,12 @@ void tcp_listen_task(void *arg)
 					int optval;
 					
 					lwip_setsockopt(socket_list[com_port][i].socket, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof(optval));
-					socket_list[com_port][i].used = 1;
+					socket_conn_attach(&socket_list[com_port][i]);
 					printf("-> Accept connect(%d): %s:%d\r\n", i, inet_ntoa(socket_list[com_port][i].remote.sin_addr), ntohs(socket_list[com_port][i].remote.sin_port));
 				}
 				
 				os_mutex_unlock(&(socket_list[com_port][i].sock_mutex));
+				lwip_select_wakeup(&SelectWaker[com_port]);
 			}
 			
             if(i == SOCKET_LIST_SIZE) {
@@ -169,10 +192,16 @@ void tcp_connect_task(void *arg)
             int optval;
             int tmpsock;
 			struct sockaddr_in tmpaddr;
+			portTickType now;
 			
 			if(TcpServerList[com_port][i].valid != 0x01)
 				continue;
 
+			/* A dead server is retried less and less often, so it does not hold up the others */
+			now = xTaskGetTickCount();
+			if((TcpConnBackoff[com_port][i] > 0) && ((signed portBASE_TYPE)(TcpConnNextTry[com_port][i] - now) > 0))
+				continue;
+
 			already_connected = 0;
 			for(sock_index=0; sock_index<SOCKET_LIST_SIZE; sock_index++) {
 				os_mutex_lock(&(socket_list[com_port][sock_index].sock_mutex),OS_MUTEX_WAIT_FOREVER);
@@ -204,8 +233,14 @@ void tcp_connect_task(void *arg)
             if(lwip_connect(tmpsock,(struct sockaddr *)&(tmpaddr),sizeof(tmpaddr)) == -1) {
 				//printf("Can't connect to %s:%d\r\n", inet_ntoa(tmpaddr.sin_addr), ntohs(tmpaddr.sin_port));
 				lwip_close(tmpsock);
+				if(TcpConnBackoff[com_port][i] == 0)
+					TcpConnBackoff[com_port][i] = TCP_CONNECT_BACKOFF_MIN;
+				else if(TcpConnBackoff[com_port][i] < TCP_CONNECT_BACKOFF_MAX)
+					TcpConnBackoff[com_port][i] <<= 1;
+				TcpConnNextTry[com_port][i] = xTaskGetTickCount() + TcpConnBackoff[com_port][i] / portTICK_RATE_MS;
 				continue;
 			} else {
+				TcpConnBackoff[com_port][i] = 0;
 				printf("Connected to %s:%d\r\n", inet_ntoa(tmpaddr.sin_addr), ntohs(tmpaddr.sin_port));
 			}
 			
@@ -220,8 +255,9 @@ void tcp_connect_task(void *arg)
 
                 socket_list[com_port][sock_index].socket = tmpsock;
                 socket_list[com_port][sock_index].remote = tmpaddr;
-                socket_list[com_port][sock_index].used = 1;
+                socket_conn_attach(&socket_list[com_port][sock_index]);
                 os_mutex_unlock(&(socket_list[com_port][sock_index].sock_mutex));
+                lwip_select_wakeup(&SelectWaker[com_port]);
                 break;
             }
             /* Can't find any empty slot */
@@ -272,8 +308,9 @@ void udp_mode_entry(void *arg)
     os_mutex_lock(&(socket_list[com_port][0].sock_mutex), OS_MUTEX_WAIT_FOREVER);
     socket_list[com_port][0].socket = udp_sock;
     socket_list[com_port][0].remote = remote;	
-    socket_list[com_port][0].used = 1;
+    socket_conn_attach(&socket_list[com_port][0]);
     os_mutex_unlock(&(socket_list[com_port][0].sock_mutex));
+    lwip_select_wakeup(&SelectWaker[com_port]);
 	
 	vTaskDelete( NULL );
 }
@@ -326,8 +363,9 @@ void udp_multicast_mode_entry(void *arg)
     os_mutex_lock(&(socket_list[com_port][0].sock_mutex), OS_MUTEX_WAIT_FOREVER);
     socket_list[com_port][0].socket = udp_sock;
     socket_list[com_port][0].remote = remote;	
-    socket_list[com_port][0].used = 1;
+    socket_conn_attach(&socket_list[com_port][0]);
     os_mutex_unlock(&(socket_list[com_port][0].sock_mutex));
+    lwip_select_wakeup(&SelectWaker[com_port]);
 	
 	vTaskDelete( NULL );
 }
@@ -336,15 +374,15 @@ void uart_send_task(void *arg)
 {
 	u8 com_port = *(u8 *)arg;
 	int maxfd;
+	u32_t gen;
 	fd_set readfds, tmpfds;
-	struct timeval timeout;
-
-	timeout.tv_sec = 0;
-	timeout.tv_usec = 100 * 1000;
 	
 	for(;;) {
 		int i;
 		
+		/* Sampled before the scan, a client attached after it makes the
+		   select below return at once instead of sleeping without it */
+		gen = lwip_select_generation(&SelectWaker[com_port]);
 		FD_ZERO(&readfds);
 		maxfd = 0;
 		for(i=0; i<SOCKET_LIST_SIZE; i++) {
@@ -355,13 +393,10 @@ void uart_send_task(void *arg)
 			}
 		}
 		
-		if(maxfd == 0) {
-			vTaskDelay(100);
-			continue;
-		}
-
+		/* Block until a client has data, or lwip_select_wakeup() reports a
+		   change of the socket list (an empty set just waits for that) */
 		tmpfds = readfds;
-		if (lwip_select(maxfd, &tmpfds, NULL, 0, &timeout) == 0) 
+		if (lwip_select_since(maxfd, &tmpfds, NULL, 0, NULL, &SelectWaker[com_port], gen) <= 0) 
 			continue;
 
 		for(i=0; i<SOCKET_LIST_SIZE; i++) {
@@ -405,24 +440,29 @@ void uart_recv_task(void *arg)
 	u16 max_interval,max_datalen;
 	u8 working_mode;
 	u16 read_len;
+	u16 frame_gap;
+	u8 rx_idle;
 	
 	for(;;) {
 		if(xSemaphoreTake(xSemUartRx[com_port], portMAX_DELAY) == pdTRUE) {
-
+			/* Sample idle before reading, so every byte ahead of it is in the buffer */
+			rx_idle = UartRxIdle(com_port);
 			read_len = UartRead(com_port, usEthTxBuffer[com_port]+rx_buf_offset[com_port], UART_RX_BUFFER_SIZE-rx_buf_offset[com_port]);
 			UartDevice[com_port].stat.rx_bytes += read_len;
 			
-			if(rx_buf_offset[com_port] == 0) {
-				if(read_len == 0) {
-					continue;
-				} else {
-					uart_tim[com_port] = 200;
-				}			
-			}
+			if((rx_buf_offset[com_port] == 0) && (read_len == 0))
+				continue;
+
+			/* New data restarts the inter-character gap */
+			frame_gap = UartGetFrameGap(com_port);
+			if(read_len > 0)
+				uart_tim[com_port] = frame_gap ? frame_gap : UART_FRAME_TIMEOUT;
 			
 			rx_buf_offset[com_port] += read_len;
 			if((rx_buf_offset[com_port] < UART_RX_BUFFER_SIZE/2) && (uart_tim[com_port] > 0)) {
-				continue;
+				/* Without a gap the frame ends at the idle line */
+				if(!((frame_gap == 0) && rx_idle))
+					continue;
 			}
 			if(uart_tim[com_port] == 0)
 				UartDevice[com_port].stat.count_tim_ethtx++;
@@ -432,28 +472,55 @@ void uart_recv_task(void *arg)
 			UartLedFlash(com_port);
 			
 			if((UartWorkingMode[com_port] == UART_MODE_TCP_SERVER) || (UartWorkingMode[com_port] == UART_MODE_TCP_CLIENT)) {
-				int i;
+				int i, maxfd = 0, conn_lost = 0;
+				int scan_sock[SOCKET_LIST_SIZE];
+				fd_set writefds;
+				struct timeval nowait = {0, 0};
+
+				/* One poll for all clients: a client whose send window is full
+				   skips this frame instead of stalling the others */
+				FD_ZERO(&writefds);
+				for(i=0; i<SOCKET_LIST_SIZE; i++) {
+					scan_sock[i] = -1;
+					if(socket_list[com_port][i].used) {
+						scan_sock[i] = socket_list[com_port][i].socket;
+						FD_SET(scan_sock[i], &writefds);
+						if(maxfd <= scan_sock[i])
+							maxfd = scan_sock[i] + 1;
+					}
+				}
+				if(maxfd > 0)
+					lwip_select(maxfd, NULL, &writefds, 0, &nowait);
 				
 				for(i=0; i<SOCKET_LIST_SIZE; i++) {
 					if(os_mutex_lock(&(socket_list[com_port][i].sock_mutex),10) != OS_MUTEX_SUCCESS)
 						continue;
 					if(socket_list[com_port][i].used) {
-						#if 1
-						if(lwip_send(socket_list[com_port][i].socket, usEthTxBuffer[com_port], rx_buf_offset[com_port], 0) < 0) {
+						if((scan_sock[i] == socket_list[com_port][i].socket) && !FD_ISSET(scan_sock[i], &writefds)) {
+							socket_list[com_port][i].tx_drops++;
+						} else if(lwip_send(socket_list[com_port][i].socket, usEthTxBuffer[com_port], rx_buf_offset[com_port], 0) < 0) {
 							lwip_close(socket_list[com_port][i].socket);
 							socket_list[com_port][i].used = 0;
+							conn_lost = 1;
 							printf("Connect lost!\r\n");
+						} else {
+							socket_list[com_port][i].tx_frames++;
+							socket_list[com_port][i].tx_bytes += rx_buf_offset[com_port];
 						}
-						#else
-						//lwip_send(socket_list[com_port][i].socket, usEthTxBuffer[com_port], rx_buf_offset[com_port], 0);
-						#endif
 					}
 					os_mutex_unlock(&(socket_list[com_port][i].sock_mutex));
 				}
+				if(conn_lost)
+					lwip_select_wakeup(&SelectWaker[com_port]);
 			} else if((UartWorkingMode[com_port] == UART_MODE_UDP) || (UartWorkingMode[com_port] == UART_MODE_UDP_MULTICAST)) {
 				if(os_mutex_lock(&(socket_list[com_port][0].sock_mutex),10) == OS_MUTEX_SUCCESS) {
 					if(socket_list[com_port][0].used) {
-						lwip_sendto(socket_list[com_port][0].socket, usEthTxBuffer[com_port], rx_buf_offset[com_port], 0, (struct sockaddr *)&(socket_list[com_port][0].remote), sizeof(struct sockaddr));
+						if(lwip_sendto(socket_list[com_port][0].socket, usEthTxBuffer[com_port], rx_buf_offset[com_port], 0, (struct sockaddr *)&(socket_list[com_port][0].remote), sizeof(struct sockaddr)) < 0) {
+							socket_list[com_port][0].tx_drops++;
+						} else {
+							socket_list[com_port][0].tx_frames++;
+							socket_list[com_port][0].tx_bytes += rx_buf_offset[com_port];
+						}
 					}
 					os_mutex_unlock(&(socket_list[com_port][0].sock_mutex));
 				}
@@ -488,12 +555,23 @@ int uart_get_socket_connect(u8 uart_port, u32 conn_index, struct sockaddr_in *so
 		return -1;
 }
 
+int uart_get_socket_stat(u8 uart_port, u32 conn_index, uart_sock_stat_t *stat)
+{
+	if(!socket_list[uart_port][conn_index].used)
+		return -1;
+	stat->tx_frames = socket_list[uart_port][conn_index].tx_frames;
+	stat->tx_bytes = socket_list[uart_port][conn_index].tx_bytes;
+	stat->tx_drops = socket_list[uart_port][conn_index].tx_drops;
+	return 0;
+}
+
 void UartServerStart(void)
 {
 	int i;
 	u8 port;
 	u8 CfgUartEnable=0;
 	u8 CfgUartWorkMode=0;
+	u16 CfgFrameGap=0;
 	uart_setup_t uart_set;
 	USART_InitTypeDef USART_InitStructure;
 
@@ -510,6 +588,10 @@ void UartServerStart(void)
 			uart_set.txSize 	= UART_TX_BUFFER_SIZE;
 			uart_set.txBuf 		= UartTxBuffer[port];
 			UartDevSetup(port, uart_set);
+
+			/* Inter-character gap framing, 0 keeps idle line framing */
+			if(GetUartFrameGap(port, &CfgFrameGap) == CONF_ERR_NONE)
+				UartSetFrameGap(port, CfgFrameGap);
 			
 			if(xSemUartTx[port] == NULL) {
 				vSemaphoreCreateBinary(xSemUartTx[port]);
@@ -574,9 +656,9 @@ void UartServerStart(void)
 					break;
 				
 				printf("COM-Port%d working in TCP Server mode, Listen port %d\r\n", port, ntohs(TcpSrvListenPort[port]));				
-				xTaskCreate(uart_recv_task, "tUartRx", configMINIMAL_STACK_SIZE * 1, &ComPort[port], tskIDLE_PRIORITY + 10, NULL);
-				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2, tskIDLE_PRIORITY + 8);
-				sys_thread_new("tTcpServer", tcp_listen_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1, tskIDLE_PRIORITY + 8);
+				xTaskCreate(uart_recv_task, "tUartRx", configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, &ComPort[port], tskIDLE_PRIORITY + 10, NULL);
+				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 8);
+				sys_thread_new("tTcpServer", tcp_listen_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 8);
 				break;
 
 				case UART_MODE_TCP_CLIENT:
@@ -592,9 +674,9 @@ void UartServerStart(void)
 					if(TcpServerList[port][i].valid == 0x01)
 						printf(" # ip:%16s, port: %d\r\n", inet_ntoa(addrin), ntohs(TcpServerList[port][i].server_port));
 				}
-				xTaskCreate(uart_recv_task, "tUartRx", configMINIMAL_STACK_SIZE * 1, &ComPort[port], tskIDLE_PRIORITY + 10, NULL);
-				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2, tskIDLE_PRIORITY + 8);
-				sys_thread_new("tTcpClient", tcp_connect_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1, tskIDLE_PRIORITY + 8);
+				xTaskCreate(uart_recv_task, "tUartRx", configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, &ComPort[port], tskIDLE_PRIORITY + 10, NULL);
+				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 8);
+				sys_thread_new("tTcpClient", tcp_connect_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 8);
 				break;
 
 				case UART_MODE_UDP:
@@ -602,9 +684,9 @@ void UartServerStart(void)
 					break;
 				
 				printf("COM-Port%d working in UDP mode\r\n", port);			
-				sys_thread_new("tUartRx", uart_recv_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1, tskIDLE_PRIORITY + 10);
-				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2, tskIDLE_PRIORITY + 8);
-				xTaskCreate(udp_mode_entry, "tUdpMode", configMINIMAL_STACK_SIZE * 1, &ComPort[port], tskIDLE_PRIORITY + 8, NULL);
+				sys_thread_new("tUartRx", uart_recv_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 10);
+				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 8);
+				xTaskCreate(udp_mode_entry, "tUdpMode", configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, &ComPort[port], tskIDLE_PRIORITY + 8, NULL);
 				break;
 
 				case UART_MODE_UDP_MULTICAST:
@@ -612,9 +694,9 @@ void UartServerStart(void)
 					break;
 				
 				printf("COM-Port%d working in UDP multicast mode\r\n", port);
-				sys_thread_new("tUartRx", uart_recv_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1, tskIDLE_PRIORITY + 10);
-				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2, tskIDLE_PRIORITY + 8);
-				xTaskCreate(udp_multicast_mode_entry, "tUdpMulti", configMINIMAL_STACK_SIZE * 1, &ComPort[port], tskIDLE_PRIORITY + 8, NULL);
+				sys_thread_new("tUartRx", uart_recv_task, &ComPort[port], configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 10);
+				sys_thread_new("tUartTx", uart_send_task, &ComPort[port], configMINIMAL_STACK_SIZE * 2 + LWIP_API_STACK_EXTRA, tskIDLE_PRIORITY + 8);
+				xTaskCreate(udp_multicast_mode_entry, "tUdpMulti", configMINIMAL_STACK_SIZE * 1 + LWIP_API_STACK_EXTRA, &ComPort[port], tskIDLE_PRIORITY + 8, NULL);
 				break;
 			}
 
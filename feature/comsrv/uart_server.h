@@ -9,7 +9,15 @@
 
 #define TCP_SERVER_PORT_BASE	6010
 
+/* Per client counters of the serial to ethernet direction */
+typedef struct _uart_sock_stat {
+	u32 tx_frames;
+	u32 tx_bytes;
+	u32 tx_drops;
+} uart_sock_stat_t;
+
 void UartServerStart(void);
+int uart_get_socket_stat(u8 uart_port, u32 conn_index, uart_sock_stat_t *stat);
 
 #endif
 
@@ -1,30 +1,215 @@
 
 
 
+#include "mconfig.h"
+#include "stm32f2xx.h"
 #include "delay.h"
 
 #include "stdio.h"
 
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/* DWT cycle counter, shared with the run time stats timer which may reset it:
+   only differences of CYCCNT are used here. */
+#define DELAY_DWT_CYCCNT		( *( ( volatile unsigned long * ) 0xE0001004 ) )
+#define DELAY_DWT_CONTROL		( *( ( volatile unsigned long * ) 0xE0001000 ) )
+#define DELAY_SCB_DEMCR			( *( ( volatile unsigned long * ) 0xE000EDFC ) )
+#define DELAY_DEMCR_TRCENA		0x01000000
+#define DELAY_DWT_CYCCNTENA		0x00000001
+#define DELAY_SCB_ICSR			( *( ( volatile unsigned long * ) 0xE000ED04 ) )
+#define DELAY_ICSR_VECTACTIVE	0x000001FF
+
+/* Longest span handed to Delay_Us in one go, well below the CYCCNT wrap */
+#define DELAY_CHUNK_US			1000000
+
+static u32 DelayCyclesPerUs = 0;
+static u32 DelayCyclesPerTick = 0;
+/* Cycles between the TIM7 update and the task running again (EWMA, 1/8) */
+static u32 DelayWakeLatency = 0;
+static xSemaphoreHandle xSemDelayWake = NULL;
+static xSemaphoreHandle xDelayMutex = NULL;
+
+
+static void Delay_DwtEnable(void)
+{
+	if((DELAY_SCB_DEMCR & DELAY_DEMCR_TRCENA) == 0)
+		DELAY_SCB_DEMCR |= DELAY_DEMCR_TRCENA;
+	if((DELAY_DWT_CONTROL & DELAY_DWT_CYCCNTENA) == 0)
+		DELAY_DWT_CONTROL |= DELAY_DWT_CYCCNTENA;
+	if(DelayCyclesPerUs == 0) {
+		DelayCyclesPerUs = SystemCoreClock / 1000000;
+		DelayCyclesPerTick = SystemCoreClock / configTICK_RATE_HZ;
+		DelayWakeLatency = DELAY_WAKE_LATENCY_US * DelayCyclesPerUs;
+	}
+}
+
+static void Delay_SpinUntil(u32 start, u32 cycles)
+{
+	while((u32)(DELAY_DWT_CYCCNT - start) < cycles);
+}
+
+static u32 Delay_SpinMax(void)
+{
+	u32 spin = DELAY_SPIN_MIN_US * DelayCyclesPerUs;
+
+	/* blocking only pays off when the wait is well above the wake-up cost */
+	if(spin < (DelayWakeLatency << 2))
+		spin = DelayWakeLatency << 2;
+	return spin;
+}
+
+static int Delay_CanBlock(void)
+{
+	if(xDelayMutex == NULL)
+		return 0;
+	if(DELAY_SCB_ICSR & DELAY_ICSR_VECTACTIVE)
+		return 0;
+	return (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+}
+
+static u32 Delay_TimerClock(void)
+{
+	RCC_ClocksTypeDef clocks;
+
+	RCC_GetClocksFreq(&clocks);
+	/* APB1 timers run at twice PCLK1 when APB1 is divided */
+	if(clocks.PCLK1_Frequency != clocks.HCLK_Frequency)
+		return clocks.PCLK1_Frequency * 2;
+	return clocks.PCLK1_Frequency;
+}
+
+/* Start TIM7 as a one-shot that raises its update interrupt after 'us' */
+static void Delay_TimerArm(u32 us)
+{
+	if(us == 0)
+		us = 1;
+	TIM7->CR1 = 0;
+	TIM7->CNT = 0;
+	TIM7->ARR = us - 1;
+	TIM7->SR = 0;
+	TIM7->DIER = TIM_DIER_UIE;
+	TIM7->CR1 = TIM_CR1_OPM | TIM_CR1_URS | TIM_CR1_CEN;
+}
+
+void TIM7_IRQHandler(void)
+{
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	TIM7->SR = 0;
+	TIM7->DIER = 0;
+	if(xSemDelayWake != NULL)
+		xSemaphoreGiveFromISR(xSemDelayWake, &xHigherPriorityTaskWoken);
+	portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+}
+
+void Delay_Init(void)
+{
+	TIM_TimeBaseInitTypeDef timinit;
+	NVIC_InitTypeDef nvicinit;
+
+	Delay_DwtEnable();
+	if(xDelayMutex != NULL)
+		return;
+
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM7, ENABLE);
+	TIM_DeInit(TIM7);
+	TIM_TimeBaseStructInit(&timinit);
+	timinit.TIM_Prescaler = (Delay_TimerClock() / DELAY_TIMER_HZ) - 1;
+	timinit.TIM_Period = DELAY_TIMER_MAX_US;
+	TIM_TimeBaseInit(TIM7, &timinit);
+	/* TIM_TimeBaseInit generates an update event to load the prescaler */
+	TIM7->SR = 0;
+
+	nvicinit.NVIC_IRQChannel = TIM7_IRQn;
+	nvicinit.NVIC_IRQChannelPreemptionPriority = 3;
+	nvicinit.NVIC_IRQChannelSubPriority = 0;
+	nvicinit.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&nvicinit);
+
+	vSemaphoreCreateBinary(xSemDelayWake);
+	if(xSemDelayWake == NULL)
+		return;
+	xSemaphoreTake(xSemDelayWake, 0);
+	xDelayMutex = xSemaphoreCreateMutex();
+}
 
+/* Wait 'us' microseconds. Short waits, waits from interrupt context and waits
+   before the scheduler runs spin on CYCCNT. Longer ones sleep for whole ticks,
+   then on a TIM7 one-shot for the sub-tick remainder, and finish with a short
+   spin so the delay never ends early. */
+void Delay_Us(unsigned int us)
+{
+	u32 start, cycles, elapsed, remain, arm, target;
+	s32 late;
+
+	while(us > DELAY_CHUNK_US) {
+		Delay_Us(DELAY_CHUNK_US);
+		us -= DELAY_CHUNK_US;
+	}
+	Delay_DwtEnable();
+	start = DELAY_DWT_CYCCNT;
+	cycles = us * DelayCyclesPerUs;
+
+	if((cycles <= Delay_SpinMax()) || !Delay_CanBlock()) {
+		Delay_SpinUntil(start, cycles);
+		return;
+	}
 
+	/* whole ticks first; tick phase is unknown so keep one tick in hand */
+	elapsed = DELAY_DWT_CYCCNT - start;
+	if((elapsed < cycles) && ((cycles - elapsed) >= (DelayCyclesPerTick << 1)))
+		vTaskDelay(((cycles - elapsed) / DelayCyclesPerTick) - 1);
+
+	/* TIM7 is one timer for all tasks, only the one-shot needs the lock */
+	xSemaphoreTake(xDelayMutex, portMAX_DELAY);
+
+	elapsed = DELAY_DWT_CYCCNT - start;
+	if(elapsed < cycles) {
+		remain = cycles - elapsed;
+		if(remain > (DelayWakeLatency + (DELAY_SPIN_MIN_US * DelayCyclesPerUs))) {
+			arm = (remain - DelayWakeLatency) / DelayCyclesPerUs;
+			if(arm > DELAY_TIMER_MAX_US)
+				arm = DELAY_TIMER_MAX_US;
+			xSemaphoreTake(xSemDelayWake, 0);
+			target = DELAY_DWT_CYCCNT + (arm * DelayCyclesPerUs);
+			Delay_TimerArm(arm);
+			if(xSemaphoreTake(xSemDelayWake, (arm / 1000) / portTICK_RATE_MS + 2) == pdTRUE) {
+				late = (s32)(DELAY_DWT_CYCCNT - target);
+				if(late < 0)
+					late = 0;
+				DelayWakeLatency = DelayWakeLatency - (DelayWakeLatency >> 3) + ((u32)late >> 3);
+			} else {
+				TIM7->CR1 = 0;
+				TIM7->DIER = 0;
+			}
+		}
+	}
+
+	xSemaphoreGive(xDelayMutex);
+
+	Delay_SpinUntil(start, cycles);
+}
 
 void Delay_5Us(unsigned int s)
 {
-	unsigned int i;
-	while (s--)
-	{
-		for (i = 0; i < 90; i++);
+	while(s > (DELAY_CHUNK_US / 5)) {
+		Delay_Us(DELAY_CHUNK_US);
+		s -= DELAY_CHUNK_US / 5;
 	}
+	Delay_Us(s * 5);
 }
 
 
 void Delay_Ms(unsigned int s)
 {
-	unsigned int i;
-	while (s--)
-	{
-		for (i = 0; i < 20970; i++);
+	while(s > (DELAY_CHUNK_US / 1000)) {
+		Delay_Us(DELAY_CHUNK_US);
+		s -= DELAY_CHUNK_US / 1000;
 	}
+	Delay_Us(s * 1000);
 }
 
 
@@ -1,10 +1,22 @@
-#ifndef __DELAY_H
-#define __DELAY_H
 
 
 
+#ifndef __DELAY_H
+#define __DELAY_H
+
+/* Delays up to this length always busy-wait on the DWT cycle counter; longer
+   ones block the calling task once the service runs (see Delay_Init). The
+   effective threshold grows with the measured wake-up latency. */
+#define DELAY_SPIN_MIN_US		50
+/* Initial guess of the TIM7 update -> task running latency */
+#define DELAY_WAKE_LATENCY_US	10
+/* TIM7 one-shot counts in microseconds */
+#define DELAY_TIMER_HZ			1000000
+#define DELAY_TIMER_MAX_US		0xFFFF
 
 /* func */
+void Delay_Init(void);
+void Delay_Us(unsigned int us);
 void Delay_5Us(unsigned int s);
 void Delay_Ms(unsigned int s);
 
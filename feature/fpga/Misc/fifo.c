@@ -114,51 +114,108 @@ void Fifo_Init(fifo_p  fifop)
 }
 
 
-void Fifo_Add_Value(fifo_p  fifop, unsigned char value)
+unsigned int Fifo_Used(fifo_p  fifop)
 {
-	fifop->buff[fifop->tail++] = value;
-	if (fifop->tail == MAXSIZE)
-	{
-		fifop->tail = 0;
-	}
+	return fifop->tail - fifop->head;
 }
 
 
-unsigned char Fifo_Read(fifo_p fifop, unsigned char *buf, unsigned int size)
+unsigned int Fifo_Room(fifo_p  fifop)
 {
-	unsigned int i = 0;
-	unsigned int acsize;
-	if (size == 0)
-	{
-		return 0;
-	}
-	if (fifop->tail > fifop->head)
+	return FIFOSIZE - (fifop->tail - fifop->head);
+}
+
+
+/* producer side */
+unsigned int Fifo_WriteSpan(fifo_p  fifop, unsigned char **pp)
+{
+	unsigned int tail = fifop->tail;
+	unsigned int room = FIFOSIZE - (tail - fifop->head);
+	unsigned int end = FIFOSIZE - (tail & FIFOMASK);
+
+	*pp = &fifop->buff[tail & FIFOMASK];
+	return (room < end) ? room : end;
+}
+
+
+void Fifo_WriteCommit(fifo_p  fifop, unsigned int size)
+{
+	unsigned int used;
+
+	/* data must land before the consumer sees the new tail */
+	FIFO_BARRIER();
+	fifop->tail += size;
+	used = fifop->tail - fifop->head;
+	if (used > fifop->highwater)
 	{
-		acsize = fifop->tail - fifop->head;
+		fifop->highwater = used;
 	}
-	else
+}
+
+
+unsigned int Fifo_Write(fifo_p  fifop, unsigned char *buf, unsigned int size)
+{
+	unsigned int tail = fifop->tail;
+	unsigned int room = FIFOSIZE - (tail - fifop->head);
+	unsigned int i;
+
+	if (size > room)
 	{
-		acsize = MAXSIZE - (fifop->tail - fifop->head);
+		fifop->overrun += size - room;
+		size = room;
 	}
-	size = (size >= acsize) ? acsize : size;
 	for (i = 0; i < size; i++)
 	{
-		*(buf++) = fifop->buff[fifop->head++];
-		if (fifop->head == MAXSIZE)
-		{
-			fifop->head = 0x00;
-		}
+		fifop->buff[(tail + i) & FIFOMASK] = buf[i];
 	}
+	Fifo_WriteCommit(fifop, size);
 	return size;
 }
 
 
-void Fifo_Write(fifo_p  fifop, unsigned char *buf, unsigned int size)
+void Fifo_Add_Value(fifo_p  fifop, unsigned char value)
 {
-	unsigned char i = size;
-	while (i--)
+	Fifo_Write(fifop, &value, 1);
+}
+
+
+/* consumer side */
+unsigned int Fifo_ReadSpan(fifo_p  fifop, unsigned char **pp)
+{
+	unsigned int head = fifop->head;
+	unsigned int used = fifop->tail - head;
+	unsigned int end = FIFOSIZE - (head & FIFOMASK);
+
+	/* tail is read before the data it covers */
+	FIFO_BARRIER();
+	*pp = &fifop->buff[head & FIFOMASK];
+	return (used < end) ? used : end;
+}
+
+
+void Fifo_ReadCommit(fifo_p  fifop, unsigned int size)
+{
+	/* data must be copied out before the producer may reuse it */
+	FIFO_BARRIER();
+	fifop->head += size;
+}
+
+
+unsigned int Fifo_Read(fifo_p  fifop, unsigned char *buf, unsigned int size)
+{
+	unsigned int head = fifop->head;
+	unsigned int used = fifop->tail - head;
+	unsigned int i;
+
+	FIFO_BARRIER();
+	if (size > used)
 	{
-		Fifo_Add_Value(fifop, *buf);
-		buf++;
+		size = used;
+	}
+	for (i = 0; i < size; i++)
+	{
+		buf[i] = fifop->buff[(head + i) & FIFOMASK];
 	}
+	Fifo_ReadCommit(fifop, size);
+	return size;
 }
@@ -3,7 +3,20 @@
 
 
 
-#define MAXSIZE	640
+/* Single producer (isr) / single consumer (task) ring without locking: only
+   the producer moves tail and only the consumer moves head. Both indices run
+   free and are masked on access, so FIFOSIZE must be a power of two. */
+#define FIFOSIZE	1024
+#define FIFOMASK	(FIFOSIZE - 1)
+#define MAXSIZE		FIFOSIZE
+
+/* Orders the buffer accesses against the index seen by the other side */
+#if defined(__ICCARM__)
+#include <intrinsics.h>
+#define FIFO_BARRIER()	__DMB()
+#else
+#define FIFO_BARRIER()	__sync_synchronize()
+#endif
 
 #if 0
 typedef struct FIFO_STATCK
@@ -17,16 +30,27 @@ typedef struct FIFO_STATCK
 
 typedef struct FIFO_STATCK
 {
-	unsigned int		head;
-	unsigned int		tail;
-	unsigned char 	buff[MAXSIZE];
+	volatile unsigned int	head;		/* consumer */
+	volatile unsigned int	tail;		/* producer */
+	unsigned int		highwater;		/* most bytes ever waiting */
+	unsigned int		overrun;		/* bytes dropped for lack of room */
+	unsigned char 	buff[FIFOSIZE];
 } fifo_t, *fifo_p;
 
 
 
+void Fifo_Init(fifo_p  fifop);
+unsigned int Fifo_Used(fifo_p  fifop);
+unsigned int Fifo_Room(fifo_p  fifop);
 void Fifo_Add_Value(fifo_p  fifop, unsigned char vlue);
-void Fifo_Write(fifo_p  fifop, unsigned char *buf, unsigned int size);
-unsigned char Fifo_Read(fifo_p  fifop, unsigned char *buf, unsigned int size);
+unsigned int Fifo_Write(fifo_p  fifop, unsigned char *buf, unsigned int size);
+unsigned int Fifo_Read(fifo_p  fifop, unsigned char *buf, unsigned int size);
+
+/* zero copy access: longest contiguous span, then commit what was used */
+unsigned int Fifo_WriteSpan(fifo_p  fifop, unsigned char **pp);
+void Fifo_WriteCommit(fifo_p  fifop, unsigned int size);
+unsigned int Fifo_ReadSpan(fifo_p  fifop, unsigned char **pp);
+void Fifo_ReadCommit(fifo_p  fifop, unsigned int size);
 
 
 
@@ -12,8 +12,14 @@
 #include "os_mutex.h"
 #include "stdio.h"
 
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+/* Longest internal write cycle (ms) waited by acknowledge polling */
+#define AT24_WRITE_TIMEOUT	20
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 
@@ -23,6 +29,26 @@ const  unsigned int pagesize = (AT24C32 + 1);
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 
+/* The AT24 ignores its address while an internal write cycle runs, poll it
+   (sleeping a tick between tries) instead of a fixed worst case delay */
+static unsigned char At24_WaitReady(int devid, unsigned char devadd)
+{
+	unsigned char err = I2C_NO_ACK;
+	int retry;
+
+	for (retry = 0; retry < AT24_WRITE_TIMEOUT; retry++) {
+		SW_I2CBusstart(devid);
+		err = SW_I2CWriteByte(devid, devadd | I2C_W);
+		SW_I2CBusStop(devid);
+		if (err == I2C_ACK_OK) {
+			break;
+		}
+		vTaskDelay(1);
+	}
+
+	return err;
+}
+
 void At24WpInit(void)
 {
 	GPIO_InitTypeDef gpioinit;
@@ -52,7 +78,7 @@ unsigned char At24_Byte_Write(int devid, unsigned char devadd, unsigned int stor
     
     os_mutex_lock(&i2c_mutex, OS_MUTEX_WAIT_FOREVER);
 	AT24_WPDIS;
-	Delay_5Us(2000);
+	At24_WaitReady(devid, devadd);
 	err = SW_CheakI2CState(devid);
 
 	if(err == I2C_IDLE_OK) {
@@ -84,7 +110,7 @@ unsigned char At24_Page_Write(int devid, unsigned char devadd, unsigned int stor
 	startpage = storeadd / pagesize;
 	spramainsize = pagesize - (storeadd - startpage * pagesize);
 	AT24_WPDIS;
-	Delay_5Us(2000);
+	At24_WaitReady(devid, devadd);
 	if (spramainsize) {
 		if (spramainsize > size) {
 			tsize = size;
@@ -106,11 +132,13 @@ unsigned char At24_Page_Write(int devid, unsigned char devadd, unsigned int stor
 			SW_I2CBusstart(devid);
 			err = SW_I2CWriteByte(devid, devadd | I2C_W);
 			if (err != I2C_ACK_OK) {
-				return err;
+				SW_I2CBusStop(devid);
+				break;
 			}
 			err = SW_I2CWriteByte(devid, (unsigned char)(storeadd >> 8));
 			if (err != I2C_ACK_OK) {
-				return err;
+				SW_I2CBusStop(devid);
+				break;
 			}
 			err = SW_I2CWriteByte(devid, (unsigned char)storeadd);
 			if (err == I2C_ACK_OK) {
@@ -121,8 +149,7 @@ unsigned char At24_Page_Write(int devid, unsigned char devadd, unsigned int stor
 			}
 			SW_I2CBusStop(devid);
 			storeadd += tsize;
-//			Delay_5Us(1000);
-			Delay_5Us(2000);
+			At24_WaitReady(devid, devadd);
 			size -= tsize;
 			tsize = (size / pagesize) ? pagesize : (size % pagesize);
 		}
@@ -160,7 +187,7 @@ unsigned char At24_Current_Read(int devid, unsigned char devadd, unsigned char *
     
     os_mutex_lock(&i2c_mutex, OS_MUTEX_WAIT_FOREVER);
 	AT24_WPDIS;
-	Delay_5Us(2000);
+	At24_WaitReady(devid, devadd);
 	err = SW_CheakI2CState(devid);
 	if (err == I2C_IDLE_OK) {
 		SW_I2CBusstart(devid);
@@ -179,8 +206,10 @@ unsigned char At24_Current_Read(int devid, unsigned char devadd, unsigned char *
 unsigned char At24_Random_Read(int devid, unsigned char devadd, unsigned int storeadd, unsigned char *buf)
 {
 	unsigned char err;
+
+    os_mutex_lock(&i2c_mutex, OS_MUTEX_WAIT_FOREVER);
 	AT24_WPDIS;
-	Delay_5Us(2000);
+	At24_WaitReady(devid, devadd);
 	err = SW_CheakI2CState(devid);
 	if (err == I2C_IDLE_OK) {
 		if (I2C_ACK_OK == (err = At24_Addr_Write(devid, devadd, storeadd))) {
@@ -203,7 +232,7 @@ unsigned char At24_Sequential_Read(int devid, unsigned char devadd, unsigned int
     
     os_mutex_lock(&i2c_mutex, OS_MUTEX_WAIT_FOREVER);
 	AT24_WPDIS;
-	Delay_5Us(2000);
+	At24_WaitReady(devid, devadd);
 	err = SW_CheakI2CState(devid);
 	size -= 1;
 	if (err == I2C_IDLE_OK) {
@@ -48,6 +48,32 @@ extern unsigned char DevMac[6];
 static boardinfo localboard;
 static device_t deviceinfo;
 
+/* command handler, builds its reply in place over the request payload */
+typedef void (*cmdprocess)(int port, unsigned char *msg, int *size, int op);
+
+#define CMDF_REPLY		0x01		/* always reply, even to a set */
+#define CMDIDXSIZE		0x20
+
+typedef struct
+{
+	unsigned char	subcmd;
+	unsigned char	setlen;			/* minimum payload of a set request */
+	unsigned char	getlen;			/* minimum payload of a get request */
+	unsigned char	rsplen;			/* largest reply payload, 0 = never grows */
+	unsigned char	flags;
+	cmdprocess		process;
+} cmdentry;
+
+typedef struct
+{
+	const cmdentry	*entry;
+	unsigned char	num;
+	unsigned short	room;			/* reply payload room of the frame buffer */
+	unsigned char	idx[CMDIDXSIZE];	/* subcmd -> entry + 1, 0 = unregistered */
+} cmdtable, *cmdtablep;
+
+#define COMCMDBUFF		64
+
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
 unsigned short int 	MsgLenGet(unsigned short int len)
@@ -71,6 +97,20 @@ typedef enum {REND = 0, RSTART} rstate;
 
 //serialbufftype * srlbuffp = NULL;
 
+/* Length and frame go in together or not at all, a half record would
+   desync the reader. Called from the uart isr, the only producer. */
+static int UtFifoPut(fifo_p fp, serialbufftype *rx)
+{
+	if (Fifo_Room(fp) < sizeof(rx->cnt) + rx->cnt)
+	{
+		fp->overrun += sizeof(rx->cnt) + rx->cnt;
+		return 0;
+	}
+	Fifo_Write(fp, (unsigned char *)&rx->cnt, sizeof(rx->cnt));
+	Fifo_Write(fp, rx->buff, rx->cnt);
+	return 1;
+}
+
 static fifo_t ut1fifo;
 static serialbufftype ut1rx = {&ut1fifo};
 static fifo_p ut1fp = &ut1fifo;
@@ -132,8 +172,8 @@ void Ut1Recv(unsigned char ch)
 //					*ut1p = ch;
 					if ((ut1rx.buff[0] == NMSGHLD) && (ut1rx.buff[ut1rx.cnt - 1] == NMSGEND))
 					{
-						Fifo_Write(ut1fp, (unsigned char *)&ut1rx.cnt, sizeof(ut1rx.cnt));
-						Fifo_Write(ut1fp, ut1rx.buff, ut1rx.cnt);
+						UtFifoPut(ut1fp, &ut1rx);
+						HalCmdNotifyFromISR();
 //						ut1msgcnt++;
 					}
 					ut1rx.cnt = 0;
@@ -152,8 +192,7 @@ void Ut1Recv(unsigned char ch)
 			ut1rxstate = REND;
 			*ut1p = ch;
 			if((ut1rx.buff[0] == NMSGHLD) && (ut1rx.buff[ut1rx.cnt - 1] == NMSGEND)){
-				Fifo_Write(ut1fp, (unsigned char *)&ut1rx.cnt, sizeof(ut1rx.cnt));
-				Fifo_Write(ut1fp, ut1rx.buff,ut1rx.cnt);
+				UtFifoPut(ut1fp, &ut1rx);
 			}
 			ut1rx.cnt = 0;
 			ut1p = ut1rx.buff;
@@ -224,8 +263,7 @@ void Ut4Recv(unsigned char ch)
 					*ut4p = ch;
 					if ((ut4rx.buff[0] == NMSGHLD) && (ut4rx.buff[ut4rx.cnt - 1] == NMSGEND))
 					{
-						Fifo_Write(ut4fp, (unsigned char *)&ut4rx.cnt, sizeof(ut4rx.cnt));
-						Fifo_Write(ut4fp, ut4rx.buff, ut4rx.cnt);
+						UtFifoPut(ut4fp, &ut4rx);
 //						ut4msgcnt++;
 					}
 					ut4rx.cnt = 0;
@@ -244,8 +282,7 @@ void Ut4Recv(unsigned char ch)
 			ut4rxstate = REND;
 			*ut4p = ch;
 			if((ut4rx.buff[0] == NMSGHLD) && (ut4rx.buff[ut4rx.cnt - 1] == NMSGEND)){
-				Fifo_Write(ut4fp, (unsigned char *)&ut4rx.cnt, sizeof(ut4rx.cnt));
-				Fifo_Write(ut4fp, ut4rx.buff,ut4rx.cnt);
+				UtFifoPut(ut4fp, &ut4rx);
 			}
 			ut4rx.cnt = 0;
 			ut4p = ut4rx.buff;
@@ -314,8 +351,7 @@ void Ut2Recv(unsigned char ch)
 					if ((ut2rx.buff[0] == CMSGHLD) && (ut2rx.buff[ut2rx.cnt - 1] == CMSGEND))
 					{
 //						Fifo_Add_Value(ut2fp, ut2rx.cnt);
-						Fifo_Write(ut2fp, (unsigned char *)&ut2rx.cnt, sizeof(ut2rx.cnt));
-						Fifo_Write(ut2fp, ut2rx.buff, ut2rx.cnt);
+						UtFifoPut(ut2fp, &ut2rx);
 					}
 					ut2rx.cnt = 0;
 					ut2p = ut2rx.buff;
@@ -359,8 +395,7 @@ void Ut2Recv(unsigned char ch)
 					if ((ut2rx.buff[0] == CMSGHLD) && (ut2rx.buff[ut2rx.cnt - 1] == CMSGEND))
 					{
 //						Fifo_Add_Value(ut2fp, ut2rx.cnt);
-						Fifo_Write(ut2fp, (unsigned char *)&ut2rx.cnt, sizeof(ut2rx.cnt));
-						Fifo_Write(ut2fp, ut2rx.buff, ut2rx.cnt);
+						UtFifoPut(ut2fp, &ut2rx);
 					}
 					ut2rx.cnt = 0;
 					ut2p = ut2rx.buff;
@@ -392,8 +427,7 @@ void Ut2Recv(unsigned char ch)
 		if ((ut2rx.buff[0] == CMSGHLD) && (ut2rx.buff[ut2rx.cnt - 1] == CMSGEND))
 		{
 //			Fifo_Add_Value(ut2fp, ut2rx.cnt);
-			Fifo_Write(ut2fp, (unsigned char *)&ut2rx.cnt, sizeof(ut2rx.cnt));
-			Fifo_Write(ut2fp, ut2rx.buff, ut2rx.cnt);
+			UtFifoPut(ut2fp, &ut2rx);
 		}
 		ut2rx.cnt = 0;
 		ut2p = ut2rx.buff;
@@ -442,20 +476,6 @@ void BoardInfoSet(void)
 }
 
 
-void PakDatConv(unsigned char *dist, unsigned char *src, unsigned char size)
-{
-	unsigned char i;
-	unsigned char hch;
-	if (size > 9)
-	{
-		return;
-	}
-	hch = src[size - 1];
-	for (i = 0; i < size - 1; i++)
-	{
-		*dist = *src | ((hch & (1 << i)) ? 0x80 : 0x00);
-	}
-}
 unsigned char GetFpgaVersion(unsigned int fcodeid)
 {
 	return ((fcodeid >> 24) & 0xff);
@@ -1111,7 +1131,9 @@ void PhyTestProcess(int port, unsigned char *msg, int *size, int op)
 
 void UpgradeProcee(int port, unsigned char *msg, int *size, int op)
 {
-	
+	upgrademsgp upmsgp = (upgrademsgp)msg;
+
+	*(unsigned int *)upmsgp->size = SWP32(*(unsigned int *)upmsgp->size);
 	UpgradeImageProsess(msg,(unsigned int*)size);
 
 }
@@ -1132,8 +1154,6 @@ void GetIdMacProcess(int port, unsigned char *msg, int *size, int op)
 
 void SystemResetProcess(int port, unsigned char *msg, int *size, int op)
 {
-    uint8_t  Rx_Buffer_copy_a[128] = {0};
-    
 	switch(*msg){
 		case MCURESET:
 			NVIC_SystemReset();
@@ -1156,19 +1176,10 @@ void SystemResetProcess(int port, unsigned char *msg, int *size, int op)
 			//------------------------ָ------------------------------//
 			//----------------goldenprimary-------------------//
 		{
-			uint32_t copy_1;
-			uint8_t erasesector;
-			uint8_t  Rx_Buffer_copy;
-
 			SPI3_FLASH_Init();
-			// erase flash //
-			for (erasesector = 0; (erasesector < 15); erasesector++) {
-				SPI3_FLASH_EraseSector(PRIMARY_ADDRESS + (SPI_FLASH_SIZE * erasesector));
-			}
-			
-			for(copy_1 = 0; copy_1 < 7680; copy_1++){
-				SPI3_FLASH_ReadBuffer(Rx_Buffer_copy_a,GOLDEN_ADDRESS+copy_1,128) ;
-				SPI3_FLASH_WriteBuffer(Rx_Buffer_copy_a,PRIMARY_ADDRESS+copy_1,128);
+			/* sectors already matching golden are left alone */
+			if (SPI3_FLASH_Copy(PRIMARY_ADDRESS, GOLDEN_ADDRESS, PRIMARYSIZE) != 0) {
+				st_fpga_debug(ST_FPGA_ERROR, "golden to primary copy verify failed\r\n");
 			}
 			SPI_Cmd(SPI3_FLASH_SPI, DISABLE);
 			SPI3_MCU_pin_to_3state();
@@ -1203,6 +1214,118 @@ void CpuMsgDump(newcmd_e code)
 	st_fpga_debug(ST_FPGA_DEBUG,"%s\r\n",CpuMsgParse(code));
 }
 
+/* commands from the box cpu, payload at &ccp->subcmd + 1 */
+static const cmdentry cpucmdentry[] =
+{
+/*	  subcmd		set	get	rsp	flags		process */
+	{ MACINFO,		7,	1,	21,	0,			MacInfoProcess },
+	{ CHANMASK,		2,	1,	32,	0,			ChanMaskProcess },
+	{ MACMASK,		2,	1,	6,	0,			MacMaskProcess },
+	{ MODBOARD,		2,	0,	2,	0,			ModModeProcess },
+	{ COLORMODE,	1,	0,	0,	0,			ColorModeProcess },
+	{ COLORCHAN,	2,	0,	0,	0,			ColorChanProcess },
+	{ ERRRATE,		0,	0,	3,	0,			ErrRateProcess },
+	{ STATUS,		0,	0,	14,	0,			StatusProcess },
+	{ DEFAULTSET,	0,	0,	sizeof(fpgainfo),	0,	FpgaDefaultProcess },
+	{ CODEIDSRL,	0,	0,	20,	0,			CardIdProcess },
+	{ MCODEUPGRADE,	7,	7,	7 + FUPBLKNUM * 4,	CMDF_REPLY,	UpgradeProcee },
+	{ SYSRESET,		1,	1,	0,	0,			SystemResetProcess },
+	{ RMTIDSET,		0,	0,	sizeof(getidmacmsg),	0,	GetIdMacProcess },
+};
+
+static cmdtable cpucmdtbl =
+{
+	cpucmdentry, sizeof(cpucmdentry) / sizeof(cpucmdentry[0]),
+	SRLMAXBUFF - sizeof(msghead) - sizeof(serial10Gcmd) - sizeof(cmdend)
+};
+
+/* commands from the console queue, payload at &utccp->subcmd + 1 */
+static const cmdentry comcmdentry[] =
+{
+/*	  subcmd		set	get	rsp	flags		process */
+#if 0
+	{ MACINFO,		7,	1,	21,	0,			MacInfoProcess },
+	{ CHANMASK,		2,	1,	32,	0,			ChanMaskProcess },
+	{ MODBOARD,		2,	0,	2,	0,			ModModeProcess },
+	{ ERRRATE,		0,	0,	3,	0,			ErrRateProcess },
+	{ STATUS,		0,	0,	14,	0,			StatusProcess },
+	{ DEFAULTSET,	0,	0,	sizeof(fpgainfo),	0,	FpgaDefaultProcess },
+	{ RMTIDSET,		0,	0,	1 + RMTID_MAXNUM * 6,	0,	RMTIdInfoProcess },
+	{ FPGAREG,		2,	1,	2,	0,			FpgaRegProcess },
+#endif
+	{ BOARDRMTSET,	5,	1,	5,	0,			BoardInfoProcess },
+};
+
+static cmdtable comcmdtbl =
+{
+	comcmdentry, sizeof(comcmdentry) / sizeof(comcmdentry[0]),
+	COMCMDBUFF - sizeof(uart2cmd)
+};
+
+/* Index a command table by subcmd, dropping entries that could not be served */
+static void CmdTableBuild(cmdtablep ctp)
+{
+	const cmdentry *ep = ctp->entry;
+	unsigned char i;
+
+	memset(ctp->idx, 0, sizeof(ctp->idx));
+	for (i = 0; i < ctp->num; i++, ep++)
+	{
+		if ((ep->subcmd >= CMDIDXSIZE) || ctp->idx[ep->subcmd] ||
+			(ep->process == NULL) || (ep->rsplen > ctp->room))
+		{
+			st_fpga_debug(ST_FPGA_ERROR, "bad command entry 0x%02x\r\n", ep->subcmd);
+			continue;
+		}
+		ctp->idx[ep->subcmd] = i + 1;
+	}
+}
+
+/* Find the entry for subcmd, or NULL if it is unknown or its payload is short */
+static const cmdentry *CmdTableGet(cmdtablep ctp, unsigned char subcmd, int op, int size)
+{
+	const cmdentry *ep;
+
+	if ((subcmd >= CMDIDXSIZE) || !ctp->idx[subcmd])
+	{
+		return NULL;
+	}
+	ep = &ctp->entry[ctp->idx[subcmd] - 1];
+	if (size < (op ? ep->getlen : ep->setlen))
+	{
+		st_fpga_debug(ST_FPGA_INFO, "command 0x%02x payload %d too short\r\n", subcmd, size);
+		return NULL;
+	}
+	return ep;
+}
+
+void CmdTableInit(void)
+{
+	CmdTableBuild(&cpucmdtbl);
+	CmdTableBuild(&comcmdtbl);
+}
+
+/* Turn the request frame into the reply to the cpu and send it */
+static void CpuMsgReply(msgheadp msgp, serial10Gcmdp ccp, int msgsize)
+{
+	cmdendp endp;
+
+	msgp->src = REMOTE_MCU;
+#if 1
+	msgp->dst = LOCAL_MCU;
+#else
+	msgp->dst = (BOX_CPU | ((ccp->slecport & 0x0f) << 4));
+#endif
+	msgp->len = msgsize + sizeof(serial10Gcmd) + 2; 	// len = sizeof(msghead) + msgsize + sizeof(serial10Gcmd) + 2 - 1;
+	ccp->head.len = msgp->len - sizeof(ccp->head);
+	ccp->cmd = CMDREQ;
+	endp = (cmdendp)(((unsigned char *)&ccp->subcmd + 1) + msgsize);
+	ccp->head.len = MsgLenSet(ccp->head.len);
+	endp->crc = CrcCreat((unsigned char *)&ccp->head.boxid, msgp->len - 3);
+	endp->end = NMSGEND;
+	Uart1Pollputc((unsigned char *)msgp, msgp->len + sizeof(msghead));
+}
+
 void CpuMsgExe(unsigned char *buf, unsigned int size)
 {
 	msgheadp msgp = (msgheadp) buf;
@@ -1211,8 +1334,11 @@ void CpuMsgExe(unsigned char *buf, unsigned int size)
 	unsigned int cnt = size;
 	unsigned char port;
 	int msgsize = MsgLenGet(ccp->head.len) - (&ccp->subcmd - &ccp->cmd + 1) - 2;
-	cmdendp endp;
+	const cmdentry *ep;
 	
+	if (msgsize < 0) {
+		return;
+	}
 	ccp->mask &= ALLOPMASK;
 	if (ccp->mask) {
 		if ((ccp->remoteid == boardif->remoteid) || (ccp->remoteid == BOARDCASTID)) {
@@ -1223,79 +1349,16 @@ void CpuMsgExe(unsigned char *buf, unsigned int size)
 
 			/* display command code message */
 			CpuMsgDump(ccp->subcmd);
-			switch (ccp->subcmd) {
-				case MACINFO:
-					MacInfoProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case CHANMASK:
-					ChanMaskProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case MACMASK:
-					MacMaskProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case MODBOARD:
-					ModModeProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case COLORMODE:
-					ColorModeProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case COLORCHAN:
-					ColorChanProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case ERRRATE:
-					ErrRateProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case STATUS:
-					StatusProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case DEFAULTSET:
-					FpgaDefaultProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case BOARDRMTSET:
-//					BoardInfoProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case CODEIDSRL:
-					CardIdProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case MCODEUPGRADE:
-                  {
-                    //				upgrademsgp up;
-					unsigned int swpsize;
+			ep = CmdTableGet(&cpucmdtbl, ccp->subcmd, ccp->cmd, msgsize);
+			if (ep != NULL) {
+				if (ep->flags & CMDF_REPLY) {
 					ccp->cmd = CMDREQ;
-					//msgsize -= 6;
-	//				up = (upgrademsgp)&ccp->subcmd + 1;
-
-					swpsize = *(unsigned int *)(&ccp->subcmd + 4);
-					*(unsigned int *)(&ccp->subcmd + 4) = SWP32(swpsize);
-
-					UpgradeProcee(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-                  }
-					break;
-				case SYSRESET:
-					SystemResetProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				case RMTIDSET:
-					GetIdMacProcess(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
-					break;
-				default:
-					break;
+				}
+				ep->process(port, &ccp->subcmd + 1, &msgsize, ccp->cmd);
 			}
 			
 			if (ccp->cmd) {
-				msgp->src = REMOTE_MCU;
-#if 1
-				msgp->dst = LOCAL_MCU;
-#else
-				msgp->dst = (BOX_CPU | ((ccp->slecport & 0x0f) << 4));
-#endif
-				msgp->len = msgsize + sizeof(serial10Gcmd) + 2; 	// len = sizeof(msghead) + msgsize + sizeof(serial10Gcmd) + 2 - 1;
-				ccp->head.len = msgp->len - sizeof(ccp->head);
-				ccp->cmd = CMDREQ;
-				endp = (cmdendp)(((unsigned char *)&ccp->subcmd + 1) + msgsize);
-				ccp->head.len = MsgLenSet(ccp->head.len);
-				endp->crc = CrcCreat((unsigned char *)&ccp->head.boxid, msgp->len - 3);
-				endp->end = NMSGEND;
-				Uart1Pollputc((unsigned char *)msgp, msgp->len + sizeof(msghead));
+				CpuMsgReply(msgp, ccp, msgsize);
 			}
 		}
 	}
@@ -1321,8 +1384,10 @@ void LocalMcuExe(unsigned char *buf, unsigned int size)
 	unsigned char port;
 	unsigned char slecport;
 	int msgsize = MsgLenGet(ccp->head.len) - (&ccp->subcmd - &ccp->cmd + 1) - 2;
-	cmdendp endp;
 	
+	if (msgsize < 0) {
+		return;
+	}
 	ccp->mask &= ALLOPMASK;
 	if (ccp->mask) {
 		if ((ccp->remoteid == boardif->remoteid) || (ccp->remoteid == BOARDCASTID)) {
@@ -1342,20 +1407,7 @@ void LocalMcuExe(unsigned char *buf, unsigned int size)
 			}
 			
 			if (ccp->cmd) {
-				msgp->src = REMOTE_MCU;
-#if 1
-				msgp->dst = LOCAL_MCU;
-#else
-				msgp->dst = (BOX_CPU | ((ccp->slecport & 0x0f) << 4));
-#endif
-				msgp->len = msgsize + sizeof(serial10Gcmd) + 2; 	// len = sizeof(msghead) + msgsize + sizeof(serial10Gcmd) + 2 - 1;
-				ccp->head.len = msgp->len - sizeof(ccp->head);
-				ccp->cmd = CMDREQ;
-				endp = (cmdendp)(((unsigned char *)&ccp->subcmd + 1) + msgsize);
-				ccp->head.len = MsgLenSet(ccp->head.len);
-				endp->crc = CrcCreat((unsigned char *)&ccp->head.boxid, msgp->len - 3);
-				endp->end = NMSGEND;
-				Uart1Pollputc((unsigned char *)msgp, msgp->len + sizeof(msghead));
+				CpuMsgReply(msgp, ccp, msgsize);
 			}
 		}
 	}
@@ -1461,12 +1513,12 @@ void NetCmdExe(void)
 	boardinfop boardif = &localboard;
 	unsigned int ret, cmdcnt;
 	unsigned short int cnt = 0;
-	unsigned char buff[256];
+	unsigned char buff[SRLMAXBUFF];
 	unsigned char crc;
 	msgheadp msgp;
 	serial10Gcmdp ccp;
 	unsigned char id;
-	while ((ut1fp->head != ut1fp->tail) && (ret =  Fifo_Read(ut1fp, (unsigned char *)&cnt, sizeof(cnt))))
+	while (Fifo_Used(ut1fp) && (ret =  Fifo_Read(ut1fp, (unsigned char *)&cnt, sizeof(cnt))))
 	{
 		ret = Fifo_Read(ut1fp, buff, cnt);
 		if ((buff[0] == NMSGHLD) && (buff[cnt - 1] == NMSGEND))
@@ -1479,7 +1531,7 @@ void NetCmdExe(void)
 //				ccp->head.len =  MsgLenGet(ccp->head.len);
 				if ((cmdcnt - sizeof(cmdhead)) != MsgLenGet(ccp->head.len))
 				{
-					return;
+					continue;
 				}
 				crc = CrcCreat(&ccp->head.boxid, (cmdcnt - 3));
 
@@ -1488,7 +1540,7 @@ void NetCmdExe(void)
 #else
 				if (buff[cnt - 2] != crc)
 				{
-					return;
+					continue;
 				}
 #endif
 
@@ -1652,64 +1704,19 @@ void Com1Exe(void)
 
 void ComCmdExe(void)
 {
-	unsigned char buff[64];
+	unsigned char buff[COMCMDBUFF];
 	uart2cmdp utccp;
+	const cmdentry *ep;
 	int ret;
-	unsigned short int cnt = 0;
-	unsigned char  debugen;
 
 	while(ret = HalQueueRead((int8_t *)buff, 0))
 	{
 		utccp = (uart2cmdp)buff;
 		ret -= ((&utccp->subcmd - &utccp->head) - 1);
-		switch (utccp->subcmd)
+		ep = CmdTableGet(&comcmdtbl, utccp->subcmd, utccp->cmd, ret);
+		if (ep != NULL)
 		{
-#if 0
-			case MACINFO:
-				MacInfoProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case CHANMASK:
-				ChanMaskProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case MACMASK:
-//				MacMaskProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case MODBOARD:
-				ModModeProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case COLORMODE:
-//				ColorModeProcess(utccp->port, &utccp->subcmd + 1, &ret, utccp->cmd);
-				break;
-			case COLORCHAN:
-//				ColorChanProcess(utccp->port, &utccp->subcmd + 1, &ret, utccp->cmd);
-			case  ERRRATE:
-				ErrRateProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case STATUS:
-				StatusProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case DEFAULTSET:
-				FpgaDefaultProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case RMTIDSET:
-				RMTIdInfoProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-
-			case FPGAREG:
-				FpgaRegProcess(utccp->port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			case PHYREG:{
-				unsigned char port;
-				port = (utccp->port) ? PHYCHAN2 : PHYCHAN1;
-				PhyRegProcess(port, &utccp->rev, &ret, utccp->cmd);
-				break;
-			}
-#endif
-			case BOARDRMTSET:
-				BoardInfoProcess(utccp->port, &utccp->subcmd + 1, &ret, utccp->cmd);
-				break;
-			default:
-				break;
+			ep->process(utccp->port, &utccp->subcmd + 1, &ret, utccp->cmd);
 		}
 		if (utccp->cmd)
 		{
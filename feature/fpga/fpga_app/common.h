@@ -474,6 +474,7 @@ void FpgaRegSet(void);
 void NetCmdExe();
 void Com1Exe();
 void ComCmdExe(void);
+void CmdTableInit(void);
 void PhyDet(unsigned int *timeblink);
 void DeviceInfoInit(void);
 char* BoardInfoGet(void);
@@ -24,6 +24,7 @@
 #include "hal_io.h"
 #include "halcmd_msg.h"
 #include "fpga_api.h"
+#include "tsensor.h"
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -41,16 +42,43 @@ uartxinfo uart1conf =
 };
 #endif
 
+/* set while the chip temperature is above TS_TEMP_HIGH */
+static unsigned char fpgatempalarm;
+
 /* Private function prototypes -----------------------------------------------*/
 void BoardPeriphInit(void);
 void SYSHalInit(void);
 
 /* Private functions ---------------------------------------------------------*/
 
+/* Act on the threshold events latched by the ADC filter */
+static void TempEventCheck(void)
+{
+    u32 ev = TSensorEventGet();
+
+    if (ev & TS_EVT_HIGH(TS_IDX_TEMP))
+    {
+        fpgatempalarm = 1;
+        st_fpga_debug(ST_FPGA_ERROR, "over temperature, above %dC", TS_TEMP_HIGH);
+    }
+    if (ev & TS_EVT_LOW(TS_IDX_TEMP))
+    {
+        fpgatempalarm = 0;
+        st_fpga_debug(ST_FPGA_INFO, "temperature back below %dC", TS_TEMP_LOW);
+    }
+}
+
+unsigned char fpga_temp_alarm_get(void)
+{
+    return fpgatempalarm;
+}
+
 void fpga_task(void *arg)
 {
     SYSHalInit();
     BoardPeriphInit(); 
+    CmdTableInit();
+    TSensorThresholdSet(ADC_Channel_TempSensor, TS_TEMP_RAW(TS_TEMP_HIGH), TS_TEMP_RAW(TS_TEMP_LOW));
     
     for(;;){
         
@@ -59,9 +87,11 @@ void fpga_task(void *arg)
 		ComCmdExe();
 //		PhyDet(&pdettime);
 		UartR1TimeoutSet();
+		TempEventCheck();
 //		UartR2TimeoutSet();
 //		An_test();
-        vTaskDelay(1);
+        /* sleep until a frame arrives; the timeout expires partial uart1 frames */
+        HalCmdWait(MBLINK / portTICK_RATE_MS);
     }
 }
 
@@ -74,6 +104,7 @@ void fpga_task_init(void)
 void SYSHalInit(void)
 {
 	//SysTick_Config(SystemCoreClock / (1000)); //8M
+	Delay_Init();
 	/* uart Init */
 #if	((defined HAL_UART1) && HAL_UART1)
 	UartxInit(&uart1conf, TXDERXEN);
@@ -139,11 +170,8 @@ void BoardPeriphInit(void)
     
     Si5324AllGetReg(I2CDEV_0, SI5324ADD1, temp2_p);
     
-#if BOARD_GV3S_HONUE_QM
-    vTaskDelay(1000);
-#else
-    Delay_Ms(1000);
-#endif
+    /* wait for the clock to lock instead of a fixed second */
+    Si5324WaitLock(I2CDEV_0, SI5324ADD1, 1000);
 
     BoardInfoGet();
  }
@@ -21,6 +21,7 @@ extern "C" {
 /* Exported functions --------------------------------------------------------*/ 
 void fpga_task_init(void);
 void dev_reset(void);
+unsigned char fpga_temp_alarm_get(void);
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
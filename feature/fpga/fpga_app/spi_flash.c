@@ -52,6 +52,14 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "spi_flash.h"
+#include "delay.h"
+#include "ob_image.h"
+#include <string.h>
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
 
 /**
   * @brief  Erases the specified FLASH sector.
@@ -61,11 +69,24 @@
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+/* Operation left running in the FLASH, waited for by SPI3_FLASH_Sync */
+#define SPI3_FLASH_PEND_NONE      0
+#define SPI3_FLASH_PEND_PROG      1
+#define SPI3_FLASH_PEND_ERASE     2
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
+static xSemaphoreHandle SPI3FlashDmaSem = NULL;
+static uint8_t SPI3FlashPending = SPI3_FLASH_PEND_NONE;
+static const uint8_t SPI3FlashDummy = sFLASH_DUMMY_BYTE;
+static uint8_t SPI3FlashSink;
+
 /* Private function prototypes -----------------------------------------------*/
 void SPI3_FLASH_LowLevel_DeInit(void);
 void SPI3_FLASH_LowLevel_Init(void); 
+static void SPI3_FLASH_DmaStart(const uint8_t* pTx, uint8_t* pRx, uint16_t Num);
+static int SPI3_FLASH_DmaWait(void);
+static int SPI3_FLASH_WaitReady(uint32_t PollMs, uint32_t Timeout);
 
 /* Private functions ---------------------------------------------------------*/
 
@@ -108,6 +129,14 @@ void SPI3_FLASH_Init(void)
 
   /*!< Enable the sFLASH_SPI  */
   SPI_Cmd(SPI3_FLASH_SPI, ENABLE);
+
+  /*!< DMA completion semaphore, kept across SPI3_MCU_pin_to_3state */
+  if (SPI3FlashDmaSem == NULL)
+  {
+    vSemaphoreCreateBinary(SPI3FlashDmaSem);
+    if (SPI3FlashDmaSem != NULL)
+      xSemaphoreTake(SPI3FlashDmaSem, 0);
+  }
 }
 
 /**
@@ -152,6 +181,24 @@ void SPI3_MCU_pin_to_3state(void)
   */
 void SPI3_FLASH_EraseSector(uint32_t SectorAddr)
 {
+  SPI3_FLASH_EraseSectorStart(SectorAddr);
+
+  /*!< Wait the end of Flash erasing, sleeping between status polls */
+  SPI3_FLASH_Sync();
+}
+
+/**
+  * @brief  Starts erasing the specified FLASH sector and returns at once.
+  * @note   The erase keeps running in the FLASH, the next access to it waits
+  *         in SPI3_FLASH_Sync, so the caller can receive more data meanwhile.
+  * @param  SectorAddr: address of the sector to erase.
+  * @retval None
+  */
+void SPI3_FLASH_EraseSectorStart(uint32_t SectorAddr)
+{
+  /*!< Let the previous program or erase finish */
+  SPI3_FLASH_Sync();
+
   /*!< Send write enable instruction */
   SPI3_FLASH_WriteEnable();
 
@@ -169,8 +216,7 @@ void SPI3_FLASH_EraseSector(uint32_t SectorAddr)
   /*!< Deselect the FLASH: Chip Select high */
   SPI3_FLASH_CS_HIGH();
 
-  /*!< Wait the end of Flash writing */
-  SPI3_FLASH_WaitForWriteEnd();
+  SPI3FlashPending = SPI3_FLASH_PEND_ERASE;
 }
 
 /**
@@ -180,6 +226,9 @@ void SPI3_FLASH_EraseSector(uint32_t SectorAddr)
   */
 void SPI3_FLASH_EraseBulk(void)
 {
+  /*!< Let the previous program or erase finish */
+  SPI3_FLASH_Sync();
+
   /*!< Send write enable instruction */
   SPI3_FLASH_WriteEnable();
 
@@ -199,6 +248,8 @@ void SPI3_FLASH_EraseBulk(void)
   * @brief  Writes more than one byte to the FLASH with a single WRITE cycle 
   *         (Page WRITE sequence).
   * @note   The number of byte can't exceed the FLASH page size.
+  * @note   Returns once the page is sent, the program cycle is waited for by
+  *         the next access to the FLASH (SPI3_FLASH_Sync).
   * @param  pBuffer: pointer to the buffer  containing the data to be written
   *         to the FLASH.
   * @param  WriteAddr: FLASH's internal address to write to.
@@ -208,6 +259,9 @@ void SPI3_FLASH_EraseBulk(void)
   */
 void SPI3_FLASH_WritePage(uint8_t* pBuffer, uint32_t WriteAddr, uint16_t NumByteToWrite)
 {
+  /*!< Let the previous program or erase finish */
+  SPI3_FLASH_Sync();
+
   /*!< Enable the write access to the FLASH */
   SPI3_FLASH_WriteEnable();
 
@@ -222,20 +276,28 @@ void SPI3_FLASH_WritePage(uint8_t* pBuffer, uint32_t WriteAddr, uint16_t NumByte
   /*!< Send WriteAddr low nibble address byte to write to */
   SPI3_FLASH_SendByte(WriteAddr & 0xFF);
 
-  /*!< while there is data to be written on the FLASH */
-  while (NumByteToWrite--)
+  if (NumByteToWrite >= SPI3_FLASH_DMA_MIN)
   {
-    /*!< Send the current byte */
-    SPI3_FLASH_SendByte(*pBuffer);
-    /*!< Point on the next byte to be written */
-    pBuffer++;
+    /*!< Send the page through DMA */
+    SPI3_FLASH_DmaStart(pBuffer, NULL, NumByteToWrite);
+    SPI3_FLASH_DmaWait();
+  }
+  else
+  {
+    /*!< while there is data to be written on the FLASH */
+    while (NumByteToWrite--)
+    {
+      /*!< Send the current byte */
+      SPI3_FLASH_SendByte(*pBuffer);
+      /*!< Point on the next byte to be written */
+      pBuffer++;
+    }
   }
 
   /*!< Deselect the FLASH: Chip Select high */
   SPI3_FLASH_CS_HIGH();
 
-  /*!< Wait the end of Flash writing */
-  SPI3_FLASH_WaitForWriteEnd();
+  SPI3FlashPending = SPI3_FLASH_PEND_PROG;
 }
 
 /**
@@ -327,6 +389,9 @@ void SPI3_FLASH_WriteBuffer(uint8_t* pBuffer, uint32_t WriteAddr, uint16_t NumBy
   */
 void SPI3_FLASH_ReadBuffer(uint8_t* pBuffer, uint32_t ReadAddr, uint16_t NumByteToRead)
 {
+  /*!< Let the previous program or erase finish */
+  SPI3_FLASH_Sync();
+
   /*!< Select the FLASH: Chip Select low */
   SPI3_FLASH_CS_LOW();
 
@@ -340,12 +405,21 @@ void SPI3_FLASH_ReadBuffer(uint8_t* pBuffer, uint32_t ReadAddr, uint16_t NumByte
   /*!< Send ReadAddr low nibble address byte to read from */
   SPI3_FLASH_SendByte(ReadAddr & 0xFF);
 
-  while (NumByteToRead--) /*!< while there is data to be read */
+  if (NumByteToRead >= SPI3_FLASH_DMA_MIN)
   {
-    /*!< Read a byte from the FLASH */
-    *pBuffer = SPI3_FLASH_SendByte(sFLASH_DUMMY_BYTE);
-    /*!< Point to the next location where the byte read will be saved */
-    pBuffer++;
+    /*!< Receive the data through DMA */
+    SPI3_FLASH_DmaStart(NULL, pBuffer, NumByteToRead);
+    SPI3_FLASH_DmaWait();
+  }
+  else
+  {
+    while (NumByteToRead--) /*!< while there is data to be read */
+    {
+      /*!< Read a byte from the FLASH */
+      *pBuffer = SPI3_FLASH_SendByte(sFLASH_DUMMY_BYTE);
+      /*!< Point to the next location where the byte read will be saved */
+      pBuffer++;
+    }
   }
 
   /*!< Deselect the FLASH: Chip Select high */
@@ -361,6 +435,9 @@ uint32_t SPI3_FLASH_ReadID(void)
 {
   uint32_t Temp = 0, Temp0 = 0, Temp1 = 0, Temp2 = 0;
 
+  /*!< Let the previous program or erase finish */
+  SPI3_FLASH_Sync();
+
   /*!< Select the FLASH: Chip Select low */
   SPI3_FLASH_CS_LOW();
 
@@ -395,6 +472,9 @@ uint32_t SPI3_FLASH_ReadID(void)
   */
 void SPI3_FLASH_StartReadSequence(uint32_t ReadAddr)
 {
+  /*!< Let the previous program or erase finish */
+  SPI3_FLASH_Sync();
+
   /*!< Select the FLASH: Chip Select low */
   SPI3_FLASH_CS_LOW();
 
@@ -489,7 +569,22 @@ void SPI3_FLASH_WriteEnable(void)
   */
 void SPI3_FLASH_WaitForWriteEnd(void)
 {
-  uint8_t flashstatus = 0;
+  /*!< Loop as long as the memory is busy with a write cycle */
+  SPI3_FLASH_WaitReady(0, 0);
+  SPI3FlashPending = SPI3_FLASH_PEND_NONE;
+}
+
+/**
+  * @brief  Polls the WIP flag until the FLASH is ready.
+  * @param  PollMs: 0 to spin on the status register, else sleep this many ms
+  *         between reads of it.
+  * @param  Timeout: ms before giving up, only used when PollMs is not 0.
+  * @retval 0 when ready, -1 on timeout.
+  */
+static int SPI3_FLASH_WaitReady(uint32_t PollMs, uint32_t Timeout)
+{
+  uint32_t waited = 0;
+  int ret = 0;
 
   /*!< Select the FLASH: Chip Select low */
   SPI3_FLASH_CS_LOW();
@@ -497,18 +592,274 @@ void SPI3_FLASH_WaitForWriteEnd(void)
   /*!< Send "Read Status Register" instruction */
   SPI3_FLASH_SendByte(sFLASH_CMD_RDSR);
 
-  /*!< Loop as long as the memory is busy with a write cycle */
-  do
+  /*!< Each dummy byte clocks out the status register again */
+  while ((SPI3_FLASH_SendByte(sFLASH_DUMMY_BYTE) & sFLASH_WIP_FLAG) == SET)
   {
-    /*!< Send a dummy byte to generate the clock needed by the FLASH
-    and put the value of the status register in FLASH_Status variable */
-    flashstatus = SPI3_FLASH_SendByte(sFLASH_DUMMY_BYTE);
+    if (PollMs == 0)
+      continue;
+    if (waited >= Timeout)
+    {
+      ret = -1;
+      break;
+    }
+    Delay_Ms(PollMs);
+    waited += PollMs;
+  }
 
+  /*!< Deselect the FLASH: Chip Select high */
+  SPI3_FLASH_CS_HIGH();
+
+  return ret;
+}
+
+/**
+  * @brief  Waits for the program or erase left running by the last call.
+  * @note   Page programs (a few ms at most) are spun on, sector erases sleep
+  *         SPI3_FLASH_ERASE_POLL ms between status reads.
+  * @param  None
+  * @retval 0 when the FLASH is ready, -1 if the erase timed out.
+  */
+int SPI3_FLASH_Sync(void)
+{
+  uint8_t pending = SPI3FlashPending;
+
+  SPI3FlashPending = SPI3_FLASH_PEND_NONE;
+  if (pending == SPI3_FLASH_PEND_ERASE)
+    return SPI3_FLASH_WaitReady(SPI3_FLASH_ERASE_POLL, SPI3_FLASH_ERASE_TIMEOUT);
+  if (pending == SPI3_FLASH_PEND_PROG)
+    return SPI3_FLASH_WaitReady(0, 0);
+  return 0;
+}
+
+/**
+  * @brief  Programs an erased area page by page. Pages left all 0xFF already
+  *         match the erased state and are skipped.
+  * @param  pBuffer: pointer to the data to be written to the FLASH.
+  * @param  WriteAddr: FLASH's internal address to write to.
+  * @param  NumByteToWrite: number of bytes to write to the FLASH.
+  * @retval None
+  */
+void SPI3_FLASH_Program(uint8_t* pBuffer, uint32_t WriteAddr, uint32_t NumByteToWrite)
+{
+  uint32_t count, i;
+
+  while (NumByteToWrite)
+  {
+    count = sFLASH_SPI_PAGESIZE - (WriteAddr % sFLASH_SPI_PAGESIZE);
+    if (count > NumByteToWrite)
+      count = NumByteToWrite;
+
+    for (i = 0; (i < count) && (pBuffer[i] == 0xFF); i++);
+    if (i != count)
+      SPI3_FLASH_WritePage(pBuffer, WriteAddr, count);
+
+    pBuffer += count;
+    WriteAddr += count;
+    NumByteToWrite -= count;
+  }
+}
+
+/**
+  * @brief  Reads an area back and runs it through crc32 (ob_image.c).
+  * @note   Two SPI3_FLASH_CRC_CHUNK buffers are used, the next one is filled
+  *         by DMA while the current one is summed.
+  * @param  ReadAddr: FLASH's internal address to read from.
+  * @param  NumByteToRead: number of bytes to check.
+  * @param  pCrc: running crc32 in, updated crc32 out.
+  * @retval 0 on success, -1 if a DMA transfer timed out.
+  */
+int SPI3_FLASH_Crc(uint32_t ReadAddr, uint32_t NumByteToRead, uint32_t *pCrc)
+{
+  static uint8_t crcbuf[2][SPI3_FLASH_CRC_CHUNK];
+  uint32_t crc = *pCrc, count, next;
+  uint8_t cur = 0;
+  int ret = 0;
+
+  if (NumByteToRead == 0)
+    return 0;
+
+  SPI3_FLASH_StartReadSequence(ReadAddr);
+
+  count = (NumByteToRead > SPI3_FLASH_CRC_CHUNK) ? SPI3_FLASH_CRC_CHUNK : NumByteToRead;
+  SPI3_FLASH_DmaStart(NULL, crcbuf[cur], count);
+  while (NumByteToRead)
+  {
+    if (SPI3_FLASH_DmaWait() != 0)
+    {
+      ret = -1;
+      break;
+    }
+    NumByteToRead -= count;
+
+    next = (NumByteToRead > SPI3_FLASH_CRC_CHUNK) ? SPI3_FLASH_CRC_CHUNK : NumByteToRead;
+    if (next)
+      SPI3_FLASH_DmaStart(NULL, crcbuf[cur ^ 1], next);
+
+    crc = crc32(crc, crcbuf[cur], count);
+    cur ^= 1;
+    count = next;
   }
-  while ((flashstatus & sFLASH_WIP_FLAG) == SET); /* Write in progress */
 
   /*!< Deselect the FLASH: Chip Select high */
   SPI3_FLASH_CS_HIGH();
+
+  *pCrc = crc;
+  return ret;
+}
+
+/**
+  * @brief  Copies an area of the FLASH to another sector aligned one.
+  * @note   Destination sectors that already hold the data are neither erased
+  *         nor programmed, blank pages are skipped by SPI3_FLASH_Program.
+  *         The result is checked by comparing the crc32 of both areas.
+  * @param  DstAddr: sector aligned destination address.
+  * @param  SrcAddr: source address.
+  * @param  NumByteToCopy: number of bytes to copy.
+  * @retval 0 on success, -1 on verify error.
+  */
+int SPI3_FLASH_Copy(uint32_t DstAddr, uint32_t SrcAddr, uint32_t NumByteToCopy)
+{
+  static uint8_t srcbuf[sFLASH_SPI_PAGESIZE], dstbuf[sFLASH_SPI_PAGESIZE];
+  uint32_t sector, seclen, offs, count;
+  uint32_t srccrc = 0, dstcrc = 0;
+
+  for (sector = 0; sector < NumByteToCopy; sector += sFLASH_SPI_SECTORSIZE)
+  {
+    seclen = NumByteToCopy - sector;
+    if (seclen > sFLASH_SPI_SECTORSIZE)
+      seclen = sFLASH_SPI_SECTORSIZE;
+
+    for (offs = 0; offs < seclen; offs += count)
+    {
+      count = (seclen - offs > sFLASH_SPI_PAGESIZE) ? sFLASH_SPI_PAGESIZE : seclen - offs;
+      SPI3_FLASH_ReadBuffer(srcbuf, SrcAddr + sector + offs, count);
+      SPI3_FLASH_ReadBuffer(dstbuf, DstAddr + sector + offs, count);
+      if (memcmp(srcbuf, dstbuf, count) != 0)
+        break;
+    }
+    if (offs >= seclen)
+      continue;
+
+    SPI3_FLASH_EraseSectorStart(DstAddr + sector);
+    for (offs = 0; offs < seclen; offs += count)
+    {
+      count = (seclen - offs > sFLASH_SPI_PAGESIZE) ? sFLASH_SPI_PAGESIZE : seclen - offs;
+      SPI3_FLASH_ReadBuffer(srcbuf, SrcAddr + sector + offs, count);
+      SPI3_FLASH_Program(srcbuf, DstAddr + sector + offs, count);
+    }
+  }
+
+  if ((SPI3_FLASH_Crc(SrcAddr, NumByteToCopy, &srccrc) != 0) ||
+      (SPI3_FLASH_Crc(DstAddr, NumByteToCopy, &dstcrc) != 0))
+    return -1;
+
+  return (srccrc == dstcrc) ? 0 : -1;
+}
+
+/**
+  * @brief  Starts a full duplex DMA transfer on SPI3, Chip Select is left to
+  *         the caller.
+  * @param  pTx: data to send, NULL to send dummy bytes.
+  * @param  pRx: buffer for the received data, NULL to drop it.
+  * @param  Num: number of bytes.
+  * @retval None
+  */
+static void SPI3_FLASH_DmaStart(const uint8_t* pTx, uint8_t* pRx, uint16_t Num)
+{
+  DMA_InitTypeDef DMA_InitStructure;
+
+  DMA_Cmd(SPI3_FLASH_RX_DMA_STREAM, DISABLE);
+  DMA_Cmd(SPI3_FLASH_TX_DMA_STREAM, DISABLE);
+  DMA_ClearFlag(SPI3_FLASH_RX_DMA_STREAM, SPI3_FLASH_RX_DMA_FLAGS);
+  DMA_ClearFlag(SPI3_FLASH_TX_DMA_STREAM, SPI3_FLASH_TX_DMA_FLAGS);
+  if (SPI3FlashDmaSem != NULL)
+    xSemaphoreTake(SPI3FlashDmaSem, 0);
+
+  DMA_StructInit(&DMA_InitStructure);
+  DMA_InitStructure.DMA_Channel = SPI3_FLASH_DMA_CHANNEL;
+  DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&SPI3_FLASH_SPI->DR;
+  DMA_InitStructure.DMA_BufferSize = Num;
+
+  /*!< rx stream runs first in priority so the SPI never overruns */
+  DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (pRx != NULL) ? (uint32_t)pRx : (uint32_t)&SPI3FlashSink;
+  DMA_InitStructure.DMA_MemoryInc = (pRx != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_VeryHigh;
+  DMA_Init(SPI3_FLASH_RX_DMA_STREAM, &DMA_InitStructure);
+
+  DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+  DMA_InitStructure.DMA_Memory0BaseAddr = (pTx != NULL) ? (uint32_t)pTx : (uint32_t)&SPI3FlashDummy;
+  DMA_InitStructure.DMA_MemoryInc = (pTx != NULL) ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+  DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+  DMA_Init(SPI3_FLASH_TX_DMA_STREAM, &DMA_InitStructure);
+
+  DMA_ITConfig(SPI3_FLASH_RX_DMA_STREAM, DMA_IT_TC, ENABLE);
+
+  /*!< Drop a stale byte so rx starts in step with tx */
+  SPI_I2S_ReceiveData(SPI3_FLASH_SPI);
+
+  DMA_Cmd(SPI3_FLASH_RX_DMA_STREAM, ENABLE);
+  DMA_Cmd(SPI3_FLASH_TX_DMA_STREAM, ENABLE);
+  SPI_I2S_DMACmd(SPI3_FLASH_SPI, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+}
+
+/**
+  * @brief  Waits for the transfer started by SPI3_FLASH_DmaStart. The task
+  *         sleeps on the rx complete interrupt, before the scheduler runs the
+  *         stream enable bit is polled.
+  * @param  None
+  * @retval 0 on success, -1 on timeout.
+  */
+static int SPI3_FLASH_DmaWait(void)
+{
+  uint32_t waited = 0;
+  int ret = 0;
+
+  if ((SPI3FlashDmaSem != NULL) && (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING))
+  {
+    if (xSemaphoreTake(SPI3FlashDmaSem, SPI3_FLASH_DMA_TIMEOUT / portTICK_RATE_MS + 1) != pdTRUE)
+      ret = -1;
+  }
+  else
+  {
+    while (DMA_GetCmdStatus(SPI3_FLASH_RX_DMA_STREAM) != DISABLE)
+    {
+      if (waited++ >= SPI3_FLASH_DMA_TIMEOUT * 1000)
+      {
+        ret = -1;
+        break;
+      }
+      Delay_Us(1);
+    }
+  }
+
+  if (ret != 0)
+  {
+    DMA_Cmd(SPI3_FLASH_RX_DMA_STREAM, DISABLE);
+    DMA_Cmd(SPI3_FLASH_TX_DMA_STREAM, DISABLE);
+  }
+  DMA_ITConfig(SPI3_FLASH_RX_DMA_STREAM, DMA_IT_TC, DISABLE);
+  SPI_I2S_DMACmd(SPI3_FLASH_SPI, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+
+  return ret;
+}
+
+/**
+  * @brief  SPI3 rx DMA transfer complete.
+  * @param  None
+  * @retval None
+  */
+void DMA1_Stream2_IRQHandler(void)
+{
+  portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+  if (DMA_GetITStatus(SPI3_FLASH_RX_DMA_STREAM, SPI3_FLASH_RX_DMA_IT_TC) != RESET)
+  {
+    DMA_ClearITPendingBit(SPI3_FLASH_RX_DMA_STREAM, SPI3_FLASH_RX_DMA_IT_TC);
+    if (SPI3FlashDmaSem != NULL)
+      xSemaphoreGiveFromISR(SPI3FlashDmaSem, &xHigherPriorityTaskWoken);
+  }
+  portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
 }
 
 /**
@@ -519,6 +870,7 @@ void SPI3_FLASH_WaitForWriteEnd(void)
 void SPI3_FLASH_LowLevel_Init(void)
 {
   GPIO_InitTypeDef GPIO_InitStructure;
+  NVIC_InitTypeDef NVIC_InitStructure;
 
   /*!< Enable the SPI clock */
   SPI3_FLASH_SPI_CLK_INIT(SPI3_FLASH_SPI_CLK, ENABLE);
@@ -558,6 +910,15 @@ void SPI3_FLASH_LowLevel_Init(void)
   GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
   GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
   GPIO_Init(SPI3_FLASH_CS_GPIO_PORT, &GPIO_InitStructure);
+
+  /*!< DMA clock and rx complete interrupt, below configMAX_SYSCALL_INTERRUPT_PRIORITY */
+  RCC_AHB1PeriphClockCmd(SPI3_FLASH_DMA_CLK, ENABLE);
+
+  NVIC_InitStructure.NVIC_IRQChannel = SPI3_FLASH_RX_DMA_IRQn;
+  NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+  NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+  NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+  NVIC_Init(&NVIC_InitStructure);
 }
 
 /**
@@ -48,6 +48,7 @@
 
 #define sFLASH_DUMMY_BYTE         0xA5
 #define sFLASH_SPI_PAGESIZE       0x100
+#define sFLASH_SPI_SECTORSIZE     0x10000
 
 #define sFLASH_M25P128_ID         0x202018
 #define sFLASH_M25P64_ID          0x202017
@@ -82,6 +83,28 @@
 #define SPI3_FLASH_CS_PIN                        GPIO_Pin_4
 #define SPI3_FLASH_CS_GPIO_PORT                  GPIOA
 #define SPI3_FLASH_CS_GPIO_CLK                   RCC_AHB1Periph_GPIOA
+
+/* DMA1 stream2 (rx) / stream5 (tx), channel 0. Stream5 is COM port1 rx when
+   MODULE_UART_SERVER is on, the FPGA boards leave it off. */
+#define SPI3_FLASH_DMA_CLK                       RCC_AHB1Periph_DMA1
+#define SPI3_FLASH_DMA_CHANNEL                   DMA_Channel_0
+#define SPI3_FLASH_RX_DMA_STREAM                 DMA1_Stream2
+#define SPI3_FLASH_RX_DMA_IRQn                   DMA1_Stream2_IRQn
+#define SPI3_FLASH_RX_DMA_IT_TC                  DMA_IT_TCIF2
+#define SPI3_FLASH_RX_DMA_FLAGS                  (DMA_FLAG_TCIF2 | DMA_FLAG_HTIF2 | DMA_FLAG_TEIF2 | DMA_FLAG_DMEIF2 | DMA_FLAG_FEIF2)
+#define SPI3_FLASH_TX_DMA_STREAM                 DMA1_Stream5
+#define SPI3_FLASH_TX_DMA_FLAGS                  (DMA_FLAG_TCIF5 | DMA_FLAG_HTIF5 | DMA_FLAG_TEIF5 | DMA_FLAG_DMEIF5 | DMA_FLAG_FEIF5)
+
+/* Transfers shorter than this are clocked out by SPI3_FLASH_SendByte */
+#define SPI3_FLASH_DMA_MIN                       16
+/* Longest time (ms) for one DMA transfer, a page takes ~0.3ms at 7.5MHz */
+#define SPI3_FLASH_DMA_TIMEOUT                   10
+/* Read back chunk of SPI3_FLASH_Crc, two of them are kept in flight */
+#define SPI3_FLASH_CRC_CHUNK                     512
+/* Status poll period (ms) while a sector erase runs, page programs are spun on */
+#define SPI3_FLASH_ERASE_POLL                    10
+/* Longest sector erase (ms), M25P128 max is 3s */
+#define SPI3_FLASH_ERASE_TIMEOUT                 3000
 	 
 /* Select sFLASH: Chip Select pin low */
 #define SPI3_FLASH_CS_LOW()       GPIO_ResetBits(SPI3_FLASH_CS_GPIO_PORT, SPI3_FLASH_CS_PIN)
@@ -112,6 +135,12 @@ void SPI3_FLASH_ReadBuffer(uint8_t* pBuffer, uint32_t ReadAddr, uint16_t NumByte
 uint32_t SPI3_FLASH_ReadID(void);
 void SPI3_FLASH_StartReadSequence(uint32_t ReadAddr);
 
+void SPI3_FLASH_EraseSectorStart(uint32_t SectorAddr);
+int SPI3_FLASH_Sync(void);
+void SPI3_FLASH_Program(uint8_t* pBuffer, uint32_t WriteAddr, uint32_t NumByteToWrite);
+int SPI3_FLASH_Crc(uint32_t ReadAddr, uint32_t NumByteToRead, uint32_t *pCrc);
+int SPI3_FLASH_Copy(uint32_t DstAddr, uint32_t SrcAddr, uint32_t NumByteToCopy);
+
 /* Low layer functions */
 uint8_t SPI3_FLASH_ReadByte(void);
 uint8_t SPI3_FLASH_SendByte(uint8_t byte);
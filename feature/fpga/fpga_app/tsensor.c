@@ -1,5 +1,6 @@
 #include "tsensor.h"
-#include "delay.h"
+#include "FreeRTOS.h"
+#include "task.h"
 //#include "stm32f10x_adc.h"
 //#include "stm32f2xx.h"
 //#include "stm32f2xx_adc.h"
@@ -7,14 +8,40 @@
 
 ////////////////////////////////////////////////////////////////////////////////// 	  
  
+/* scan order of the regular sequence */
+static const u8 tsensorchan[TS_CHAN_NUM] = {ADC_Channel_TempSensor, ADC_Channel_Vrefint};
+
+static volatile u16 tsensordma[TS_DMA_SCANS][TS_CHAN_NUM];
+static tsensorstate tsensorst[TS_CHAN_NUM];
+static volatile u32 tsensorevent;
+
+/* TIM2 counter clock, the scan period is counted in these ticks */
+#define TS_TIM_HZ		10000
+
+/* APB1 timers run at twice PCLK1 whenever APB1 is divided */
+static u32 TSensorTimerClock(void)
+{
+	RCC_ClocksTypeDef clocks;
+
+	RCC_GetClocksFreq(&clocks);
+	if (clocks.PCLK1_Frequency != clocks.HCLK_Frequency)
+		return clocks.PCLK1_Frequency * 2;
+	return clocks.PCLK1_Frequency;
+}
 
 void T_Adc_Init(void)  //ADCͨʼ
 {
 	ADC_InitTypeDef ADC_InitStructure; 
 	ADC_CommonInitTypeDef ADC_CommonInitStructure;
+	DMA_InitTypeDef DMA_InitStructure;
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+	u8 i;
 	GPIO_InitTypeDef GPIO_InitStructure;
 	RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1	, ENABLE );	  //ʹADC1ͨʱ
 	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOA, ENABLE);
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA2, ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
   
 	//RCC_ADCCLKConfig(RCC_PCLK2_Div2);   //24M/2=12,ADCʱ䲻ܳ14M
 
@@ -23,6 +50,33 @@ void T_Adc_Init(void)  //ADCͨ
 //	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AIN;		//ģ
 //	GPIO_Init(GPIOA, &GPIO_InitStructure);	
 
+	/* DMA2 Stream0 channel0: ADC1 regular data into the circular scan buffer */
+	DMA_DeInit(DMA2_Stream0);
+	DMA_InitStructure.DMA_Channel = DMA_Channel_0;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&ADC1->DR;
+	DMA_InitStructure.DMA_Memory0BaseAddr = (u32)tsensordma;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_BufferSize = TS_DMA_SCANS * TS_CHAN_NUM;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Low;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(DMA2_Stream0, &DMA_InitStructure);
+	DMA_ITConfig(DMA2_Stream0, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+	NVIC_InitStructure.NVIC_IRQChannel = DMA2_Stream0_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+	DMA_Cmd(DMA2_Stream0, ENABLE);
+
    	ADC_DeInit();  // ADC1 ȫĴΪȱʡֵ
 	
  
@@ -34,17 +88,22 @@ void T_Adc_Init(void)  //ADCͨ
 	
 	ADC_InitStructure.ADC_Resolution = ADC_Resolution_12b;
 	//ADC_InitStructure.ADC_Mode = ADC_Mode_Independent;	//ADCģʽ:ADC1ADC2ڶģʽ
-	ADC_InitStructure.ADC_ScanConvMode = DISABLE;	//ģתڵͨģʽ
-	ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;	//ģתڵתģʽ
-	//ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;	//תⲿ
-	ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_None;
+	ADC_InitStructure.ADC_ScanConvMode = ENABLE;
+	ADC_InitStructure.ADC_ContinuousConvMode = DISABLE;	//one scan per TIM2 trigger
+	ADC_InitStructure.ADC_ExternalTrigConv = ADC_ExternalTrigConv_T2_TRGO;
+	ADC_InitStructure.ADC_ExternalTrigConvEdge = ADC_ExternalTrigConvEdge_Rising;
 	ADC_InitStructure.ADC_DataAlign = ADC_DataAlign_Right;	//ADCҶ
 	//ADC_InitStructure.ADC_NbrOfChannel = 1;	//˳йתADCͨĿ
-	ADC_InitStructure.ADC_NbrOfConversion = 1;
+	ADC_InitStructure.ADC_NbrOfConversion = TS_CHAN_NUM;
 	ADC_Init(ADC1, &ADC_InitStructure);	//ADC_InitStructָĲʼADCxļĴ
+	/* the temperature sensor needs at least 10us of sampling */
+	for (i = 0; i < TS_CHAN_NUM; i++)
+		ADC_RegularChannelConfig(ADC1, tsensorchan[i], i + 1, ADC_SampleTime_480Cycles);
 
 	ADC_TempSensorVrefintCmd(ENABLE);//ڲ¶ȴ
 	
+	ADC_DMARequestAfterLastTransferCmd(ADC1, ENABLE);
+	ADC_DMACmd(ADC1, ENABLE);
  
 	ADC_Cmd(ADC1, ENABLE);	//ʹָADC1
 
@@ -55,29 +114,86 @@ void T_Adc_Init(void)  //ADCͨ
 	//ADC_StartCalibration(ADC1);
 
 	//while(ADC_GetCalibrationStatus(ADC1));		//ȡָADC1У׼,״̬ȴ
+
+	/* TIM2 update -> TRGO starts one scan every 1/TS_SCAN_HZ s */
+	TIM_TimeBaseStructInit(&TIM_TimeBaseStructure);
+	TIM_TimeBaseStructure.TIM_Prescaler = (TSensorTimerClock() / TS_TIM_HZ) - 1;
+	TIM_TimeBaseStructure.TIM_Period = (TS_TIM_HZ / TS_SCAN_HZ) - 1;
+	TIM_TimeBaseStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInit(TIM2, &TIM_TimeBaseStructure);
+	TIM_SelectOutputTrigger(TIM2, TIM_TRGOSource_Update);
+	TIM_Cmd(TIM2, ENABLE);
 	
 	
 }
+
+void DMA2_Stream0_IRQHandler(void)
+{
+	if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_HTIF0) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_HTIF0);
+		tsensorevent |= TSensorFilter(tsensorst, &tsensordma[0]);
+	}
+	if (DMA_GetITStatus(DMA2_Stream0, DMA_IT_TCIF0) != RESET)
+	{
+		DMA_ClearITPendingBit(DMA2_Stream0, DMA_IT_TCIF0);
+		tsensorevent |= TSensorFilter(tsensorst, &tsensordma[TS_MEDIAN_LEN]);
+	}
+}
+
+static int TSensorIndex(u8 ch)
+{
+	int i;
+
+	for (i = 0; i < TS_CHAN_NUM; i++)
+	{
+		if (tsensorchan[i] == ch)
+			return i;
+	}
+	return -1;
+}
+
+/* Filtered value of a scanned channel, 0 before the first half buffer */
 u16 T_Get_Adc(u8 ch)   
 {
-	ADC_RegularChannelConfig(ADC1, ch, 1,ADC_SampleTime_144Cycles);	//ADC1,ADCͨ3,˳ֵΪ1,ʱΪ239.5	  			    
- 
-	ADC_SoftwareStartConv(ADC1);		//ʹָADC1ת
-	while(!ADC_GetFlagStatus(ADC1, ADC_FLAG_EOC ));//ȴת
-	return ADC_GetConversionValue(ADC1);	//һADC1ת
+	int i = TSensorIndex(ch);
+
+	if (i < 0)
+		return 0;
+	return (u16)(tsensorst[i].filt >> TS_IIR_FRAC);
 }
 
 
 //õADCڲ¶ȴֵ
-
+/* the filter already averages, times is kept for the callers */
 u16 Get_Adc_Average(u8 ch,u8 times)
 {
-	u32 temp_val=0;
-	u8 t;
-	for(t=0;t<times;t++)
-		{
-		temp_val+=T_Get_Adc(ch);	  //TampSensor
-		Delay_Ms(5);
-		}
-	return temp_val/times;
+	return T_Get_Adc(ch);
+}
+
+/* Latch TS_EVT_HIGH when ch reaches high, TS_EVT_LOW when it falls back to low */
+int TSensorThresholdSet(u8 ch, u16 high, u16 low)
+{
+	int i = TSensorIndex(ch);
+
+	if ((i < 0) || (low > high))
+		return -1;
+	taskENTER_CRITICAL();
+	tsensorst[i].high = high;
+	tsensorst[i].low = low;
+	tsensorst[i].alarm = 0;
+	taskEXIT_CRITICAL();
+	return 0;
+}
+
+/* Return and clear the latched threshold events */
+u32 TSensorEventGet(void)
+{
+	u32 ev;
+
+	taskENTER_CRITICAL();
+	ev = tsensorevent;
+	tsensorevent = 0;
+	taskEXIT_CRITICAL();
+	return ev;
 }
@@ -5,6 +5,36 @@
 #include "stm32f2xx_adc.h"
 //////////////////////////////////////////////////////////////////////////////////	 
 
+/* ADC1 scans TS_CHAN_NUM channels on every TIM2 trigger, DMA2 Stream0 fills a
+   circular buffer of TS_DMA_SCANS scans and each half is filtered in the DMA
+   interrupt: median of the half, then a first order IIR. */
+#define TS_SCAN_HZ		100
+#define TS_DMA_SCANS	10
+#define TS_MEDIAN_LEN	(TS_DMA_SCANS / 2)
+#define TS_IIR_SHIFT	2			/* IIR weight 1/4 per half buffer */
+#define TS_IIR_FRAC		4			/* fractional bits kept in the filter */
+#define TS_CHAN_NUM		2			/* temperature sensor, Vrefint */
+#define TS_IDX_TEMP		0			/* scan slot of the temperature sensor */
+
+/* latched threshold events, see TSensorEventGet */
+#define TS_EVT_HIGH(idx)	(0x01 << ((idx) * 2))
+#define TS_EVT_LOW(idx)		(0x02 << ((idx) * 2))
+
+/* raw 12-bit count of the internal sensor at c degrees:
+   V = 0.76V + 2.5mV/C * (c - 25), Vref = 3.3V */
+#define TS_TEMP_RAW(c)		((u16)(((7600 + 25 * ((c) - 25)) * 4096) / 33000))
+#define TS_TEMP_HIGH		78			/* over temperature alarm, C */
+#define TS_TEMP_LOW			73			/* alarm cleared, C */
+
+typedef struct
+{
+	s32	filt;				/* IIR output << TS_IIR_FRAC */
+	u16	high;				/* alarm at or above, 0 = off */
+	u16	low;				/* alarm cleared at or below */
+	u8	seeded;
+	u8	alarm;
+} tsensorstate;
+
 ////////////////////////////////////////////////////////////////////////////////// 	  
 
 /*
@@ -19,5 +49,8 @@
 void T_Adc_Init(void); //ADCͨʼ
 u16  T_Get_Adc(u8 ch); //ĳֵͨ  	
 u16 Get_Adc_Average(u8 ch,u8 times);  //ȡ¶ֵ
+int TSensorThresholdSet(u8 ch, u16 high, u16 low);
+u32 TSensorEventGet(void);
+u32 TSensorFilter(tsensorstate *st, volatile u16 (*scan)[TS_CHAN_NUM]);
 
 #endif 
@@ -0,0 +1,56 @@
+#include "tsensor.h"
+
+/* Median/IIR filter and threshold latch of the ADC scans, kept free of the
+   ADC, DMA and TIM2 setup of tsensor.c so they can be run on the host. */
+
+static u16 TSensorMedian(u16 *s)
+{
+	u8 i, j;
+	u16 t;
+
+	for (i = 1; i < TS_MEDIAN_LEN; i++)
+	{
+		t = s[i];
+		for (j = i; (j > 0) && (s[j - 1] > t); j--)
+			s[j] = s[j - 1];
+		s[j] = t;
+	}
+	return s[TS_MEDIAN_LEN / 2];
+}
+
+/* Filter one half of the scan buffer, returns the threshold crossings */
+u32 TSensorFilter(tsensorstate *st, volatile u16 (*scan)[TS_CHAN_NUM])
+{
+	u16 s[TS_MEDIAN_LEN];
+	u32 ev = 0;
+	u8 i, j;
+	u16 val;
+
+	for (i = 0; i < TS_CHAN_NUM; i++, st++)
+	{
+		for (j = 0; j < TS_MEDIAN_LEN; j++)
+			s[j] = scan[j][i];
+		val = TSensorMedian(s);
+
+		if (!st->seeded)
+		{
+			st->filt = (s32)val << TS_IIR_FRAC;
+			st->seeded = 1;
+		}
+		else
+			st->filt += (((s32)val << TS_IIR_FRAC) - st->filt) >> TS_IIR_SHIFT;
+
+		val = (u16)(st->filt >> TS_IIR_FRAC);
+		if (!st->alarm && st->high && (val >= st->high))
+		{
+			st->alarm = 1;
+			ev |= TS_EVT_HIGH(i);
+		}
+		else if (st->alarm && (val <= st->low))
+		{
+			st->alarm = 0;
+			ev |= TS_EVT_LOW(i);
+		}
+	}
+	return ev;
+}
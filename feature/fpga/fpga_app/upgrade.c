@@ -6,6 +6,7 @@
 #include <string.h>
 #include "halsw_i2c.h"
 #include "spi_flash.h"
+#include "ob_image.h"
 
 
 unsigned int fblocknum = 0;
@@ -219,6 +220,11 @@ unsigned char SumAdd(unsigned char* buf, unsigned int size)
 
 static upgradeif lastupinfo;
 static char imgtempame[32], version;
+/* SPI flash is erased up to here, crc32 of what was programmed */
+static unsigned int ferasedend;
+static unsigned long fcrc;
+/* FUPSTART seen / blocks are being rewritten out of order */
+static unsigned char fsession, fdelta;
 
 #define SUBDATA 7
 
@@ -243,6 +249,18 @@ void UpgradeCmdDump(upgrademsg *UpgradeMsgp)
 			st_fpga_debug(ST_FPGA_DEBUG,"%s crc check sum :0x%x \r\n",
 			"ending fpga Upgrade", UpgradeMsgp->version[1]);
 			break;
+		case FUPBLKSUM	:	
+			st_fpga_debug(ST_FPGA_DEBUG,"%s first block:%d \r\n",
+			"Reading fpga block crc", seqid);
+			break;
+		case FUPBLKSEL	:	
+			st_fpga_debug(ST_FPGA_DEBUG,"%s block:%d \r\n",
+			"Selecting fpga block", seqid);
+			break;
+		case FUPVERIFY	:	
+			st_fpga_debug(ST_FPGA_DEBUG,"%s \r\n",
+			"Verifying fpga image crc32");
+			break;
 		default 		:	
 			st_fpga_debug(ST_FPGA_DEBUG,"%s \r\n","unknow code");
 			break;
@@ -251,14 +269,42 @@ void UpgradeCmdDump(upgrademsg *UpgradeMsgp)
 }
 
 
+/* Sectors are erased as the image reaches them rather than all at FUPSTART.
+   The erase is only started here, the next SPI flash access waits for it, so
+   it overlaps the host sending the next packet. */
+static void UpgradeEraseTo(unsigned int end)
+{
+	while (ferasedend < end) {
+		SPI3_FLASH_EraseSectorStart(ferasedend);
+		ferasedend += SPI_FLASH_SIZE;
+	}
+}
+
+static void UpgradeSpiRelease(void)
+{
+	fsession = 0;
+	SPI_Cmd(SPI3_FLASH_SPI, DISABLE);
+	SPI3_MCU_pin_to_3state();
+}
+
+/* Image is in place, record it as the current one */
+static void UpgradeRecord(void)
+{
+	lastupinfo.cnt++;
+	lastupinfo.errtype = NONEERR;
+	lastupinfo.status = UPDATEND;
+	memcpy(lastupinfo.image.imgname, imgtempame, strlen(imgtempame) + 1);
+	lastupinfo.image.imgsize = lastupinfo.filesize;
+	lastupinfo.image.imgver = version;
+	At24_Page_Write(I2CDEV_0, E2DEVADD0, UPGRADEINFOADD3, (unsigned char *)&lastupinfo, sizeof(lastupinfo));
+}
+
 void UpgradeImageProsess(unsigned char* buf, unsigned int* size)
 {
 	upgrademsgp upmsgp = (upgrademsgp)buf;
-	unsigned int pagecnt, erasepage;
 	static int filesize;
 	static unsigned char sum = 0;
 	static short int  contentcnt = 0;
-    uint8_t  Rx_Buffer1[128];
 
 //	upmsgp->content = (char *)&upmsgp->content;
     
@@ -294,23 +340,20 @@ void UpgradeImageProsess(unsigned char* buf, unsigned int* size)
 			lastupinfo.status = (unsigned short int)UPDATING;
 			lastupinfo.errtype = (unsigned short int)NONEERR;
 			lastupinfo.filesize = *(unsigned int *)upmsgp->size;
+			/* an interrupted session stays UPDATING, FUPBLKSUM then shows
+			   the host which blocks already hold the new image */
+			At24_Page_Write(I2CDEV_0, E2DEVADD0, UPGRADEINFOADD3, (unsigned char *)&lastupinfo, sizeof(lastupinfo));
 			
 			/* recode image name */
 			memcpy(imgtempame, &upmsgp->content, (*size - SUBDATA));
 			imgtempame[*size - SUBDATA] = '\0';
 			
 			version = upmsgp->version[1];
-			if (*(unsigned int *)upmsgp->size % SPI_FLASH_SIZE) {
-				pagecnt = *(unsigned int *)upmsgp->size / SPI_FLASH_SIZE + 1;
-			}
-			else {
-				pagecnt = *(unsigned int *)upmsgp->size / SPI_FLASH_SIZE;
-			}
 
-			/* erase flash */
-			for (erasepage = 0; (erasepage < pagecnt); erasepage++) {
-				SPI3_FLASH_EraseSector(PRIMARY_ADDRESS + (SPI_FLASH_SIZE * erasepage));
-			}
+			/* nothing is erased until content or FUPBLKSEL says where */
+			ferasedend = PRIMARY_ADDRESS;
+			fsession = 1;
+			fdelta = 0;
 		//	if (flashstatus != FLASH_COMPLETE) {
 		//		/* return flash erase error */
 		//		*(unsigned int *)upmsgp->size = FLASHERASEERR;
@@ -323,6 +366,7 @@ void UpgradeImageProsess(unsigned char* buf, unsigned int* size)
 			filesize = 0;
 			contentcnt = 0;
 			sum = 0;
+			fcrc = 0;
 			/* send data size = 128 */
 			*(unsigned short int *)upmsgp->version = SWP16(0x80);
 		//	*(unsigned short int *)upmsgp->version = *(unsigned short int *)upmsgp->version;
@@ -338,6 +382,12 @@ void UpgradeImageProsess(unsigned char* buf, unsigned int* size)
 			uint8_t  Rx_Buffer111;
 			unsigned char ssump;		
 			
+			/* SPI3 is back with the FPGA outside a session */
+			if (!fsession) {
+				*(unsigned int *)upmsgp->size = FLASHWRITEERR;
+				*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
+				break;
+			}
 			filesize += *(unsigned int *)upmsgp->size;
 			//pp = (unsigned int *)&upmsgp->content;
 			pp = (uint8_t *)&upmsgp->content;
@@ -347,8 +397,7 @@ void UpgradeImageProsess(unsigned char* buf, unsigned int* size)
 			if (filesize > lastupinfo.filesize) {
 				*(unsigned int *)upmsgp->size = FILETOLARERR;
 				*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
-				SPI_Cmd(SPI3_FLASH_SPI,DISABLE);
-				SPI3_MCU_pin_to_3state();
+				UpgradeSpiRelease();
 				break;
 			}	
 			if(*(unsigned int *)upmsgp->size & 0x7f){
@@ -358,22 +407,16 @@ void UpgradeImageProsess(unsigned char* buf, unsigned int* size)
 				*(unsigned int *)upmsgp->size += 128 - (*(unsigned int *)upmsgp->size & 0x7f);
 			}
 			
-			for (int i = 0; i < *(unsigned int *)upmsgp->size; ) {
-				SPI3_FLASH_WriteBuffer(pp,fdstaddr,128);
-				SPI3_FLASH_ReadBuffer(Rx_Buffer1,fdstaddr,128);
-				for(uint8_t j = 0;j < 128; j++){
-					if(Rx_Buffer1[j] != *pp){
-					*(unsigned int *)upmsgp->size = FLASHWRITEERR;
-					*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
-					SPI_Cmd(SPI3_FLASH_SPI,DISABLE);
-					SPI3_MCU_pin_to_3state();
-					break;
-					}
-					pp++;
-				}
-				
-				fdstaddr += 128;
-				i += 128;
+			/* blank pages are skipped, the image is verified by crc at FUPEND */
+			UpgradeEraseTo(fdstaddr + *(unsigned int *)upmsgp->size);
+			SPI3_FLASH_Program(pp, fdstaddr, *(unsigned int *)upmsgp->size);
+			fcrc = crc32(fcrc, pp, *(unsigned int *)upmsgp->size);
+			fdstaddr += *(unsigned int *)upmsgp->size;
+
+			/* erased area used up: start on the next sector before replying,
+			   a delta upgrade may keep that sector */
+			if (!fdelta && (fdstaddr == ferasedend) && (filesize < lastupinfo.filesize)) {
+				UpgradeEraseTo(fdstaddr + 1);
 			}
             
 			contentcnt++;
@@ -382,31 +425,99 @@ void UpgradeImageProsess(unsigned char* buf, unsigned int* size)
 			*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
 			break;
 		}
-		case FUPEND:
+		case FUPEND: {
+			uint32_t flashcrc = 0;
+			int verify;
+
 			//GPIO_InitTypeDef GPIO_InitStructure;
 		//	FLASH_Lock();
-			SPI_Cmd(SPI3_FLASH_SPI, DISABLE);
-			SPI3_MCU_pin_to_3state();
+			/* read the image back once and crc it against what was received */
+			verify = fsession ? SPI3_FLASH_Crc(PRIMARY_ADDRESS, fdstaddr - PRIMARY_ADDRESS, &flashcrc) : -1;
+			UpgradeSpiRelease();
 			if (sum != upmsgp->version[1]) {
 				upmsgp->version[1] = sum;
 				*(unsigned int *)upmsgp->size = FILECRCERR;
 				*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
 				break;
 			}
+			else if ((verify != 0) || (flashcrc != fcrc)) {
+				*(unsigned int *)upmsgp->size = FLASHWRITEERR;
+				*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
+				break;
+			}
 			else {
-				lastupinfo.cnt++;
-				lastupinfo.errtype = NONEERR;
-				lastupinfo.status = UPDATEND;
-				memcpy(lastupinfo.image.imgname, imgtempame, strlen(imgtempame) + 1);
-				lastupinfo.image.imgsize = lastupinfo.filesize;
-				lastupinfo.image.imgver = version;
-				At24_Page_Write(I2CDEV_0, E2DEVADD0, UPGRADEINFOADD3, (unsigned char *)&lastupinfo, sizeof(lastupinfo));
+				UpgradeRecord();
 				*(unsigned int *)upmsgp->size = NONEERR;
-				SPI_Cmd(SPI3_FLASH_SPI, DISABLE);
-				SPI3_MCU_pin_to_3state();
 			}
 			*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
 			break;
+		}
+		case FUPBLKSUM: {
+			/* version = first block, size = block count. Replies one
+			   big-endian crc32 per block of what the primary area holds now */
+			unsigned int blk = (upmsgp->version[0] << 8) | upmsgp->version[1];
+			unsigned int cnt = *(unsigned int *)upmsgp->size;
+			unsigned int i;
+
+			if (!FUPBLKVALID(blk, cnt)) {
+				*(unsigned int *)upmsgp->size = FLASHREADERR;
+				*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
+				break;
+			}
+			/* also answered outside a session, the bus goes back to the FPGA after */
+			if (!fsession) {
+				SPI3_FLASH_Init();
+			}
+			i = UpgradeBlkSum(blk, cnt, &upmsgp->content);
+			if (!fsession) {
+				UpgradeSpiRelease();
+			}
+			*(unsigned int *)upmsgp->size = (i == cnt) ? NONEERR : FLASHREADERR;
+			*size = sizeof(upgrademsg) - sizeof(upmsgp->content) + i * 4;
+			break;
+		}
+		case FUPBLKSEL: {
+			/* version = block, the next FUPCONTENT are written from its start.
+			   Its erase starts now and overlaps the host sending the data */
+			unsigned int blk = (upmsgp->version[0] << 8) | upmsgp->version[1];
+
+			if (!fsession || !FUPBLKVALID(blk, 1)) {
+				*(unsigned int *)upmsgp->size = FLASHWRITEERR;
+				*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
+				break;
+			}
+			fdelta = 1;
+			fdstaddr = PRIMARY_ADDRESS + blk * FUPBLKSIZE;
+			ferasedend = fdstaddr;
+			UpgradeEraseTo(fdstaddr + 1);
+			*(unsigned int *)upmsgp->size = NONEERR;
+			*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
+			break;
+		}
+		case FUPVERIFY: {
+			/* content = crc32 of the whole new image, checked against the
+			   flash since a delta upgrade only received the changed blocks */
+			uint32_t flashcrc = 0;
+			int verify;
+
+			if (!fsession || (*size < sizeof(upgrademsg) - sizeof(upmsgp->content) + 4)) {
+				*(unsigned int *)upmsgp->size = FLASHREADERR;
+				*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
+				break;
+			}
+			verify = SPI3_FLASH_Crc(PRIMARY_ADDRESS, lastupinfo.filesize, &flashcrc);
+			UpgradeSpiRelease();
+			if ((verify != 0) || (flashcrc != UpgradeGet32(&upmsgp->content))) {
+				*(unsigned int *)upmsgp->size = FILECRCERR;
+				UpgradePut32(&upmsgp->content, flashcrc);
+				*size = sizeof(upgrademsg) - sizeof(upmsgp->content) + 4;
+				break;
+			}
+			UpgradeRecord();
+			*(unsigned int *)upmsgp->size = NONEERR;
+			*size = sizeof(upgrademsg) - sizeof(upmsgp->content);
+			break;
+		}
 	}
 }
 
@@ -101,6 +101,10 @@ typedef enum
 #define FLASHREADERRINFO  "internal falsh read error\n"
 #endif
 
+/* size is sent big-endian and converted in place by UpgradeProcee before
+   the opcode runs. crc32 values travel in content, also big-endian:
+   FUPBLKSUM replies one per block, FUPVERIFY carries the image crc and
+   on a mismatch replies the crc the device computed. */
 typedef enum {
 	UPSTART = 0x01,
 	UPCONTENT,
@@ -109,9 +113,19 @@ typedef enum {
 	FUPSTART = 0x11,
 	FUPCONTENT,
 	FUPEND,
-	FUPIFCFG
+	FUPIFCFG,
+	FUPBLKSUM,		/* crc32 of primary image blocks */
+	FUPBLKSEL,		/* following FUPCONTENT rewrite this block */
+	FUPVERIFY		/* end of a delta upgrade, crc32 of the whole image */
 } upgradeop;
 
+/* Delta upgrade block, one SPI flash erase sector. Blocks are hashed over
+   their full size, past the end of the image the flash reads 0xFF. */
+#define FUPBLKSIZE		SPI_FLASH_SIZE
+#define FUPBLKNUM		(PRIMARYSIZE / FUPBLKSIZE)
+/* cnt blocks from blk all lie in the primary area, overflow safe */
+#define FUPBLKVALID(blk, cnt)	(((blk) < FUPBLKNUM) && ((cnt) != 0) && ((cnt) <= FUPBLKNUM - (blk)))
+
 
 /** 
   * @brief Upgrade image info 
@@ -181,6 +195,9 @@ void JumpToBoot(void);
 void FlashDisWriteProtectPage(void);
 unsigned int FlashCpy(unsigned int dist,unsigned int src, unsigned int size);
 void UpgradeImageProsess(unsigned char* buf, unsigned int* size);
+void UpgradePut32(unsigned char *p, unsigned int val);
+unsigned int UpgradeGet32(const unsigned char *p);
+unsigned int UpgradeBlkSum(unsigned int blk, unsigned int cnt, unsigned char *out);
 
 
 
@@ -0,0 +1,38 @@
+#include "upgrade.h"
+#include "spi_flash.h"
+
+/* Delta upgrade block sums, kept free of the uart and eeprom side of
+   upgrade.c so they can be run against a flash image on the host. */
+
+/* crc32 fields in content are big-endian, see upgradeop */
+void UpgradePut32(unsigned char *p, unsigned int val)
+{
+	p[0] = (unsigned char)(val >> 24);
+	p[1] = (unsigned char)(val >> 16);
+	p[2] = (unsigned char)(val >> 8);
+	p[3] = (unsigned char)val;
+}
+
+unsigned int UpgradeGet32(const unsigned char *p)
+{
+	return ((unsigned int)p[0] << 24) | ((unsigned int)p[1] << 16) |
+		((unsigned int)p[2] << 8) | p[3];
+}
+
+/* crc32 of cnt primary blocks from blk, one big-endian word each in out.
+   The range is checked by the caller with FUPBLKVALID. Returns the number
+   of sums written, short of cnt when a read fails. */
+unsigned int UpgradeBlkSum(unsigned int blk, unsigned int cnt, unsigned char *out)
+{
+	unsigned int i;
+	uint32_t blkcrc;
+
+	for (i = 0; i < cnt; i++) {
+		blkcrc = 0;
+		if (SPI3_FLASH_Crc(PRIMARY_ADDRESS + (blk + i) * FUPBLKSIZE, FUPBLKSIZE, &blkcrc) != 0) {
+			break;
+		}
+		UpgradePut32(out + i * 4, blkcrc);
+	}
+	return i;
+}
@@ -104,7 +104,8 @@ void UartxInit(uartxinfop uartcfp, unsigned int interrupt)
 	if (interrupt)
 	{
 		NVIC_PriorityGroupConfig(NVIC_PriorityGroup_2);
-		uartnvic.NVIC_IRQChannelPreemptionPriority = 0;
+		/* receive callbacks use FreeRTOS FromISR calls */
+		uartnvic.NVIC_IRQChannelPreemptionPriority = 3;
 		uartnvic.NVIC_IRQChannelSubPriority = 0;
 		uartnvic.NVIC_IRQChannelCmd = ENABLE;
 		NVIC_Init(&uartnvic);
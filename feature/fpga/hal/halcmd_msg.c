@@ -6,6 +6,7 @@
  *************************************************************/
 /* include -------------------------------------------------------------------*/
 #include "halcmd_msg.h"
+#include "task.h"
 #include "console.h"
 #include "stdio.h"
 
@@ -15,6 +16,7 @@
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static StHalCmdQueueMsg HalCmdQueueMsg;
+static xSemaphoreHandle HalCmdWakeSem = NULL;
 
 /* Private function prototypes -----------------------------------------------*/
 /* Private functions ---------------------------------------------------------*/
@@ -33,6 +35,10 @@ void HalQueueInit(void)
     {
 		printf("creat HalCmdQueueMsg queue failed \r\n");
     }
+
+	vSemaphoreCreateBinary(HalCmdWakeSem);
+	if(HalCmdWakeSem != NULL)
+		xSemaphoreTake(HalCmdWakeSem, 0);
 }
 
 /**
@@ -106,10 +112,55 @@ portBASE_TYPE HalQueueWrite(StHalCmdMsg *CmdMsg, portBASE_TYPE xTicksToWait)
 		{
 			printf("Could not send to the queue \r\n");
 		}
+	else
+		HalCmdNotify();
 	
 	return xStatus;
 }
 
+/**
+  * @brief  Wake the fpga task, a command is waiting.
+  * @param  none
+  * @retval none
+  */
+void HalCmdNotify(void)
+{
+	if(HalCmdWakeSem != NULL)
+		xSemaphoreGive(HalCmdWakeSem);
+}
+
+/**
+  * @brief  Wake the fpga task from a receive interrupt.
+  * @param  none
+  * @retval none
+  */
+void HalCmdNotifyFromISR(void)
+{
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	if(HalCmdWakeSem != NULL)
+	{
+		xSemaphoreGiveFromISR(HalCmdWakeSem, &xHigherPriorityTaskWoken);
+		portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+	}
+}
+
+/**
+  * @brief  Sleep until a command is notified.
+  * @param  @xTicksToWait   : longest sleep (ticks)
+  * @retval pdTRUE if notified, pdFALSE on timeout
+  */
+portBASE_TYPE HalCmdWait(portTickType xTicksToWait)
+{
+	if(HalCmdWakeSem == NULL)
+	{
+		/* no wake source, fall back to polling */
+		vTaskDelay(1);
+		return pdFALSE;
+	}
+	return xSemaphoreTake(HalCmdWakeSem, xTicksToWait);
+}
+
 /**
   * @brief  Write to uart3.
   * @param  none
@@ -44,6 +44,9 @@ xQueueHandle HalQueueCreat(StHalCmdQueueMsg *HalCmdQueueMsg);
 portBASE_TYPE HalQueueWrite(StHalCmdMsg *CmdMsg, portBASE_TYPE xTicksToWait);
 uint16_t HalQueueRead(int8_t *buff, portBASE_TYPE xTicksToWait);
 void HalWrite(int8_t *buff, uint16_t len);
+void HalCmdNotify(void);
+void HalCmdNotifyFromISR(void);
+portBASE_TYPE HalCmdWait(portTickType xTicksToWait);
 
 #ifdef __cplusplus
 }
@@ -18,7 +18,17 @@ const unsigned char cregaddr[41] = {  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
                                    };
 #endif
 
-
+/* Length of the run of consecutive register addresses starting at cregaddr[i];
+   the Si5324/5327 auto-increments its address pointer, so a run is one burst */
+static unsigned char Si5324RunLen(unsigned char i)
+{
+	unsigned char n = 1;
+	while (((i + n) < sizeof(cregaddr)) && (cregaddr[i + n] == (cregaddr[i + n - 1] + 1)))
+	{
+		n++;
+	}
+	return n;
+}
 
 
 unsigned char Si5324GetReg(unsigned char devid, unsigned char devaddr, unsigned char regadd)
@@ -30,18 +40,18 @@ unsigned char Si5324GetReg(unsigned char devid, unsigned char devaddr, unsigned
 
 void Si5324AllGetReg(unsigned char devid, unsigned char devaddr, si5324confregp cregp)
 {
-	unsigned char i;
-	for (i = 0; i < sizeof(cregaddr); i++)
+	unsigned char i, n;
+	for (i = 0; i < sizeof(cregaddr); i += n)
 	{
-		SWI2cRandomRead(devid, devaddr, cregaddr[i], &cregp->reg[i]);
-		Delay_5Us(10);
+		n = Si5324RunLen(i);
+		SWI2cSequentialRead(devid, devaddr, cregaddr[i], &cregp->reg[i], n);
 	}
 }
 
 
 void Si5324Conf(unsigned char devid, unsigned char devaddr, si5324confregp cregp, const unsigned char *name)
 {
-	unsigned char i;
+	unsigned char i, n;
 
 	//added for test
 	unsigned int err5324;
@@ -49,21 +59,22 @@ void Si5324Conf(unsigned char devid, unsigned char devaddr, si5324confregp cregp
 	printf("Seting Si5327 clock frequency: %s\r\n", name);
 #endif
 
-	for (i = 0; i < sizeof(cregaddr); i++)
+	/* table order is kept, so ICAL (0x88, last entry) still goes out last */
+	for (i = 0; i < sizeof(cregaddr); i += n)
 	{
-		err5324 = SWI2cRandomWrite(devid, devaddr, cregaddr[i], &cregp->reg[i]);
-		Delay_5Us(2);
+		n = Si5324RunLen(i);
+		err5324 = SWI2cSequentialWrite(devid, devaddr, cregaddr[i], &cregp->reg[i], n);
 	}
 }
 
 
 int Si5324LockCheck(unsigned char devid, unsigned char devaddr)
 {
-	unsigned char value[2];
+	unsigned char value[3];
 	int lockstate = 0;
-	value[0] = Si5324GetReg(devid, devaddr, 0x80);
-	value[1] = Si5324GetReg(devid, devaddr, 0x82);
-	if (!(value[1] & 0x01))
+	/* 0x80 CK_ACTV, 0x81 LOS, 0x82 LOL in one burst */
+	SWI2cSequentialRead(devid, devaddr, 0x80, value, sizeof(value));
+	if (!(value[2] & 0x01))
 	{
 		switch (value[0] & 0x03)
 		{
@@ -81,3 +92,17 @@ int Si5324LockCheck(unsigned char devid, unsigned char devaddr)
 	return lockstate;
 }
 
+/* Poll the lock state every SI5324_LOCK_POLL ms until locked or timeout ms
+   have passed; returns the last Si5324LockCheck value */
+int Si5324WaitLock(unsigned char devid, unsigned char devaddr, unsigned int timeout)
+{
+	int lockstate;
+	unsigned int waited = 0;
+
+	while (!(lockstate = Si5324LockCheck(devid, devaddr)) && (waited < timeout))
+	{
+		Delay_Ms(SI5324_LOCK_POLL);
+		waited += SI5324_LOCK_POLL;
+	}
+	return lockstate;
+}
@@ -20,6 +20,8 @@ typedef struct SI5324_CONFREG
 } si5324confreg, *si5324confregp;
 #endif
 
+#define SI5324_LOCK_POLL	10		/* ms between lock state reads */
+
 /* ʱ ģʽΪlvds OUT2  */
 extern const si5324confreg cfg_7425;
 extern const si5324confreg cfg_15625;
@@ -32,5 +34,6 @@ unsigned char Si5324GetReg(unsigned char devid, unsigned char devaddr, unsigned
 void Si5324AllGetReg(unsigned char devid, unsigned char devaddr, si5324confregp cregp);
 void Si5324Conf(unsigned char devid, unsigned char devaddr, si5324confregp cregp, const unsigned char *name);
 int Si5324LockCheck(unsigned char devid, unsigned char devaddr);
+int Si5324WaitLock(unsigned char devid, unsigned char devaddr, unsigned int timeout);
 
 #endif /* _SI5324_H_ */
@@ -11,16 +11,46 @@
 #include "halsw_i2c.h"
 #endif
 
-void TlkValueWrite(unsigned int phyadd, unsigned int devadd, unsigned int  regadd, unsigned int value)
+/* Register address last loaded into an MMD. Clause 45 write and read frames
+   leave it alone and post-read-increment advances it, so an access to the
+   same register again needs no new address frame. */
+static struct
+{
+	unsigned char	valid;
+	unsigned char	phyadd;
+	unsigned char	devadd;
+	unsigned short	regadd;
+} tlkaddr;
+
+static void TlkAddrSet(unsigned int phyadd, unsigned int devadd, unsigned int regadd)
 {
+	if (tlkaddr.valid && (tlkaddr.phyadd == phyadd) && (tlkaddr.devadd == devadd) && (tlkaddr.regadd == regadd))
+	{
+		return;
+	}
 	MdioCL45WriteA(phyadd, devadd, regadd);
+	tlkaddr.valid = 1;
+	tlkaddr.phyadd = phyadd;
+	tlkaddr.devadd = devadd;
+	tlkaddr.regadd = regadd;
+}
+
+/* Forget the cached address, the PHY resets its MMD address registers */
+void TlkAddrFlush(void)
+{
+	tlkaddr.valid = 0;
+}
+
+void TlkValueWrite(unsigned int phyadd, unsigned int devadd, unsigned int  regadd, unsigned int value)
+{
+	TlkAddrSet(phyadd, devadd, regadd);
 	MdioCL45WriteV(phyadd, devadd, value);
 }
 
 unsigned short int TlkValueRead(unsigned int phyadd, unsigned int devadd, unsigned int  regadd)
 {
 	unsigned short int ret;
-	MdioCL45WriteA(phyadd, devadd, regadd);
+	TlkAddrSet(phyadd, devadd, regadd);
 	ret = MdioCL45Read(phyadd, devadd);
 	return ret;
 }
@@ -28,11 +58,48 @@ unsigned short int TlkValueRead(unsigned int phyadd, unsigned int devadd, unsign
 unsigned short int TlkValueIncRead(unsigned int phyadd, unsigned int devadd, unsigned int  regadd)
 {
 	unsigned short int ret;
-	MdioCL45WriteA(phyadd, devadd, regadd);
+	TlkAddrSet(phyadd, devadd, regadd);
 	ret = MdioCL45IncRead(phyadd, devadd);
+	tlkaddr.regadd++;
 	return ret;
 }
 
+/* Read num consecutive registers: one address frame, then post-read-increment */
+void TlkBatchRead(unsigned int phyadd, unsigned int devadd, unsigned int regadd, unsigned int *buf, unsigned int num)
+{
+	unsigned int i;
+	for (i = 0; i < num; i++)
+	{
+		buf[i] = TlkValueIncRead(phyadd, devadd, regadd + i);
+	}
+}
+
+/* Program a register table in order; consecutive accesses to the same
+   register share one address frame */
+void TlkBatchWrite(unsigned int phyadd, const tlkregop *ops, unsigned int num)
+{
+	unsigned int i;
+	for (i = 0; i < num; i++, ops++)
+	{
+		TlkValueWrite(phyadd, ops->devadd, ops->regadd, ops->value);
+	}
+}
+
+/* Poll CHANNEL_STATUS_1 every TLK_LINK_POLL ms until all of mask is set or
+   timeout ms have passed; returns the last status read */
+unsigned int TlkWaitStatus(unsigned int phyadd, unsigned int mask, unsigned int timeout)
+{
+	unsigned int val;
+	unsigned int waited = 0;
+
+	while ((((val = TlkValueRead(phyadd, VSPDRADDR, CHAN_STU)) & mask) != mask) && (waited < timeout))
+	{
+		Delay_Ms(TLK_LINK_POLL);
+		waited += TLK_LINK_POLL;
+	}
+	return val;
+}
+
 
 
 
@@ -40,6 +107,7 @@ void TlkSwReset(unsigned int phyadd)
 {
 	/* software reset GBL_CTL1[15] = 1 */
 	TlkValueWrite(phyadd, VSPDRADDR , GBL_CTL1, 0x8000);
+	TlkAddrFlush();
 }
 
 #if 0
@@ -48,9 +116,22 @@ void TlkHwReset(void)
 	TLK10232RSTCTL(0);
 	Delay_Ms(10);
 	TLK10232RSTCTL(1);
+	TlkAddrFlush();
 }
 #endif
 
+#if !(defined PHY_TEST)
+/* S8002/S8001 serdes setup after the per channel control words */
+static const tlkregop tlkmannualconf[] =
+{
+	{0x01, 0x0096, 0x0000},		//disable Link Training
+	{0x1e, 0x8020, 0x03ff},		//reserved register settings
+	{0x1e, 0x0004, 0x5500},		//5500   //tlk10232 Link Training Optimization
+	{0x1e, 0x0003, 0x7848},		//7848  660mv  HS_SWING [3:0]
+	{0x1e, 0x0005, 0x2200},
+};
+#endif
+
 
 void MannualModeConf(unsigned char chan, unsigned char isauto, void (*pFunction)(void))
 {
@@ -72,16 +153,12 @@ void MannualModeConf(unsigned char chan, unsigned char isauto, void (*pFunction)
 	/* hs rx clk en */
 //	val = (chan == PHYCH2) ?  0x2f88 : 0x2f80;
 //	TlkValueWrite(chan, 0x1e, 0x000d, val);
-	TlkValueWrite(chan, 0x01, 0x0096, 0x0000);	//disable Link Training
-	TlkValueWrite(chan, 0x1e, 0x8020, 0x03ff);	//reserved register settings
 #if !(defined PHY_TEST)
 	/*****************S8002 AND S8001**************/
 //	TlkValueWrite(chan, 0x1e, 0x04, 0xd500);      //5500   //tlk10232 Link Training Optimization
-	TlkValueWrite(chan, 0x1e, 0x04, 0x5500);      //5500   //tlk10232 Link Training Optimization
 //	TlkValueWrite(chan, 0x1e, 0x03, 0xb848);      //7848  660mv  HS_SWING [3:0]
-	TlkValueWrite(chan, 0x1e, 0x03, 0x7848);      //7848  660mv  HS_SWING [3:0]
-	TlkValueWrite(chan, 0x1e, 0x05, 0x2200);      //
 //	TlkValueWrite(chan, 0x1e, 0x05, 0x2000);      //
+	TlkBatchWrite(chan, tlkmannualconf, sizeof(tlkmannualconf) / sizeof(tlkmannualconf[0]));
 	/************************40km******************************
 
 	TlkValueWrite(0x0000, 0x1e, 0x04, 0x6500);      //d500   //tlk10232 Link Training Optimization
@@ -99,6 +176,8 @@ void MannualModeConf(unsigned char chan, unsigned char isauto, void (*pFunction)
 	//Write 30.5.3:0 HS_TWPOST2 [3:0]
 	/* issue data path reset */
 #else
+	TlkValueWrite(chan, 0x01, 0x0096, 0x0000);	//disable Link Training
+	TlkValueWrite(chan, 0x1e, 0x8020, 0x03ff);	//reserved register settings
 	regaddr = (chan == PHYCHAN1) ? PHYREGADDR1 : PHYREGADDR2;
 	At24_Sequential_Read(I2CDEV_0, E2DEVADD0, regaddr, (unsigned char *)&reg, sizeof(reg));
 	reg[0] = SWP16(reg[0]);
@@ -111,7 +190,8 @@ void MannualModeConf(unsigned char chan, unsigned char isauto, void (*pFunction)
 	val = TlkValueRead(chan, 0x1e, 0x000e);
 	val |= 0x0008;
 	TlkValueWrite(chan, 0x1e, 0x000e, val);
-	Delay_Ms(1000);
+	/* wait for the channel instead of a fixed 1s */
+	TlkWaitStatus(chan, TLK_LINK_UP, 1000);
 	/* status read ,clear latch */
 //	do{
 	val = TlkValueRead(chan, 0x1e, 0x0f);
@@ -137,20 +217,23 @@ void Read_status(int chan)
 {
 	unsigned int val;
 	unsigned int i;
-	chnstatus1 = TlkValueRead(chan, 0x1e, 0x000f);    //CHANNEL_STATUS_1 to clear (16h5C03)
+	unsigned int cnt[6];
+	/* CHANNEL_STATUS_1 .. LS_LN3_ERROR_COUNTER (0x0f - 0x14) in one increment run */
+	TlkBatchRead(chan, 0x1e, 0x000f, cnt, 6);
+	chnstatus1 = cnt[0];    //CHANNEL_STATUS_1 to clear (16h5C03)
 	/*
 	sprintf(UART2_TX_BUF, "\nCHANNEL_STATUS_1       is: 0x%04x \n", chnstatus1);
 	val = strlen(UART2_TX_BUF);
 	USART2_Send(val);*/
-	hserrcnt = TlkValueRead(chan, 0x1e, 0x0010);      //HS_ERROR_COUNTER to clear (16h0000)
+	hserrcnt = cnt[1];      //HS_ERROR_COUNTER to clear (16h0000)
 	/*
 	sprintf(UART2_TX_BUF, "HS_ERROR_COUNTER       is: 0x%04x \n", hserrcnt);
 	val = strlen(UART2_TX_BUF);
 	USART2_Send(val);*/
-	lslnerrcnt[0] = TlkValueRead(chan, 0x1e, 0x0011); //LS_LN0_ERROR_COUNTER to clear (16h0000)
-	lslnerrcnt[1] = TlkValueRead(chan, 0x1e, 0x0012); // LS_LN1_ERROR_COUNTER to clear (16h0000)
-	lslnerrcnt[2] = TlkValueRead(chan, 0x1e, 0x0013); // LS_LN2_ERROR_COUNTER to clear (16h0000)
-	lslnerrcnt[3] = TlkValueRead(chan, 0x1e, 0x0014); // LS_LN3_ERROR_COUNTER to clear (16h0000)
+	lslnerrcnt[0] = cnt[2]; //LS_LN0_ERROR_COUNTER to clear (16h0000)
+	lslnerrcnt[1] = cnt[3]; // LS_LN1_ERROR_COUNTER to clear (16h0000)
+	lslnerrcnt[2] = cnt[4]; // LS_LN2_ERROR_COUNTER to clear (16h0000)
+	lslnerrcnt[3] = cnt[5]; // LS_LN3_ERROR_COUNTER to clear (16h0000)
 	/*
 	sprintf(UART2_TX_BUF, "LS_LN0-3_ERROR_COUNTER is: 0x%04x,0x%04x,0x%04x,0x%04x \n", lslnerrcnt[0], lslnerrcnt[1], lslnerrcnt[2], lslnerrcnt[3]);
 	val = strlen(UART2_TX_BUF);
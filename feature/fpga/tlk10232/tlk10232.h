@@ -157,9 +157,24 @@ typedef unsigned short int subaddr_t;
 #define	PHYCH2	0x0001
 
 
+/* one Clause 45 register write of a batch */
+typedef struct
+{
+	unsigned char		devadd;
+	unsigned short int	regadd;
+	unsigned short int	value;
+} tlkregop;
+
+#define	TLK_LINK_POLL	10			/* ms between CHANNEL_STATUS_1 reads */
+#define	TLK_LINK_UP		0x1803		/* CHANNEL_STATUS_1 bits of a synced channel */
+
 void TlkValueWrite(unsigned int phyadd, unsigned int devadd, unsigned int  regadd, unsigned int value);
 unsigned short int TlkValueRead(unsigned int phyadd, unsigned int devadd, unsigned int  regadd);
 unsigned short int TlkValueIncRead(unsigned int phyadd, unsigned int devadd, unsigned int  regadd);
+void TlkAddrFlush(void);
+void TlkBatchRead(unsigned int phyadd, unsigned int devadd, unsigned int regadd, unsigned int *buf, unsigned int num);
+void TlkBatchWrite(unsigned int phyadd, const tlkregop *ops, unsigned int num);
+unsigned int TlkWaitStatus(unsigned int phyadd, unsigned int mask, unsigned int timeout);
 
 
 void TlkSwReset(unsigned int phyadd);
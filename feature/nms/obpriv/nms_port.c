@@ -84,7 +84,7 @@ void Rsp_GetPortStatus(u8 *DMA, u8 *RequestID)
 	for(i=0; i<MAX_PORT_NUM; i++) {
 		RspPortStatus.PortStatus[i] = 0;
 		hport = hal_swif_lport_2_hport(i+1);
-		hal_swif_port_get_link_state(i+1, &link_state);
+		hal_swif_port_get_dampened_link_state(i+1, &link_state);
 		hal_swif_port_get_speed(i+1, &speed);
 		hal_swif_port_get_duplex(i+1, &duplex);
 		hal_swif_port_get_mdi_mdix(i+1, &mdi_mdix);
@@ -92,7 +92,8 @@ void Rsp_GetPortStatus(u8 *DMA, u8 *RequestID)
 		RspPortStatus.PortStatus[i] = 	((link_state == LINK_UP)? 0x80 : 0x00) | \
 										((speed == SPEED_10M)? 0x00 : (speed == SPEED_100M)? 0x10 : (speed == SPEED_1000M)? 0x20 : 0x00) | \
 										((duplex == FULL_DUPLEX)? 0x08 : 0x00) | \
-										((mdi_mdix == MODE_MDI)? 0x02 : 0x00);
+										((mdi_mdix == MODE_MDI)? 0x02 : 0x00) | \
+										((hal_swif_port_link_suppressed(i+1))? PORT_STATUS_DAMPENED : 0x00);
 	}
 
 	/************************************************/
@@ -54,6 +54,9 @@ void Rsp_SetUart(u8 *DMA, u8 *RequestID,u8 *UartConfig)
 #if MODULE_UART_SERVER	
 	memset(&CfgData, 0x00, sizeof(uartcfg_t));
 	UartPort = pUartCfg->UartPort - 1;
+	/* Frame gap is set from the CLI only, keep it across NMS writes */
+	if((UartPort > 1) || (GetUartFrameGap(UartPort, &CfgData.FrameGap) != CONF_ERR_NONE))
+		CfgData.FrameGap = 0;
 	CfgData.UartEn		= pUartCfg->UartEn;
 	CfgData.Baudrate	= pUartCfg->Baudrate;
 	CfgData.DataBits	= pUartCfg->DataBits;
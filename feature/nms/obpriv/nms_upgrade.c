@@ -36,8 +36,18 @@
 //#define NMS_UPGRADE_DEBUG
 
 /* Private define ------------------------------------------------------------*/
+#if BOOT_AB_SLOT
+/* A/B boot slots, the image goes to the slot which is not running */
+#define NMS_RUNNING_SLOT		((SCB->VTOR >= OB_SLOT_B_ADDRESS) ? OB_SLOT_B : OB_SLOT_A)
+#define NMS_UPGRADE_SLOT		((NMS_RUNNING_SLOT == OB_SLOT_A) ? OB_SLOT_B : OB_SLOT_A)
+#define FLASH_UPGRADE_START		((NMS_UPGRADE_SLOT == OB_SLOT_A) ? OB_SLOT_A_ADDRESS : OB_SLOT_B_ADDRESS)
+#define FLASH_UPGRADE_END		((NMS_UPGRADE_SLOT == OB_SLOT_A) ? ADDR_FLASH_SECTOR_7 : ADDR_FLASH_SECTOR_11)
+#define FLASH_UPGRADE_SIZE		((NMS_UPGRADE_SLOT == OB_SLOT_A) ? OB_SLOT_A_SIZE : OB_SLOT_B_SIZE)
+#else
 #define FLASH_UPGRADE_START		ADDR_FLASH_SECTOR_8
 #define FLASH_UPGRADE_END		ADDR_FLASH_SECTOR_11
+#define FLASH_UPGRADE_SIZE		(FLASH_UPGRADE_END + 0x20000 - FLASH_UPGRADE_START)
+#endif
 
 #define ST_SRECODE_MAX_COUNT	125
 
@@ -214,6 +224,10 @@ void RspNMS_FirmwareUpgradeDoing(u8 *DMA, u8 *RequestID, u8 *DataBuffer)
 				#endif
 				RspData.RetCode = 0x01;
 				RspData.Res = 0x0B;	/* not define */
+			} else if (FlashWriteIndex + datalen > FLASH_UPGRADE_SIZE) {
+				/* Never run into the next partition (the running slot) */
+				RspData.RetCode = 0x01;
+				RspData.Res = 0x0e;
 			} else {
 				FlashWriteAddress = FLASH_UPGRADE_START + FlashWriteIndex;
 				retf = FLASH_If_Write(&FlashWriteAddress,(uint32_t *)(OutputBuf),datalen);
@@ -256,9 +270,22 @@ void RspNMS_FirmwareUpgradeComplete(u8 *DMA, u8 *RequestID)
 	/* fill the response data */
 	RspData.GetCode = CODE_FIRMWARE_COMPLETE;
 	if(OB_Check_Upgrade_Image(FLASH_UPGRADE_START, NULL, NULL) == IHCHK_OK) {
+#if BOOT_AB_SLOT
+		if(ntohl(((OB_Image_Header_t *)FLASH_UPGRADE_START)->LoadAddress) != FLASH_UPGRADE_START + OB_SLOT_VECTOR_OFFSET) {
+			/* Not linked for the inactive slot */
+			conf_clear_upgrade_flag();
+			RspData.RetCode = 0x01;
+			RspData.Res = 0x01;
+		} else {
+			conf_set_upgrade_slot(NMS_UPGRADE_SLOT);
+			RspData.RetCode = 0x00;
+			RspData.Res = 0x00;
+		}
+#else
 		conf_set_upgrade_flag();
 		RspData.RetCode = 0x00;
 		RspData.Res = 0x00;		
+#endif
 	} else {
         conf_clear_upgrade_flag();
 		RspData.RetCode = 0x01;
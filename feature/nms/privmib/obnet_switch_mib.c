@@ -36,11 +36,101 @@ static u8 BoardType[SWITCHTYPE_LEN] = {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
 extern GT_QD_DEV *dev;
 #endif
 
+/* Port table snapshot of the SNMP request in progress. All columns of a
+   portConfTable walk or GetBulk are served from one NVRAM read of the port
+   configuration and at most one PHY status read per port. */
+typedef struct {
+  u32_t PduSeq;
+  u8_t  ConfValid;
+  u32_t LinkValid;
+  u32_t PhyValid;
+  hal_port_conf_t PortConf;
+  u8_t  LinkState[MAX_PORT_NUM];
+  u8_t  Speed[MAX_PORT_NUM];
+  u8_t  Duplex[MAX_PORT_NUM];
+  u8_t  MdiMdix[MAX_PORT_NUM];
+} privmib_port_ctx_t;
+
+static privmib_port_ctx_t PortCtx;
+static u32_t PrivMibPduSeq = 1;
+
+/* Called by the agent for every accepted request, drops the previous snapshot */
+void lwip_privmib_pdu_begin(void)
+{
+  PrivMibPduSeq++;
+}
+
+static void portConfEntry_ctx_sync(void)
+{
+  if(PortCtx.PduSeq != PrivMibPduSeq)
+  {
+    PortCtx.PduSeq = PrivMibPduSeq;
+    PortCtx.ConfValid = 0;
+    PortCtx.LinkValid = 0;
+    PortCtx.PhyValid = 0;
+  }
+}
+
+/* 4 bytes port configuration of row <index> */
+static u8_t *portConfEntry_ctx_conf(u8_t index)
+{
+  portConfEntry_ctx_sync();
+  if(!PortCtx.ConfValid)
+  {
+    if(eeprom_read(NVRAM_PORT_CFG_BASE, (uint8 *)&PortCtx.PortConf, sizeof(hal_port_conf_t)) != I2C_SUCCESS)
+      memset(&PortCtx.PortConf, 0, sizeof(hal_port_conf_t));
+    PortCtx.ConfValid = 1;
+  }
+  if((index == 0) || (index > MAX_PORT_NUM))
+    index = 1;
+  return &PortCtx.PortConf.PortConfig[(index-1)*4];
+}
+
+static HAL_PORT_LINK_STATE portConfEntry_ctx_link(u8_t index)
+{
+  HAL_PORT_LINK_STATE link_state = LINK_DOWN;
+
+  if((index == 0) || (index > MAX_PORT_NUM))
+    return LINK_DOWN;
+  portConfEntry_ctx_sync();
+  if(!(PortCtx.LinkValid & (1UL << (index-1))))
+  {
+    hal_swif_port_get_link_state(index, &link_state);
+    PortCtx.LinkState[index-1] = (u8_t)link_state;
+    PortCtx.LinkValid |= (1UL << (index-1));
+  }
+  return (HAL_PORT_LINK_STATE)PortCtx.LinkState[index-1];
+}
+
+static void portConfEntry_ctx_phy(u8_t index, HAL_PORT_SPEED_STATE *speed, HAL_PORT_DUPLEX_STATE *duplex, HAL_MDI_MDIX_STATE *mdi_mdix)
+{
+  HAL_PORT_SPEED_STATE s;
+  HAL_PORT_DUPLEX_STATE d;
+  HAL_MDI_MDIX_STATE m;
+
+  if((index == 0) || (index > MAX_PORT_NUM))
+    index = 1;
+  portConfEntry_ctx_sync();
+  if(!(PortCtx.PhyValid & (1UL << (index-1))))
+  {
+    hal_swif_port_get_speed(index, &s);
+    hal_swif_port_get_duplex(index, &d);
+    hal_swif_port_get_mdi_mdix(index, &m);
+    PortCtx.Speed[index-1] = (u8_t)s;
+    PortCtx.Duplex[index-1] = (u8_t)d;
+    PortCtx.MdiMdix[index-1] = (u8_t)m;
+    PortCtx.PhyValid |= (1UL << (index-1));
+  }
+  *speed = (HAL_PORT_SPEED_STATE)PortCtx.Speed[index-1];
+  *duplex = (HAL_PORT_DUPLEX_STATE)PortCtx.Duplex[index-1];
+  *mdi_mdix = (HAL_MDI_MDIX_STATE)PortCtx.MdiMdix[index-1];
+}
+
 static void portConfEntry_get_object_def(u8_t ident_len, s32_t *ident, struct obj_def *od)
 {
   u8_t id;
   u8_t index;
-  u8_t PortConfig[4];
+  u8_t *PortConfig;
   enum port_type type;
   u8_t port;
   HAL_PORT_LINK_STATE link_state;
@@ -54,7 +144,7 @@ static void portConfEntry_get_object_def(u8_t ident_len, s32_t *ident, struct ob
     od->id_inst_ptr = ident;
 
     index = ident[1];
-    eeprom_read(NVRAM_PORT_CFG_BASE+(1+(index-1)*4), PortConfig, 4); 
+    PortConfig = portConfEntry_ctx_conf(index);
     
     /* ˿*/
     type = (PortConfig[0] >> 6) & 0x01;
@@ -189,7 +279,7 @@ static void portConfEntry_get_object_def(u8_t ident_len, s32_t *ident, struct ob
         od->instance = MIB_OBJECT_TAB;
         od->access = MIB_OBJECT_READ_ONLY;
         //port = hal_swif_lport_2_hport(index);
-        hal_swif_port_get_link_state(index, &link_state);
+        link_state = portConfEntry_ctx_link(index);
         if(link_state == LINK_UP)
         {
             od->asn_type = (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_INTEG);
@@ -203,7 +293,7 @@ static void portConfEntry_get_object_def(u8_t ident_len, s32_t *ident, struct ob
         od->instance = MIB_OBJECT_TAB;
         od->access = MIB_OBJECT_READ_ONLY;
         //port = hal_swif_lport_2_hport(index);
-        hal_swif_port_get_link_state(index, &link_state);
+        link_state = portConfEntry_ctx_link(index);
         if(link_state == LINK_UP)
         {
             od->asn_type = (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_INTEG);
@@ -231,7 +321,7 @@ static void portConfEntry_get_value(struct obj_def *od, u16_t len, void *value)
   u8_t id;
   u8_t index;
   u8_t port;
-  u8_t PortConfig[4];
+  u8_t *PortConfig;
   enum port_type type;
   HAL_PORT_LINK_STATE link_state;
   HAL_PORT_SPEED_STATE speed;
@@ -242,7 +332,7 @@ static void portConfEntry_get_value(struct obj_def *od, u16_t len, void *value)
   /* the index value can be found in: od->id_inst_ptr[1] */
   index = od->id_inst_ptr[1];
   /* read port configration */
-  eeprom_read(NVRAM_PORT_CFG_BASE+(1+(index-1)*4), PortConfig, 4);
+  PortConfig = portConfEntry_ctx_conf(index);
   id = od->id_inst_ptr[0];
   switch (id)
   {
@@ -345,7 +435,7 @@ static void portConfEntry_get_value(struct obj_def *od, u16_t len, void *value)
       {
         s32_t *sint_ptr = value;
         //port = hal_swif_lport_2_hport(index);
-        hal_swif_port_get_link_state(index, &link_state);
+        link_state = portConfEntry_ctx_link(index);
         
         *sint_ptr = ((link_state == LINK_UP)? UP : DOWN); /* todo: set appropriate value */
       }
@@ -354,8 +444,7 @@ static void portConfEntry_get_value(struct obj_def *od, u16_t len, void *value)
       {
         s32_t *sint_ptr = value;
         //port = hal_swif_lport_2_hport(index);
-        hal_swif_port_get_speed(index, &speed);
-		hal_swif_port_get_duplex(index, &duplex);
+        portConfEntry_ctx_phy(index, &speed, &duplex, &mdi_mdix);
         
         *sint_ptr = (speed == SPEED_1000M && duplex == FULL_DUPLEX) ? GFD:
                     (speed == SPEED_1000M && duplex == HALF_DUPLEX) ? GHD:
@@ -384,7 +473,7 @@ static void portConfEntry_get_value(struct obj_def *od, u16_t len, void *value)
                 mdi_mdix = MODE_MDIX;
         }
 #else
-        hal_swif_port_get_mdi_mdix(index, &mdi_mdix);       
+        portConfEntry_ctx_phy(index, &speed, &duplex, &mdi_mdix);
 #endif
         *sint_ptr = ((mdi_mdix == MODE_MDI) ? CONN_MDI : CONN_MDIX); /* todo: set appropriate value */
       }
@@ -674,6 +763,7 @@ static void portConf_set_value(struct obj_def *od, u16_t len, void *value)
         PortConfig.PortNum = port_num;
         if(eeprom_page_write(NVRAM_PORT_CFG_BASE, (uint8 *)&PortConfig, sizeof(hal_port_conf_t)) != I2C_SUCCESS)
           return;
+        PortCtx.ConfValid = 0;
       }
       break;
   };
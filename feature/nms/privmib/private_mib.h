@@ -125,6 +125,7 @@ enum port_conn_mode
 */
 
 #define SNMP_PRIVATE_MIB_INIT() lwip_privmib_init()
+#define SNMP_PRIVATE_MIB_PDU_BEGIN() lwip_privmib_pdu_begin()
 
 /*
    ----------------------------------
@@ -132,6 +133,7 @@ enum port_conn_mode
    ----------------------------------
 */
 void lwip_privmib_init(void);
+void lwip_privmib_pdu_begin(void);
 
 #endif /* LWIP_SNMP */
 
@@ -146,7 +146,7 @@ void SendTrapTaskInit(void)
 {
     vSNMP_Trap_Init( );
     /* Start SendTrapTask server */
-    sys_thread_new("tSnmpTrap", vSendTrapTaskDemo, NULL, configMINIMAL_STACK_SIZE,mainSNMP_Trap_TASK_PRIORITY );
+    sys_thread_new("tSnmpTrap", vSendTrapTaskDemo, NULL, configMINIMAL_STACK_SIZE + LWIP_API_STACK_EXTRA, mainSNMP_Trap_TASK_PRIORITY );
 
 }   
 
@@ -15,6 +15,7 @@
 /* Kernel includes. */
 #include "FreeRTOS.h"
 #include "task.h"
+#include "semphr.h"
 #include "os_mutex.h"
 
 /* LwIP includes */
@@ -27,7 +28,10 @@
 
 /* BSP includes */
 #include "stm32f2xx_gpio.h"
+#include "stm32f2xx_exti.h"
+#include "stm32f2xx_syscfg.h"
 #include "stm32f2xx.h"
+#include "misc.h"
 #include "misc_drv.h"
 #include "fpga_api.h"
 
@@ -35,7 +39,17 @@
 /* Private define ------------------------------------------------------------*/
 #define SIGNAL_TX_BUFF_LEN  128
 #define SIGNAL_RX_BUFF_LEN  128
+
+/* The FPGA K-signal input has no interrupt line, sample it every SampleCycle */
+#if BOARD_GV3S_HONUE_QM
+#define SIGNAL_POLL_INPUT   1
+#else
+#define SIGNAL_POLL_INPUT   0
+#endif
+
+#define SIGNAL_WAIT_FOREVER 0xFFFFFFFF
 /* Private macro -------------------------------------------------------------*/
+#define SIGNAL_TICK_MS()    ((u32)(xTaskGetTickCount() * portTICK_RATE_MS))
 /* Private variables ---------------------------------------------------------*/
 
 tKinAlarmInfo KinAlarmInfo;
@@ -46,8 +60,61 @@ u8 rxbuff[SIGNAL_RX_BUFF_LEN];
 OS_MUTEX_T kin_mutex;
 u8 KinStatus = 0;
 
+/* Channel edges not yet debounced, shared with the EXTI handler */
+static xSemaphoreHandle xKinSemaphore = NULL;
+static volatile u16 KinEdgePending = 0;
+static volatile u32 KinEdgeFirst[KIN_MAX_CHAN_NUM];
+static volatile u32 KinEdgeLast[KIN_MAX_CHAN_NUM];
+/* Event time of the last settled edge, owned by the signal task */
+static u32 KinSettleTick[KIN_MAX_CHAN_NUM];
+#if SIGNAL_POLL_INPUT
+static u8 KinRawLevel[KIN_MAX_CHAN_NUM];
+#endif
+
 /* Private function prototypes -----------------------------------------------*/
+void ChanGetStatus(u8 chanid, u8 *bitstatus);
 /* Private functions ---------------------------------------------------------*/
+
+/**************************************************************************
+  * @brief  Note an input edge, the first edge of a burst is the event time
+  * @param  chanid: channel 1~16, now: edge time in ms
+  * @retval None
+  * @note   Caller masks the EXTI handler or runs in it
+  *************************************************************************/
+static void SignalChanEdge(u8 chanid, u32 now)
+{
+    u16 mask = 0x0001 << (chanid-1);
+
+    if(!(KinEdgePending & mask))
+        KinEdgeFirst[chanid-1] = now;
+    KinEdgeLast[chanid-1] = now;
+    KinEdgePending |= mask;
+}
+
+#if BOARD_GE22103MA
+/**************************************************************************
+  * @brief  Channel 1 (PD11) edge, wake the signal task to debounce it
+  * @param  None
+  * @retval None
+  *************************************************************************/
+void EXTI15_10_IRQHandler(void)
+{
+    portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+    if(EXTI_GetITStatus(EXTI_Line11) != RESET) {
+        EXTI_ClearITPendingBit(EXTI_Line11);
+        SignalChanEdge(1, (u32)(xTaskGetTickCountFromISR() * portTICK_RATE_MS));
+        if(xKinSemaphore != NULL)
+            xSemaphoreGiveFromISR(xKinSemaphore, &xHigherPriorityTaskWoken);
+    }
+
+    /* Switch tasks if necessary. */
+    if(xHigherPriorityTaskWoken != pdFALSE) {
+        portEND_SWITCHING_ISR(xHigherPriorityTaskWoken);
+    }
+}
+#endif /* BOARD_GE22103MA */
+
 void SignalLockInit(void)
 {
     os_mutex_init(&kin_mutex);
@@ -55,9 +122,21 @@ void SignalLockInit(void)
 
 void SignalMsgSend(u8 HonuKinStatus)
 {
+    u8 changed;
+
     os_mutex_lock(&kin_mutex, OS_MUTEX_WAIT_FOREVER);
+    changed = (KinStatus != HonuKinStatus);
     KinStatus = HonuKinStatus;
     os_mutex_unlock(&kin_mutex); 
+
+    /* Status frames arrive periodically, only a change is an edge */
+    if(changed) {
+        taskENTER_CRITICAL();
+        SignalChanEdge(1, SIGNAL_TICK_MS());
+        taskEXIT_CRITICAL();
+        if(xKinSemaphore != NULL)
+            xSemaphoreGive(xKinSemaphore);
+    }
 }
 
 void SignalMsgRecv(u8 *HonuKinStatus)
@@ -90,9 +169,12 @@ void SignalAlarmInit(tKinAlarmInfo *KinAlarmInfo)
 {   
     u16 serverport;
     u32 serverip;
+    u32 now;
     
 #if BOARD_GE22103MA
     GPIO_InitTypeDef GPIO_InitStructure;
+    EXTI_InitTypeDef EXTI_InitStructure;
+    NVIC_InitTypeDef NVIC_InitStructure;
 
     /* Enable GPIOG's AHB interface clock */
     RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOD, ENABLE);
@@ -125,9 +207,19 @@ void SignalAlarmInit(tKinAlarmInfo *KinAlarmInfo)
     /* Initialize configration */
     KinAlarmInfo->CurrAlarmStatusFlag = 0;
     KinAlarmInfo->PrevAlarmStatusFlag = 0;
-    KinAlarmInfo->AlarmRspStatus = 0;
+    KinAlarmInfo->AlarmRspStatus = KIN_RESP_OK;
     KinAlarmInfo->RxBuff = rxbuff;
     KinAlarmInfo->TxBuff = txbuff;
+    KinAlarmInfo->EventHead = 0;
+    KinAlarmInfo->EventCount = 0;
+    KinAlarmInfo->InFlight = 0;
+    KinAlarmInfo->Retrans = 0;
+    KinAlarmInfo->EventLost = 0;
+    KinAlarmInfo->Srtt = 0;
+    KinAlarmInfo->Rttvar = 0;
+    KinAlarmInfo->Rto = KIN_RTO_INIT;
+    KinAlarmInfo->TickHigh = 0;
+    KinAlarmInfo->LastTick = SIGNAL_TICK_MS();
 
     /* Creat socket */
     if(SignalCreatSocket(KinAlarmInfo) == 1) {
@@ -143,6 +235,42 @@ void SignalAlarmInit(tKinAlarmInfo *KinAlarmInfo)
     KinAlarmInfo->server.sin_port = serverport;
     KinAlarmInfo->server.sin_family = AF_INET;
 
+    if(xKinSemaphore == NULL)
+        vSemaphoreCreateBinary(xKinSemaphore);
+    /* An ack wakes the task the same way as an input edge */
+    lwip_socket_notify(KinAlarmInfo->sock, xKinSemaphore);
+
+    /* Sample every channel once at start, an input already in alarm is reported */
+    now = SIGNAL_TICK_MS();
+    for(u8 chanid=1; chanid<=KinAlarmInfo->KinAlarmCfg.ChanConfig.ChanNum; chanid++)
+    {
+#if SIGNAL_POLL_INPUT
+        ChanGetStatus(chanid, &KinRawLevel[chanid-1]);
+#endif
+        taskENTER_CRITICAL();
+        SignalChanEdge(chanid, now);
+        taskEXIT_CRITICAL();
+    }
+
+#if BOARD_GE22103MA
+    /* Channel 1 interrupts on both edges */
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
+    SYSCFG_EXTILineConfig(EXTI_PortSourceGPIOD, EXTI_PinSource11);
+
+    EXTI_InitStructure.EXTI_Line = EXTI_Line11;
+    EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+    EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising_Falling;
+    EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+    EXTI_Init(&EXTI_InitStructure);
+    EXTI_ClearITPendingBit(EXTI_Line11);
+
+    /* Below configMAX_SYSCALL_INTERRUPT_PRIORITY, the handler uses the FromISR API */
+    NVIC_InitStructure.NVIC_IRQChannel = EXTI15_10_IRQn;
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 2;
+    NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStructure);
+#endif /* BOARD_GE22103MA */
 }
 
 void ChanGetStatus(u8 chanid, u8 *bitstatus)
@@ -168,7 +296,82 @@ void ChanGetStatus(u8 chanid, u8 *bitstatus)
     }
 }
 
-void SignalAlarmGetStatus(tKinAlarmInfo *KinAlarmInfo)
+/**************************************************************************
+  * @brief  Return the channels whose debounce time has passed
+  * @param  now: current time in ms
+  * @param  wait: lowered to the time until the next channel settles
+  * @retval bit0~bit15 is channel 1~16
+  *************************************************************************/
+u16 SignalChanSettled(tKinAlarmInfo *KinAlarmInfo, u32 now, u32 *wait)
+{
+    u32 jitter = 0;
+    u32 elapsed;
+    u32 remain;
+    u16 settled = 0;
+    u16 mask;
+
+    if(KinAlarmInfo->KinAlarmCfg.RemoveJitterEnable == KIN_ENABLE)
+        jitter = KinAlarmInfo->KinAlarmCfg.JitterProbeTime;
+
+    taskENTER_CRITICAL();
+    for(u8 chanid=1; chanid<=KinAlarmInfo->KinAlarmCfg.ChanConfig.ChanNum; chanid++)
+    {
+        mask = 0x0001 << (chanid-1);
+        if(!(KinEdgePending & mask))
+            continue;
+
+        /* Quiet for a probe time, or chattering for four of them */
+        elapsed = now - KinEdgeLast[chanid-1];
+        remain = (elapsed >= jitter) ? 0 : (jitter - elapsed);
+        elapsed = now - KinEdgeFirst[chanid-1];
+        if(elapsed >= (jitter << 2))
+            remain = 0;
+
+        if(remain == 0) {
+            KinSettleTick[chanid-1] = KinEdgeFirst[chanid-1];
+            KinEdgePending &= ~mask;
+            settled |= mask;
+        } else if(remain < *wait) {
+            *wait = remain;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return settled;
+}
+
+/**************************************************************************
+  * @brief  Queue one timestamped alarm record
+  * @param  chanid: channel 1~16, tick: edge time in ms
+  * @retval None
+  *************************************************************************/
+void SignalEventPut(tKinAlarmInfo *KinAlarmInfo, u8 chanid, u32 tick, u32 now)
+{
+    tKinEvent *pEvent;
+
+    if(KinAlarmInfo->EventCount >= KIN_EVENT_RING_SIZE) {
+        KinAlarmInfo->EventLost++;
+        printf("Error: Kin alarm record lost \r\n");
+        return;
+    }
+
+    /* First record not yet in a report starts the batch window */
+    if(KinAlarmInfo->EventCount == KinAlarmInfo->InFlight)
+        KinAlarmInfo->BatchTick = now;
+
+    pEvent = &KinAlarmInfo->Event[(KinAlarmInfo->EventHead + KinAlarmInfo->EventCount) % KIN_EVENT_RING_SIZE];
+    pEvent->ChanID = chanid;
+    pEvent->SeqId = (KinAlarmInfo->SeqId)++;
+    pEvent->Tick = tick;
+    /* The edge may be stamped just before the counter wrapped */
+    if((tick > now) && (tick - now > 0x7FFFFFFF))
+        pEvent->TickHigh = KinAlarmInfo->TickHigh - 1;
+    else
+        pEvent->TickHigh = KinAlarmInfo->TickHigh;
+    KinAlarmInfo->EventCount++;
+}
+
+void SignalAlarmGetStatus(tKinAlarmInfo *KinAlarmInfo, u16 settled, u32 now)
 {
     u8 ChanNum;
     u8 bitstatus;
@@ -177,6 +380,9 @@ void SignalAlarmGetStatus(tKinAlarmInfo *KinAlarmInfo)
     ChanNum = KinAlarmInfo->KinAlarmCfg.ChanConfig.ChanNum;
     for(u8 chanid=1; chanid<=ChanNum; chanid++)
     {
+        if(!(settled & (0x0001 << (chanid-1))))
+            continue;
+
         AlarmType = CHAN_GET_ALARM_TYPE(KinAlarmInfo->KinAlarmCfg.ChanConfig.Data[chanid-1]);
         switch(AlarmType)
         {
@@ -185,7 +391,7 @@ void SignalAlarmGetStatus(tKinAlarmInfo *KinAlarmInfo)
                 if(bitstatus == Bit_RESET){
                     KinAlarmInfo->CurrAlarmStatusFlag |= (0x0001 << (chanid-1));
                 }else{
-                    KinAlarmInfo->CurrAlarmStatusFlag &= (0xfffe << (chanid-1));
+                    KinAlarmInfo->CurrAlarmStatusFlag &= ~(0x0001 << (chanid-1));
                 }
                 break;
             case ALARMTYPE_OPEN:
@@ -193,7 +399,7 @@ void SignalAlarmGetStatus(tKinAlarmInfo *KinAlarmInfo)
                 if(bitstatus == Bit_SET){
                     KinAlarmInfo->CurrAlarmStatusFlag |= (0x0001 << (chanid-1));
                 }else{
-                    KinAlarmInfo->CurrAlarmStatusFlag &= (0xfffe << (chanid-1));
+                    KinAlarmInfo->CurrAlarmStatusFlag &= ~(0x0001 << (chanid-1));
                 }
                 break;
             case ALARMTYPE_DOWN: 
@@ -201,7 +407,7 @@ void SignalAlarmGetStatus(tKinAlarmInfo *KinAlarmInfo)
                 if(bitstatus == Bit_SET){
                     KinAlarmInfo->CurrAlarmStatusFlag |= (0x0001 << (chanid-1));
                 }else{
-                    KinAlarmInfo->CurrAlarmStatusFlag &= (0xfffe << (chanid-1));
+                    KinAlarmInfo->CurrAlarmStatusFlag &= ~(0x0001 << (chanid-1));
                 }
                 break;
             case ALARMTYPE_UNKNOW:
@@ -215,6 +421,12 @@ void SignalAlarmGetStatus(tKinAlarmInfo *KinAlarmInfo)
                                      ^KinAlarmInfo->PrevAlarmStatusFlag);
 
     KinAlarmInfo->PrevAlarmStatusFlag = KinAlarmInfo->CurrAlarmStatusFlag;
+
+    for(u8 chanid=1; chanid<=ChanNum; chanid++)
+    {
+        if(KinAlarmInfo->Normal2AlarmFlag & (0x0001 << (chanid-1)))
+            SignalEventPut(KinAlarmInfo, chanid, KinSettleTick[chanid-1], now);
+    }
 }
 
 void PrepareAlarmHead(tKinAlarmInfo *KinAlarmInfo)
@@ -257,104 +469,212 @@ void PrepareAlarmHead(tKinAlarmInfo *KinAlarmInfo)
     KinAlarmInfo->TxLen = sizeof(tAlarmHead) + sizeof(tChanHead);
 }
 
-void SignalAlarmSend(tKinAlarmInfo *KinAlarmInfo)
+/**************************************************************************
+  * @brief  Send the oldest unacknowledged records as one report
+  * @param  now: current time in ms
+  * @retval None
+  * @note   Header SeqId is the sequence of the last record, an ack for it
+  *         acknowledges every record of the report
+  *************************************************************************/
+void SignalAlarmSend(tKinAlarmInfo *KinAlarmInfo, u32 now)
 {
     u16 len = 0;
     u16 msglen = 0;
-    u8 ChanNum = 0;
     u8 RecordCount = 0;
+    tKinEvent *pEvent = NULL;
     tAlarmHead *pTxAlarmHead = (tAlarmHead *)KinAlarmInfo->TxBuff;
     tChanMsg *pTxChanMsg = (tChanMsg *)(KinAlarmInfo->TxBuff + ALARM_ADDR_CHAN_MSG);
     tChanHead *pTxChanHead = (tChanHead *)(KinAlarmInfo->TxBuff + ALARM_ADDR_CHAN_HEAD);
+    tAlarmTail *pTxAlarmTail;
 
-    len = KinAlarmInfo->TxLen;
-    ChanNum = KinAlarmInfo->KinAlarmCfg.ChanConfig.ChanNum;
+    RecordCount = KinAlarmInfo->EventCount;
+    if(RecordCount > KIN_REPORT_MAX_RECORD)
+        RecordCount = KIN_REPORT_MAX_RECORD;
+    if(RecordCount == 0)
+        return;
     
-    /* determine current alarm status flag */
-    if(KinAlarmInfo->CurrAlarmStatusFlag > 0){
-        /* determine current seqid whether add */
-        if(KinAlarmInfo->Normal2AlarmFlag > 0){
-            pTxChanHead->RecordCount = 0;
-            for(u8 chanid=1; chanid<=ChanNum; chanid++)
-            {
-                if(KinAlarmInfo->Normal2AlarmFlag & 1<<(chanid - 1))
-                {
-                    pTxChanHead->RecordCount++;
-                    pTxChanMsg[chanid-1].ChanID = chanid;
-                    /* @todo: timestamp */
-                }
-            }
+    for(u8 i=0; i<RecordCount; i++)
+    {
+        pEvent = &KinAlarmInfo->Event[(KinAlarmInfo->EventHead + i) % KIN_EVENT_RING_SIZE];
+        pTxChanMsg[i].ChanID = pEvent->ChanID;
+        /* Edge time in ms since boot, 48-bit big endian */
+        pTxChanMsg[i].TimeStamp[0] = (u8)(pEvent->TickHigh >> 8);
+        pTxChanMsg[i].TimeStamp[1] = (u8)(pEvent->TickHigh);
+        pTxChanMsg[i].TimeStamp[2] = (u8)(pEvent->Tick >> 24);
+        pTxChanMsg[i].TimeStamp[3] = (u8)(pEvent->Tick >> 16);
+        pTxChanMsg[i].TimeStamp[4] = (u8)(pEvent->Tick >> 8);
+        pTxChanMsg[i].TimeStamp[5] = (u8)(pEvent->Tick);
+    }
+    pTxChanHead->RecordCount = RecordCount;
     
-            *(u16 *)(pTxAlarmHead->SeqId) = htons((KinAlarmInfo->SeqId)++);
-            len = len + (pTxChanHead->RecordCount)*sizeof(tChanMsg) + sizeof(tAlarmTail);
-            msglen = sizeof(tChanHead) + (pTxChanHead->RecordCount)*sizeof(tChanMsg);
-            pTxAlarmHead->MsgLen[0] = (msglen>>8) & 0x00FF;
-            pTxAlarmHead->MsgLen[1] = msglen & 0x00FF;
-            /* Send alarm message */
-            if(lwip_sendto(KinAlarmInfo->sock, KinAlarmInfo->TxBuff, len, 0, 
-                            (struct sockaddr *)&(KinAlarmInfo->server), 
-                            sizeof(KinAlarmInfo->server)) != len){
-                printf("Error: lwip send signal failed \r\n");
-            }
+    *(u16 *)(pTxAlarmHead->SeqId) = htons(pEvent->SeqId);
+    msglen = sizeof(tChanHead) + RecordCount*sizeof(tChanMsg);
+    pTxAlarmHead->MsgLen[0] = (msglen>>8) & 0x00FF;
+    pTxAlarmHead->MsgLen[1] = msglen & 0x00FF;
+    pTxAlarmTail = (tAlarmTail *)&pTxChanMsg[RecordCount];
+    memset(pTxAlarmTail, 0, sizeof(tAlarmTail));
+    len = KinAlarmInfo->TxLen + RecordCount*sizeof(tChanMsg) + sizeof(tAlarmTail);
     
-            KinAlarmInfo->respTime = 0;
-            KinAlarmInfo->AlarmRspStatus = KIN_RESP_WAIT;
-        }else{
-            /* Retransmission if non-ack */
-            if(KinAlarmInfo->AlarmRspStatus == KIN_RESP_WAIT){
-                KinAlarmInfo->respTime++;
-                /* retransmission if respond timeout */
-                if(KinAlarmInfo->respTime > RESPOND_TIMEOUT){
-                    len = len + (pTxChanHead->RecordCount)*sizeof(tChanMsg) + sizeof(tAlarmTail);
-                    /* Send alarm message */
-                    if(lwip_sendto(KinAlarmInfo->sock, KinAlarmInfo->TxBuff, len, 0, 
-                                    (struct sockaddr *)&(KinAlarmInfo->server), 
-                                    sizeof(KinAlarmInfo->server)) != len){
-                        printf("Error: lwip send signal failed \r\n");
-                    }
-                    KinAlarmInfo->respTime = 0;
-                }
-            }
-        }
-    }else{
+    /* Send alarm message */
+    if(lwip_sendto(KinAlarmInfo->sock, KinAlarmInfo->TxBuff, len, 0,
+                    (struct sockaddr *)&(KinAlarmInfo->server),
+                    sizeof(KinAlarmInfo->server)) != len){
+        printf("Error: lwip send signal failed \r\n");
     }
 
+    KinAlarmInfo->InFlight = RecordCount;
+    KinAlarmInfo->SendTick = now;
+    KinAlarmInfo->AlarmRspStatus = KIN_RESP_WAIT;
 }
 
-void SignalAlarmRspProc(tKinAlarmInfo *KinAlarmInfo)
+/**************************************************************************
+  * @brief  Update the retransmit timeout from one round trip sample
+  * @param  rtt: measured round trip in ms
+  * @retval None
+  *************************************************************************/
+void SignalRttUpdate(tKinAlarmInfo *KinAlarmInfo, s32 rtt)
+{
+    s32 delta;
+    u32 rto;
+
+    if(KinAlarmInfo->Srtt == 0) {
+        KinAlarmInfo->Srtt = rtt;
+        KinAlarmInfo->Rttvar = rtt >> 1;
+    } else {
+        delta = rtt - KinAlarmInfo->Srtt;
+        KinAlarmInfo->Srtt += delta >> 3;
+        if(delta < 0)
+            delta = -delta;
+        KinAlarmInfo->Rttvar += (delta - KinAlarmInfo->Rttvar) >> 2;
+    }
+
+    rto = (u32)(KinAlarmInfo->Srtt + (KinAlarmInfo->Rttvar << 2));
+    if(rto < KIN_RTO_MIN)
+        rto = KIN_RTO_MIN;
+    if(rto > KIN_RTO_MAX)
+        rto = KIN_RTO_MAX;
+    KinAlarmInfo->Rto = rto;
+}
+
+void SignalAlarmRspProc(tKinAlarmInfo *KinAlarmInfo, u32 now)
 {
     tAlarmHead *pRxAlarmHead = (tAlarmHead *)KinAlarmInfo->RxBuff;
-    tAlarmHead *pTxAlarmHead = (tAlarmHead *)KinAlarmInfo->RxBuff;
-    u8 opcode;
-    u16 len;
+    u16 seqid;
+    u16 acked;
+    int len;
 
-    while(lwip_recv(KinAlarmInfo->sock, KinAlarmInfo->RxBuff, SIGNAL_RX_BUFF_LEN, MSG_DONTWAIT) > 0);
-    opcode = pRxAlarmHead->FrameType;
-    switch(opcode)
+    while((len = lwip_recv(KinAlarmInfo->sock, KinAlarmInfo->RxBuff, SIGNAL_RX_BUFF_LEN, MSG_DONTWAIT)) > 0)
     {
-        case COMAND_TRAP_RESPONE:
-            if(*(u16 *)(pRxAlarmHead->SeqId) == *(u16 *)(pTxAlarmHead->SeqId))
-                KinAlarmInfo->AlarmRspStatus = KIN_RESP_OK;
-            memset(pRxAlarmHead, 0, SIGNAL_RX_BUFF_LEN);
-            break;
-        default:
-            break;
+        if((len < (int)sizeof(tAlarmHead)) || (pRxAlarmHead->FrameType != COMAND_TRAP_RESPONE))
+            continue;
+        if(KinAlarmInfo->InFlight == 0)
+            continue;
+
+        /* Cumulative ack, covers every record up to and including seqid */
+        seqid = ntohs(*(u16 *)(pRxAlarmHead->SeqId));
+        acked = (u16)(seqid - KinAlarmInfo->Event[KinAlarmInfo->EventHead].SeqId) + 1;
+        if(acked > KinAlarmInfo->InFlight)
+            continue;
+
+        KinAlarmInfo->EventHead = (KinAlarmInfo->EventHead + acked) % KIN_EVENT_RING_SIZE;
+        KinAlarmInfo->EventCount -= acked;
+        KinAlarmInfo->InFlight -= acked;
+        if(KinAlarmInfo->InFlight == 0) {
+            /* Karn: a retransmitted report gives no round trip sample */
+            if(KinAlarmInfo->Retrans == 0)
+                SignalRttUpdate(KinAlarmInfo, (s32)(now - KinAlarmInfo->SendTick));
+            KinAlarmInfo->Retrans = 0;
+            KinAlarmInfo->AlarmRspStatus = KIN_RESP_OK;
+            KinAlarmInfo->BatchTick = now;
+        }
     }
 }
 
 void SignalTask(void * arg)
 {
+    u32 now;
+    u32 wait;
+    u32 elapsed;
+    u16 settled;
+#if SIGNAL_POLL_INPUT
+    u8 bitstatus;
+    u32 SampleTick;
+    u32 SampleCycle;
+#endif
+
     SignalAlarmInit(pKinAlarmInfo);
     PrepareAlarmHead(pKinAlarmInfo);
     
+#if SIGNAL_POLL_INPUT
+    SampleCycle = pKinAlarmInfo->KinAlarmCfg.SampleCycle;
+    if(SampleCycle == 0)
+        SampleCycle = KSIG_IN_ALARM_DEFAULT_SAMPLE_CYCLE;
+    SampleTick = SIGNAL_TICK_MS();
+#endif
+
     for(;;){
-        /* Check input signal per 50ms */
-        SignalAlarmGetStatus(pKinAlarmInfo);
-        SignalAlarmSend(pKinAlarmInfo);
-        SignalAlarmRspProc(pKinAlarmInfo);
+        now = SIGNAL_TICK_MS();
+        if(now < pKinAlarmInfo->LastTick)
+            pKinAlarmInfo->TickHigh++;
+        pKinAlarmInfo->LastTick = now;
+        wait = SIGNAL_WAIT_FOREVER;
         
-        /* Task poll about POLL_TIME(ms) */
-        vTaskDelay(POLL_TIME);
+#if SIGNAL_POLL_INPUT
+        /* No edge interrupt, a level change seen by sampling is the edge */
+        if(now - SampleTick >= SampleCycle) {
+            SampleTick = now;
+            for(u8 chanid=1; chanid<=pKinAlarmInfo->KinAlarmCfg.ChanConfig.ChanNum; chanid++)
+            {
+                ChanGetStatus(chanid, &bitstatus);
+                if(bitstatus != KinRawLevel[chanid-1]) {
+                    KinRawLevel[chanid-1] = bitstatus;
+                    SignalChanEdge(chanid, now);
+                }
+            }
+        }
+        wait = SampleCycle - (now - SampleTick);
+#endif
+
+        /* Sample the channels whose debounce time has passed */
+        settled = SignalChanSettled(pKinAlarmInfo, now, &wait);
+        if(settled)
+            SignalAlarmGetStatus(pKinAlarmInfo, settled, now);
+
+        if(pKinAlarmInfo->InFlight) {
+            SignalAlarmRspProc(pKinAlarmInfo, now);
+        }
+
+        if(pKinAlarmInfo->InFlight) {
+            /* Retransmit with back off, newer records join the report */
+            elapsed = now - pKinAlarmInfo->SendTick;
+            if(elapsed >= pKinAlarmInfo->Rto) {
+                pKinAlarmInfo->Retrans++;
+                pKinAlarmInfo->Rto <<= 1;
+                if(pKinAlarmInfo->Rto > KIN_RTO_MAX)
+                    pKinAlarmInfo->Rto = KIN_RTO_MAX;
+                SignalAlarmSend(pKinAlarmInfo, now);
+                elapsed = 0;
+            }
+            if(wait > pKinAlarmInfo->Rto - elapsed)
+                wait = pKinAlarmInfo->Rto - elapsed;
+        } else if(pKinAlarmInfo->EventCount) {
+            /* Gather records that settle close together into one report */
+            elapsed = now - pKinAlarmInfo->BatchTick;
+            if(elapsed >= KIN_BATCH_TIME) {
+                SignalAlarmSend(pKinAlarmInfo, now);
+                if(wait > pKinAlarmInfo->Rto)
+                    wait = pKinAlarmInfo->Rto;
+            } else if(wait > KIN_BATCH_TIME - elapsed) {
+                wait = KIN_BATCH_TIME - elapsed;
+            }
+        }
+
+        /* Sleep until an edge, an ack, a debounce deadline or the next
+           report step, edges are debounced while a report is in flight */
+        if(wait == SIGNAL_WAIT_FOREVER)
+            xSemaphoreTake(xKinSemaphore, portMAX_DELAY);
+        else
+            xSemaphoreTake(xKinSemaphore, (portTickType)((wait / portTICK_RATE_MS) + 1));
     }
 }
 
@@ -381,6 +701,5 @@ void SignalTaskInit(void)
 #endif 
     
     /* create fpga upgrade task */
-    xTaskCreate(SignalTask,	"tSIGNAL", 	configMINIMAL_STACK_SIZE*3, NULL,	tskIDLE_PRIORITY + 3, NULL);
+    xTaskCreate(SignalTask,	"tSIGNAL", 	configMINIMAL_STACK_SIZE*3 + LWIP_API_STACK_EXTRA, NULL,	tskIDLE_PRIORITY + 3, NULL);
 }
-
@@ -24,6 +24,17 @@ extern "C" {
 #include "lwip/inet.h"
 
 /* Exported types ------------------------------------------------------------*/
+/* Debounced alarm records waiting for acknowledgement */
+#define KIN_EVENT_RING_SIZE     16
+
+typedef struct
+{
+    u8  ChanID;
+    u16 SeqId;
+    u16 TickHigh;                       /* bit32~bit47 of the edge time */
+    u32 Tick;                           /* edge time, ms since boot */
+}tKinEvent;
+
 typedef struct
 {
     tKinAlarmConfig KinAlarmCfg;
@@ -41,8 +52,23 @@ typedef struct
     u8 *TxBuff;
     u16 RxLen;
     u8 *RxBuff;
-    int respTime;
     struct sockaddr_in server;
+    /* Event ring, Event[EventHead] is the oldest unacknowledged record */
+    tKinEvent Event[KIN_EVENT_RING_SIZE];
+    u8 EventHead;
+    u8 EventCount;
+    /* Records carried by the outstanding report */
+    u8 InFlight;
+    u8 Retrans;
+    u16 EventLost;
+    u32 BatchTick;
+    u32 SendTick;
+    /* Retransmit timer, all in ms */
+    s32 Srtt;
+    s32 Rttvar;
+    u32 Rto;
+    u32 LastTick;
+    u16 TickHigh;
 }tKinAlarmInfo;
 
 typedef struct
@@ -89,8 +115,14 @@ typedef struct
 /* KIN response status */
 #define KIN_RESP_OK             0x00                /* ɹӦ */
 #define KIN_RESP_WAIT           0x01                /* ȴӦ */
-#define POLL_TIME               (10)                /* ѯʱ ms*/
-#define RESPOND_TIMEOUT         (3000/POLL_TIME)    /* 3sӦش */
+/* Report timing, ms */
+#define KIN_BATCH_TIME          20                  /* gather records before sending */
+#define KIN_RTO_INIT            3000                /* first report, no RTT sample yet */
+#define KIN_RTO_MIN             200
+#define KIN_RTO_MAX             12000
+
+/* Records per report, TxBuff must hold head + records + tail */
+#define KIN_REPORT_MAX_RECORD   8
 
 /* Frame type */
 #define COMAND_SEND             0X91
@@ -20,6 +20,7 @@
 #include "stm32f2xx.h"
 #include "stm32f2x7_smi.h"
 #include "misc_drv.h"
+#include "timer.h"
 #if ROBO_SWITCH
 #include "robo_drv.h"
 #endif
@@ -1156,6 +1157,18 @@ void hal_swif_conf_initialize(void)
 uint32 gNeighborReqEnBitMap = 0;
 extern hal_port_config_info_t gPortConfigInfo[];
 
+/* Queue a port status trap, the trap task resends it until the NMS answers */
+static void hal_swif_trap_port_post(uint8 *PortStatus)
+{
+	hal_trap_port_status TrapPortStatus;
+	
+	memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
+	TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
+	TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
+	memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
+	hal_swif_trap_post((uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status));
+}
+
 void hal_swif_poll_task(void *arg)
 {
 #if BOARD_GE2C400U
@@ -1163,61 +1176,29 @@ void hal_swif_poll_task(void *arg)
 	uint16	u16Data, OpModeStatus;
 	uint32	u32Data;
 	uint32	SDStatusMap = 0, CurrLinkMap = 0, PrevLinkMap = 0, Link_DownUp_Map, Link_UpDown_Map;
-	uint32	NeighborClearEnBitMap=0;
-	uint16	ReqID = 0;
 	HAL_PORT_LINK_STATE CurrLinkStatus;
-	uint8	LoopCount[MAX_PORT_NUM] = {0};
-    uint8	LoopLinkStatusMax = 20000/LINK_STATUS_POLLING_DELAY; /* 20s */
-    uint8   LoopCountLinkStatus[MAX_PORT_NUM] = {0};
-	uint8	LoopCnt = 0;
-	uint8	LoopMaxCount = 1000/LINK_STATUS_POLLING_DELAY;
 	uint8	PortStatus[MAX_PORT_NUM] = {0};
 	HAL_PORT_DUPLEX_STATE Duplex;
 	HAL_PORT_SPEED_STATE Speed;
-	hal_trap_port_status TrapPortStatus;
 
 
 	while(1) {
 
 		for(lport=1; lport<=MAX_PORT_NUM; lport++) {
-         //   LoopCountLinkStatus[lport-1]++;
 			hport = hal_swif_lport_2_hport(lport);
 
 			if(lport > 12) {
 				if(hal_swif_port_get_link_state(lport, &CurrLinkStatus) == HAL_SWIF_SUCCESS) {
+					CurrLinkStatus = hal_swif_port_link_dampen(lport, CurrLinkStatus);
         
-                    /* If timeout neighbor_req_send 20S */
-                    if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                        LoopCountLinkStatus[lport-1] = 0;
-                    }
-                    
 					if(CurrLinkStatus == LINK_UP) {
-						if((PrevLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-							gNeighborReqEnBitMap |= (1<<(lport-1));
-							NeighborClearEnBitMap |= (1<<(lport-1));
-							LoopCount[lport-1] = 0;
-							LoopCountLinkStatus[lport-1] = 0;
-							ReqID = 1;
-						}
-						if(LoopCount[lport-1] >= LoopMaxCount)
-							LoopCount[lport-1] = 0;
-						/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-						if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						LoopCount[lport-1]++;
-						LoopCountLinkStatus[lport-1]++;
+						if((PrevLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+							hal_swif_neighbor_link_changed(lport, LINK_UP);
 						CurrLinkMap |= (1<<(lport-1));
 					} else {
 						if(PrevLinkMap & (1<<(lport-1))) {			/* Previous LinkStatus is up */
 							CurrLinkMap &= ~(uint32)(1<<(lport-1));
-							gNeighborReqEnBitMap &= ~(1<<(lport-1));
-							if(NeighborClearEnBitMap & (1<<(lport-1))) {
-								hal_swif_neighbor_info_clear(lport);
-								NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-							}
+							hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 						}
 					}
 				}
@@ -1228,30 +1209,9 @@ void hal_swif_poll_task(void *arg)
 					robo_write(0x80+hport, 0x38, (u8 *)&u16Data, 2);
 					robo_read(0x80+hport, 0x38, (u8 *)&u16Data, 2);
                     
-                    /* If timeout neighbor_req_send 20S */
-                    if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                        LoopCountLinkStatus[lport-1] = 0;
-                        //u16Data &= 0xfdff; /* Set port link down */
-                    }
-
 					if(u16Data&0x0200) {							/* SGMII link up */
-						if((PrevLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-							gNeighborReqEnBitMap |= (1<<(lport-1));
-							NeighborClearEnBitMap |= (1<<(lport-1));
-							LoopCount[lport-1] = 0;
-							LoopCountLinkStatus[lport-1] = 0;
-							ReqID = 1;
-						}
-						if(LoopCount[lport-1] >= LoopMaxCount)
-							LoopCount[lport-1] = 0;
-						/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-						if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						LoopCount[lport-1]++;
-						LoopCountLinkStatus[lport-1]++;
+						if((PrevLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+							hal_swif_neighbor_link_changed(lport, LINK_UP);
 						CurrLinkMap |= (1<<(lport-1));
 						//continue;
 					} else {										/* SGMII link down */
@@ -1284,11 +1244,7 @@ void hal_swif_poll_task(void *arg)
 					if(SDStatusMap & (1<<(lport-1))) {
 						SDStatusMap &= ~(uint32)(1<<(lport-1));
 						CurrLinkMap &= ~(uint32)(1<<(lport-1));
-						gNeighborReqEnBitMap &= ~(uint32)(1<<(lport-1));
-						if(NeighborClearEnBitMap & (1<<(lport-1))) {
-							hal_swif_neighbor_info_clear(lport);
-							NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-						}
+						hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 						/* Re-enable 1000BASE-X mode */
 						u16Data = 0xCC0A;
 						robo_write(0x80+hport, 0x38, (u8 *)&u16Data, 2);
@@ -1297,6 +1253,9 @@ void hal_swif_poll_task(void *arg)
 			}
 		}
 
+		/* Ports still probing or due a refresh */
+		hal_swif_neighbor_poll();
+
 		/* Process for Trap */
 		if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_PORT_STATUS)) {
 			if(CurrLinkMap ^ PrevLinkMap) {
@@ -1313,24 +1272,9 @@ void hal_swif_poll_task(void *arg)
 					}
 				}
 				if(CurrLinkMap > 0) {
-					gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] = HAL_TRUE;
-					gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]++;
-					LoopCnt = 0;
+					hal_swif_trap_port_post(PortStatus);
 				}
 			}
-
-			if(LoopCnt >= LoopMaxCount)
-				LoopCnt = 0;
-
-			if((gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) && (LoopCnt == 0)) {
-				memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
-				TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
-				TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
-				memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status), gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]);
-			}
-
-			LoopCnt++;
 		}
 
 		PrevLinkMap = CurrLinkMap;
@@ -1344,59 +1288,29 @@ void hal_swif_poll_task(void *arg)
 	uint16	u16Data, OpModeStatus;
 	uint32	SDStatusMap = 0;
 	uint32	CurrLinkMap = 0, PrevLinkMap = 0, Link_DownUp_Map, Link_UpDown_Map;
-	uint32	NeighborClearEnBitMap=0;
-	uint16	ReqID = 0;
 	HAL_PORT_LINK_STATE CurrLinkStatus;
-	uint8	LoopCount[MAX_PORT_NUM] = {0};
-    uint8	LoopLinkStatusMax = 20000/LINK_STATUS_POLLING_DELAY; /* 20s */
-    uint8   LoopCountLinkStatus[MAX_PORT_NUM] = {0};
-	uint8	LoopCnt = 0;
-	uint8	LoopMaxCount = 1000/LINK_STATUS_POLLING_DELAY;
 	uint8	PortStatus[MAX_PORT_NUM] = {0};
 	HAL_PORT_DUPLEX_STATE Duplex;
 	HAL_PORT_SPEED_STATE Speed;
-	hal_trap_port_status TrapPortStatus;
 
 	while(1) {
 		for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
 			if(hal_swif_port_get_link_state(lport, &CurrLinkStatus) == HAL_SWIF_SUCCESS) {
-               
-              //  LoopCountLinkStatus[lport-1]++; 
-                /* If timeout neighbor_req_send 20s*/
-                if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                    LoopCountLinkStatus[lport-1] = 0;
-                }
-                
+				CurrLinkStatus = hal_swif_port_link_dampen(lport, CurrLinkStatus);
 				if(CurrLinkStatus == LINK_UP) {
-					if((CurrLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-						gNeighborReqEnBitMap |= (1<<(lport-1));
-						NeighborClearEnBitMap |= (1<<(lport-1));
-						LoopCount[lport-1] = 0;
-						LoopCountLinkStatus[lport-1] = 0;
-						ReqID = 1;
-					}
-					if(LoopCount[lport-1] >= LoopMaxCount)
-						LoopCount[lport-1] = 0;
-					/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-					if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					LoopCount[lport-1]++;
-					LoopCountLinkStatus[lport-1]++;
+					if((CurrLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+						hal_swif_neighbor_link_changed(lport, LINK_UP);
 					CurrLinkMap |= (1<<(lport-1));
 				} else {
 					CurrLinkMap &= ~(uint32)(1<<(lport-1));
-					gNeighborReqEnBitMap &= ~(1<<(lport-1));
-					if(NeighborClearEnBitMap & (1<<(lport-1))) {
-						hal_swif_neighbor_info_clear(lport);
-						NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-					}
+					hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 				}
 			}
 		}
 
+		/* Ports still probing or due a refresh */
+		hal_swif_neighbor_poll();
+
 		/* Process for Trap */
 		if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_PORT_STATUS)) {
 			if(CurrLinkMap ^ PrevLinkMap) {
@@ -1413,25 +1327,10 @@ void hal_swif_poll_task(void *arg)
 					}
 				}
 				if(CurrLinkMap > 0) {
-					gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] = HAL_TRUE;
-					gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]++;
-					LoopCnt = 0;
+					hal_swif_trap_port_post(PortStatus);
 				}
 			}
 
-			if(LoopCnt >= LoopMaxCount)
-				LoopCnt = 0;
-
-			if((gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) && (LoopCnt == 0)) {
-				memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
-				TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
-				TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
-				memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status), gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]);
-			}
-
-			LoopCnt++;
-
 			PrevLinkMap = CurrLinkMap;
 		}
 
@@ -1444,59 +1343,30 @@ void hal_swif_poll_task(void *arg)
 	uint16	u16Data, OpModeStatus;
 	uint32	SDStatusMap = 0;
 	uint32	CurrLinkMap = 0, PrevLinkMap = 0, Link_DownUp_Map, Link_UpDown_Map;
-	uint32	NeighborClearEnBitMap=0;
-	uint16	ReqID = 0;
 	HAL_PORT_LINK_STATE CurrLinkStatus;
-	uint8	LoopCount[MAX_PORT_NUM] = {0};
-    uint8	LoopLinkStatusMax = 20000/LINK_STATUS_POLLING_DELAY; /* 20s */
-    uint8   LoopCountLinkStatus[MAX_PORT_NUM] = {0};
-	uint8	LoopCnt = 0;
-	uint8	LoopMaxCount = 1000/LINK_STATUS_POLLING_DELAY;
 	uint8	PortStatus[MAX_PORT_NUM] = {0};
 	HAL_PORT_DUPLEX_STATE Duplex;
 	HAL_PORT_SPEED_STATE Speed;
-	hal_trap_port_status TrapPortStatus;
 
 	while(1) {
 		for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
 			if(hal_swif_port_get_link_state(lport, &CurrLinkStatus) == HAL_SWIF_SUCCESS) {
-                
-               // LoopCountLinkStatus[lport-1]++; 
-                /* If timeout neighbor_req_send 20S */
-                if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                    LoopCountLinkStatus[lport-1] = 0;
-                }
+				CurrLinkStatus = hal_swif_port_link_dampen(lport, CurrLinkStatus);
                 
 				if(CurrLinkStatus == LINK_UP) {
-					if((CurrLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-						gNeighborReqEnBitMap |= (1<<(lport-1));
-						NeighborClearEnBitMap |= (1<<(lport-1));
-						LoopCount[lport-1] = 0;
-						LoopCountLinkStatus[lport-1] = 0;
-						ReqID = 1;
-					}
-					if(LoopCount[lport-1] >= LoopMaxCount)
-						LoopCount[lport-1] = 0;
-					/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-					if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					LoopCount[lport-1]++;
-					LoopCountLinkStatus[lport-1]++;
+					if((CurrLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+						hal_swif_neighbor_link_changed(lport, LINK_UP);
 					CurrLinkMap |= (1<<(lport-1));
 				} else {
 					CurrLinkMap &= ~(uint32)(1<<(lport-1));
-					gNeighborReqEnBitMap &= ~(1<<(lport-1));
-					if(NeighborClearEnBitMap & (1<<(lport-1))) {
-						hal_swif_neighbor_info_clear(lport);
-						NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-					}
+					hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 				}
 			}
 		}
 
+		/* Ports still probing or due a refresh */
+		hal_swif_neighbor_poll();
+
 		/* Process for Trap */
 		if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_PORT_STATUS)) {
 			if(CurrLinkMap ^ PrevLinkMap) {
@@ -1513,25 +1383,10 @@ void hal_swif_poll_task(void *arg)
 					}
 				}
 				if(CurrLinkMap > 0) {
-					gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] = HAL_TRUE;
-					gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]++;
-					LoopCnt = 0;
+					hal_swif_trap_port_post(PortStatus);
 				}
 			}
 
-			if(LoopCnt >= LoopMaxCount)
-				LoopCnt = 0;
-
-			if((gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) && (LoopCnt == 0)) {
-				memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
-				TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
-				TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
-				memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status), gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]);
-			}
-
-			LoopCnt++;
-
 			PrevLinkMap = CurrLinkMap;
 		}
 
@@ -1542,18 +1397,13 @@ void hal_swif_poll_task(void *arg)
 #elif BOARD_GE1040PU
 	uint8	lport, hport;
 	uint32	CurrLinkMap = 0, PrevLinkMap = 0, Link_DownUp_Map, Link_UpDown_Map;
-	uint32	NeighborClearEnBitMap=0;
 	uint16	ReqID = 0;
 	HAL_PORT_LINK_STATE CurrLinkStatus;
 	uint8	LoopCount[MAX_PORT_NUM] = {0};
-    uint8	LoopLinkStatusMax = 20000/LINK_STATUS_POLLING_DELAY; /* 20s */
-    uint8   LoopCountLinkStatus[MAX_PORT_NUM] = {0};
-	uint8	LoopCnt = 0;
 	uint8	LoopMaxCount = 1000/LINK_STATUS_POLLING_DELAY;
 	uint8	PortStatus[MAX_PORT_NUM] = {0};
 	HAL_PORT_DUPLEX_STATE Duplex;
 	HAL_PORT_SPEED_STATE Speed;
-	hal_trap_port_status TrapPortStatus;
 #if RURAL_CREDIT_PROJECT
 	extern u8 HonuKinStatus;
 	extern u8 HonuPortStatus[];
@@ -1579,39 +1429,15 @@ void hal_swif_poll_task(void *arg)
 			} else {
 #endif
 				if(hal_swif_port_get_link_state(lport, &CurrLinkStatus) == HAL_SWIF_SUCCESS) {
-                    
-                   // LoopCountLinkStatus[lport-1]++; 
-                    /* If timeout neighbor_req_send 20S */
-                    if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                        LoopCountLinkStatus[lport-1] = 0;
-                    }
+					CurrLinkStatus = hal_swif_port_link_dampen(lport, CurrLinkStatus);
                     
 					if(CurrLinkStatus == LINK_UP) {
-						if((CurrLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-							gNeighborReqEnBitMap |= (1<<(lport-1));
-							NeighborClearEnBitMap |= (1<<(lport-1));
-							LoopCount[lport-1] = 0;
-							LoopCountLinkStatus[lport-1] = 0;
-							ReqID = 1;
-						}
-						if(LoopCount[lport-1] >= LoopMaxCount)
-							LoopCount[lport-1] = 0;
-						/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-						if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						LoopCount[lport-1]++;
-						LoopCountLinkStatus[lport-1]++;
+						if((CurrLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+							hal_swif_neighbor_link_changed(lport, LINK_UP);
 						CurrLinkMap |= (1<<(lport-1));
 					} else {
 						CurrLinkMap &= ~(uint32)(1<<(lport-1));
-						gNeighborReqEnBitMap &= ~(1<<(lport-1));
-						if(NeighborClearEnBitMap & (1<<(lport-1))) {
-							hal_swif_neighbor_info_clear(lport);
-							NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-						}
+						hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 					}
 				}
 #if RURAL_CREDIT_PROJECT				
@@ -1619,6 +1445,9 @@ void hal_swif_poll_task(void *arg)
 #endif			
 		}
 
+		/* Ports still probing or due a refresh */
+		hal_swif_neighbor_poll();
+
 		/* Process for Trap */
 		if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_PORT_STATUS)) {
 			if(CurrLinkMap ^ PrevLinkMap) {
@@ -1657,32 +1486,10 @@ void hal_swif_poll_task(void *arg)
 				if(CurrLinkMap > 0) 
 #endif
 				{
-					gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] = HAL_TRUE;
-					gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]++;
-					LoopCnt = 0;
+					hal_swif_trap_port_post(PortStatus);
 				}
 			}					
 
-			if(LoopCnt >= LoopMaxCount)
-				LoopCnt = 0;
-			
-			if((gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) && (LoopCnt == 0)) {
-				memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
-				TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
-/*#if RURAL_CREDIT_PROJECT
-				if(HonuMasterFlag)
-					TrapPortStatus.PortNum = 26;
-				else
-					TrapPortStatus.PortNum = 24;
-#else*/
-				TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
-//#endif
-				memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status), gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]);
-			}
-
-			LoopCnt++;
-			
 			PrevLinkMap = CurrLinkMap;
 		}
 		
@@ -1694,59 +1501,29 @@ void hal_swif_poll_task(void *arg)
 #elif BOARD_GE204P0U
 	uint8	lport, hport;
 	uint32	CurrLinkMap = 0, PrevLinkMap = 0, Link_DownUp_Map, Link_UpDown_Map;
-	uint32	NeighborClearEnBitMap=0;
-	uint16	ReqID = 0;
 	HAL_PORT_LINK_STATE CurrLinkStatus;
-	uint8	LoopCount[MAX_PORT_NUM] = {0};
-    uint8	LoopLinkStatusMax = 20000/LINK_STATUS_POLLING_DELAY; /* 20s */
-    uint8   LoopCountLinkStatus[MAX_PORT_NUM] = {0};
-	uint8	LoopCnt = 0;
-	uint8	LoopMaxCount = 1000/LINK_STATUS_POLLING_DELAY;
 	uint8	PortStatus[MAX_PORT_NUM] = {0};
 	HAL_PORT_DUPLEX_STATE Duplex;
 	HAL_PORT_SPEED_STATE Speed;
-	hal_trap_port_status TrapPortStatus;
 	
 	while(1) {
 		for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
 			if(hal_swif_port_get_link_state(lport, &CurrLinkStatus) == HAL_SWIF_SUCCESS) {
-                
-             //   LoopCountLinkStatus[lport-1]++;
-                /* If timeout neighbor_req_send 20S */
-                if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                    LoopCountLinkStatus[lport-1] = 0;
-                }
-                
+				CurrLinkStatus = hal_swif_port_link_dampen(lport, CurrLinkStatus);
 				if(CurrLinkStatus == LINK_UP) {
-					if((CurrLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-						gNeighborReqEnBitMap |= (1<<(lport-1));
-						NeighborClearEnBitMap |= (1<<(lport-1));
-						LoopCount[lport-1] = 0;
-						LoopCountLinkStatus[lport-1] = 0;
-						ReqID = 1;
-					}
-					if(LoopCount[lport-1] >= LoopMaxCount)
-						LoopCount[lport-1] = 0;
-					/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-					if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					LoopCount[lport-1]++;
-					LoopCountLinkStatus[lport-1]++;
+					if((CurrLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+						hal_swif_neighbor_link_changed(lport, LINK_UP);
 					CurrLinkMap |= (1<<(lport-1));
 				} else {
 					CurrLinkMap &= ~(uint32)(1<<(lport-1));
-					gNeighborReqEnBitMap &= ~(1<<(lport-1));
-					if(NeighborClearEnBitMap & (1<<(lport-1))) {
-						hal_swif_neighbor_info_clear(lport);
-						NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-					}
+					hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 				}
 			}		
 		}
 
+		/* Ports still probing or due a refresh */
+		hal_swif_neighbor_poll();
+
 		/* Process for Trap */
 	//	if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_PORT_STATUS)) {
 		if(CurrLinkMap ^ PrevLinkMap) {
@@ -1769,22 +1546,9 @@ void hal_swif_poll_task(void *arg)
 			if(CurrLinkMap ^ PrevLinkMap) {
 				if(CurrLinkMap > 0) 
 				{
-					gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] = HAL_TRUE;
-					gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]++;
-					LoopCnt = 0;
+					hal_swif_trap_port_post(PortStatus);
 				}
 			}
-			if(LoopCnt >= LoopMaxCount)
-				LoopCnt = 0;
-			
-			if((gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) && (LoopCnt == 0)) {
-				memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
-				TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
-				TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
-				memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status), gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]);
-			}
-			LoopCnt++;					
 		}
 		PrevLinkMap = CurrLinkMap;
 		
@@ -1796,57 +1560,30 @@ void hal_swif_poll_task(void *arg)
 	uint16	u16Data, OpModeStatus;
 	uint32	SDStatusMap = 0;
 	uint32	CurrLinkMap = 0, PrevLinkMap = 0, Link_DownUp_Map, Link_UpDown_Map;
-	uint32	NeighborClearEnBitMap=0;
-	uint16	ReqID = 0;
 	HAL_PORT_LINK_STATE CurrLinkStatus;
-	uint8	LoopCount[MAX_PORT_NUM] = {0};
-    uint8	LoopLinkStatusMax = 20000/LINK_STATUS_POLLING_DELAY; /* 20s */
-    uint8   LoopCountLinkStatus[MAX_PORT_NUM] = {0};
-	uint8	LoopCnt = 0;
-	uint8	LoopMaxCount = 1000/LINK_STATUS_POLLING_DELAY;
 	uint8	PortStatus[MAX_PORT_NUM] = {0};
 	HAL_PORT_DUPLEX_STATE Duplex;
 	HAL_PORT_SPEED_STATE Speed;
-	hal_trap_port_status TrapPortStatus;
 
 	while(1) {
 		for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
 			if(hal_swif_port_get_link_state(lport, &CurrLinkStatus) == HAL_SWIF_SUCCESS) {
+				CurrLinkStatus = hal_swif_port_link_dampen(lport, CurrLinkStatus);
 				
-                /* If timeout neighbor_req_send 20S */
-                if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                    LoopCountLinkStatus[lport-1] = 0;
-                }
-                
 				if(CurrLinkStatus == LINK_UP) {
-					if((CurrLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-						gNeighborReqEnBitMap |= (1<<(lport-1));
-						NeighborClearEnBitMap |= (1<<(lport-1));
-						LoopCount[lport-1] = 0;
-						LoopCountLinkStatus[lport-1] = 0;
-						ReqID = 1;
-					}
-					if(LoopCount[lport-1] >= LoopMaxCount)
-						LoopCount[lport-1] = 0;
-					/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-					if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-					LoopCount[lport-1]++;
-					LoopCountLinkStatus[lport-1]++;
+					if((CurrLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+						hal_swif_neighbor_link_changed(lport, LINK_UP);
 					CurrLinkMap |= (1<<(lport-1));
 				} else {
 					CurrLinkMap &= ~(uint32)(1<<(lport-1));
-					gNeighborReqEnBitMap &= ~(1<<(lport-1));
-					if(NeighborClearEnBitMap & (1<<(lport-1))) {
-						hal_swif_neighbor_info_clear(lport);
-						NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-					}
+					hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 				}
 			}
 		}
+
+		/* Ports still probing or due a refresh */
+		hal_swif_neighbor_poll();
+
 		/* Process for Trap */
 		if(CurrLinkMap ^ PrevLinkMap) {
 			Link_DownUp_Map = CurrLinkMap & (CurrLinkMap ^ PrevLinkMap);
@@ -1868,23 +1605,9 @@ void hal_swif_poll_task(void *arg)
 		if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_PORT_STATUS)) {
             if(CurrLinkMap ^ PrevLinkMap) {
                 if(CurrLinkMap > 0) {
-                    gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] = HAL_TRUE;
-                    gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]++;
-                    LoopCnt = 0;
+                    hal_swif_trap_port_post(PortStatus);
                 }
             }
-
-			if(LoopCnt >= LoopMaxCount)
-				LoopCnt = 0;
-		
-			if((gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) && (LoopCnt == 0)) {
-				memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
-				TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
-				TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
-				memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status), gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]);
-			}           
-			LoopCnt++;
 		}
         PrevLinkMap = CurrLinkMap;
         
@@ -1901,14 +1624,10 @@ void hal_swif_poll_task(void *arg)
 	uint16	ReqID = 0;
 	HAL_PORT_LINK_STATE CurrLinkStatus;
 	uint8	LoopCount[MAX_PORT_NUM] = {0};
-    uint8	LoopLinkStatusMax = 20000/LINK_STATUS_POLLING_DELAY; /* 20s */
-    uint8   LoopCountLinkStatus[MAX_PORT_NUM] = {0};
-	uint8	LoopCnt = 0;
 	uint8	LoopMaxCount = 1000/LINK_STATUS_POLLING_DELAY;   //10
 	uint8	PortStatus[MAX_PORT_NUM] = {0};
 	HAL_PORT_DUPLEX_STATE Duplex;
 	HAL_PORT_SPEED_STATE Speed;
-	hal_trap_port_status TrapPortStatus;
 
     PortStatus[8] = 0x40; /* port9  SDIbit6 */
     PortStatus[9] = 0x40; /* port10 OPTbit6 */
@@ -1917,39 +1636,14 @@ void hal_swif_poll_task(void *arg)
 		for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
 			if(lport>=1 && lport<=8 ){
 				if(hal_swif_port_get_link_state(lport, &CurrLinkStatus) == HAL_SWIF_SUCCESS) {
-                    
-                 //   LoopCountLinkStatus[lport-1]++; 
-                    /* If timeout neighbor_req_send 20S */
-                    if(LoopCountLinkStatus[lport-1] >= LoopLinkStatusMax){
-                        LoopCountLinkStatus[lport-1] = 0;
-                    }
-                    
+					CurrLinkStatus = hal_swif_port_link_dampen(lport, CurrLinkStatus);
 					if(CurrLinkStatus == LINK_UP) {
-						if((CurrLinkMap & (1<<(lport-1))) == 0) {	/* Previous LinkStatus is down */
-							gNeighborReqEnBitMap |= (1<<(lport-1));
-							NeighborClearEnBitMap |= (1<<(lport-1));
-							LoopCount[lport-1] = 0;
-							LoopCountLinkStatus[lport-1] = 0;
-							ReqID = 1;
-						}
-						if(LoopCount[lport-1] >= LoopMaxCount)
-							LoopCount[lport-1] = 0;
-						/* If not received Neighbor_response,Neighbor_req_send per 1s,Else force Neighbor_req_send per 20s */
-						if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && (gNeighborReqEnBitMap & (1<<(lport-1))) && (LoopCount[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						else if((gPortConfigInfo[lport-1].NeigborSearch == HAL_TRUE) && ((gNeighborReqEnBitMap & (1<<(lport-1))) == 0) && (LoopCount[lport-1] == 0) \
-																		&& (LoopCountLinkStatus[lport-1] == 0))
-							hal_swif_neighbor_req_send(lport, ReqID++);
-						LoopCount[lport-1]++;
-						LoopCountLinkStatus[lport-1]++;
+						if((CurrLinkMap & (1<<(lport-1))) == 0)	/* Previous LinkStatus is down */
+							hal_swif_neighbor_link_changed(lport, LINK_UP);
 						CurrLinkMap |= (1<<(lport-1));
 					} else {
 						CurrLinkMap &= ~(uint32)(1<<(lport-1));
-						gNeighborReqEnBitMap &= ~(1<<(lport-1));
-						if(NeighborClearEnBitMap & (1<<(lport-1))) {
-							hal_swif_neighbor_info_clear(lport);
-							NeighborClearEnBitMap &= ~(uint32)(1<<(lport-1));
-						}
+						hal_swif_neighbor_link_changed(lport, LINK_DOWN);
 					}
 				}
 			}
@@ -2012,6 +1706,9 @@ void hal_swif_poll_task(void *arg)
 
 		}
 
+		/* Ports still probing or due a refresh */
+		hal_swif_neighbor_poll();
+
 		/* Process for Trap */
 		if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_PORT_STATUS)) {
 			if(CurrLinkMap ^ PrevLinkMap) {
@@ -2058,25 +1755,10 @@ void hal_swif_poll_task(void *arg)
 
 				}
 				if(CurrLinkMap > 0) {
-					gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] = HAL_TRUE;
-					gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]++;
-					LoopCnt = 0;
+					hal_swif_trap_port_post(PortStatus);
 				}
 			}
 
-			if(LoopCnt >= LoopMaxCount)
-				LoopCnt = 0;
-
-			if((gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) && (LoopCnt == 0)) {
-				memset(&TrapPortStatus, 0, sizeof(hal_trap_port_status));
-				TrapPortStatus.TrapIndex = TRAP_INDEX_PORT_STATUS;
-				TrapPortStatus.PortNum = DeviceBaseInfo.PortNum;
-				memcpy(&TrapPortStatus.PortStatus[0], PortStatus, DeviceBaseInfo.PortNum);
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapPortStatus, sizeof(hal_trap_port_status), gTrapInfo.RequestID[TRAP_INDEX_PORT_STATUS]);
-			}
-
-			LoopCnt++;
-
 			PrevLinkMap = CurrLinkMap;
 		}
 
@@ -2169,34 +1851,67 @@ void combo_led_control_task(void *arg)
 xSemaphoreHandle xSemTraffic = NULL;
 hal_port_traffic_info_t	gPortTrafficInfo[MAX_PORT_NUM];
 
+#if BOARD_GE204P0U
+/**************************************************************************
+  * @brief  check that the active medium of a combo port is the one reported
+  * @param  lport
+  * @retval 1 if the port may raise a traffic trap
+  *************************************************************************/
+static uint8 hal_swif_traffic_medium_check(uint8 lport)
+{
+	uint8	hport;
+	uint16	u16PhyRegVal;
+
+	if(lport < 25)
+		return 1;			/* lport 1-24 */
+
+	hport = hal_swif_lport_2_hport(lport);
+	u16PhyRegVal = 0x7C00;
+	robo_write(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2); 	        
+	robo_read(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2);
+	if(lport <= 28) {
+		/* Fiber select */
+		if((u16PhyRegVal & 0x0040) && ((u16PhyRegVal & 0x0002) == 0x2))
+			return 1;
+	} else {
+		/* Copper select */
+		if((u16PhyRegVal & 0x0080) && ((u16PhyRegVal & 0x0002) == 0x0))
+			return 1;
+	}
+
+	return 0;
+}
+#endif
+
 void hal_swif_traffic_task(void *arg)
 {
 	uint8 lport;
-	uint8 FirstTrafficFlag[MAX_PORT_NUM] = {0};
 	hal_port_counters_t counter;
 	uint16 valid_bit_mask, traffic_status;
 	hal_trap_traffic_status TrapTrafficStatus;
-	uint8 	TrapFlag = 0;
-	uint8	hport;
-	uint16	u16PhyRegVal;
+	hal_port_traffic_info_t *pInfo;
+	uint8 	TrapFlag, TrapNew, was_over, storm_changed;
+	uint8	TrapAge = 0;
+	uint32	tick, tx_rate, rx_rate;
 	
     /* initializes counters clear flag mutex. */
     cnt_clr_mutex_init();
     
+	memset(gPortTrafficInfo, 0, sizeof(gPortTrafficInfo));
 	for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
-		gPortTrafficInfo[lport-1].PortNo = lport;
-		gPortTrafficInfo[lport-1].Interval = HAL_DEFAULT_TRAFFIC_INTERVAL;
+		pInfo = &gPortTrafficInfo[lport-1];
+		pInfo->PortNo = lport;
+		pInfo->Interval = HAL_TRAFFIC_SAMPLE_INTERVAL;
 		if((gPortConfigInfo[lport-1].PortType == S1000M_CABLE) || (gPortConfigInfo[lport-1].PortType == S1000M_OPTICAL)) {
-			gPortTrafficInfo[lport-1].Threshold_TxOctets = 12500000 * (gPortConfigInfo[lport-1].TxThreshold + 1) * HAL_DEFAULT_TRAFFIC_INTERVAL;
-			gPortTrafficInfo[lport-1].Threshold_RxOctets = 12500000 * (gPortConfigInfo[lport-1].RxThreshold + 1) * HAL_DEFAULT_TRAFFIC_INTERVAL;
+			pInfo->Threshold_TxOctets = 12500000 * (gPortConfigInfo[lport-1].TxThreshold + 1);
+			pInfo->Threshold_RxOctets = 12500000 * (gPortConfigInfo[lport-1].RxThreshold + 1);
 		} else {
-			gPortTrafficInfo[lport-1].Threshold_TxOctets = 1250000 * (gPortConfigInfo[lport-1].TxThreshold + 1) * HAL_DEFAULT_TRAFFIC_INTERVAL;
-			gPortTrafficInfo[lport-1].Threshold_RxOctets = 1250000 * (gPortConfigInfo[lport-1].RxThreshold + 1) * HAL_DEFAULT_TRAFFIC_INTERVAL;
+			pInfo->Threshold_TxOctets = 1250000 * (gPortConfigInfo[lport-1].TxThreshold + 1);
+			pInfo->Threshold_RxOctets = 1250000 * (gPortConfigInfo[lport-1].RxThreshold + 1);
 		}
-		gPortTrafficInfo[lport-1].PrevTxOctets = 0;
-		gPortTrafficInfo[lport-1].PrevRxOctets = 0;
-		gPortTrafficInfo[lport-1].Interval_TxOctets = 0;
-		gPortTrafficInfo[lport-1].Interval_RxOctets = 0;
+		pInfo->StormState = STORM_IDLE;
+		pInfo->StormHoldTime = HAL_STORM_HOLD_MIN;
+		pInfo->StormQuiet = HAL_STORM_HOLD_MAX;
 	}
 
 	for(;;) {
@@ -2205,128 +1920,73 @@ void hal_swif_traffic_task(void *arg)
 			TrapTrafficStatus.TrapIndex = TRAP_INDEX_TRAFFIC_OVER;
 			TrapTrafficStatus.PortNum = DeviceBaseInfo.PortNum;
 			TrapFlag = 0;
+			TrapNew = 0;
+			if(TrapAge < HAL_DEFAULT_TRAFFIC_INTERVAL)
+				TrapAge++;
 			
 			for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
+				pInfo = &gPortTrafficInfo[lport-1];
                 if(hal_swif_port_get_clear_counters_flag(lport) == 1){
-                    gPortTrafficInfo[lport-1].PrevTxOctets = 0;
-					gPortTrafficInfo[lport-1].PrevRxOctets = 0;
-					gPortTrafficInfo[lport-1].Interval_TxOctets = 0;
-					gPortTrafficInfo[lport-1].Interval_RxOctets = 0;
-					FirstTrafficFlag[lport-1] = 0;
+					pInfo->SampleState = 0;
+					memset(pInfo->Total, 0, sizeof(pInfo->Total));
                     continue;
                 }
-                    
-				if((gPortConfigInfo[lport-1].TxThreshold < PERCENTAGE_100) || (gPortConfigInfo[lport-1].RxThreshold < PERCENTAGE_100)) {
-					if(hal_swif_port_get_counters(lport, &counter, &valid_bit_mask) == HAL_SWIF_SUCCESS) {
-						if(FirstTrafficFlag[lport-1] == 0) {
-							gPortTrafficInfo[lport-1].PrevTxOctets = counter.TxOctetsLo;
-							gPortTrafficInfo[lport-1].PrevRxOctets = counter.RxGoodOctetsLo;
-							gPortTrafficInfo[lport-1].Interval_TxOctets = 0;
-							gPortTrafficInfo[lport-1].Interval_RxOctets = 0;
-							FirstTrafficFlag[lport-1] = 1;
-							continue;
-						}
 
-						traffic_status = 0;
-						if(gPortConfigInfo[lport-1].TxThreshold < PERCENTAGE_100) {
-							if(counter.TxOctetsLo < gPortTrafficInfo[lport-1].PrevTxOctets) {
-								gPortTrafficInfo[lport-1].Interval_TxOctets = (0xFFFFFFFF - gPortTrafficInfo[lport-1].PrevTxOctets + 1 + counter.TxOctetsLo);
-							} else {
-								gPortTrafficInfo[lport-1].Interval_TxOctets = (counter.TxOctetsLo - gPortTrafficInfo[lport-1].PrevTxOctets);
-							}
-
-							if(gPortTrafficInfo[lport-1].Interval_TxOctets >= gPortTrafficInfo[lport-1].Threshold_TxOctets) {
-#if BOARD_GE204P0U				
-								hport = hal_swif_lport_2_hport(lport);
-								if((lport >= 25) && (lport <= 28)){
-									u16PhyRegVal = 0x7C00;
-									robo_write(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2); 	        
-									robo_read(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2);
-									/* Fiber select */
-									if((u16PhyRegVal & 0x0040) && ((u16PhyRegVal & 0x0002) == 0x2)) {
-										TrapFlag = 1;            /* traffick trap send */
-									}else{
-										TrapFlag = 0;
-									}
-								}else if(lport >= 29){
-									u16PhyRegVal = 0x7C00;
-									robo_write(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2); 	        
-									robo_read(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2);
-									/* Copper select */
-									if((u16PhyRegVal & 0x0080) && ((u16PhyRegVal & 0x0002) == 0x0)) {
-										TrapFlag = 1;			 /* traffick trap send */
-									}else{
-										TrapFlag = 0;
-									}
-								}else{
-									TrapFlag = 1;                 /* lport 1-24 */
-								}																
-								traffic_status |= (0x8000 | ((uint16)(gPortConfigInfo[lport-1].TxThreshold) << 4));
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)] = (uint8)((traffic_status & 0xFF00) >> 8); 
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)+1] = (uint8)(traffic_status & 0x00FF); 								
-#else
-								traffic_status |= (0x8000 | ((uint16)(gPortConfigInfo[lport-1].TxThreshold) << 4));
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)] = (uint8)((traffic_status & 0xFF00) >> 8); 
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)+1] = (uint8)(traffic_status & 0x00FF); 
-								TrapFlag = 1;
+				if(hal_swif_port_get_counters(lport, &counter, &valid_bit_mask) != HAL_SWIF_SUCCESS)
+					continue;
+
+				tick = TimerGetMsTick();
+				hal_swif_traffic_update(pInfo, &counter, tick - pInfo->PrevTick);
+				pInfo->PrevTick = tick;
+				if(pInfo->SampleState < 2)
+					continue;
+
+				traffic_status = 0;
+				storm_changed = 0;
+#if HAL_STORM_CTRL_ENABLE
+				/* Storm limit applied or released is reported at once */
+				storm_changed = hal_swif_storm_check(lport, pInfo);
+				TrapNew |= storm_changed;
+				if(pInfo->StormState == STORM_LIMITED)
+					traffic_status |= HAL_TRAFFIC_STATUS_STORM;
 #endif
-							}
-						}
 
-						if(gPortConfigInfo[lport-1].RxThreshold < PERCENTAGE_100) {
-							if(counter.RxGoodOctetsLo < gPortTrafficInfo[lport-1].PrevRxOctets) {
-								gPortTrafficInfo[lport-1].Interval_RxOctets = (0xFFFFFFFF - gPortTrafficInfo[lport-1].PrevRxOctets + 1 + counter.RxGoodOctetsLo);
-							} else {
-								gPortTrafficInfo[lport-1].Interval_RxOctets = (counter.RxGoodOctetsLo - gPortTrafficInfo[lport-1].PrevRxOctets);
-							}
-
-							if(gPortTrafficInfo[lport-1].Interval_RxOctets >= gPortTrafficInfo[lport-1].Threshold_RxOctets) {
-#if BOARD_GE204P0U				
-								hport = hal_swif_lport_2_hport(lport);
-								if((lport >= 25) && (lport <= 28)){
-									u16PhyRegVal = 0x7C00;
-									robo_write(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2); 	        
-									robo_read(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2);
-									/* Fiber select */
-									if((u16PhyRegVal & 0x0040) && ((u16PhyRegVal & 0x0002) == 0x2)) {
-										TrapFlag = 1;            /* traffick trap send */
-									}else{
-										TrapFlag = 0;
-									}
-								}else if(lport >= 29){
-									u16PhyRegVal = 0x7C00;
-									robo_write(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2); 	        
-									robo_read(0xD9+(hport-25), 0x38, (u8 *)&u16PhyRegVal, 2);
-									/* Copper select */
-									if((u16PhyRegVal & 0x0080) && ((u16PhyRegVal & 0x0002) == 0x0)) {
-										TrapFlag = 1;			 /* traffick trap send */
-									}else{
-										TrapFlag = 0;
-									}
-								}else{
-									TrapFlag = 1;                 /* lport 1-24 */
-								}																
-								traffic_status |= (0x4000 | (uint16)(gPortConfigInfo[lport-1].RxThreshold));
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)] = (uint8)((traffic_status & 0xFF00) >> 8); 
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)+1] = (uint8)(traffic_status & 0x00FF); 								
-#else								
-								traffic_status |= (0x4000 | (uint16)(gPortConfigInfo[lport-1].RxThreshold));
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)] = (uint8)((traffic_status & 0xFF00) >> 8); 
-								TrapTrafficStatus.TrafficStatus[2*(lport-1)+1] = (uint8)(traffic_status & 0x00FF); 
-								TrapFlag = 1;
-#endif
-							}
-						}
-						
-						gPortTrafficInfo[lport-1].PrevTxOctets = counter.TxOctetsLo;
-						gPortTrafficInfo[lport-1].PrevRxOctets = counter.RxGoodOctetsLo;
+				if((gTrapInfo.GateMask & TRAP_MASK_TRAFFIC_OVER) == 0)
+					continue;
+
+				/* The medium window keeps short bursts from raising the trap */
+				tx_rate = pInfo->Rate[TRAFFIC_TX_OCTETS][TRAFFIC_WIN_MEDIUM] >> HAL_TRAFFIC_RATE_SHIFT;
+				rx_rate = pInfo->Rate[TRAFFIC_RX_OCTETS][TRAFFIC_WIN_MEDIUM] >> HAL_TRAFFIC_RATE_SHIFT;
+				if(gPortConfigInfo[lport-1].TxThreshold < PERCENTAGE_100) {
+					was_over = pInfo->TxOver;
+					if(hal_swif_traffic_over(&pInfo->TxOver, tx_rate, pInfo->Threshold_TxOctets)) {
+						TrapNew |= (was_over == 0);
+						traffic_status |= (0x8000 | ((uint16)(gPortConfigInfo[lport-1].TxThreshold) << 4));
 					}
 				}
+				if(gPortConfigInfo[lport-1].RxThreshold < PERCENTAGE_100) {
+					was_over = pInfo->RxOver;
+					if(hal_swif_traffic_over(&pInfo->RxOver, rx_rate, pInfo->Threshold_RxOctets)) {
+						TrapNew |= (was_over == 0);
+						traffic_status |= (0x4000 | (uint16)(gPortConfigInfo[lport-1].RxThreshold));
+					}
+				}
+
+				if(traffic_status || storm_changed) {
+					TrapTrafficStatus.TrafficStatus[2*(lport-1)] = (uint8)((traffic_status & 0xFF00) >> 8); 
+					TrapTrafficStatus.TrafficStatus[2*(lport-1)+1] = (uint8)(traffic_status & 0x00FF); 
+#if BOARD_GE204P0U
+					TrapFlag |= hal_swif_traffic_medium_check(lport);
+#else
+					TrapFlag = 1;
+#endif
+				}
 			}
 
-			if(TrapFlag) {
-				gTrapInfo.RequestID[TRAP_INDEX_TRAFFIC_OVER]++;
-				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapTrafficStatus, sizeof(hal_trap_traffic_status), gTrapInfo.RequestID[TRAP_INDEX_TRAFFIC_OVER]);
+			/* Post on a new over or storm change, then every HAL_DEFAULT_TRAFFIC_INTERVAL while it lasts */
+			if(TrapFlag && (TrapNew || (TrapAge >= HAL_DEFAULT_TRAFFIC_INTERVAL))) {
+				hal_swif_trap_post((uint8 *)&TrapTrafficStatus, sizeof(hal_trap_traffic_status));
+				TrapAge = 0;
 			}
 		}
 	}
@@ -2334,7 +1994,7 @@ void hal_swif_traffic_task(void *arg)
 
 void hal_swif_traffic_entry(void)
 {
-	if(gTrapInfo.GateMask & TRAP_MASK_TRAFFIC_OVER) {
+	if((gTrapInfo.GateMask & TRAP_MASK_TRAFFIC_OVER) || HAL_STORM_CTRL_ENABLE) {
 		if(xSemTraffic == NULL)
 			vSemaphoreCreateBinary(xSemTraffic);
 
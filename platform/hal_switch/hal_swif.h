@@ -26,6 +26,8 @@ void hal_swif_poll_task(void *arg);
 void combo_led_control_task(void *arg);
 #endif
 void hal_swif_traffic_entry(void);
+void hal_swif_trap_entry(void);
+void hal_swif_aggr_entry(void);
 
 #endif	/* _HAL_SWIF_H_ */
 
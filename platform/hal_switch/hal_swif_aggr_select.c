@@ -0,0 +1,80 @@
+/*******************************************************************
+ * Filename     : hal_swif_aggr_select.c
+ * Description  : Trunk hash bucket selection for the 88E6095, the
+ *                select table and the trunk mask of one bucket
+ * Copyright    : OB Telecom Electronics Co.
+ *******************************************************************/
+#include "mconfig.h"
+
+/* BSP includes */
+#include "stm32f2xx.h"
+
+/* HAL for L2 includes */
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_port.h"
+#include "hal_swif_aggregation.h"
+
+#if SWITCH_CHIP_88E6095
+/**************************************************************************
+  * @brief  precompute the hash bucket selection for every member subset
+  * @param  pSelect: AGGR_SELECT_TABLE_SIZE words, one nibble per bucket
+  * @retval none
+  * @note   With n configured members bucket k belongs to member k % n.
+  *         A bucket whose member is down is dealt round robin to the
+  *         live members, so flows on surviving members never move.
+  *************************************************************************/
+void hal_swif_aggr_build_select(u32 *pSelect)
+{
+	u8	order[MAX_AGGREGATION_GROUP_PORT_NUM];
+	u8	n, k, sel, alive, spill;
+	u16	live;
+	u32	entry;
+
+	for(n=1; n<=MAX_AGGREGATION_GROUP_PORT_NUM; n++) {
+		for(live=0; live<(1<<n); live++) {
+			alive = 0;
+			for(k=0; k<n; k++) {
+				if(live & (1<<k))
+					order[alive++] = k;
+			}
+
+			entry = 0;
+			spill = 0;
+			for(k=0; k<AGGR_HASH_BUCKETS; k++) {
+				sel = k % n;
+				if(alive == 0)
+					sel = AGGR_SELECT_NONE;
+				else if((live & (1<<sel)) == 0)
+					sel = order[spill++ % alive];
+				entry |= (u32)sel << (k * 4);
+			}
+			pSelect[AGGR_SELECT_BASE(n) + live] = entry;
+		}
+	}
+}
+
+/**************************************************************************
+  * @brief  trunk mask of one hash bucket for the current live member sets
+  * @param  pSelect: table from hal_swif_aggr_build_select, pInfo,
+  *         base: ports outside any trunk, bucket
+  * @retval mask with one live member of every trunk that has one
+  *************************************************************************/
+u32 hal_swif_aggr_bucket_mask(const u32 *pSelect, const aggr_info_t *pInfo, u32 base, u8 bucket)
+{
+	const aggr_rec *pRec;
+	u32 mask = base, select;
+	u8 sel;
+	int i;
+
+	for(i=0; i<pInfo->AggrCount; i++) {
+		pRec = &pInfo->AggrGroupRec[i];
+		select = pSelect[AGGR_SELECT_BASE(pRec->PortNumber) + pRec->LiveMask];
+		sel = (u8)((select >> (bucket * 4)) & 0x0F);
+		if(sel != AGGR_SELECT_NONE)
+			mask |= 1 << pRec->HwPort[sel];
+	}
+
+	return mask;
+}
+#endif
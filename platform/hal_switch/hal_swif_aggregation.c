@@ -11,6 +11,12 @@
 /* Standard includes */
 #include <stdio.h>
 
+/* Kernel includes */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+#include "os_mutex.h"
+
 /* LwIP includes */
 #include "lwip/netif.h"
 #include "lwip/stats.h"
@@ -41,6 +47,7 @@
 #include "hal_swif_error.h"
 #include "hal_swif_types.h"
 #include "hal_swif_comm.h"
+#include "hal_swif.h"
 #include "hal_swif_port.h"
 #include "hal_swif_aggregation.h"
 
@@ -53,6 +60,30 @@ extern GT_QD_DEV *dev;
 
 aggr_info_t PortAggrInfo;
 
+/* Upper bound of each failover latency bucket, us */
+static const u32 AggrLatencyLimit[AGGR_LATENCY_BUCKETS] = {
+	50, 100, 250, 500, 1000, 2000, 5000, 0xFFFFFFFF
+};
+
+#if SWITCH_CHIP_88E6095
+/* Cortex-M3 cycle counter, started by the run time stats timer */
+#define AGGR_DWT_CYCCNT			(*((volatile unsigned long *)0xE0001004))
+
+static OS_MUTEX_T AggrMutex;
+
+/* Hash bucket -> member index, one nibble per bucket, for every live subset */
+static u32 AggrHashSelect[AGGR_SELECT_TABLE_SIZE];
+static u32 AggrMaskShadow[AGGR_HASH_BUCKETS];
+static u32 AggrBaseMask;
+
+#if AGGR_LINK_IRQ_ENABLE
+static u32 AggrPhyIntVec;
+static xSemaphoreHandle AggrLinkSemaphore = NULL;
+static volatile u8 AggrIrqPending = 0;
+static volatile u32 AggrIrqStamp;
+#endif
+#endif
+
 /**************************************************************************
   * @brief  find aggregation group
   * @param  lport
@@ -60,9 +91,9 @@ aggr_info_t PortAggrInfo;
   *************************************************************************/
 u8 hal_swif_aggr_find_group(u8 lport)
 {
-	u8 aggr_group, i;
+	u8 i;
 
-	for(i=0; i<=PortAggrInfo.AggrCount; i++) {
+	for(i=0; i<PortAggrInfo.AggrCount; i++) {
 		if((PortAggrInfo.AggrGroupRec[i].PortMask & (1<<(lport-1))) != 0)
 			return PortAggrInfo.AggrGroupRec[i].AggrId;
 	}
@@ -71,77 +102,160 @@ u8 hal_swif_aggr_find_group(u8 lport)
 }
 
 /**************************************************************************
-  * @brief  port aggregation add members
-  * @param  aggr_id, lport
+  * @brief  account one member set change in the trunk statistics
+  * @param  pRec, from_irq, latency in us
   * @retval none
   *************************************************************************/
-int hal_swif_aggr_add_member(u8 aggr_id, u8 lport)
+static void hal_swif_aggr_account(aggr_rec *pRec, u8 from_irq, u32 latency)
 {
-#if SWITCH_CHIP_88E6095
-	GT_STATUS status;
-	GT_U32 trunk_mask, mask;
-	u8	aggr_port_array[MAX_AGGREGATION_GROUP_PORT_NUM];
-	GT_U32 hwport_vec;
-	u8 hport;
-	int j, k, index, aggr_port_num, aggr_reg_idx;
+	int i;
 
-	if((PortAggrInfo.AggrCount == 0) || (PortAggrInfo.AggrCount > MAX_AGGREGATION_RECORD_COUNT))
-		return HAL_SWIF_FAILURE;
-	
-	hport = hal_swif_lport_2_hport(lport);
-	for(aggr_reg_idx=0; aggr_reg_idx<PortAggrInfo.AggrCount; aggr_reg_idx++) {
-		if(PortAggrInfo.AggrGroupRec[aggr_reg_idx].AggrId == aggr_id)
+	pRec->FailoverCount++;
+	if(!from_irq) {
+		pRec->PollCount++;
+		return;
+	}
+
+	for(i=0; i<AGGR_LATENCY_BUCKETS-1; i++) {
+		if(latency <= AggrLatencyLimit[i])
 			break;
 	}
-	if(aggr_reg_idx == PortAggrInfo.AggrCount)
-		return HAL_SWIF_FAILURE;
-	/* Get Trunk Route Table for the given Trunk ID */
-	if((status = gsysGetTrunkRouting(dev, aggr_id, (GT_U32 *)&hwport_vec)) != GT_OK) {
-		return CONF_ERR_MSAPI;
+	pRec->LatencyHist[i]++;
+	if(latency > pRec->LatencyMax)
+		pRec->LatencyMax = latency;
+}
+
+#if SWITCH_CHIP_88E6095
+/**************************************************************************
+  * @brief  write the trunk mask entries that differ from the live member sets
+  * @param  none
+  * @retval HAL_SWIF_SUCCESS or CONF_ERR_MSAPI
+  *************************************************************************/
+static int hal_swif_aggr_mask_update(void)
+{
+	u32 mask;
+	int k;
+
+	for(k=0; k<AGGR_HASH_BUCKETS; k++) {
+		mask = hal_swif_aggr_bucket_mask(AggrHashSelect, &PortAggrInfo, AggrBaseMask, k);
+		if(mask == AggrMaskShadow[k])
+			continue;
+		if(gsysSetTrunkMaskTable(dev, k, mask) != GT_OK)
+			return CONF_ERR_MSAPI;
+		AggrMaskShadow[k] = mask;
 	}
 
-	hwport_vec |= (1 << hport);
+	return HAL_SWIF_SUCCESS;
+}
 
-	/* Enable trunk on the given port */
-	if((status = gprtSetTrunkPort(dev, hport, GT_TRUE, aggr_id)) != GT_OK) {
-		return CONF_ERR_MSAPI;
+/**************************************************************************
+  * @brief  move a trunk to a new live member set, AggrMutex held
+  * @param  pRec, live, from_irq, stamp
+  * @retval HAL_SWIF_SUCCESS or CONF_ERR_MSAPI
+  *************************************************************************/
+static int hal_swif_aggr_failover(aggr_rec *pRec, u8 live, u8 from_irq, u32 stamp)
+{
+	u8 changed, member;
+	u32 latency;
+	int ret;
+
+	if((changed = pRec->LiveMask ^ live) == 0)
+		return HAL_SWIF_SUCCESS;
+
+	pRec->LiveMask = live;
+	if((ret = hal_swif_aggr_mask_update()) != HAL_SWIF_SUCCESS)
+		return ret;
+
+	latency = from_irq ? (AGGR_DWT_CYCCNT - stamp) / (configCPU_CLOCK_HZ / 1000000) : 0;
+	hal_swif_aggr_account(pRec, from_irq, latency);
+
+	/* Traffic has moved, bring the member STP state in line */
+	for(member=0; member<pRec->PortNumber; member++) {
+		if(changed & (1<<member))
+			hal_swif_port_set_stp_state(hal_swif_hport_2_lport(pRec->HwPort[member]), (live & (1<<member)) ? FORWARDING : BLOCKING);
 	}
 
-	
-	/* Set Trunk Route Table for the given Trunk ID */
-	if((status = gsysSetTrunkRouting(dev, aggr_id, hwport_vec)) != GT_OK) {
-		return CONF_ERR_MSAPI;
+	return HAL_SWIF_SUCCESS;
+}
+
+#if AGGR_LINK_IRQ_ENABLE
+/**************************************************************************
+  * @brief  switch INTn handler, called from EXTI9_5_IRQHandler
+  * @param  pxHigherPriorityTaskWoken
+  * @retval none
+  *************************************************************************/
+void hal_swif_aggr_link_isr(portBASE_TYPE *pxHigherPriorityTaskWoken)
+{
+	/* Keep the earliest edge until the task has run */
+	if(!AggrIrqPending) {
+		AggrIrqStamp = AGGR_DWT_CYCCNT;
+		AggrIrqPending = 1;
 	}
 
-	memset(aggr_port_array, 0, MAX_AGGREGATION_GROUP_PORT_NUM);
-	index = 0;
-	for(j=0; j<dev->numOfPorts; j++) {
-		if(hwport_vec & (1<<j)) {
-			aggr_port_array[index] = j;
-			index++;
-			if(index == MAX_AGGREGATION_GROUP_PORT_NUM)
-				break;					
+	if(AggrLinkSemaphore != NULL)
+		xSemaphoreGiveFromISR(AggrLinkSemaphore, pxHigherPriorityTaskWoken);
+}
+
+/**************************************************************************
+  * @brief  trunk member failover task, woken by the switch INTn
+  * @param  arg
+  * @retval none
+  *************************************************************************/
+static void hal_swif_aggr_failover_task(void *arg)
+{
+	aggr_rec *pRec;
+	GT_BOOL link;
+	GT_STATUS status;
+	GT_U16 summary, cause;
+	u8 irq, live, member, hport;
+	u32 stamp;
+	int i;
+
+	while(1) {
+		/* The timeout covers members without an internal PHY interrupt */
+		xSemaphoreTake(AggrLinkSemaphore, LINK_STATUS_POLLING_DELAY);
+
+		portENTER_CRITICAL();
+		irq = AggrIrqPending;
+		stamp = AggrIrqStamp;
+		AggrIrqPending = 0;
+		portEXIT_CRITICAL();
+
+		os_mutex_lock(&AggrMutex, OS_MUTEX_WAIT_FOREVER);
+		for(i=0; i<PortAggrInfo.AggrCount; i++) {
+			pRec = &PortAggrInfo.AggrGroupRec[i];
+			live = 0;
+			for(member=0; member<pRec->PortNumber; member++) {
+				status = gprtGetLinkState(dev, pRec->HwPort[member], &link);
+				if(status != GT_OK)
+					live |= pRec->LiveMask & (1<<member);
+				else if((link == GT_TRUE) && (hal_swif_port_link_suppressed(hal_swif_hport_2_lport(pRec->HwPort[member])) == 0))
+					live |= 1<<member;
+			}
+			hal_swif_aggr_failover(pRec, live, irq, stamp);
 		}
-	}
+		os_mutex_unlock(&AggrMutex);
 
-	aggr_port_num = index;
-	
-	/* Set Trunk Mask Table for load balancing. */
-	trunk_mask = 0x7FF;
-	trunk_mask &= ~hwport_vec;
-	for(k=0; k<8; k++) {
-		index = k % aggr_port_num;
-		mask = trunk_mask | (1 << aggr_port_array[index]);
-		if((status = gsysSetTrunkMaskTable(dev, k, mask)) != GT_OK) {
-			return CONF_ERR_MSAPI;
+		/* Acknowledge the member PHY interrupts so INTn is released */
+		if(irq && (gprtGetPhyIntPortSummary(dev, &summary) == GT_OK)) {
+			for(hport=0; hport<8; hport++) {
+				if(summary & AggrPhyIntVec & (1<<hport))
+					gprtGetPhyIntStatus(dev, hport, &cause);
+			}
 		}
 	}
+}
+#endif /* AGGR_LINK_IRQ_ENABLE */
+#endif
 
-	hal_swif_port_set_stp_state(lport, FORWARDING);
-	
-	return HAL_SWIF_SUCCESS;
-
-#elif SWITCH_CHIP_BCM53286
+/**************************************************************************
+  * @brief  port aggregation add members
+  * @param  aggr_id, lport
+  * @retval none
+  *************************************************************************/
+int hal_swif_aggr_add_member(u8 aggr_id, u8 lport)
+{
+#if SWITCH_CHIP_BCM53286
 	//GT_STATUS status;
 	u32 trunk_mask, mask;
 	u8	aggr_port_array[MAX_AGGREGATION_GROUP_PORT_NUM];
@@ -191,70 +305,7 @@ int hal_swif_aggr_add_member(u8 aggr_id, u8 lport)
   *************************************************************************/
 int hal_swif_aggr_del_member(u8 aggr_id, u8 lport)
 {
-#if SWITCH_CHIP_88E6095
-	GT_STATUS status;
-	GT_U32 trunk_mask, mask;
-	u8	aggr_port_array[MAX_AGGREGATION_GROUP_PORT_NUM];
-	GT_U32 hwport_vec;
-	u8 hport;
-	int j, k, index, aggr_port_num, aggr_reg_idx;
-
-	if((PortAggrInfo.AggrCount == 0) || (PortAggrInfo.AggrCount > MAX_AGGREGATION_RECORD_COUNT))
-		return HAL_SWIF_FAILURE;
-	
-	hport = hal_swif_lport_2_hport(lport);
-	for(aggr_reg_idx=0; aggr_reg_idx<PortAggrInfo.AggrCount; aggr_reg_idx++) {
-		if(PortAggrInfo.AggrGroupRec[aggr_reg_idx].AggrId == aggr_id)
-			break;
-	}
-	if(aggr_reg_idx == PortAggrInfo.AggrCount)
-		return HAL_SWIF_FAILURE;
-	
-	/* Get Trunk Route Table for the given Trunk ID */
-	if((status = gsysGetTrunkRouting(dev, aggr_id, (GT_U32 *)&hwport_vec)) != GT_OK) {
-		return CONF_ERR_MSAPI;
-	}
-
-	hwport_vec &= ~(1 << hport);	
-	
-	/* Disable trunk on the given port */
-	if((status = gprtSetTrunkPort(dev, hport, GT_FALSE, aggr_id)) != GT_OK) {
-		return CONF_ERR_MSAPI;
-	}
-	
-	/* Set Trunk Route Table for the given Trunk ID */
-	if((status = gsysSetTrunkRouting(dev, aggr_id, hwport_vec)) != GT_OK) {
-		return CONF_ERR_MSAPI;
-	}
-
-	aggr_port_num = PortAggrInfo.AggrGroupRec[aggr_reg_idx].PortNumber - 1;
-	memset(aggr_port_array, 0, MAX_AGGREGATION_GROUP_PORT_NUM);
-	index = 0;
-	for(j=0; j<dev->numOfPorts; j++) {
-		if(hwport_vec & (1<<j)) {
-			aggr_port_array[index] = j;
-			index++;
-			if(index == MAX_AGGREGATION_GROUP_PORT_NUM)
-				break;					
-		}
-	}
-
-	/* Set Trunk Mask Table for load balancing. */
-	trunk_mask = 0x7FF;
-	trunk_mask &= ~hwport_vec;
-	for(k=0; k<8; k++) {
-		index = k % aggr_port_num;
-		mask = trunk_mask | (1 << aggr_port_array[index]);
-		if((status = gsysSetTrunkMaskTable(dev, k, mask)) != GT_OK) {
-			return CONF_ERR_MSAPI;
-		}
-	}
-
-	hal_swif_port_set_stp_state(lport, BLOCKING);
-
-	return HAL_SWIF_SUCCESS;
-
-#elif SWITCH_CHIP_BCM53286
+#if SWITCH_CHIP_BCM53286
 	u32 trunk_mask, mask;
 	u8	aggr_port_array[MAX_AGGREGATION_GROUP_PORT_NUM];
 	u32 hwport_vec;
@@ -298,7 +349,41 @@ int hal_swif_aggr_del_member(u8 aggr_id, u8 lport)
   *************************************************************************/
 int hal_swif_aggr_link_changed(u8 lport, HAL_PORT_LINK_STATE new_state)
 {
-	u8 aggr_id,flag;
+#if SWITCH_CHIP_88E6095
+	aggr_rec *pRec;
+	u8 i, hport, member, live;
+	int ret;
+
+	for(i=0; i<PortAggrInfo.AggrCount; i++) {
+		if((PortAggrInfo.AggrGroupRec[i].PortMask & (1<<(lport-1))) != 0)
+			break;
+	}
+	if(i == PortAggrInfo.AggrCount)
+		return HAL_SWIF_FAILURE;
+
+	pRec = &PortAggrInfo.AggrGroupRec[i];
+	hport = hal_swif_lport_2_hport(lport);
+	for(member=0; member<pRec->PortNumber; member++) {
+		if(pRec->HwPort[member] == hport)
+			break;
+	}
+	if(member == pRec->PortNumber)
+		return HAL_SWIF_FAILURE;
+
+	os_mutex_lock(&AggrMutex, OS_MUTEX_WAIT_FOREVER);
+	live = pRec->LiveMask;
+	if(new_state == LINK_DOWN)
+		live &= ~(1<<member);
+	else
+		live |= (1<<member);
+	ret = hal_swif_aggr_failover(pRec, live, 0, 0);
+	os_mutex_unlock(&AggrMutex);
+
+	return ret;
+
+#else
+	aggr_rec *pRec;
+	u8 i, hport, member, aggr_id;
 	int ret;
 
 	if((aggr_id = hal_swif_aggr_find_group(lport)) == 0xFF)
@@ -313,8 +398,97 @@ int hal_swif_aggr_link_changed(u8 lport, HAL_PORT_LINK_STATE new_state)
 		ret = hal_swif_aggr_add_member(aggr_id, lport);
 		break;
 	}
+	if(ret != HAL_SWIF_SUCCESS)
+		return ret;
+
+	hport = hal_swif_lport_2_hport(lport);
+	for(i=0; i<PortAggrInfo.AggrCount; i++) {
+		pRec = &PortAggrInfo.AggrGroupRec[i];
+		if(pRec->AggrId != aggr_id)
+			continue;
+		for(member=0; member<pRec->PortNumber; member++) {
+			if(pRec->HwPort[member] == hport)
+				break;
+		}
+		if(new_state == LINK_DOWN)
+			pRec->LiveMask &= ~(1<<member);
+		else
+			pRec->LiveMask |= (1<<member);
+		hal_swif_aggr_account(pRec, 0, 0);
+	}
 	
-	return HAL_SWIF_SUCCESS;
+	return ret;
+#endif
+}
+
+/**************************************************************************
+  * @brief  start the interrupt driven trunk failover
+  * @param  none
+  * @retval none
+  *************************************************************************/
+void hal_swif_aggr_entry(void)
+{
+#if (SWITCH_CHIP_88E6095 && AGGR_LINK_IRQ_ENABLE)
+	aggr_rec *pRec;
+	GT_U16 data;
+	u8 member, hport;
+	int i;
+
+	if((PortAggrInfo.AggrCount == 0) || (AggrLinkSemaphore != NULL))
+		return;
+
+	/* Link change interrupt on every member with an internal PHY */
+	AggrPhyIntVec = 0;
+	for(i=0; i<PortAggrInfo.AggrCount; i++) {
+		pRec = &PortAggrInfo.AggrGroupRec[i];
+		for(member=0; member<pRec->PortNumber; member++) {
+			hport = pRec->HwPort[member];
+			if(hport > 7)
+				continue;
+			if(gprtPhyIntEnable(dev, hport, GT_LINK_STATUS_CHANGED) == GT_OK)
+				AggrPhyIntVec |= 1<<hport;
+		}
+	}
+	if(AggrPhyIntVec == 0)
+		return;
+
+	/* Add the PHY interrupt to the events already active */
+	if(hwGetGlobalRegField(dev, QD_REG_GLOBAL_CONTROL, 0, 7, &data) != GT_OK)
+		return;
+	if(eventSetActive(dev, data | GT_PHY_INTERRUPT) != GT_OK)
+		return;
+
+	vSemaphoreCreateBinary(AggrLinkSemaphore);
+	xSemaphoreTake(AggrLinkSemaphore, 0);
+
+	xTaskCreate(hal_swif_aggr_failover_task, "tAggr", configMINIMAL_STACK_SIZE*2, NULL, tskIDLE_PRIORITY + 5, NULL);
+#endif
+}
+
+/**************************************************************************
+  * @brief  show trunk failover counters and latency histogram
+  * @param  pCliEnv
+  * @retval none
+  *************************************************************************/
+static void hal_swif_aggr_show_failover(void *pCliEnv)
+{
+	aggr_rec *pRec;
+	int i, k;
+
+	cli_printf(pCliEnv, "  Trunk Failover Statistics :\r\n");
+	cli_printf(pCliEnv, "  ====================================================\r\n");
+	cli_printf(pCliEnv, "  AggrID  Live  Failover  Polled  Max(us)\r\n");
+	for(i=0; i<PortAggrInfo.AggrCount; i++) {
+		pRec = &PortAggrInfo.AggrGroupRec[i];
+		cli_printf(pCliEnv, "    %02d    0x%02X  %8d  %6d  %7d\r\n", pRec->AggrId, pRec->LiveMask, 
+			pRec->FailoverCount, pRec->PollCount, pRec->LatencyMax);
+		cli_printf(pCliEnv, "          ");
+		for(k=0; k<AGGR_LATENCY_BUCKETS-1; k++)
+			cli_printf(pCliEnv, "<=%d:%d ", AggrLatencyLimit[k], pRec->LatencyHist[k]);
+		cli_printf(pCliEnv, ">%d:%d\r\n", AggrLatencyLimit[AGGR_LATENCY_BUCKETS-2], pRec->LatencyHist[AGGR_LATENCY_BUCKETS-1]);
+	}
+	cli_printf(pCliEnv, "  ====================================================\r\n");
+	cli_printf(pCliEnv, "\r\n");
 }
 
 /**************************************************************************
@@ -387,6 +561,8 @@ int hal_swif_aggr_show_status(void *pCliEnv)
 	cli_printf(pCliEnv, "  ====================================================\r\n");
 	cli_printf(pCliEnv, "\r\n");
 	
+	hal_swif_aggr_show_failover(pCliEnv);
+
 	return HAL_SWIF_SUCCESS;
 
 #elif SWITCH_CHIP_BCM53286
@@ -460,6 +636,8 @@ int hal_swif_aggr_show_status(void *pCliEnv)
 	cli_printf(pCliEnv, "  ====================================================\r\n");
 	cli_printf(pCliEnv, "\r\n");
 	
+	hal_swif_aggr_show_failover(pCliEnv);
+
 	return HAL_SWIF_SUCCESS;
 
 #else
@@ -476,17 +654,19 @@ int hal_swif_aggr_conf_initialize(void)
 {
 #if SWITCH_CHIP_88E6095
 	GT_STATUS status;
-	GT_U32 AggrId, trunk_mask, mask;
+	GT_U32 AggrId;
 	link_aggregation_conf_t aggr_cfg;
 	link_aggregation_rec aggr_rec;
-	u8	aggr_port_array[MAX_AGGREGATION_GROUP_PORT_NUM];
 	u32 port_list_vec;
-	u32 hwport_vec;
+	u32 hwport_vec, member_vec;
 	u8 hport;
 	int i,j,k;
-	int index, aggr_port_num;
+	int aggr_port_num;
 
 	memset(&PortAggrInfo, 0, sizeof(aggr_info_t));
+	member_vec = 0;
+	if(os_mutex_init(&AggrMutex) != OS_MUTEX_SUCCESS)
+		return CONF_ERR_SWITCH_HAL;
 	
 	if(eeprom_read(NVRAM_PORT_TRUNK_CFG_BASE, (u8 *)&aggr_cfg, sizeof(link_aggregation_conf_t)) != I2C_SUCCESS) {
 		return CONF_ERR_I2C;
@@ -523,43 +703,32 @@ int hal_swif_aggr_conf_initialize(void)
 					return CONF_ERR_MSAPI;
 				}
 				
+				PortAggrInfo.AggrGroupRec[PortAggrInfo.AggrCount-1].HwPort[aggr_port_num] = hport;
 				aggr_port_num++;
 				if(aggr_port_num == MAX_AGGREGATION_GROUP_PORT_NUM)
 					break;				
 			}
 		}
+		if(aggr_port_num == 0) {
+			PortAggrInfo.AggrCount--;
+			continue;
+		}
 		PortAggrInfo.AggrGroupRec[PortAggrInfo.AggrCount-1].PortNumber = aggr_port_num;
-		#if 0
-		/* Set Trunk Route Table for the given Trunk ID */
+
+		/* Route the trunk to every member, the mask table picks a live one */
 		if((status = gsysSetTrunkRouting(dev, AggrId, hwport_vec)) != GT_OK) {
 			return CONF_ERR_MSAPI;
 		}
-		#endif
-		memset(aggr_port_array, 0, MAX_AGGREGATION_GROUP_PORT_NUM);
-		index = 0;
-		for(j=0; j<dev->numOfPorts; j++) {
-			if(hwport_vec & (1<<j)) {
-				aggr_port_array[index] = j;
-				index++;
-				if(index == MAX_AGGREGATION_GROUP_PORT_NUM)
-					break;					
-			}
-		}
-
-		/* Set Trunk Mask Table for load balancing. */
-		trunk_mask = 0x7FF;
-		trunk_mask &= ~hwport_vec;
-		for(k=0; k<8; k++) {
-			index = k % aggr_port_num;
-			mask = trunk_mask | (1 << aggr_port_array[index]);
-			#if 0
-			if((status = gsysSetTrunkMaskTable(dev, k, mask)) != GT_OK) {
-				return CONF_ERR_MSAPI;
-			}
-			#endif
-		}
-		
+		member_vec |= hwport_vec;
 	}
+
+	/* No member is up yet, load every bucket with an empty member set */
+	hal_swif_aggr_build_select(AggrHashSelect);
+	AggrBaseMask = 0x7FF & ~member_vec;
+	for(k=0; k<AGGR_HASH_BUCKETS; k++)
+		AggrMaskShadow[k] = 0xFFFFFFFF;
+	if(hal_swif_aggr_mask_update() != HAL_SWIF_SUCCESS)
+		return CONF_ERR_MSAPI;
 	
 	return CONF_ERR_NONE;
 
@@ -611,6 +780,7 @@ int hal_swif_aggr_conf_initialize(void)
 			if(port_list_vec & (1<<j)) {
 				hport = hal_swif_lport_2_hport(j+1);
 				hwport_vec |= 1<<hport;				
+				PortAggrInfo.AggrGroupRec[PortAggrInfo.AggrCount-1].HwPort[aggr_port_num] = hport;
 				aggr_port_num++;
 				if(aggr_port_num == MAX_AGGREGATION_GROUP_PORT_NUM)
 					break;				
@@ -18,6 +18,25 @@
 	#define MAX_AGGREGATION_GROUP_ID		8
 	#define MAX_AGGREGATION_GROUP_PORT_NUM	8	
 #endif 	
+
+/*****************************************************************************************
+ 			Trunk member failover			
+ ******************************************************************************************/
+#if SWITCH_CHIP_88E6095
+	#define AGGR_HASH_BUCKETS			8		/* Trunk Mask Table entries */
+	#define AGGR_SELECT_NONE			0x0F	/* No live member for a bucket */
+	/* One select word per (member count, live member subset), see hal_swif_aggr_build_select() */
+	#define AGGR_SELECT_BASE(n)			((1 << (n)) - 2)
+	#define AGGR_SELECT_TABLE_SIZE		AGGR_SELECT_BASE(MAX_AGGREGATION_GROUP_PORT_NUM + 1)
+#endif
+
+#if BOARD_GE22103MA
+	#define AGGR_LINK_IRQ_ENABLE		1		/* 88E6095 INTn on PE8 */
+#else
+	#define AGGR_LINK_IRQ_ENABLE		0
+#endif
+
+#define AGGR_LATENCY_BUCKETS			8
 	
 typedef struct {
 	u8	PortNum;
@@ -64,6 +83,12 @@ typedef struct {
 	u8	AggrId;
 	u8	PortNumber;
 	u32	PortMask;
+	u8	HwPort[MAX_AGGREGATION_GROUP_PORT_NUM];		/* Members in configuration order */
+	u8	LiveMask;									/* Bit n set while HwPort[n] is linked up */
+	u32	FailoverCount;								/* Member set changes */
+	u32	PollCount;									/* Changes first seen by a poll, not by INTn */
+	u32	LatencyMax;									/* INTn to trunk mask written, us */
+	u32	LatencyHist[AGGR_LATENCY_BUCKETS];
 } aggr_rec;
 
 typedef struct {
@@ -79,6 +104,11 @@ int hal_swif_aggr_show_status(void *pCliEnv);
 
 int hal_swif_aggr_conf_initialize(void);
 
+#if SWITCH_CHIP_88E6095
+void hal_swif_aggr_build_select(u32 *pSelect);
+u32 hal_swif_aggr_bucket_mask(const u32 *pSelect, const aggr_info_t *pInfo, u32 base, u8 bucket);
+#endif
+
 #if MODULE_OBNMS
 void nms_rsp_set_port_aggregation(u8 *DMA, u8 *RequestID, obnet_set_port_aggregation *pSetPortAggr);
 void nms_rsp_get_port_aggregation(u8 *DMA, u8 *RequestID, obnet_get_port_aggregation *pGetPortAggr);
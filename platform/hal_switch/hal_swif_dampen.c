@@ -0,0 +1,61 @@
+/*******************************************************************
+ * Filename     : hal_swif_dampen.c
+ * Description  : Link flap dampening of one port, penalty, decay,
+ *                suppress and reuse, fed one link sample at a time
+ * Copyright    : OB Telecom Electronics Co.
+ *******************************************************************/
+#include "mconfig.h"
+
+/* BSP includes */
+#include "stm32f2xx.h"
+
+/* HAL for L2 includes */
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_port.h"
+
+/**************************************************************************
+  * @brief  run one link sample through the flap dampening state
+  * @param  pDampen, link_state read from the switch, tick in ms
+  * @retval link state to hand to the upper layers
+  *************************************************************************/
+HAL_PORT_LINK_STATE hal_swif_dampen_update(hal_port_dampen_t *pDampen, HAL_PORT_LINK_STATE link_state, uint32 tick)
+{
+	if(pDampen->Valid == 0) {
+		pDampen->Valid = 1;
+		pDampen->RawState = link_state;
+		pDampen->LastTick = tick;
+	}
+
+	/* Penalty decays in whole seconds */
+	pDampen->DecayMs += tick - pDampen->LastTick;
+	pDampen->LastTick = tick;
+	while(pDampen->DecayMs >= 1000) {
+		pDampen->DecayMs -= 1000;
+		pDampen->Penalty = (uint16)(((uint32)pDampen->Penalty * HAL_DAMPEN_DECAY) >> 10);
+		if(pDampen->Suppressed)
+			pDampen->SuppressTime++;
+	}
+
+	/* A down always goes through at once, the penalty decides about the next up */
+	if((link_state == LINK_DOWN) && (pDampen->RawState == LINK_UP)) {
+		pDampen->FlapCount++;
+		pDampen->Penalty += HAL_DAMPEN_PENALTY;
+		if(pDampen->Penalty > HAL_DAMPEN_PENALTY_MAX)
+			pDampen->Penalty = HAL_DAMPEN_PENALTY_MAX;
+
+		/* The STP state stays with its owners (obring, trunk failover), they
+		   already act on the down and keep seeing it until the release */
+		if((pDampen->Suppressed == 0) && (pDampen->Penalty >= HAL_DAMPEN_SUPPRESS)) {
+			pDampen->Suppressed = 1;
+			pDampen->SuppressTime = 0;
+			pDampen->SuppressCount++;
+		}
+	}
+	pDampen->RawState = link_state;
+
+	if((pDampen->Suppressed) && (pDampen->Penalty < HAL_DAMPEN_REUSE))
+		pDampen->Suppressed = 0;
+
+	return (pDampen->Suppressed) ? LINK_DOWN : link_state;
+}
@@ -738,7 +738,10 @@ int hal_swif_atu_int_disable()
 {
 	GT_U16 data;
 
-	data = 0;
+	/* Leave the PHY interrupt used by trunk failover alone */
+	if(hwGetGlobalRegField(dev,QD_REG_GLOBAL_CONTROL,0,7,&data) != GT_OK)
+		return GT_ERROR;
+	data &= ~GT_ATU_PROB;
 	if(eventSetActive(dev,data) != GT_OK)
 		return GT_ERROR;
 	return GT_OK;
@@ -748,7 +751,9 @@ int hal_swif_atu_int_enable()
 {
 	GT_U16 data;
 
-	data = GT_ATU_PROB;
+	if(hwGetGlobalRegField(dev,QD_REG_GLOBAL_CONTROL,0,7,&data) != GT_OK)
+		return GT_ERROR;
+	data |= GT_ATU_PROB;
 	if(eventSetActive(dev,data) != GT_OK)
 		return GT_ERROR;
 	return GT_OK;
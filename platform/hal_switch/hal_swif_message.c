@@ -13,6 +13,9 @@
 #include <string.h>
 
 /* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
 #include "os_mutex.h"
 
 /* BSP includes */
@@ -35,6 +38,7 @@
 #include "hal_swif_error.h"
 #include "hal_swif_types.h"
 #include "hal_swif_comm.h"
+#include "hal_swif.h"
 #include "hal_swif_port.h"
 #include "hal_swif_txrx.h"
 #include "hal_swif_message.h"
@@ -51,6 +55,25 @@ OS_MUTEX_T OBMsgTxMutex;
 OS_MUTEX_T NeighborInfoMutex;
 hal_trap_info_t gTrapInfo;
 
+/* Queue bookkeeping is in hal_swif_trapq.c, the message of each slot here */
+static hal_trapq_t TrapQueue;
+static hal_trap_msg_t TrapQueueMsg[HAL_TRAP_QUEUE_SIZE];
+static uint16 TrapQueueLen[HAL_TRAP_QUEUE_SIZE];
+static OS_MUTEX_T TrapQueueMutex;
+static xSemaphoreHandle xSemTrap = NULL;
+
+typedef struct {
+	uint8			State;			/* HAL_NEIGHBOR_STATE */
+	uint16			ReqID;
+	uint16			Interval;		/* Next probe interval, ms */
+	portTickType	NextTx;
+	portTickType	LastHeard;
+} hal_neighbor_port_t;
+
+/* Per-port discovery state, guarded by NeighborInfoMutex */
+static hal_neighbor_port_t NeighborPort[MAX_PORT_NUM];
+static uint32 NeighborSeed = 0;
+
 extern hal_port_config_info_t gPortConfigInfo[];
 extern unsigned char DevMac[];
 extern unsigned char MultiAddress[];
@@ -381,6 +404,21 @@ int hal_swif_neighbor_req_rsponse(uint8 *SMA, uint8 RxLport, uint16 ReqID, hal_s
 	return HAL_SWIF_SUCCESS;
 }
 
+/**************************************************************************
+  * @brief  Spread an interval by +-25%, so devices powered up together do
+  *         not probe in step
+  * @param  Interval in ms
+  * @retval Jittered interval in ms
+  *************************************************************************/
+static uint32 hal_swif_neighbor_jitter(uint32 Interval)
+{
+	if(NeighborSeed == 0)
+		NeighborSeed = ((uint32)DevMac[2] << 24) | ((uint32)DevMac[3] << 16) | ((uint32)DevMac[4] << 8) | DevMac[5] | 1;
+	NeighborSeed = NeighborSeed * 1103515245 + 12345;
+
+	return (Interval * 3 / 4) + ((NeighborSeed >> 16) % (Interval / 2 + 1));
+}
+
 /**************************************************************************
   * @brief  Update the Neighbor information
   * @param  pNeighBorReqRsp
@@ -391,7 +429,6 @@ int hal_swif_neighbor_info_update(hal_swif_msg_neighbor_req_rsponse *pNeighBorRe
 	uint8 LocalLport;
 	HAL_PORT_STP_STATE	stp_state;
 	extern hal_neighbor_record_t gNeighborInformation[];
-	extern uint32 gNeighborReqEnBitMap;
 	
 	if((pNeighBorReqRsp->PortNo == 0) || (pNeighBorReqRsp->PortNo > MAX_PORT_NUM))
 		return HAL_SWIF_FAILURE;
@@ -411,7 +448,13 @@ int hal_swif_neighbor_info_update(hal_swif_msg_neighbor_req_rsponse *pNeighBorRe
 	memcpy(gNeighborInformation[LocalLport - 1].NeighborIP, pNeighBorReqRsp->NeighborIP, 4);
 	memcpy(gNeighborInformation[LocalLport - 1].NeighborSwitchType, pNeighBorReqRsp->NeighborSwitchType, 8);
 
-	gNeighborReqEnBitMap &= ~(uint32)(1<<(LocalLport-1));
+	/* Stop probing, the next request is the periodic refresh */
+	NeighborPort[LocalLport - 1].LastHeard = xTaskGetTickCount();
+	if(NeighborPort[LocalLport - 1].State != NEIGHBOR_LEARNED) {
+		NeighborPort[LocalLport - 1].State = NEIGHBOR_LEARNED;
+		NeighborPort[LocalLport - 1].NextTx = NeighborPort[LocalLport - 1].LastHeard + 
+			hal_swif_neighbor_jitter(HAL_NEIGHBOR_REFRESH) / portTICK_RATE_MS;
+	}
 	
 	os_mutex_unlock(&NeighborInfoMutex);
 
@@ -443,6 +486,90 @@ int hal_swif_neighbor_info_clear(uint8 Lport)
 	return HAL_SWIF_SUCCESS;
 }
 
+/**************************************************************************
+  * @brief  Start probing a port on link up, forget its neighbor on link down
+  * @param  Lport, LinkState: LINK_UP or LINK_DOWN
+  * @retval none
+  *************************************************************************/
+void hal_swif_neighbor_link_changed(uint8 Lport, uint8 LinkState)
+{
+	hal_neighbor_port_t *pPort;
+	HAL_BOOL Clear = HAL_FALSE;
+
+	if((Lport == 0) || (Lport > MAX_PORT_NUM))
+		return;
+
+	os_mutex_lock(&NeighborInfoMutex, OS_MUTEX_WAIT_FOREVER);
+	pPort = &NeighborPort[Lport-1];
+	if(LinkState == LINK_UP) {
+		pPort->State = NEIGHBOR_PROBING;
+		pPort->ReqID = 1;
+		pPort->Interval = HAL_NEIGHBOR_PROBE_MIN;
+		pPort->NextTx = xTaskGetTickCount();
+	} else if(pPort->State != NEIGHBOR_IDLE) {
+		pPort->State = NEIGHBOR_IDLE;
+		Clear = HAL_TRUE;
+	}
+	os_mutex_unlock(&NeighborInfoMutex);
+
+	if(Clear)
+		hal_swif_neighbor_info_clear(Lport);
+}
+
+/**************************************************************************
+  * @brief  Send the neighbor requests that are due and age out neighbors
+  *         silent for HAL_NEIGHBOR_HOLDTIME, called from the link poll loop
+  * @param  none
+  * @retval none
+  *************************************************************************/
+void hal_swif_neighbor_poll(void)
+{
+	hal_neighbor_port_t *pPort;
+	portTickType Now;
+	HAL_BOOL Aged, Send;
+	uint16 ReqID;
+	uint8 Lport;
+	extern dev_base_info_t DeviceBaseInfo;
+
+	for(Lport=1; (Lport<=DeviceBaseInfo.PortNum) && (Lport<=MAX_PORT_NUM); Lport++) {
+		Aged = HAL_FALSE;
+		Send = HAL_FALSE;
+
+		os_mutex_lock(&NeighborInfoMutex, OS_MUTEX_WAIT_FOREVER);
+		pPort = &NeighborPort[Lport-1];
+		Now = xTaskGetTickCount();
+
+		/* Link stays up but the neighbor went quiet, probe it again */
+		if((pPort->State == NEIGHBOR_LEARNED) && 
+		   ((signed portBASE_TYPE)(Now - pPort->LastHeard) >= (signed portBASE_TYPE)(HAL_NEIGHBOR_HOLDTIME / portTICK_RATE_MS))) {
+			pPort->State = NEIGHBOR_PROBING;
+			pPort->Interval = HAL_NEIGHBOR_PROBE_MIN;
+			pPort->NextTx = Now;
+			Aged = HAL_TRUE;
+		}
+
+		if((pPort->State != NEIGHBOR_IDLE) && (gPortConfigInfo[Lport-1].NeigborSearch == HAL_TRUE) && 
+		   ((signed portBASE_TYPE)(Now - pPort->NextTx) >= 0)) {
+			Send = HAL_TRUE;
+			ReqID = pPort->ReqID++;
+			if(pPort->State == NEIGHBOR_PROBING) {
+				pPort->NextTx = Now + hal_swif_neighbor_jitter(pPort->Interval) / portTICK_RATE_MS;
+				pPort->Interval <<= 1;
+				if(pPort->Interval > HAL_NEIGHBOR_PROBE_MAX)
+					pPort->Interval = HAL_NEIGHBOR_PROBE_MAX;
+			} else {
+				pPort->NextTx = Now + hal_swif_neighbor_jitter(HAL_NEIGHBOR_REFRESH) / portTICK_RATE_MS;
+			}
+		}
+		os_mutex_unlock(&NeighborInfoMutex);
+
+		if(Aged)
+			hal_swif_neighbor_info_clear(Lport);
+		if(Send)
+			hal_swif_neighbor_req_send(Lport, ReqID);
+	}
+}
+
 /**************************************************************************
   * @brief  Trap message send
   * @param  ServerMac, TrapMsgBuf, TrapMsgLen, RequestID
@@ -536,17 +663,126 @@ int hal_swif_trap_send(uint8 *ServerMac, uint8 *TrapMsgBuf, uint16 TrapMsgLen, u
   *************************************************************************/
 int hal_swif_trap_complete(uint8 *SMA, uint16 ReqID, hal_trap_port_status *pTrapReponse)
 {
+	int ret = HAL_SWIF_SUCCESS;
+
 	if(memcmp(SMA, gTrapInfo.ServerMac, 6) != 0)
 		return HAL_SWIF_FAILURE;
 
 	if(pTrapReponse->TrapIndex >= MAX_TRAP_TYPE_NUM)
 		return HAL_SWIF_FAILURE;
 
-	if(ReqID != gTrapInfo.RequestID[pTrapReponse->TrapIndex])
+	/* hal_swif_trap_post may renumber the trap between the compare and
+	   the clear, an ack for the old RequestID must not stop the new one */
+	if(xSemTrap != NULL)
+		os_mutex_lock(&TrapQueueMutex, OS_MUTEX_WAIT_FOREVER);
+
+	if(ReqID != gTrapInfo.RequestID[pTrapReponse->TrapIndex]) {
+		ret = HAL_SWIF_FAILURE;
+	} else {
+		gTrapInfo.SendEnable[pTrapReponse->TrapIndex] = HAL_FALSE;
+		if(xSemTrap != NULL)
+			hal_trapq_ack(&TrapQueue, pTrapReponse->TrapIndex, ReqID);
+	}
+
+	if(xSemTrap != NULL)
+		os_mutex_unlock(&TrapQueueMutex);
+
+	return ret;
+}
+
+/**************************************************************************
+  * @brief  Queue a trap for sending, TrapIndex is the first byte of TrapMsgBuf.
+  *         A pending trap of the same index is replaced and gets a new
+  *         RequestID, so an ack for the stale one is ignored.
+  * @param  TrapMsgBuf, TrapMsgLen
+  * @retval HAL_SWIF_SUCCESS, or HAL_SWIF_FAILURE when the queue is full
+  *************************************************************************/
+int hal_swif_trap_post(uint8 *TrapMsgBuf, uint16 TrapMsgLen)
+{
+	uint8 TrapIndex = TrapMsgBuf[0];
+	int Slot;
+
+	if((xSemTrap == NULL) || (TrapIndex >= MAX_TRAP_TYPE_NUM) || (TrapMsgLen > sizeof(hal_trap_msg_t)))
 		return HAL_SWIF_FAILURE;
 
-	gTrapInfo.SendEnable[pTrapReponse->TrapIndex] = HAL_FALSE;
+	os_mutex_lock(&TrapQueueMutex, OS_MUTEX_WAIT_FOREVER);
+	
+	Slot = hal_trapq_post(&TrapQueue, TrapIndex, gTrapInfo.RequestID[TrapIndex] + 1, xTaskGetTickCount());
+	if(Slot < 0) {
+		os_mutex_unlock(&TrapQueueMutex);
+		return HAL_SWIF_FAILURE;
+	}
 
+	gTrapInfo.RequestID[TrapIndex]++;
+	gTrapInfo.SendEnable[TrapIndex] = HAL_TRUE;
+	
+	TrapQueueLen[Slot] = TrapMsgLen;
+	memcpy(&TrapQueueMsg[Slot], TrapMsgBuf, TrapMsgLen);
+	
+	os_mutex_unlock(&TrapQueueMutex);
+
+	xSemaphoreGive(xSemTrap);
+	
 	return HAL_SWIF_SUCCESS;
 }
 
+void hal_swif_trap_get_stats(hal_trap_stats_t *pStats)
+{
+	os_mutex_lock(&TrapQueueMutex, OS_MUTEX_WAIT_FOREVER);
+	memcpy(pStats, &TrapQueue.Stats, sizeof(hal_trap_stats_t));
+	os_mutex_unlock(&TrapQueueMutex);
+}
+
+/**************************************************************************
+  * @brief  Send new traps at once and resend unanswered ones, each entry
+  *         keeps its own retransmit timer
+  * @param  arg
+  * @retval none
+  *************************************************************************/
+static void hal_swif_trap_task(void *arg)
+{
+	hal_trap_msg_t TxMsg;
+	uint16 TxLen, TxReqID;
+	int i;
+	
+	for(;;) {
+		xSemaphoreTake(xSemTrap, HAL_TRAP_POLL_INTERVAL / portTICK_RATE_MS);
+
+		for(i=0; i<HAL_TRAP_QUEUE_SIZE; i++) {
+			TxLen = 0;
+			
+			os_mutex_lock(&TrapQueueMutex, OS_MUTEX_WAIT_FOREVER);
+			switch(hal_trapq_poll(&TrapQueue, i, xTaskGetTickCount(), HAL_TRAP_RETRY_INTERVAL / portTICK_RATE_MS)) {
+				case HAL_TRAPQ_SEND:
+					TxLen = TrapQueueLen[i];
+					TxReqID = TrapQueue.Entry[i].RequestID;
+					memcpy(&TxMsg, &TrapQueueMsg[i], TxLen);
+					break;
+				case HAL_TRAPQ_EXPIRED:
+					gTrapInfo.SendEnable[TrapQueue.Entry[i].TrapIndex] = HAL_FALSE;
+					break;
+				default:
+					break;
+			}
+			os_mutex_unlock(&TrapQueueMutex);
+
+			/* Send outside the queue lock, a slow send must not block posters */
+			if(TxLen > 0)
+				hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TxMsg, TxLen, TxReqID);
+		}
+	}
+}
+
+void hal_swif_trap_entry(void)
+{
+	if(xSemTrap != NULL)
+		return;
+
+	hal_trapq_init(&TrapQueue);
+	os_mutex_init(&TrapQueueMutex);
+	vSemaphoreCreateBinary(xSemTrap);
+	xSemaphoreTake(xSemTrap, 0);
+
+	xTaskCreate(hal_swif_trap_task, "tTrap", configMINIMAL_STACK_SIZE*2, NULL, tskIDLE_PRIORITY + 2, NULL);
+}
+
@@ -4,6 +4,7 @@
 #define _HAL_SWIF_MESSAGE_H_
 
 #include "mconfig.h"
+#include "hal_swif_trapq.h"
 
 #if SWITCH_CHIP_88E6095
 typedef struct {
@@ -130,6 +131,19 @@ typedef struct {
 	uint8	NeighborSwitchType[8];
 } hal_swif_msg_neighbor_req_rsponse;
 
+/* Discovery timing, ms. A link up port is probed at once, then with a
+   jittered interval doubling from PROBE_MIN to PROBE_MAX until it answers */
+#define HAL_NEIGHBOR_PROBE_MIN		200
+#define HAL_NEIGHBOR_PROBE_MAX		1000
+#define HAL_NEIGHBOR_REFRESH		20000
+#define HAL_NEIGHBOR_HOLDTIME		(3 * HAL_NEIGHBOR_REFRESH)
+
+typedef enum {
+	NEIGHBOR_IDLE		= 0,	/* Link down */
+	NEIGHBOR_PROBING	= 1,	/* Link up, no response yet */
+	NEIGHBOR_LEARNED	= 2		/* Answered within the holdtime */
+} HAL_NEIGHBOR_STATE;
+
 /*********************************************************************
 		Trap Feature
  *********************************************************************/
@@ -210,6 +224,12 @@ typedef struct {
 	u8	TrafficStatus[2*MAX_PORT_NUM];
 } hal_trap_traffic_status;
 
+typedef union {
+	hal_trap_port_status	PortStatus;
+	hal_trap_ring_status	RingStatus;
+	hal_trap_traffic_status	TrafficStatus;
+} hal_trap_msg_t;
+
 /*********************************************************************
 		Exported Functions
  *********************************************************************/
@@ -217,9 +237,13 @@ int hal_swif_neighbor_req_send(uint8 Lport, uint16 ReqID);
 int hal_swif_neighbor_req_rsponse(uint8 *SMA, uint8 RxLport, uint16 ReqID, hal_swif_msg_neighbor_req *NeighborReq);
 int hal_swif_neighbor_info_update(hal_swif_msg_neighbor_req_rsponse *pNeighBorReqRsp);
 int hal_swif_neighbor_info_clear(uint8 Lport);
+void hal_swif_neighbor_link_changed(uint8 Lport, uint8 LinkState);
+void hal_swif_neighbor_poll(void);
 
 int hal_swif_trap_send(uint8 *ServerMac, uint8 *TrapMsgBuf, uint16 TrapMsgLen, uint16 RequestID);
 int hal_swif_trap_complete(uint8 *SMA, uint16 ReqID, hal_trap_port_status *pTrapReponse);
+int hal_swif_trap_post(uint8 *TrapMsgBuf, uint16 TrapMsgLen);
+void hal_swif_trap_get_stats(hal_trap_stats_t *pStats);
 
 #endif	/* _HAL_SWIF_MESSAGE_H_ */
 
@@ -50,6 +50,121 @@
 extern GT_QD_DEV *dev;
 #endif
 
+#if SWITCH_CHIP_88E6095
+/* Running image of the static multicast ATU entries, the base of the differential apply */
+static multicast_conf_t McastRunCfg;
+static multicast_rec McastRunRec[MAX_MCAST_RECORD_COUNT];
+static multicast_rec McastNewRec[MAX_MCAST_RECORD_COUNT];
+static u8 McastRunValid = 0;
+
+/* eeprom_read() length is 8 bits, so records are accessed one by one */
+static int hal_swif_mcast_rec_read(multicast_rec *rec, int count)
+{
+	int i;
+
+	for(i=0; i<count; i++) {
+		if(eeprom_read(NVRAM_MCAST_RECORD_CFG_BASE + i * sizeof(multicast_rec), (u8 *)&rec[i], sizeof(multicast_rec)) != I2C_SUCCESS)
+			return CONF_ERR_I2C;
+	}
+	return CONF_ERR_NONE;
+}
+
+/* Hardware port vector of a record */
+static u32 hal_swif_mcast_rec_hwvec(multicast_rec *rec, u8 port_num)
+{
+#if MULTI_CFG_OPTIMIZAION
+	u32 port_list_vec;
+#else
+	u16 port_list_vec;
+#endif
+	u32 hwport_vec;
+	int j;
+
+#if MULTI_CFG_OPTIMIZAION
+	port_list_vec = *(u32 *)&(rec->Member[0]);
+	port_list_vec = ntohl(port_list_vec);
+#else
+	port_list_vec = *(u16 *)&(rec->Member[0]);
+	port_list_vec = ntohs(port_list_vec);
+#endif		
+	hwport_vec = 0;
+	for(j=0; j<port_num; j++) {
+		if(port_list_vec & (1<<j))
+			hwport_vec |= 1<<hal_swif_lport_2_hport(j+1);
+	}
+	return hwport_vec;
+}
+
+static int hal_swif_mcast_rec_find(multicast_rec *rec, int count, u8 *mac)
+{
+	int i;
+
+	for(i=0; i<count; i++) {
+		if(((rec[i].Mac[0] & 0x1) == 1) && (memcmp(rec[i].Mac, mac, 6) == 0))
+			return i;
+	}
+	return -1;
+}
+
+static GT_STATUS hal_swif_mcast_atu_load(multicast_rec *rec, u8 port_num)
+{
+	GT_ATU_ENTRY macEntry;
+
+	memset(&macEntry,0,sizeof(GT_ATU_ENTRY));	
+	memcpy(macEntry.macAddr.arEther, rec->Mac, 6);
+	macEntry.DBNum = 0;
+	macEntry.portVec = hal_swif_mcast_rec_hwvec(rec, port_num);
+	macEntry.prio = 0;
+	macEntry.entryState.mcEntryState = GT_MC_STATIC;
+
+	return gfdbAddMacEntry(dev,&macEntry);
+}
+
+static GT_STATUS hal_swif_mcast_atu_purge(multicast_rec *rec)
+{
+	GT_ETHERADDR macAddr;
+
+	memcpy(macAddr.arEther, rec->Mac, 6);
+	return gfdbDelMacEntry(dev,&macAddr);
+}
+
+#if MULTI_CFG_OPTIMIZAION
+/* Whether multicast frames with unknown DAs egress out the port */
+static GT_STATUS hal_swif_mcast_default_forward(u8 hport, u8 forward)
+{
+	GT_STATUS status = GT_OK;
+
+	switch(dev->deviceId) {
+		case GT_88E6095:
+		/* DF=1/0, Multicast frames with unknown DAs are allowed to egress out this port or not */
+	    if((status = gprtSetDefaultForward(dev, hport, forward ? GT_TRUE : GT_FALSE)) != GT_OK) {
+	        printf("Error: gprtSetDefaultForward failed\r\n");
+	        return status;
+	    }
+
+		case GT_88E6097:
+	    if((status = hwSetPortRegField(dev, hport, QD_REG_PORT_CONTROL, 2, 2, forward ? 0x3 : 0x1)) != GT_OK) {
+	        printf("Error: hwSetPortRegField failed\r\n");
+	        return status;
+	    }
+		break;
+
+		default:
+		break;
+	}
+	return status;
+}
+
+static u32 hal_swif_mcast_default_forward_vec(multicast_conf_t *cfg)
+{
+	u32 port_list_vec;
+
+	port_list_vec = *(u32 *)&(cfg->PortDefaultForward[0]);
+	return ntohl(port_list_vec);
+}
+#endif
+#endif
+
 /**************************************************************************
   * @brief  static muticast initialize use configuration
   * @param  none
@@ -59,17 +174,13 @@ int hal_swif_mcast_conf_initialize(void)
 {
 #if SWITCH_CHIP_88E6095
 	GT_STATUS status;
-	GT_ATU_ENTRY macEntry;
 	multicast_conf_t mcast_cfg;
-	multicast_rec mcast_rec;
 #if MULTI_CFG_OPTIMIZAION
 	u32 port_list_vec;
-#else
-	u16 port_list_vec;
 #endif
-	u32 hwport_vec;
-	u8 hport;
 	int i,j;
+
+	McastRunValid = 0;
 	
 	if(eeprom_read(NVRAM_MCAST_CFG_BASE, (u8 *)&mcast_cfg, sizeof(multicast_conf_t)) != I2C_SUCCESS) {
 		return CONF_ERR_I2C;
@@ -80,95 +191,30 @@ int hal_swif_mcast_conf_initialize(void)
 	}
 	
 #if MULTI_CFG_OPTIMIZAION
-	port_list_vec = *(u32 *)&(mcast_cfg.PortDefaultForward[0]);
-	port_list_vec = ntohl(port_list_vec);
+	port_list_vec = hal_swif_mcast_default_forward_vec(&mcast_cfg);
 	
 	for(j=0; j<mcast_cfg.PortNum; j++) {
-		if(port_list_vec & (1<<j)) {
-			hport = hal_swif_lport_2_hport(j+1);
-			switch(dev->deviceId) {
-				case GT_88E6095:
-				/* DF=1, Multicast frames with unknown DAs are allowed to egress out this port */
-			    if((status = gprtSetDefaultForward(dev, hport, GT_TRUE)) != GT_OK) {
-			        printf("Error: gprtSetDefaultForward failed\r\n");
-			        return status;
-			    }
-
-				case GT_88E6097:
-			    if((status = hwSetPortRegField(dev, hport, QD_REG_PORT_CONTROL, 2, 2, 0x3)) != GT_OK) {
-			        printf("Error: hwSetPortRegField failed\r\n");
-			        return status;
-			    }
-				break;
-
-				default:
-				break;
-			}
-		} else {
-			hport = hal_swif_lport_2_hport(j+1);
-			switch(dev->deviceId) {
-				case GT_88E6095:
-				/* DF=0, Multicast frames with unknown DAs do not egress from this port */
-			    if((status = gprtSetDefaultForward(dev, hport, GT_FALSE)) != GT_OK) {
-			        printf("Error: gprtSetDefaultForward failed\r\n");
-			        return status;
-			    }
-
-				case GT_88E6097:
-			    if((status = hwSetPortRegField(dev, hport, QD_REG_PORT_CONTROL, 2, 2, 0x1)) != GT_OK) {
-			        printf("Error: hwSetPortRegField failed\r\n");
-			        return status;
-			    }					
-				break;
-
-				default:
-				break;
-			}			
-		}
+		if((status = hal_swif_mcast_default_forward(hal_swif_lport_2_hport(j+1), (port_list_vec & (1<<j)) ? 1 : 0)) != GT_OK)
+			return status;
 	}
 #endif	
 
-	for(i=0; i<mcast_cfg.TotalRecordCount; i++) {
-		if(eeprom_read(NVRAM_MCAST_RECORD_CFG_BASE + i * sizeof(multicast_rec), (u8 *)&mcast_rec, sizeof(multicast_rec)) != I2C_SUCCESS) {
-			return CONF_ERR_I2C;
-		}
+	if(hal_swif_mcast_rec_read(McastRunRec, mcast_cfg.TotalRecordCount) != CONF_ERR_NONE) {
+		return CONF_ERR_I2C;
+	}
 
-		if((mcast_rec.Mac[0] & 0x1) != 1)
+	for(i=0; i<mcast_cfg.TotalRecordCount; i++) {
+		if((McastRunRec[i].Mac[0] & 0x1) != 1)
 			continue;
-		
-#if MULTI_CFG_OPTIMIZAION
-		port_list_vec = *(u32 *)&(mcast_rec.Member[0]);
-		port_list_vec = ntohl(port_list_vec);
-#else
-		port_list_vec = *(u16 *)&(mcast_rec.Member[0]);
-		port_list_vec = ntohs(port_list_vec);
-#endif		
-		hwport_vec = 0;
-		for(j=0; j<mcast_cfg.PortNum; j++) {
-			if(port_list_vec & (1<<j)) {
-				hport = hal_swif_lport_2_hport(j+1);
-				hwport_vec |= 1<<hport;
-			}
-		}
-		
-		memset(&macEntry,0,sizeof(GT_ATU_ENTRY));	
-		macEntry.macAddr.arEther[0] = mcast_rec.Mac[0];
-		macEntry.macAddr.arEther[1] = mcast_rec.Mac[1];
-		macEntry.macAddr.arEther[2] = mcast_rec.Mac[2];
-		macEntry.macAddr.arEther[3] = mcast_rec.Mac[3];
-		macEntry.macAddr.arEther[4] = mcast_rec.Mac[4];
-		macEntry.macAddr.arEther[5] = mcast_rec.Mac[5];	
-
-		macEntry.DBNum = 0;
-		macEntry.portVec = hwport_vec;
-		macEntry.prio = 0;
-		macEntry.entryState.mcEntryState = GT_MC_STATIC;
-
-		if((status = gfdbAddMacEntry(dev,&macEntry)) != GT_OK) {
+
+		if((status = hal_swif_mcast_atu_load(&McastRunRec[i], mcast_cfg.PortNum)) != GT_OK) {
 			printf("gfdbAddMacEntry return failed, ret=%d\r\n", status);
 			return CONF_ERR_MSAPI;
 		}
 	}
+
+	memcpy(&McastRunCfg, &mcast_cfg, sizeof(multicast_conf_t));
+	McastRunValid = 1;
 	
 	return CONF_ERR_NONE;
 #else
@@ -176,6 +222,109 @@ int hal_swif_mcast_conf_initialize(void)
 #endif
 }
 
+/**************************************************************************
+  * @brief  Apply the static multicast records in EEPROM to the running ATU.
+  *         Only groups which are added, removed or whose members changed,
+  *         and ports whose default forward changed are programmed. On a
+  *         failure the touched entries are restored in reverse order and
+  *         the running records are written back to EEPROM.
+  * @param  none
+  * @retval CONF_ERR_NONE, CONF_ERR_NO_CFG, CONF_ERR_I2C, CONF_ERR_MSAPI
+  *************************************************************************/
+int hal_swif_mcast_conf_apply(void)
+{
+#if SWITCH_CHIP_88E6095
+	multicast_conf_t new_cfg;
+	u8 journal[MAX_MCAST_RECORD_COUNT * 2];	/* running index, 0xFF: group was not running */
+	u8 journal_new[MAX_MCAST_RECORD_COUNT * 2];
+#if MULTI_CFG_OPTIMIZAION
+	u32 old_df, new_df, df_done;
+#endif
+	int count, i, j;
+
+	/* Nothing running from the configuration yet, program from scratch */
+	if(!McastRunValid)
+		return hal_swif_mcast_conf_initialize();
+
+	if(eeprom_read(NVRAM_MCAST_CFG_BASE, (u8 *)&new_cfg, sizeof(multicast_conf_t)) != I2C_SUCCESS)
+		return CONF_ERR_I2C;
+	if((new_cfg.PortNum == 0) || (new_cfg.PortNum > MAX_PORT_NUM) || (new_cfg.TotalRecordCount > MAX_MCAST_RECORD_COUNT))
+		return CONF_ERR_NO_CFG;
+	if(hal_swif_mcast_rec_read(McastNewRec, new_cfg.TotalRecordCount) != CONF_ERR_NONE)
+		return CONF_ERR_I2C;
+
+	count = 0;
+#if MULTI_CFG_OPTIMIZAION
+	df_done = 0;
+#endif
+
+	/* 1) Load the new and changed groups */
+	for(i=0; i<new_cfg.TotalRecordCount; i++) {
+		if((McastNewRec[i].Mac[0] & 0x1) != 1)
+			continue;
+		j = hal_swif_mcast_rec_find(McastRunRec, McastRunCfg.TotalRecordCount, McastNewRec[i].Mac);
+		if((j >= 0) && (hal_swif_mcast_rec_hwvec(&McastNewRec[i], new_cfg.PortNum) == hal_swif_mcast_rec_hwvec(&McastRunRec[j], McastRunCfg.PortNum)))
+			continue;
+		journal[count] = (j >= 0) ? (u8)j : 0xFF;
+		journal_new[count] = (u8)i;
+		count++;
+		if(hal_swif_mcast_atu_load(&McastNewRec[i], new_cfg.PortNum) != GT_OK)
+			goto Rollback;
+	}
+
+	/* 2) Purge the groups which are no longer configured */
+	for(j=0; j<McastRunCfg.TotalRecordCount; j++) {
+		if((McastRunRec[j].Mac[0] & 0x1) != 1)
+			continue;
+		if(hal_swif_mcast_rec_find(McastNewRec, new_cfg.TotalRecordCount, McastRunRec[j].Mac) >= 0)
+			continue;
+		journal[count] = (u8)j;
+		journal_new[count] = 0xFF;
+		count++;
+		if(hal_swif_mcast_atu_purge(&McastRunRec[j]) != GT_OK)
+			goto Rollback;
+	}
+
+#if MULTI_CFG_OPTIMIZAION
+	/* 3) Default forward of the ports which changed */
+	old_df = hal_swif_mcast_default_forward_vec(&McastRunCfg);
+	new_df = hal_swif_mcast_default_forward_vec(&new_cfg);
+	for(j=0; j<new_cfg.PortNum; j++) {
+		if((j < McastRunCfg.PortNum) && ((old_df ^ new_df) & (1<<j)) == 0)
+			continue;
+		df_done |= 1<<j;
+		if(hal_swif_mcast_default_forward(hal_swif_lport_2_hport(j+1), (new_df & (1<<j)) ? 1 : 0) != GT_OK)
+			goto Rollback;
+	}
+#endif
+
+	/* Commit */
+	memcpy(&McastRunCfg, &new_cfg, sizeof(multicast_conf_t));
+	memcpy(McastRunRec, McastNewRec, new_cfg.TotalRecordCount * sizeof(multicast_rec));
+	return CONF_ERR_NONE;
+
+Rollback:
+#if MULTI_CFG_OPTIMIZAION
+	for(j=new_cfg.PortNum-1; j>=0; j--) {
+		if(df_done & (1<<j))
+			hal_swif_mcast_default_forward(hal_swif_lport_2_hport(j+1), (old_df & (1<<j)) ? 1 : 0);
+	}
+#endif
+	while(count-- > 0) {
+		if(journal[count] == 0xFF)
+			hal_swif_mcast_atu_purge(&McastNewRec[journal_new[count]]);
+		else
+			hal_swif_mcast_atu_load(&McastRunRec[journal[count]], McastRunCfg.PortNum);
+	}
+	eeprom_page_write(NVRAM_MCAST_CFG_BASE, (u8 *)&McastRunCfg, sizeof(multicast_conf_t));
+	for(i=0; i<McastRunCfg.TotalRecordCount; i++)
+		eeprom_page_write(NVRAM_MCAST_RECORD_CFG_BASE + i * sizeof(multicast_rec), (u8 *)&McastRunRec[i], sizeof(multicast_rec));
+	return CONF_ERR_MSAPI;
+#else
+	return CONF_ERR_NOT_SUPPORT;
+#endif
+}
+
 
 #if MODULE_OBNMS
 
@@ -189,6 +338,7 @@ void nms_rsp_set_multicast(u8 *DMA, u8 *RequestID, obnet_set_multicast *pSetMcas
 	u16 RspLength;
 	multicast_conf_t mcast_cfg;
 	multicast_rec mcast_rec;
+	int ret;
 	multicast_rec *pMcastRec = (multicast_rec *)((u8 *)pSetMcast+sizeof(obnet_set_multicast));
 	
 	memset(NMS_TxBuffer, 0, MSG_MAXSIZE);
@@ -258,6 +408,18 @@ void nms_rsp_set_multicast(u8 *DMA, u8 *RequestID, obnet_set_multicast *pSetMcas
 			RspSet.RetCode = 0x00;
 			RspSet.Res = 0x00;
 		}
+
+		/* Last packet of the record set, apply it to the running switch */
+		if((((pSetMcast->OpCode & 0xC0) >> 6) == 0x0) || (((pSetMcast->OpCode & 0xC0) >> 6) == 0x2)) {
+			ret = hal_swif_mcast_conf_apply();
+			if(ret == CONF_ERR_I2C) {
+				RspSet.RetCode = 0x01;
+				RspSet.Res = RSP_ERR_EEPROM_OPERATION;
+			} else if((ret != CONF_ERR_NONE) && (ret != CONF_ERR_NO_CFG)) {
+				RspSet.RetCode = 0x01;
+				RspSet.Res = RSP_ERR_INVALID_CONFIGURATION;
+			}
+		}
 	}
 #else
 	RspSet.RetCode = 0x01;
@@ -63,6 +63,7 @@ typedef struct {
 	      Exported Functions
  ******************************************************************************************/
 int hal_swif_mcast_conf_initialize(void);
+int hal_swif_mcast_conf_apply(void);
 
 #if MODULE_OBNMS
 void nms_rsp_set_multicast(u8 *DMA, u8 *RequestID, obnet_set_multicast *pSetMcast);
@@ -19,6 +19,7 @@
 #include "stm32f2x7_smi.h"
 #include "soft_i2c.h"
 #include "misc_drv.h"
+#include "timer.h"
 #if ROBO_SWITCH
 #include "robo_drv.h"
 #elif MARVELL_SWITCH
@@ -42,6 +43,7 @@
 #include "hal_swif_types.h"
 #include "hal_swif_comm.h"
 #include "hal_swif_port.h"
+#include "hal_swif_rate_ctrl.h"
 #include "hal_swif_message.h"
 
 /* Other includes */
@@ -199,11 +201,13 @@ hal_port_map_t gHalPortMap[MAX_PORT_NUM] = {{1,10,S1000M_OPTICAL}, {2,8,S1000M_O
 
 hal_port_config_info_t gPortConfigInfo[MAX_PORT_NUM];
 hal_neighbor_record_t gNeighborInformation[MAX_PORT_NUM];
+extern OS_MUTEX_T NeighborInfoMutex;
 uint32 gTrafficEnableBitMap = 0;
 HAL_BOOL gPortConfigInitialized = HAL_FALSE;
 extern dev_base_info_t	DeviceBaseInfo;
 OS_MUTEX_T cnt_clr_mutex;
 uint32     clear_flag[MAX_PORT_NUM] = {0};
+hal_port_dampen_t gPortDampen[MAX_PORT_NUM];
 uint8	   disable_flag = 0;
 
 /**************************************************************************
@@ -410,6 +414,50 @@ int hal_swif_port_get_link_state(uint8 lport, HAL_PORT_LINK_STATE *link_state)
 	return HAL_SWIF_FAILURE;
 }
 
+/**************************************************************************
+  * @brief  run one link sample through the flap dampening of a port
+  * @param  lport, link_state read from the switch
+  * @retval link state to hand to the upper layers
+  *************************************************************************/
+HAL_PORT_LINK_STATE hal_swif_port_link_dampen(uint8 lport, HAL_PORT_LINK_STATE link_state)
+{
+	if((lport == 0) || (lport > MAX_PORT_NUM))
+		return link_state;
+
+	return hal_swif_dampen_update(&gPortDampen[lport-1], link_state, TimerGetMsTick());
+}
+
+/**************************************************************************
+  * @brief  check if a port is held down by flap dampening
+  * @param  lport
+  * @retval 1 if held down
+  *************************************************************************/
+int hal_swif_port_link_suppressed(uint8 lport)
+{
+	if((lport == 0) || (lport > MAX_PORT_NUM))
+		return 0;
+
+	return gPortDampen[lport-1].Suppressed;
+}
+
+/**************************************************************************
+  * @brief  get logic port link state as seen through flap dampening
+  * @param  lport
+  * @retval link_state
+  *************************************************************************/
+int hal_swif_port_get_dampened_link_state(uint8 lport, HAL_PORT_LINK_STATE *link_state)
+{
+	int ret;
+
+	if((ret = hal_swif_port_get_link_state(lport, link_state)) != HAL_SWIF_SUCCESS)
+		return ret;
+
+	if(hal_swif_port_link_suppressed(lport))
+		*link_state = LINK_DOWN;
+
+	return HAL_SWIF_SUCCESS;
+}
+
 /**************************************************************************
   * @brief  set logic port stp state
   * @param  lport
@@ -2636,10 +2684,12 @@ int hal_swif_port_show_traffic(void *pCliEnv)
 	hal_port_counters_t counters;
 	uint8	lport;
 	char TxRateStr[8], RxRateStr[8], TxThresholdStr[8], RxThresholdStr[8];
+	uint32 TxRate, RxRate;
+	hal_port_traffic_info_t *pInfo;
 	extern hal_trap_info_t gTrapInfo;
 	extern hal_port_traffic_info_t	gPortTrafficInfo[];
 	
-	if((gTrapInfo.GateMask & TRAP_MASK_TRAFFIC_OVER) == 0) {
+	if(((gTrapInfo.GateMask & TRAP_MASK_TRAFFIC_OVER) == 0) && (HAL_STORM_CTRL_ENABLE == 0)) {
 		cli_printf(pCliEnv, "Warning: traffic over trap is not enable!\r\n");
 		return 0;
 	}
@@ -2653,16 +2703,18 @@ int hal_swif_port_show_traffic(void *pCliEnv)
 	
 #if 1	
 	for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
+		pInfo = &gPortTrafficInfo[lport-1];
+		/* Medium window average, octets per second */
+		TxRate = pInfo->Rate[TRAFFIC_TX_OCTETS][TRAFFIC_WIN_MEDIUM] >> HAL_TRAFFIC_RATE_SHIFT;
+		RxRate = pInfo->Rate[TRAFFIC_RX_OCTETS][TRAFFIC_WIN_MEDIUM] >> HAL_TRAFFIC_RATE_SHIFT;
 		if(gPortConfigInfo[lport-1].TxThreshold < PERCENTAGE_100) {
-			sprintf(TxRateStr,"%2d.%02d", ((gPortTrafficInfo[lport-1].Interval_TxOctets/HAL_DEFAULT_TRAFFIC_INTERVAL)<<3)/1000000, 
-											(((gPortTrafficInfo[lport-1].Interval_TxOctets/HAL_DEFAULT_TRAFFIC_INTERVAL)<<3)%1000000)/10000);
+			sprintf(TxRateStr,"%2d.%02d", (TxRate<<3)/1000000, ((TxRate<<3)%1000000)/10000);
 		} else {
 			sprintf(TxRateStr,"%s"," --- ");
 		}
 			
 		if(gPortConfigInfo[lport-1].RxThreshold < PERCENTAGE_100) {
-			sprintf(RxRateStr,"%2d.%02d", ((gPortTrafficInfo[lport-1].Interval_RxOctets/HAL_DEFAULT_TRAFFIC_INTERVAL)<<3)/1000000, 
-											(((gPortTrafficInfo[lport-1].Interval_RxOctets/HAL_DEFAULT_TRAFFIC_INTERVAL)<<3)%1000000)/10000);			
+			sprintf(RxRateStr,"%2d.%02d", (RxRate<<3)/1000000, ((RxRate<<3)%1000000)/10000);
 		} else {
 			sprintf(RxRateStr,"%s"," --- ");
 		}
@@ -2693,9 +2745,48 @@ int hal_swif_port_show_traffic(void *pCliEnv)
 		cli_printf(pCliEnv, "   %02d  |  %9s    %7s    |  %9s    %7s   |\r\n", lport, TxRateStr, TxThresholdStr, RxRateStr, RxThresholdStr);		
 	}
 #endif
+
+	cli_printf(pCliEnv, "\r\n");
+	cli_printf(pCliEnv, "  Rx Broadcast + Multicast (pps) :\r\n");
+	cli_printf(pCliEnv, "  ==========================================================\r\n");
+	cli_printf(pCliEnv, "  Port |  %3d Sec     %3d Sec     %3d Sec  |  Storm   Count  |\r\n",
+				hal_swif_traffic_window_get(TRAFFIC_WIN_SHORT) * HAL_TRAFFIC_SAMPLE_INTERVAL,
+				hal_swif_traffic_window_get(TRAFFIC_WIN_MEDIUM) * HAL_TRAFFIC_SAMPLE_INTERVAL,
+				hal_swif_traffic_window_get(TRAFFIC_WIN_LONG) * HAL_TRAFFIC_SAMPLE_INTERVAL);
+	cli_printf(pCliEnv, "  ==========================================================\r\n");
+	for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
+		pInfo = &gPortTrafficInfo[lport-1];
+		cli_printf(pCliEnv, "   %02d  | %8u    %8u    %8u  | %7s  %6u  |\r\n", lport,
+					(pInfo->Rate[TRAFFIC_RX_BCAST][TRAFFIC_WIN_SHORT] + pInfo->Rate[TRAFFIC_RX_MCAST][TRAFFIC_WIN_SHORT]) >> HAL_TRAFFIC_RATE_SHIFT,
+					(pInfo->Rate[TRAFFIC_RX_BCAST][TRAFFIC_WIN_MEDIUM] + pInfo->Rate[TRAFFIC_RX_MCAST][TRAFFIC_WIN_MEDIUM]) >> HAL_TRAFFIC_RATE_SHIFT,
+					(pInfo->Rate[TRAFFIC_RX_BCAST][TRAFFIC_WIN_LONG] + pInfo->Rate[TRAFFIC_RX_MCAST][TRAFFIC_WIN_LONG]) >> HAL_TRAFFIC_RATE_SHIFT,
+					(HAL_STORM_CTRL_ENABLE == 0) ? "---" : (pInfo->StormState == STORM_LIMITED) ? "Limited" : "Normal",
+					pInfo->StormCount);
+	}
     return HAL_SWIF_SUCCESS;
 }
 
+int hal_swif_port_show_dampen(void *pCliEnv)
+{
+	uint8	lport;
+	hal_port_dampen_t *pDampen;
+
+	cli_printf(pCliEnv, "\r\n");
+	cli_printf(pCliEnv, "  Port link flap dampening (suppress %d, reuse %d, half-life %ds) :\r\n", 
+				HAL_DAMPEN_SUPPRESS, HAL_DAMPEN_REUSE, HAL_DAMPEN_HALF_LIFE);
+	cli_printf(pCliEnv, "  ==========================================================\r\n");
+	cli_printf(pCliEnv, "  Port |  State    Penalty   Held(s)  |  Flaps    Holds     |\r\n");
+	cli_printf(pCliEnv, "  ==========================================================\r\n");
+	for(lport=1; lport<=DeviceBaseInfo.PortNum; lport++) {
+		pDampen = &gPortDampen[lport-1];
+		cli_printf(pCliEnv, "   %02d  |  %-7s  %7d   %7d  |  %-8u %-8u  |\r\n", lport, 
+					(pDampen->Suppressed) ? "Held" : "Normal", pDampen->Penalty, 
+					(pDampen->Suppressed) ? pDampen->SuppressTime : 0, pDampen->FlapCount, pDampen->SuppressCount);
+	}
+
+	return HAL_SWIF_SUCCESS;
+}
+
 int hal_swif_port_show_frames(void *pCliEnv)
 {
 	hal_port_counters_t counters;
@@ -3306,7 +3397,9 @@ void nms_rsp_get_port_neighbor(u8 *DMA, u8 *RequestID, obnet_get_port_neighbor *
 		RspGetNeighbor.OpCode = 0x00;
 		RspGetNeighbor.RecordCount = TotalRecordCount;
 		memcpy(&NMS_TxBuffer[PAYLOAD_OFFSET], (u8 *)&RspGetNeighbor, sizeof(obnet_rsp_get_port_neighbor));
+		os_mutex_lock(&NeighborInfoMutex, OS_MUTEX_WAIT_FOREVER);
 		memcpy(&NMS_TxBuffer[PAYLOAD_OFFSET + sizeof(obnet_rsp_get_port_neighbor)], (u8 *)&(gNeighborInformation[0]), TotalRecordCount * sizeof(hal_neighbor_record_t));
+		os_mutex_unlock(&NeighborInfoMutex);
 		RspLength = PAYLOAD_OFFSET + sizeof(obnet_rsp_get_port_neighbor) + TotalRecordCount * sizeof(hal_neighbor_record_t);
 		if (RspLength < MSG_MINSIZE)
 			RspLength = MSG_MINSIZE;
@@ -3331,7 +3424,9 @@ void nms_rsp_get_port_neighbor(u8 *DMA, u8 *RequestID, obnet_get_port_neighbor *
 			RspGetNeighbor.RecordCount = 0x02;
 
 			memcpy(&NMS_TxBuffer[PAYLOAD_OFFSET], (u8 *)&RspGetNeighbor, sizeof(obnet_rsp_get_port_neighbor));
+			os_mutex_lock(&NeighborInfoMutex, OS_MUTEX_WAIT_FOREVER);
 			memcpy(&NMS_TxBuffer[PAYLOAD_OFFSET + sizeof(obnet_rsp_get_port_neighbor)], (u8 *)&(gNeighborInformation[TotalRecordCount - NMS_GetNeighborState.RemainCount]), 2 * sizeof(hal_neighbor_record_t));
+			os_mutex_unlock(&NeighborInfoMutex);
 			RspLength = PAYLOAD_OFFSET + sizeof(obnet_rsp_get_port_neighbor) + 2 * sizeof(hal_neighbor_record_t);
 			if (RspLength < MSG_MINSIZE)
 				RspLength = MSG_MINSIZE;
@@ -3351,7 +3446,9 @@ void nms_rsp_get_port_neighbor(u8 *DMA, u8 *RequestID, obnet_get_port_neighbor *
 			RspGetNeighbor.RecordCount = NMS_GetNeighborState.RemainCount;
 
 			memcpy(&NMS_TxBuffer[PAYLOAD_OFFSET], (u8 *)&RspGetNeighbor, sizeof(obnet_rsp_get_port_neighbor));
+			os_mutex_lock(&NeighborInfoMutex, OS_MUTEX_WAIT_FOREVER);
 			memcpy(&NMS_TxBuffer[PAYLOAD_OFFSET + sizeof(obnet_rsp_get_port_neighbor)], (u8 *)&(gNeighborInformation[TotalRecordCount - NMS_GetNeighborState.RemainCount]), NMS_GetNeighborState.RemainCount * sizeof(hal_neighbor_record_t));
+			os_mutex_unlock(&NeighborInfoMutex);
 			RspLength = PAYLOAD_OFFSET + sizeof(obnet_rsp_get_port_neighbor) + NMS_GetNeighborState.RemainCount * sizeof(hal_neighbor_record_t);
 			if (RspLength < MSG_MINSIZE)
 				RspLength = MSG_MINSIZE;
@@ -238,18 +238,87 @@ typedef struct {
 	HAL_PERCENTAGE_E		RxThreshold;
 } hal_port_config_info_t;
 
-#define HAL_DEFAULT_TRAFFIC_INTERVAL	5	/* 5 Second */
+#define HAL_DEFAULT_TRAFFIC_INTERVAL	5	/* 5 Second, traffic over trap repeat interval */
+#define HAL_TRAFFIC_SAMPLE_INTERVAL		1	/* 1 Second, counters sample interval */
+#define HAL_TRAFFIC_RATE_SHIFT			4	/* Fraction bits of the averaged rates */
+#define HAL_TRAFFIC_HYSTERESIS			8	/* Over state is left below threshold - threshold/8 */
+#define HAL_TRAFFIC_STATUS_STORM		0x2000	/* Traffic trap port status: broadcast/multicast ingress limited */
+
+typedef enum {
+	TRAFFIC_RX_OCTETS = 0,
+	TRAFFIC_TX_OCTETS,
+	TRAFFIC_RX_UCAST,
+	TRAFFIC_RX_MCAST,
+	TRAFFIC_RX_BCAST,
+	TRAFFIC_TX_UCAST,
+	TRAFFIC_TX_MCAST,
+	TRAFFIC_TX_BCAST,
+	TRAFFIC_METRIC_NUM
+} HAL_TRAFFIC_METRIC;
+
+/* Moving average windows, length in samples. The defaults may be set in
+   mconfig.h, "config traffic-window" changes them at run time */
+#ifndef HAL_TRAFFIC_WIN_SHORT
+#define HAL_TRAFFIC_WIN_SHORT			1
+#endif
+#ifndef HAL_TRAFFIC_WIN_MEDIUM
+#define HAL_TRAFFIC_WIN_MEDIUM			10
+#endif
+#ifndef HAL_TRAFFIC_WIN_LONG
+#define HAL_TRAFFIC_WIN_LONG			60
+#endif
+
+typedef enum {
+	TRAFFIC_WIN_SHORT = 0,			/* Storm detection */
+	TRAFFIC_WIN_MEDIUM,				/* Traffic over trap, storm release */
+	TRAFFIC_WIN_LONG,
+	TRAFFIC_WIN_NUM
+} HAL_TRAFFIC_WINDOW;
+
 typedef struct {
 	uint8	PortNo;
 	uint8	Interval;
-	uint32	Threshold_TxOctets;
-	uint32	Threshold_RxOctets;
-	uint32	PrevTxOctets;
-	uint32	PrevRxOctets;
-	uint32	Interval_TxOctets;
-	uint32	Interval_RxOctets;
+	uint8	SampleState;		/* 0: no sample, 1: previous counters valid, 2: rates valid */
+	uint8	TxOver;
+	uint8	RxOver;
+	uint8	StormState;
+	uint8	StormSamples;
+	uint16	StormHold;
+	uint16	StormHoldTime;
+	uint16	StormQuiet;
+	uint32	StormCount;
+	uint32	Threshold_TxOctets;	/* Octets per second */
+	uint32	Threshold_RxOctets;	/* Octets per second */
+	uint32	PrevTick;
+	uint32	Prev[TRAFFIC_METRIC_NUM];
+	uint64	Total[TRAFFIC_METRIC_NUM];
+	uint32	Rate[TRAFFIC_METRIC_NUM][TRAFFIC_WIN_NUM];	/* Per second, HAL_TRAFFIC_RATE_SHIFT fraction bits */
 } hal_port_traffic_info_t;
 
+/* Link flap dampening, a down adds HAL_DAMPEN_PENALTY which halves every HAL_DAMPEN_HALF_LIFE */
+#define HAL_DAMPEN_PENALTY			1000	/* Added on every link down */
+#define HAL_DAMPEN_SUPPRESS			2000	/* Port is held down at or above this penalty */
+#define HAL_DAMPEN_REUSE			750		/* Held port is released below this penalty */
+#define HAL_DAMPEN_HALF_LIFE		15		/* Second */
+#define HAL_DAMPEN_DECAY			978		/* 2^(-1/HAL_DAMPEN_HALF_LIFE) per second, Q10 */
+#define HAL_DAMPEN_MAX_SUPPRESS		60		/* Second, longest hold once the flapping stops */
+#define HAL_DAMPEN_PENALTY_MAX		(HAL_DAMPEN_REUSE << (HAL_DAMPEN_MAX_SUPPRESS / HAL_DAMPEN_HALF_LIFE))
+
+/* NMS port status bit, link is held down by flap dampening */
+#define PORT_STATUS_DAMPENED		0x04
+
+typedef struct {
+	uint8				Valid;
+	uint8				Suppressed;
+	HAL_PORT_LINK_STATE	RawState;
+	uint16				Penalty;
+	uint16				SuppressTime;	/* Second */
+	uint32				DecayMs;
+	uint32				LastTick;
+	uint32				FlapCount;
+	uint32				SuppressCount;
+} hal_port_dampen_t;
+
 /************************* Struct for OBNet NMS message **********************************/
 #if MODULE_OBNMS
 
@@ -344,12 +413,22 @@ int	hal_swif_port_clear_counters(uint8 lport);
 int cnt_clr_mutex_init(void);
 int hal_swif_port_get_clear_counters_flag(uint8 lport);
 int hal_swif_port_clear_counters_flag(uint8 lport);
+HAL_PORT_LINK_STATE hal_swif_port_link_dampen(uint8 lport, HAL_PORT_LINK_STATE link_state);
+int hal_swif_port_link_suppressed(uint8 lport);
+int hal_swif_port_get_dampened_link_state(uint8 lport, HAL_PORT_LINK_STATE *link_state);
+HAL_PORT_LINK_STATE hal_swif_dampen_update(hal_port_dampen_t *pDampen, HAL_PORT_LINK_STATE link_state, uint32 tick);
+int hal_swif_traffic_window_set(uint8 win, uint8 samples);
+uint8 hal_swif_traffic_window_get(uint8 win);
+void hal_swif_traffic_update(hal_port_traffic_info_t *pInfo, hal_port_counters_t *counter, uint32 elapsed);
+uint8 hal_swif_traffic_over(uint8 *pOver, uint32 rate, uint32 threshold);
+uint8 hal_swif_storm_check(uint8 lport, hal_port_traffic_info_t *pInfo);
 
 /* For CLI */
 int hal_swif_port_show_status(void *pCliEnv);
 int hal_swif_port_show_config(void *pCliEnv);
 int hal_swif_port_show_neigbor(void *pCliEnv);
 int hal_swif_port_show_traffic(void *pCliEnv);
+int hal_swif_port_show_dampen(void *pCliEnv);
 int hal_swif_port_show_counters(void *pCliEnv, uint8 lport);
 
 /* Configuration */
@@ -46,6 +46,15 @@
 extern GT_QD_DEV *dev;
 #endif
 
+#if HAL_STORM_CTRL_ENABLE
+/* Ports with an ingress limit from configuration, storm suppression keeps off them */
+static uint8 IngressLimitConfigured[MAX_PORT_NUM];
+/* Ingress limiter as it was before the storm limit, put back on release */
+static uint8 StormLimited[MAX_PORT_NUM];
+static GT_RATE_LIMIT_MODE StormSavedMode[MAX_PORT_NUM];
+static GT_PRI0_RATE StormSavedRate[MAX_PORT_NUM];
+#endif
+
 /**************************************************************************
   * @brief  set logic port ingress rate
   * @param  lport
@@ -68,6 +77,16 @@ int hal_swif_set_ingress_rate
 		return HAL_SWIF_ERR_INVALID_LPORT;
 	hport = hal_swif_lport_2_hport(lport);
 
+#if HAL_STORM_CTRL_ENABLE
+	/* A new setting during a storm limit is what the release puts back */
+	if(StormLimited[lport-1]) {
+		if(ingress_rate == RATE_NO_LIMIT)
+			StormSavedRate[lport-1] = GT_NO_LIMIT;
+		else
+			StormLimited[lport-1] = 0;
+	}
+#endif
+
 	if(ingress_rate != RATE_NO_LIMIT) {
 	    if((status = grcSetLimitMode(dev, hport, frame_type)) != GT_OK) {
 	        return HAL_SWIF_ERR_MSAPI;
@@ -153,6 +172,9 @@ int hal_swif_rate_ctrl_conf_initialize(void)
 		pri1_mode = (HAL_BOOL)((single_port_rate_cfg & RATE_CTRL_MASK_INGRESS_PRI1_RATE) >> 11);
 		pri0_rate = (HAL_INGRESS_RATE)((single_port_rate_cfg & RATE_CTRL_MASK_INGRESS_PRI0_RATE) >> 8);
 		egress_rate = (HAL_EGRESS_RATE)(single_port_rate_cfg & RATE_CTRL_MASK_EGRESS_RATE);
+#if HAL_STORM_CTRL_ENABLE
+		IngressLimitConfigured[lport-1] = (pri0_rate != RATE_NO_LIMIT) ? 1 : 0;
+#endif
 
 		if(hal_swif_set_ingress_rate(lport, rate_limit_mode, pri0_rate, pri1_mode, pri2_mode, pri3_mode) != HAL_SWIF_SUCCESS)
 			return CONF_ERR_SWITCH_HAL;
@@ -166,6 +188,9 @@ int hal_swif_rate_ctrl_conf_initialize(void)
 		ingress_limit_enable = (HAL_BOOL)((single_port_rate_cfg & RATE_CTRL_MASK_INGRESS_ENBALE) >> 13);
 		egress_limit_enable = (HAL_BOOL)((single_port_rate_cfg & RATE_CTRL_MASK_EGRESS_ENABLE) >> 12);
 
+#if HAL_STORM_CTRL_ENABLE
+		IngressLimitConfigured[lport-1] = ((ingress_limit_enable) && (ingress_rate != RATE_NO_LIMIT)) ? 1 : 0;
+#endif
 		if(ingress_limit_enable) {
 			if(hal_swif_set_ingress_rate(lport, rate_limit_mode, ingress_rate, HAL_FALSE, HAL_FALSE, HAL_FALSE) != HAL_SWIF_SUCCESS)
 				return CONF_ERR_SWITCH_HAL;
@@ -184,6 +209,52 @@ int hal_swif_rate_ctrl_conf_initialize(void)
 #endif
 }
 
+/**************************************************************************
+  * @brief  apply or release the broadcast/multicast storm ingress limit
+  * @param  lport, enable
+  * @retval HAL_SWIF_FAILURE if the port has a configured ingress limit
+  * @note   release restores the limit mode and rate saved on apply
+  *************************************************************************/
+int hal_swif_storm_ctrl_set(uint8 lport, HAL_BOOL enable)
+{
+#if HAL_STORM_CTRL_ENABLE
+	GT_U32 hport;
+
+	if((lport == 0) || (lport > MAX_PORT_NUM))
+		return HAL_SWIF_ERR_INVALID_LPORT;
+	if(IngressLimitConfigured[lport-1])
+		return HAL_SWIF_FAILURE;
+	hport = hal_swif_lport_2_hport(lport);
+
+	if(enable == HAL_TRUE) {
+		if(StormLimited[lport-1])
+			return HAL_SWIF_SUCCESS;
+		if(grcGetLimitMode(dev, hport, &StormSavedMode[lport-1]) != GT_OK)
+			return HAL_SWIF_ERR_MSAPI;
+		if(grcGetPri0Rate(dev, hport, &StormSavedRate[lport-1]) != GT_OK)
+			return HAL_SWIF_ERR_MSAPI;
+		if(grcSetLimitMode(dev, hport, FRAME_BRDCST_MLTCST) != GT_OK)
+			return HAL_SWIF_ERR_MSAPI;
+		if(grcSetPri0Rate(dev, hport, HAL_STORM_LIMIT_RATE) != GT_OK)
+			return HAL_SWIF_ERR_MSAPI;
+		StormLimited[lport-1] = 1;
+	} else {
+		/* Cleared when the configuration replaced the limit meanwhile */
+		if(StormLimited[lport-1] == 0)
+			return HAL_SWIF_SUCCESS;
+		if(grcSetPri0Rate(dev, hport, StormSavedRate[lport-1]) != GT_OK)
+			return HAL_SWIF_ERR_MSAPI;
+		if(grcSetLimitMode(dev, hport, StormSavedMode[lport-1]) != GT_OK)
+			return HAL_SWIF_ERR_MSAPI;
+		StormLimited[lport-1] = 0;
+	}
+
+	return HAL_SWIF_SUCCESS;
+#else
+	return HAL_SWIF_FAILURE;
+#endif
+}
+
 #if MODULE_OBNMS
 
 extern u8 NMS_TxBuffer[];
@@ -64,6 +64,27 @@ typedef struct {
 	uint8	RateCtrlConfig[MAX_PORT_NUM * 2];
 } hal_rate_conf_t;
 
+/******************************************************************************************
+	      Broadcast/Multicast Storm Suppression
+ ******************************************************************************************/
+#if ((BOARD_FEATURE & L2_PORT_RATE_CTRL) && SWITCH_CHIP_88E6095)
+#define HAL_STORM_CTRL_ENABLE		1
+#else
+#define HAL_STORM_CTRL_ENABLE		0
+#endif
+
+#define HAL_STORM_ON_PPS			10000		/* Rx broadcast + multicast, 1 second window */
+#define HAL_STORM_ON_SAMPLES		2			/* Consecutive samples over HAL_STORM_ON_PPS */
+#define HAL_STORM_OFF_PPS			1000		/* Rx broadcast + multicast, 10 second window */
+#define HAL_STORM_HOLD_MIN			10			/* Second, shortest time a limit is held */
+#define HAL_STORM_HOLD_MAX			320			/* Second, hold time cap for a returning storm */
+#define HAL_STORM_LIMIT_RATE		RATE_8M
+
+typedef enum {
+	STORM_IDLE = 0,
+	STORM_LIMITED
+} HAL_STORM_STATE;
+
 /************************* Struct for OBNet NMS message **********************************/
 #if MODULE_OBNMS
 
@@ -82,6 +103,7 @@ typedef struct {
 int hal_swif_set_ingress_rate(uint8 lport, HAL_INGRESS_FRAME_TYPE frame_type, HAL_INGRESS_RATE ingress_rate, HAL_BOOL pri1_mode, HAL_BOOL pri2_mode, HAL_BOOL pri3_mode);
 int hal_swif_set_egress_rate(uint8 lport, HAL_EGRESS_RATE egress_rate);
 int hal_swif_rate_ctrl_conf_initialize(void);
+int hal_swif_storm_ctrl_set(uint8 lport, HAL_BOOL enable);
 
 #if MODULE_OBNMS
 void nms_rsp_set_rate_ctrl(u8 *DMA, u8 *RequestID, obnet_set_rate_ctrl * pRateCtrl);
@@ -0,0 +1,177 @@
+/*******************************************************************
+ * Filename     : hal_swif_traffic.c
+ * Description  : Port traffic averages, traffic over and storm state,
+ *                fed one counters sample at a time by the traffic task
+ * Copyright    : OB Telecom Electronics Co.
+ *******************************************************************/
+#include "mconfig.h"
+
+/* BSP includes */
+#include "stm32f2xx.h"
+
+/* HAL for L2 includes */
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_port.h"
+#include "hal_swif_rate_ctrl.h"
+
+/* Length in samples of each moving average window */
+static uint8 TrafficWindow[TRAFFIC_WIN_NUM] = {HAL_TRAFFIC_WIN_SHORT, HAL_TRAFFIC_WIN_MEDIUM, HAL_TRAFFIC_WIN_LONG};
+
+/**************************************************************************
+  * @brief  set the length of one moving average window
+  * @param  win: HAL_TRAFFIC_WINDOW, samples: 1 ~ 255
+  * @retval HAL_SWIF_SUCCESS
+  *************************************************************************/
+int hal_swif_traffic_window_set(uint8 win, uint8 samples)
+{
+	if((win >= TRAFFIC_WIN_NUM) || (samples == 0))
+		return HAL_SWIF_FAILURE;
+
+	TrafficWindow[win] = samples;
+	return HAL_SWIF_SUCCESS;
+}
+
+uint8 hal_swif_traffic_window_get(uint8 win)
+{
+	if(win >= TRAFFIC_WIN_NUM)
+		return 0;
+
+	return TrafficWindow[win];
+}
+
+/**************************************************************************
+  * @brief  fold one counters sample into the port totals and averages
+  * @param  pInfo, counter, elapsed ms since the previous sample
+  * @retval none
+  *************************************************************************/
+void hal_swif_traffic_update(hal_port_traffic_info_t *pInfo, hal_port_counters_t *counter, uint32 elapsed)
+{
+	uint32 curr[TRAFFIC_METRIC_NUM];
+	uint32 delta, rate;
+	uint32 *pRate;
+	int m, w;
+
+	curr[TRAFFIC_RX_OCTETS] = counter->RxGoodOctetsLo;
+	curr[TRAFFIC_TX_OCTETS] = counter->TxOctetsLo;
+	curr[TRAFFIC_RX_UCAST] = counter->RxUnicastPkts;
+	curr[TRAFFIC_RX_MCAST] = counter->RxMulticastPkts;
+	curr[TRAFFIC_RX_BCAST] = counter->RxBroadcastPkts;
+	curr[TRAFFIC_TX_UCAST] = counter->TxUnicastPkts;
+	curr[TRAFFIC_TX_MCAST] = counter->TxMulticastPkts;
+	curr[TRAFFIC_TX_BCAST] = counter->TxBroadcastPkts;
+
+	if(pInfo->SampleState == 0) {
+		for(m=0; m<TRAFFIC_METRIC_NUM; m++)
+			pInfo->Prev[m] = curr[m];
+		pInfo->SampleState = 1;
+		return;
+	}
+
+	if(elapsed == 0)
+		elapsed = 1;
+
+	for(m=0; m<TRAFFIC_METRIC_NUM; m++) {
+		/* Unsigned difference stays exact across one 32-bit counter wrap */
+		delta = curr[m] - pInfo->Prev[m];
+		pInfo->Prev[m] = curr[m];
+		u64_ADD32(pInfo->Total[m], delta);
+
+		rate = (delta / elapsed) * 1000 + ((delta % elapsed) * 1000) / elapsed;
+		if(rate > (0xFFFFFFFF >> HAL_TRAFFIC_RATE_SHIFT))
+			rate = 0xFFFFFFFF >> HAL_TRAFFIC_RATE_SHIFT;
+		rate <<= HAL_TRAFFIC_RATE_SHIFT;
+
+		/* R += (S - R) / N, the first rate seeds every window */
+		pRate = pInfo->Rate[m];
+		for(w=0; w<TRAFFIC_WIN_NUM; w++) {
+			if((pInfo->SampleState == 1) || (TrafficWindow[w] <= 1))
+				pRate[w] = rate;
+			else if(rate >= pRate[w])
+				pRate[w] += (rate - pRate[w]) / TrafficWindow[w];
+			else
+				pRate[w] -= (pRate[w] - rate) / TrafficWindow[w];
+		}
+	}
+	pInfo->SampleState = 2;
+}
+
+/**************************************************************************
+  * @brief  threshold check with hysteresis on the way down
+  * @param  pOver, rate, threshold
+  * @retval 1 if over
+  *************************************************************************/
+uint8 hal_swif_traffic_over(uint8 *pOver, uint32 rate, uint32 threshold)
+{
+	if(*pOver) {
+		if(rate < threshold - threshold / HAL_TRAFFIC_HYSTERESIS)
+			*pOver = 0;
+	} else if(rate >= threshold) {
+		*pOver = 1;
+	}
+
+	return *pOver;
+}
+
+#if HAL_STORM_CTRL_ENABLE
+/**************************************************************************
+  * @brief  broadcast/multicast storm detection and suppression, 1 call/sample
+  * @param  lport, pInfo
+  * @retval 1 if the limit was applied or released
+  *************************************************************************/
+uint8 hal_swif_storm_check(uint8 lport, hal_port_traffic_info_t *pInfo)
+{
+	uint32 fast, slow;
+
+	fast = (pInfo->Rate[TRAFFIC_RX_BCAST][TRAFFIC_WIN_SHORT] + pInfo->Rate[TRAFFIC_RX_MCAST][TRAFFIC_WIN_SHORT]) >> HAL_TRAFFIC_RATE_SHIFT;
+	slow = (pInfo->Rate[TRAFFIC_RX_BCAST][TRAFFIC_WIN_MEDIUM] + pInfo->Rate[TRAFFIC_RX_MCAST][TRAFFIC_WIN_MEDIUM]) >> HAL_TRAFFIC_RATE_SHIFT;
+
+	switch(pInfo->StormState) {
+		case STORM_IDLE:
+		if(pInfo->StormQuiet < HAL_STORM_HOLD_MAX)
+			pInfo->StormQuiet++;
+		if(fast < HAL_STORM_ON_PPS) {
+			pInfo->StormSamples = 0;
+			break;
+		}
+		if(++pInfo->StormSamples < HAL_STORM_ON_SAMPLES)
+			break;
+		pInfo->StormSamples = 0;
+
+		/* A storm back within the last hold time is held twice as long */
+		if(pInfo->StormQuiet < pInfo->StormHoldTime) {
+			pInfo->StormHoldTime <<= 1;
+			if(pInfo->StormHoldTime > HAL_STORM_HOLD_MAX)
+				pInfo->StormHoldTime = HAL_STORM_HOLD_MAX;
+		} else {
+			pInfo->StormHoldTime = HAL_STORM_HOLD_MIN;
+		}
+
+		if(hal_swif_storm_ctrl_set(lport, HAL_TRUE) != HAL_SWIF_SUCCESS)
+			break;
+		pInfo->StormState = STORM_LIMITED;
+		pInfo->StormHold = pInfo->StormHoldTime;
+		pInfo->StormCount++;
+		return 1;
+
+		case STORM_LIMITED:
+		if(pInfo->StormHold > 0) {
+			pInfo->StormHold--;
+			break;
+		}
+		if(slow >= HAL_STORM_OFF_PPS)
+			break;
+		if(hal_swif_storm_ctrl_set(lport, HAL_FALSE) != HAL_SWIF_SUCCESS)
+			break;
+		pInfo->StormState = STORM_IDLE;
+		pInfo->StormQuiet = 0;
+		return 1;
+
+		default:
+		pInfo->StormState = STORM_IDLE;
+		break;
+	}
+
+	return 0;
+}
+#endif
@@ -0,0 +1,105 @@
+/*******************************************************************
+ * Filename     : hal_swif_trapq.c
+ * Description  : Trap queue bookkeeping, coalescing and retransmit
+ *                timing. Locking and the messages stay with the caller.
+ * Copyright    : OB Telecom Electronics Co.
+ *******************************************************************/
+#include <string.h>
+
+#include "hal_swif_trapq.h"
+
+void hal_trapq_init(hal_trapq_t *pQueue)
+{
+	memset(pQueue, 0, sizeof(hal_trapq_t));
+}
+
+/**************************************************************************
+  * @brief  Take a slot for a new trap. A pending trap of the same index is
+  *         replaced in its slot, so an ack for the stale one is ignored.
+  * @param  pQueue, TrapIndex, RequestID of the new trap, Now in ticks
+  * @retval slot number, or -1 when the queue is full
+  *************************************************************************/
+int hal_trapq_post(hal_trapq_t *pQueue, uint8 TrapIndex, uint16 RequestID, uint32 Now)
+{
+	hal_trapq_entry_t *pEntry;
+	int i, Slot = -1;
+
+	for(i=0; i<HAL_TRAP_QUEUE_SIZE; i++) {
+		pEntry = &pQueue->Entry[i];
+		if(pEntry->Used) {
+			if(pEntry->TrapIndex == TrapIndex) {
+				Slot = i;
+				pQueue->Stats.Coalesced++;
+				break;
+			}
+		} else if(Slot < 0) {
+			Slot = i;
+		}
+	}
+
+	if(Slot < 0) {
+		pQueue->Stats.Overflow++;
+		return -1;
+	}
+
+	pEntry = &pQueue->Entry[Slot];
+	pEntry->Used = HAL_TRUE;
+	pEntry->TrapIndex = TrapIndex;
+	pEntry->Retries = 0;
+	pEntry->RequestID = RequestID;
+	pEntry->NextTx = Now;
+	pQueue->Stats.Posted++;
+
+	return Slot;
+}
+
+/**************************************************************************
+  * @brief  Drop the entry the NMS answered
+  * @param  pQueue, TrapIndex, RequestID of the response
+  * @retval 1 if a pending entry matched, 0 otherwise
+  *************************************************************************/
+int hal_trapq_ack(hal_trapq_t *pQueue, uint8 TrapIndex, uint16 RequestID)
+{
+	hal_trapq_entry_t *pEntry;
+	int i;
+
+	for(i=0; i<HAL_TRAP_QUEUE_SIZE; i++) {
+		pEntry = &pQueue->Entry[i];
+		if(pEntry->Used && (pEntry->TrapIndex == TrapIndex) && (pEntry->RequestID == RequestID)) {
+			pEntry->Used = HAL_FALSE;
+			pQueue->Stats.Acked++;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**************************************************************************
+  * @brief  Check one slot against the clock, each entry keeps its own
+  *         retransmit timer and is given up after HAL_TRAP_RETRY_MAX resends
+  * @param  pQueue, Slot, Now and RetryTicks in ticks
+  * @retval HAL_TRAPQ_IDLE, HAL_TRAPQ_SEND or HAL_TRAPQ_EXPIRED
+  *************************************************************************/
+int hal_trapq_poll(hal_trapq_t *pQueue, int Slot, uint32 Now, uint32 RetryTicks)
+{
+	hal_trapq_entry_t *pEntry = &pQueue->Entry[Slot];
+
+	if(!pEntry->Used || ((int32)(Now - pEntry->NextTx) < 0))
+		return HAL_TRAPQ_IDLE;
+
+	if(pEntry->Retries > HAL_TRAP_RETRY_MAX) {
+		pEntry->Used = HAL_FALSE;
+		pQueue->Stats.Expired++;
+		return HAL_TRAPQ_EXPIRED;
+	}
+
+	if(pEntry->Retries == 0)
+		pQueue->Stats.Sent++;
+	else
+		pQueue->Stats.Retransmitted++;
+	pEntry->Retries++;
+	pEntry->NextTx = Now + RetryTicks;
+
+	return HAL_TRAPQ_SEND;
+}
@@ -0,0 +1,49 @@
+#ifndef _HAL_SWIF_TRAPQ_H_
+#define _HAL_SWIF_TRAPQ_H_
+
+#include "hal_swif_types.h"
+
+/* Trap queue: one pending entry per trap index, a newer trap of the same
+   index replaces the queued one. Entries are resent until the NMS answers. */
+#define HAL_TRAP_QUEUE_SIZE			8
+#define HAL_TRAP_RETRY_INTERVAL		1000	/* ms */
+#define HAL_TRAP_RETRY_MAX			30
+#define HAL_TRAP_POLL_INTERVAL		100		/* ms */
+
+/* hal_trapq_poll results */
+#define HAL_TRAPQ_IDLE				0		/* Empty slot or not due yet */
+#define HAL_TRAPQ_SEND				1		/* Transmit the slot now */
+#define HAL_TRAPQ_EXPIRED			2		/* Given up, slot is free again */
+
+typedef struct {
+	uint32	Posted;
+	uint32	Coalesced;		/* Replaced a pending trap of the same index */
+	uint32	Sent;
+	uint32	Retransmitted;
+	uint32	Acked;
+	uint32	Overflow;		/* Queue full, trap dropped */
+	uint32	Expired;		/* No response after HAL_TRAP_RETRY_MAX resends */
+} hal_trap_stats_t;
+
+typedef struct {
+	HAL_BOOL	Used;
+	uint8		TrapIndex;
+	uint8		Retries;		/* Transmissions done so far */
+	uint16		RequestID;
+	uint32		NextTx;			/* Tick of the next transmission */
+} hal_trapq_entry_t;
+
+typedef struct {
+	hal_trapq_entry_t	Entry[HAL_TRAP_QUEUE_SIZE];
+	hal_trap_stats_t	Stats;
+} hal_trapq_t;
+
+/*********************************************************************
+		Exported Functions
+ *********************************************************************/
+void hal_trapq_init(hal_trapq_t *pQueue);
+int hal_trapq_post(hal_trapq_t *pQueue, uint8 TrapIndex, uint16 RequestID, uint32 Now);
+int hal_trapq_ack(hal_trapq_t *pQueue, uint8 TrapIndex, uint16 RequestID);
+int hal_trapq_poll(hal_trapq_t *pQueue, int Slot, uint32 Now, uint32 RetryTicks);
+
+#endif	/* _HAL_SWIF_TRAPQ_H_ */
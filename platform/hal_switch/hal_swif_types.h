@@ -22,6 +22,7 @@
 #define COMPILER_INT64		struct { int u64_w[2]; }
 #define u64_H(v)			((v).u64_w[1])
 #define u64_L(v)			((v).u64_w[0])
+#define u64_ADD32(v, d)		do { u64_L(v) += (d); if(u64_L(v) < (d)) u64_H(v)++; } while(0)
 
 typedef signed char			int8;
 typedef signed short		int16;
@@ -456,6 +456,60 @@ int hal_swif_pvid_conf_initialize(void)
 #endif
 }
 
+#if SWITCH_CHIP_88E6095
+/* Running image of the VTU, the base of the differential apply */
+static hal_8021q_vlan_conf_t VlanRunCfg;
+static hal_8021q_vlan_record_t VlanRunRec[MAX_8021Q_VLAN_RECORD_COUNT];
+static hal_8021q_vlan_record_t VlanNewRec[MAX_8021Q_VLAN_RECORD_COUNT];
+static u8 VlanRunValid = 0;
+
+/**************************************************************************
+  * @brief  Load one vlan record into VTU, an existing vid is overwritten
+  * @param  rec, port_num
+  * @retval HAL_SWIF_SUCCESS or HAL_SWIF_FAILURE
+  *************************************************************************/
+static int hal_swif_vtu_load(const hal_8021q_vlan_record_t *rec, u8 port_num)
+{
+	GT_VTU_ENTRY vtuEntry;
+	GT_U8 hport;
+	int j;
+
+	gtMemSet(&vtuEntry,0,sizeof(GT_VTU_ENTRY));
+	vtuEntry.DBNum = 0;
+	vtuEntry.vid = hal_swif_vlan_rec_vid(rec);
+	for(j=0; j<port_num; j++) {
+		hport = hal_swif_lport_2_hport(j+1);
+		vtuEntry.vtuData.memberTagP[hport] = hal_swif_vlan_rec_member(rec, j);
+	}
+	vtuEntry.vtuData.memberTagP[dev->cpuPortNum] = MEMBER_EGRESS_UNTAGGED;
+
+	return (gvtuAddEntry(dev,&vtuEntry) == GT_OK) ? HAL_SWIF_SUCCESS : HAL_SWIF_FAILURE;
+}
+
+static int hal_swif_vtu_purge(u16 vid)
+{
+	GT_VTU_ENTRY vtuEntry;
+
+	gtMemSet(&vtuEntry,0,sizeof(GT_VTU_ENTRY));
+	vtuEntry.DBNum = 0;
+	vtuEntry.vid = vid;
+
+	return (gvtuDelEntry(dev,&vtuEntry) == GT_OK) ? HAL_SWIF_SUCCESS : HAL_SWIF_FAILURE;
+}
+
+/* eeprom_read() length is 8 bits, so records are accessed one by one */
+static int hal_swif_vlan_rec_read(hal_8021q_vlan_record_t *rec, int count)
+{
+	int i;
+
+	for(i=0; i<count; i++) {
+		if(eeprom_read(NVRAM_VLAN_RECORD_CFG_BASE + i * sizeof(hal_8021q_vlan_record_t), (u8 *)&rec[i], sizeof(hal_8021q_vlan_record_t)) != I2C_SUCCESS)
+			return CONF_ERR_I2C;
+	}
+	return CONF_ERR_NONE;
+}
+#endif
+
 /**************************************************************************
   * @brief  Initialize configuration for 8021.q VLAN
   * @param  none
@@ -465,14 +519,10 @@ int hal_swif_8021q_vlan_conf_initialize(void)
 {
 #if SWITCH_CHIP_88E6095
 	GT_STATUS status;
-	GT_VTU_ENTRY vtuEntry;
-	GT_U16 vid;
-	GT_U8 hport;
 	hal_8021q_vlan_conf_t vlan_cfg;
-	hal_8021q_vlan_record_t vlan_rec;
-	GT_U8 vlan_setup[32];
-	int i,j,x,y;
+	int i;
 
+	VlanRunValid = 0;
 
 	if(VlanMode != VLAN_MODE_8021Q)
 		return CONF_ERR_NO_CFG;
@@ -507,44 +557,18 @@ int hal_swif_8021q_vlan_conf_initialize(void)
 	}
 #endif
 	/* 4) Add VLAN ID and add vlan members */
+	if(hal_swif_vlan_rec_read(VlanRunRec, vlan_cfg.TotalRecordCount) != CONF_ERR_NONE) {
+		return CONF_ERR_I2C;
+	}
 	for(i=0; i<vlan_cfg.TotalRecordCount; i++) {
-		if(eeprom_read(NVRAM_VLAN_RECORD_CFG_BASE + i * sizeof(hal_8021q_vlan_record_t), (u8 *)&vlan_rec, sizeof(hal_8021q_vlan_record_t)) != I2C_SUCCESS) {
-			return CONF_ERR_I2C;
-		}
-		vid = *(GT_U16 *)&(vlan_rec.VLanID[0]);
-		vid = ntohs(vid);
-		
-		y=0;
-		for(j=0; j<=7; j++) {
-			for(x=0; x<4; x++) {
-				vlan_setup[y] = (vlan_rec.VLanSetting[j] >> x*2) & 0x3;
-				y++;
-			}
-		}
-        
-		#if 0
-        printf("vid=%d, vlan_setup: ",vid);
-        for(j=0; j<vlan_cfg.PortNum; j++) {
-            printf("%d ",vlan_setup[j]);
-        }
-        printf("\r\n");
-        #endif
-		
-		gtMemSet(&vtuEntry,0,sizeof(GT_VTU_ENTRY));
-		vtuEntry.DBNum = 0;
-		vtuEntry.vid = vid;			
-		for(j=0; j<vlan_cfg.PortNum; j++) {
-			hport = hal_swif_lport_2_hport(j+1);
-			vtuEntry.vtuData.memberTagP[hport] = vlan_setup[j];
-		}
-		vtuEntry.vtuData.memberTagP[dev->cpuPortNum] = MEMBER_EGRESS_UNTAGGED;
-
-		if((status = gvtuAddEntry(dev,&vtuEntry)) != GT_OK) {
+		if(hal_swif_vtu_load(&VlanRunRec[i], vlan_cfg.PortNum) != HAL_SWIF_SUCCESS) {
 			printf("gvtuAddEntry return Failed\n");
 			return CONF_ERR_MSAPI;
 		}
-	
 	}
+
+	memcpy(&VlanRunCfg, &vlan_cfg, sizeof(hal_8021q_vlan_conf_t));
+	VlanRunValid = 1;
 	
 	return CONF_ERR_NONE;
 #else
@@ -552,6 +576,49 @@ int hal_swif_8021q_vlan_conf_initialize(void)
 #endif
 }
 
+/**************************************************************************
+  * @brief  Apply the 8021.q VLAN records in EEPROM to the running VTU.
+  *         Only vids which are added, removed or whose members changed are
+  *         loaded/purged, so at most TotalRecordCount + running count VTU
+  *         operations. If one of them fails, the touched vids are restored
+  *         in reverse order and the running records are written back to
+  *         EEPROM, so hardware and EEPROM are both left as before.
+  * @param  none
+  * @retval CONF_ERR_NONE, CONF_ERR_NO_CFG, CONF_ERR_I2C, CONF_ERR_MSAPI
+  *************************************************************************/
+int hal_swif_8021q_vlan_conf_apply(void)
+{
+#if SWITCH_CHIP_88E6095
+	hal_8021q_vlan_conf_t new_cfg;
+	int i;
+
+	if(VlanMode != VLAN_MODE_8021Q)
+		return CONF_ERR_NO_CFG;
+
+	/* Nothing running from the configuration yet, program from scratch */
+	if(!VlanRunValid)
+		return hal_swif_8021q_vlan_conf_initialize();
+
+	if(eeprom_read(NVRAM_VLAN_CFG_BASE, (u8 *)&new_cfg, sizeof(hal_8021q_vlan_conf_t)) != I2C_SUCCESS)
+		return CONF_ERR_I2C;
+	if((new_cfg.PortNum == 0) || (new_cfg.PortNum > MAX_PORT_NUM) || (new_cfg.TotalRecordCount > MAX_8021Q_VLAN_RECORD_COUNT))
+		return CONF_ERR_NO_CFG;
+	if(hal_swif_vlan_rec_read(VlanNewRec, new_cfg.TotalRecordCount) != CONF_ERR_NONE)
+		return CONF_ERR_I2C;
+
+	if(hal_swif_vlan_diff_apply(&VlanRunCfg, VlanRunRec, &new_cfg, VlanNewRec, hal_swif_vtu_load, hal_swif_vtu_purge) == HAL_SWIF_SUCCESS)
+		return CONF_ERR_NONE;
+
+	/* The VTU is back on the running records, put them back in EEPROM too */
+	eeprom_page_write(NVRAM_VLAN_CFG_BASE, (u8 *)&VlanRunCfg, sizeof(hal_8021q_vlan_conf_t));
+	for(i=0; i<VlanRunCfg.TotalRecordCount; i++)
+		eeprom_page_write(NVRAM_VLAN_RECORD_CFG_BASE + i * sizeof(hal_8021q_vlan_record_t), (u8 *)&VlanRunRec[i], sizeof(hal_8021q_vlan_record_t));
+	return CONF_ERR_MSAPI;
+#else
+	return CONF_ERR_NOT_SUPPORT;
+#endif
+}
+
 /**************************************************************************
   * OBNet NMS
   *************************************************************************/
@@ -823,6 +890,7 @@ void nms_rsp_set_vlan(u8 *DMA, u8 *RequestID, obnet_set_vlan *pSetVlan)
 	u16 RspLength;
 	hal_8021q_vlan_conf_t vlan_cfg;
 	hal_8021q_vlan_record_t vlan_rec;
+	int ret;
 	obnet_vlan_rec *pVlanRec = (obnet_vlan_rec *)((u8 *)pSetVlan+sizeof(obnet_set_vlan));
 	
 	memset(NMS_TxBuffer, 0, MSG_MAXSIZE);
@@ -889,6 +957,18 @@ void nms_rsp_set_vlan(u8 *DMA, u8 *RequestID, obnet_set_vlan *pSetVlan)
 			RspSet.RetCode = 0x00;
 			RspSet.Res = 0x00;
 		}
+
+		/* Last packet of the record set, apply it to the running switch */
+		if((((pSetVlan->OpCode & 0xC0) >> 6) == 0x0) || (((pSetVlan->OpCode & 0xC0) >> 6) == 0x2)) {
+			ret = hal_swif_8021q_vlan_conf_apply();
+			if(ret == CONF_ERR_I2C) {
+				RspSet.RetCode = 0x01;
+				RspSet.Res = RSP_ERR_EEPROM_OPERATION;
+			} else if((ret != CONF_ERR_NONE) && (ret != CONF_ERR_NO_CFG)) {
+				RspSet.RetCode = 0x01;
+				RspSet.Res = RSP_ERR_INVALID_CONFIGURATION;
+			}
+		}
 	}
 #else
 	RspSet.RetCode = 0x01;
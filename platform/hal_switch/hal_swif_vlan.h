@@ -141,6 +141,13 @@ typedef struct {
 int hal_swif_port_isolation_conf_initialize(void);
 int hal_swif_pvid_conf_initialize(void);
 int hal_swif_8021q_vlan_conf_initialize(void);
+int hal_swif_8021q_vlan_conf_apply(void);
+u16 hal_swif_vlan_rec_vid(const hal_8021q_vlan_record_t *rec);
+u8 hal_swif_vlan_rec_member(const hal_8021q_vlan_record_t *rec, int lport_idx);
+int hal_swif_vlan_rec_find(const hal_8021q_vlan_record_t *rec, int count, u16 vid);
+int hal_swif_vlan_diff_apply(hal_8021q_vlan_conf_t *pRunCfg, hal_8021q_vlan_record_t *pRunRec,
+							 const hal_8021q_vlan_conf_t *pNewCfg, const hal_8021q_vlan_record_t *pNewRec,
+							 int (*load)(const hal_8021q_vlan_record_t *rec, u8 port_num), int (*purge)(u16 vid));
 
  /* Functions for NMS */
 #if MODULE_OBNMS
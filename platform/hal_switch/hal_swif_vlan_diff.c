@@ -0,0 +1,110 @@
+/*******************************************************************
+ * Filename     : hal_swif_vlan_diff.c
+ * Description  : Differential apply of 802.1Q VLAN records to the
+ *                VTU with rollback, the VTU access is passed in
+ * Copyright    : OB Telecom Electronics Co.
+ *******************************************************************/
+#include "mconfig.h"
+
+/* Standard includes */
+#include <string.h>
+
+/* BSP includes */
+#include "stm32f2xx.h"
+
+/* HAL for L2 includes */
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_vlan.h"
+
+/* VLanID is big-endian and not aligned in the record */
+u16 hal_swif_vlan_rec_vid(const hal_8021q_vlan_record_t *rec)
+{
+	return (u16)((rec->VLanID[0] << 8) | rec->VLanID[1]);
+}
+
+u8 hal_swif_vlan_rec_member(const hal_8021q_vlan_record_t *rec, int lport_idx)
+{
+	return (rec->VLanSetting[lport_idx / 4] >> ((lport_idx % 4) * 2)) & 0x3;
+}
+
+int hal_swif_vlan_rec_find(const hal_8021q_vlan_record_t *rec, int count, u16 vid)
+{
+	int i;
+
+	for(i=0; i<count; i++) {
+		if(hal_swif_vlan_rec_vid(&rec[i]) == vid)
+			return i;
+	}
+	return -1;
+}
+
+/**************************************************************************
+  * @brief  Bring the VTU from the running records to the new ones. Only
+  *         vids which are added, removed or whose members changed are
+  *         loaded/purged, so at most new + running count VTU operations.
+  *         If one of them fails, the touched vids are restored in reverse
+  *         order.
+  * @param  pRunCfg, pRunRec: running records, replaced by the new ones on
+  *         success
+  *         pNewCfg, pNewRec: records to apply
+  *         load, purge: VTU access, HAL_SWIF_SUCCESS when done
+  * @retval HAL_SWIF_SUCCESS, or HAL_SWIF_FAILURE with the VTU and the
+  *         running records left as before
+  *************************************************************************/
+int hal_swif_vlan_diff_apply(hal_8021q_vlan_conf_t *pRunCfg, hal_8021q_vlan_record_t *pRunRec,
+							 const hal_8021q_vlan_conf_t *pNewCfg, const hal_8021q_vlan_record_t *pNewRec,
+							 int (*load)(const hal_8021q_vlan_record_t *rec, u8 port_num), int (*purge)(u16 vid))
+{
+	u8 journal[MAX_8021Q_VLAN_RECORD_COUNT * 2];	/* running index, 0xFF: vid was not running */
+	u16 journal_vid[MAX_8021Q_VLAN_RECORD_COUNT * 2];
+	int count, i, j, k;
+	u16 vid;
+
+	count = 0;
+
+	/* 1) Load the new and changed vids first, members never lose a vlan in between */
+	for(i=0; i<pNewCfg->TotalRecordCount; i++) {
+		vid = hal_swif_vlan_rec_vid(&pNewRec[i]);
+		j = hal_swif_vlan_rec_find(pRunRec, pRunCfg->TotalRecordCount, vid);
+		if((j >= 0) && (pNewCfg->PortNum == pRunCfg->PortNum)) {
+			for(k=0; k<pNewCfg->PortNum; k++) {
+				if(hal_swif_vlan_rec_member(&pNewRec[i], k) != hal_swif_vlan_rec_member(&pRunRec[j], k))
+					break;
+			}
+			if(k == pNewCfg->PortNum)
+				continue;
+		}
+		journal[count] = (j >= 0) ? (u8)j : 0xFF;
+		journal_vid[count] = vid;
+		count++;
+		if(load(&pNewRec[i], pNewCfg->PortNum) != HAL_SWIF_SUCCESS)
+			goto Rollback;
+	}
+
+	/* 2) Purge the vids which are no longer configured */
+	for(j=0; j<pRunCfg->TotalRecordCount; j++) {
+		vid = hal_swif_vlan_rec_vid(&pRunRec[j]);
+		if(hal_swif_vlan_rec_find(pNewRec, pNewCfg->TotalRecordCount, vid) >= 0)
+			continue;
+		journal[count] = (u8)j;
+		journal_vid[count] = vid;
+		count++;
+		if(purge(vid) != HAL_SWIF_SUCCESS)
+			goto Rollback;
+	}
+
+	/* Commit */
+	memcpy(pRunCfg, pNewCfg, sizeof(hal_8021q_vlan_conf_t));
+	memcpy(pRunRec, pNewRec, pNewCfg->TotalRecordCount * sizeof(hal_8021q_vlan_record_t));
+	return HAL_SWIF_SUCCESS;
+
+Rollback:
+	while(count-- > 0) {
+		if(journal[count] == 0xFF)
+			purge(journal_vid[count]);
+		else
+			load(&pRunRec[journal[count]], pRunCfg->PortNum);
+	}
+	return HAL_SWIF_FAILURE;
+}
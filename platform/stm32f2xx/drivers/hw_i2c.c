@@ -0,0 +1,381 @@
+
+/*************************************************************
+ * Filename     : hw_i2c.c
+ * Description  : EEPROM access through the I2C1 peripheral with DMA
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+#include "mconfig.h"
+
+/* BSP includes */
+#include "hw_i2c.h"
+#include "soft_i2c.h"
+
+#if I2C_HW_ENABLE
+
+/* Kernel includes. */
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+enum {
+	HW_I2C_OK = 0,
+	HW_I2C_NACK,
+	HW_I2C_ERROR
+};
+
+/* One address byte with its ACK takes ~25us at 400KHz, used to bound the
+   acknowledge polling before the scheduler runs */
+#define HW_I2C_POLLS_PER_MS				40
+
+static xSemaphoreHandle xSemI2cDone = NULL;
+
+/* Before the scheduler starts (boot MAC read) transfers are polled,
+   afterwards the calling task sleeps until the DMA interrupt */
+static u8 hw_i2c_irq_mode(void)
+{
+	return ((xSemI2cDone != NULL) && (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)) ? 1 : 0;
+}
+
+static void hw_i2c_bit_delay(void)
+{
+	u8 i = 100;
+	while(i--) ;
+}
+
+/* Clock out a slave left in the middle of a read (e.g. reset during a
+   transfer) so that it releases SDA, then put a STOP on the bus */
+static void hw_i2c_bus_recover(void)
+{
+	GPIO_InitTypeDef GPIO_InitStructure;
+	u8 i;
+
+	GPIO_InitStructure.GPIO_Pin = HW_I2C_SCL_PIN | HW_I2C_SDA_PIN;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_OUT;
+	GPIO_InitStructure.GPIO_OType = GPIO_OType_OD;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_UP;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(HW_I2C_GPIO_PORT, &GPIO_InitStructure);
+
+	HW_I2C_GPIO_PORT->BSRRL = HW_I2C_SCL_PIN | HW_I2C_SDA_PIN;
+	hw_i2c_bit_delay();
+	for(i = 0; (i < 9) && !(HW_I2C_GPIO_PORT->IDR & HW_I2C_SDA_PIN); i++) {
+		HW_I2C_GPIO_PORT->BSRRH = HW_I2C_SCL_PIN;
+		hw_i2c_bit_delay();
+		HW_I2C_GPIO_PORT->BSRRL = HW_I2C_SCL_PIN;
+		hw_i2c_bit_delay();
+	}
+
+	HW_I2C_GPIO_PORT->BSRRH = HW_I2C_SCL_PIN;
+	hw_i2c_bit_delay();
+	HW_I2C_GPIO_PORT->BSRRH = HW_I2C_SDA_PIN;
+	hw_i2c_bit_delay();
+	HW_I2C_GPIO_PORT->BSRRL = HW_I2C_SCL_PIN;
+	hw_i2c_bit_delay();
+	HW_I2C_GPIO_PORT->BSRRL = HW_I2C_SDA_PIN;
+	hw_i2c_bit_delay();
+}
+
+static void hw_i2c_reset(void)
+{
+	GPIO_InitTypeDef GPIO_InitStructure;
+	RCC_ClocksTypeDef RCC_Clocks;
+	u16 freq, ccr;
+
+	HW_I2C->CR1 = I2C_CR1_SWRST;
+	HW_I2C->CR1 = 0;
+
+	hw_i2c_bus_recover();
+
+	GPIO_PinAFConfig(HW_I2C_GPIO_PORT, HW_I2C_SCL_SOURCE, HW_I2C_AF);
+	GPIO_PinAFConfig(HW_I2C_GPIO_PORT, HW_I2C_SDA_SOURCE, HW_I2C_AF);
+	GPIO_InitStructure.GPIO_Pin = HW_I2C_SCL_PIN | HW_I2C_SDA_PIN;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF;
+	GPIO_InitStructure.GPIO_OType = GPIO_OType_OD;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_UP;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(HW_I2C_GPIO_PORT, &GPIO_InitStructure);
+
+	RCC_GetClocksFreq(&RCC_Clocks);
+	freq = (u16)(RCC_Clocks.PCLK1_Frequency / 1000000);
+	HW_I2C->CR2 = freq & I2C_CR2_FREQ;
+#if (HW_I2C_SPEED > 100000)
+	/* Fast mode, Tlow = 2 * Thigh */
+	ccr = (u16)(RCC_Clocks.PCLK1_Frequency / (HW_I2C_SPEED * 3));
+	HW_I2C->CCR = I2C_CCR_FS | (ccr ? ccr : 1);
+	HW_I2C->TRISE = (freq * 300) / 1000 + 1;
+#else
+	ccr = (u16)(RCC_Clocks.PCLK1_Frequency / (HW_I2C_SPEED * 2));
+	HW_I2C->CCR = (ccr < 4) ? 4 : ccr;
+	HW_I2C->TRISE = freq + 1;
+#endif
+	HW_I2C->CR1 = I2C_CR1_PE;
+}
+
+/* Wait for an SR1 event, a NACK or a bus error ends the wait early */
+static int hw_i2c_wait(u16 flag)
+{
+	u32 timeout = HW_I2C_FLAG_TIMEOUT;
+	u16 sr1;
+
+	while(timeout--) {
+		sr1 = HW_I2C->SR1;
+		if(sr1 & flag)
+			return HW_I2C_OK;
+		if(sr1 & I2C_SR1_AF)
+			return HW_I2C_NACK;
+		if(sr1 & (I2C_SR1_BERR | I2C_SR1_ARLO))
+			return HW_I2C_ERROR;
+	}
+	return HW_I2C_ERROR;
+}
+
+static void hw_i2c_wait_stop(void)
+{
+	u32 timeout = HW_I2C_FLAG_TIMEOUT;
+
+	while((HW_I2C->CR1 & I2C_CR1_STOP) && timeout--) ;
+}
+
+/* START + device address, ADDR is left set for the caller to clear */
+static int hw_i2c_start(u8 DeviceAddress)
+{
+	int ret;
+
+	HW_I2C->CR1 |= I2C_CR1_START;
+	if((ret = hw_i2c_wait(I2C_SR1_SB)) != HW_I2C_OK)
+		return ret;
+	HW_I2C->DR = DeviceAddress;
+	return hw_i2c_wait(I2C_SR1_ADDR);
+}
+
+static int hw_i2c_send_offset(u16 Address, u8 DeviceAddress)
+{
+	int ret;
+
+	if((ret = hw_i2c_start(DeviceAddress & 0xFE)) != HW_I2C_OK)
+		return ret;
+	(void)HW_I2C->SR2;
+	HW_I2C->DR = (u8)((Address & 0x1F00) >> 8);
+	if((ret = hw_i2c_wait(I2C_SR1_TXE)) != HW_I2C_OK)
+		return ret;
+	HW_I2C->DR = (u8)(Address & 0x00FF);
+	return hw_i2c_wait(I2C_SR1_TXE);
+}
+
+static void hw_i2c_dma_start(DMA_Stream_TypeDef *stream, u32 flags, u32 dir, u8 *pBuffer, u8 length, u8 irq)
+{
+	DMA_InitTypeDef DMA_InitStructure;
+
+	DMA_Cmd(stream, DISABLE);
+	DMA_ClearFlag(stream, flags);
+
+	DMA_InitStructure.DMA_Channel = HW_I2C_DMA_CHANNEL;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&(HW_I2C->DR);
+	DMA_InitStructure.DMA_Memory0BaseAddr = (u32)pBuffer;
+	DMA_InitStructure.DMA_DIR = dir;
+	DMA_InitStructure.DMA_BufferSize = length;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(stream, &DMA_InitStructure);
+	DMA_ITConfig(stream, DMA_IT_TC, irq ? ENABLE : DISABLE);
+
+	if(irq) {
+		/* Drop a completion left over from an aborted transfer */
+		xSemaphoreTake(xSemI2cDone, 0);
+	}
+	DMA_Cmd(stream, ENABLE);
+}
+
+static int hw_i2c_dma_wait(DMA_Stream_TypeDef *stream, u32 tcFlag, u8 irq)
+{
+	u32 timeout = HW_I2C_FLAG_TIMEOUT * HW_I2C_DMA_TIMEOUT;
+
+	if(irq) {
+		if(xSemaphoreTake(xSemI2cDone, HW_I2C_DMA_TIMEOUT / portTICK_RATE_MS) == pdTRUE)
+			return HW_I2C_OK;
+		return HW_I2C_ERROR;
+	}
+
+	while(timeout--) {
+		if(DMA_GetFlagStatus(stream, tcFlag) == SET)
+			return HW_I2C_OK;
+	}
+	return HW_I2C_ERROR;
+}
+
+static void hw_i2c_abort(void)
+{
+	DMA_Cmd(HW_I2C_RX_DMA_STREAM, DISABLE);
+	DMA_Cmd(HW_I2C_TX_DMA_STREAM, DISABLE);
+	HW_I2C->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
+	HW_I2C->SR1 = 0;
+	HW_I2C->CR1 |= I2C_CR1_STOP;
+	hw_i2c_wait_stop();
+
+	if(HW_I2C->SR2 & I2C_SR2_BUSY)
+		hw_i2c_reset();
+}
+
+/* The EEPROM ignores its address until the internal write cycle is over,
+   so poll it instead of waiting out the worst case write time */
+static int hw_i2c_ack_poll(u8 DeviceAddress, u8 irq)
+{
+	u32 polls;
+	int ret;
+
+	for(polls = irq ? HW_I2C_WRITE_TIMEOUT : HW_I2C_WRITE_TIMEOUT * HW_I2C_POLLS_PER_MS; polls > 0; polls--) {
+		ret = hw_i2c_start(DeviceAddress & 0xFE);
+		if(ret == HW_I2C_OK) {
+			(void)HW_I2C->SR2;
+			HW_I2C->CR1 |= I2C_CR1_STOP;
+			hw_i2c_wait_stop();
+			return I2C_SUCCESS;
+		}
+		if(ret != HW_I2C_NACK)
+			break;
+
+		HW_I2C->SR1 = (u16)~I2C_SR1_AF;
+		HW_I2C->CR1 |= I2C_CR1_STOP;
+		hw_i2c_wait_stop();
+		if(irq)
+			vTaskDelay(1);
+	}
+
+	hw_i2c_abort();
+	return I2C_FAILURE;
+}
+
+void HwI2C_Init(void)
+{
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	RCC_AHB1PeriphClockCmd(HW_I2C_GPIO_CLK, ENABLE);
+	RCC_AHB1PeriphClockCmd(HW_I2C_DMA_CLK, ENABLE);
+	RCC_APB1PeriphClockCmd(HW_I2C_CLK, ENABLE);
+
+	if(xSemI2cDone == NULL) {
+		vSemaphoreCreateBinary(xSemI2cDone);
+		if(xSemI2cDone != NULL)
+			xSemaphoreTake(xSemI2cDone, 0);
+	}
+
+	hw_i2c_reset();
+
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStructure.NVIC_IRQChannel = HW_I2C_RX_DMA_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+	NVIC_InitStructure.NVIC_IRQChannel = HW_I2C_TX_DMA_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+}
+
+int HwI2C_Read(u8 *pBuffer, u8 length, u16 ReadAddress, u8 DeviceAddress)
+{
+	u8 irq = hw_i2c_irq_mode();
+
+	if(length == 0)
+		return I2C_SUCCESS;
+
+	if(hw_i2c_send_offset(ReadAddress, DeviceAddress) != HW_I2C_OK)
+		goto fail;
+	if(hw_i2c_wait(I2C_SR1_BTF) != HW_I2C_OK)
+		goto fail;
+
+	if(length == 1) {
+		/* Single byte: NACK and STOP must be armed before ADDR is cleared */
+		HW_I2C->CR1 &= ~I2C_CR1_ACK;
+		if(hw_i2c_start(DeviceAddress | 0x01) != HW_I2C_OK)
+			goto fail;
+		taskENTER_CRITICAL();
+		(void)HW_I2C->SR2;
+		HW_I2C->CR1 |= I2C_CR1_STOP;
+		taskEXIT_CRITICAL();
+		if(hw_i2c_wait(I2C_SR1_RXNE) != HW_I2C_OK)
+			goto fail;
+		*pBuffer = (u8)HW_I2C->DR;
+		hw_i2c_wait_stop();
+		return I2C_SUCCESS;
+	}
+
+	/* LAST makes the peripheral NACK the final DMA byte */
+	HW_I2C->CR1 |= I2C_CR1_ACK;
+	hw_i2c_dma_start(HW_I2C_RX_DMA_STREAM, HW_I2C_RX_DMA_FLAGS, DMA_DIR_PeripheralToMemory, pBuffer, length, irq);
+	HW_I2C->CR2 |= I2C_CR2_DMAEN | I2C_CR2_LAST;
+	if(hw_i2c_start(DeviceAddress | 0x01) != HW_I2C_OK)
+		goto fail;
+	(void)HW_I2C->SR2;
+	if(hw_i2c_dma_wait(HW_I2C_RX_DMA_STREAM, HW_I2C_RX_DMA_FLAG_TC, irq) != HW_I2C_OK)
+		goto fail;
+	if(!irq)
+		HW_I2C->CR1 |= I2C_CR1_STOP;
+	HW_I2C->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
+	hw_i2c_wait_stop();
+	return I2C_SUCCESS;
+
+fail:
+	hw_i2c_abort();
+	return I2C_FAILURE;
+}
+
+/* Note: can't stride page to write, returns once the write cycle is done */
+int HwI2C_Write(u8 *pBuffer, u8 length, u16 WriteAddress, u8 DeviceAddress)
+{
+	u8 irq = hw_i2c_irq_mode();
+
+	if(hw_i2c_send_offset(WriteAddress, DeviceAddress) != HW_I2C_OK)
+		goto fail;
+
+	if(length) {
+		hw_i2c_dma_start(HW_I2C_TX_DMA_STREAM, HW_I2C_TX_DMA_FLAGS, DMA_DIR_MemoryToPeripheral, pBuffer, length, irq);
+		HW_I2C->CR2 |= I2C_CR2_DMAEN;
+		if(hw_i2c_dma_wait(HW_I2C_TX_DMA_STREAM, HW_I2C_TX_DMA_FLAG_TC, irq) != HW_I2C_OK)
+			goto fail;
+		HW_I2C->CR2 &= ~I2C_CR2_DMAEN;
+	}
+
+	if(hw_i2c_wait(I2C_SR1_BTF) != HW_I2C_OK)
+		goto fail;
+	HW_I2C->CR1 |= I2C_CR1_STOP;
+	hw_i2c_wait_stop();
+
+	return hw_i2c_ack_poll(DeviceAddress, irq);
+
+fail:
+	hw_i2c_abort();
+	return I2C_FAILURE;
+}
+
+void DMA1_Stream0_IRQHandler(void)
+{
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	if(DMA_GetITStatus(HW_I2C_RX_DMA_STREAM, DMA_IT_TCIF0) == SET) {
+		DMA_ClearITPendingBit(HW_I2C_RX_DMA_STREAM, DMA_IT_TCIF0);
+		/* Last byte is already NACKed, close the transfer right away */
+		HW_I2C->CR1 |= I2C_CR1_STOP;
+		xSemaphoreGiveFromISR(xSemI2cDone, &xHigherPriorityTaskWoken);
+	}
+	portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+}
+
+void DMA1_Stream7_IRQHandler(void)
+{
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+
+	if(DMA_GetITStatus(HW_I2C_TX_DMA_STREAM, DMA_IT_TCIF7) == SET) {
+		DMA_ClearITPendingBit(HW_I2C_TX_DMA_STREAM, DMA_IT_TCIF7);
+		xSemaphoreGiveFromISR(xSemI2cDone, &xHigherPriorityTaskWoken);
+	}
+	portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
+}
+
+#endif /* I2C_HW_ENABLE */
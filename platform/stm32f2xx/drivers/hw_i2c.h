@@ -0,0 +1,73 @@
+
+/*************************************************************
+ * Filename     : hw_i2c.h
+ * Description  : EEPROM access through the I2C1 peripheral with DMA
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#ifndef __HW_I2C_H
+#define __HW_I2C_H
+
+#ifdef __cplusplus
+ extern "C" {
+#endif
+
+#include "mconfig.h"
+#include "stm32f2xx.h"
+
+/* Boards with the EEPROM on PB6/PB7 drive it through I2C1 + DMA, the others
+   keep the bit-banged bus in soft_i2c.c (GV3S shares PB6/PB7 with the FPGA
+   module's software I2C, so it stays bit-banged as well) */
+#if (BOARD_GE22103MA || BOARD_GE20023MA || BOARD_GE11014MA || BOARD_GE11500MD || BOARD_GE_EXT_22002EA || BOARD_GE220044MD)
+#define I2C_HW_ENABLE				1
+#else
+#define I2C_HW_ENABLE				0
+#endif
+
+#if I2C_HW_ENABLE
+
+/*************************************************************************
+ * I2C1 on SCL: PB6, SDA: PB7
+ * DMA1 stream0 (rx) / stream7 (tx), channel 1
+ * DMA1 stream5/6 are taken by COM port1
+ *************************************************************************/
+#define HW_I2C							I2C1
+#define HW_I2C_CLK						RCC_APB1Periph_I2C1
+#define HW_I2C_SPEED					400000
+#define HW_I2C_SCL_PIN					GPIO_Pin_6
+#define HW_I2C_SCL_SOURCE				GPIO_PinSource6
+#define HW_I2C_SDA_PIN					GPIO_Pin_7
+#define HW_I2C_SDA_SOURCE				GPIO_PinSource7
+#define HW_I2C_GPIO_PORT				GPIOB
+#define HW_I2C_GPIO_CLK					RCC_AHB1Periph_GPIOB
+#define HW_I2C_AF						GPIO_AF_I2C1
+
+#define HW_I2C_DMA_CLK					RCC_AHB1Periph_DMA1
+#define HW_I2C_DMA_CHANNEL				DMA_Channel_1
+#define HW_I2C_RX_DMA_STREAM			DMA1_Stream0
+#define HW_I2C_RX_DMA_IRQn				DMA1_Stream0_IRQn
+#define HW_I2C_RX_DMA_FLAG_TC			DMA_FLAG_TCIF0
+#define HW_I2C_RX_DMA_FLAGS				(DMA_FLAG_TCIF0 | DMA_FLAG_HTIF0 | DMA_FLAG_TEIF0 | DMA_FLAG_DMEIF0 | DMA_FLAG_FEIF0)
+#define HW_I2C_TX_DMA_STREAM			DMA1_Stream7
+#define HW_I2C_TX_DMA_IRQn				DMA1_Stream7_IRQn
+#define HW_I2C_TX_DMA_FLAG_TC			DMA_FLAG_TCIF7
+#define HW_I2C_TX_DMA_FLAGS				(DMA_FLAG_TCIF7 | DMA_FLAG_HTIF7 | DMA_FLAG_TEIF7 | DMA_FLAG_DMEIF7 | DMA_FLAG_FEIF7)
+
+/* Polled bus events (start, address, BTF) give up after this many reads */
+#define HW_I2C_FLAG_TIMEOUT				0x4000
+/* Longest time (ms) for a DMA phase, 255 bytes take ~6ms at 400KHz */
+#define HW_I2C_DMA_TIMEOUT				20
+/* Longest EEPROM internal write cycle (ms) waited by acknowledge polling */
+#define HW_I2C_WRITE_TIMEOUT			20
+
+void HwI2C_Init(void);
+int HwI2C_Read(u8 *pBuffer, u8 length, u16 ReadAddress, u8 DeviceAddress);
+int HwI2C_Write(u8 *pBuffer, u8 length, u16 WriteAddress, u8 DeviceAddress);
+
+#endif /* I2C_HW_ENABLE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -563,10 +563,10 @@ void gpio_initialize(void)
         GPIO_Init(GPIOD, &GPIO_InitStructure);
     }
 	
-#if 0
-	if(EXTI9_5_Semaphore == NULL) {
-		vSemaphoreCreateBinary(EXTI9_5_Semaphore);
-	}
+#if (BOARD_FEATURE & L2_LINK_AGGREGATION)
+	/* Switch INTn (PE8) drives the trunk failover */
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOE, ENABLE);
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
 
 	/* Configure INTn pin as input */
 	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
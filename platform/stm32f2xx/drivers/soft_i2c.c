@@ -9,6 +9,7 @@
 
 /* BSP include */
 #include "soft_i2c.h"
+#include "hw_i2c.h"
 
 /********************************************************/              
 #if BOARD_GE1040PU
@@ -395,6 +396,11 @@ void I2C_GPIO_Config(void)
 #else
 #error i2c gpio pin config unkown
 #endif	
+
+#if I2C_HW_ENABLE
+	/* SCL/SDA are handed over to I2C1, only WP stays a plain GPIO */
+	HwI2C_Init();
+#endif
 }
 
 void I2C_WriteEnable(void)
@@ -575,6 +581,9 @@ u8 I2C_ReceiveByte(void)		/* MSB->LSB to receive */
 
 int I2C_ReadByte(u8 *ReadBype, u16 ReadAddress, u8 DeviceAddress)
 {
+#if I2C_HW_ENABLE
+	return HwI2C_Read(ReadBype, 1, ReadAddress, DeviceAddress);
+#else
 #if BOARD_GV3S_HONUE_QM
     if(!I2C_Start()){return 0;}
 #endif
@@ -599,10 +608,14 @@ int I2C_ReadByte(u8 *ReadBype, u16 ReadAddress, u8 DeviceAddress)
 	I2C_Stop();
 	
 	return 1;
+#endif
 }
 
 int I2C_Read(u8 *pBuffer, u8 length, u16 ReadAddress, u8 DeviceAddress)
 {
+#if I2C_HW_ENABLE
+	return HwI2C_Read(pBuffer, length, ReadAddress, DeviceAddress);
+#else
 #if BOARD_GV3S_HONUE_QM
     if(!I2C_Start()){return 0; }
 #endif
@@ -634,11 +647,15 @@ int I2C_Read(u8 *pBuffer, u8 length, u16 ReadAddress, u8 DeviceAddress)
 	I2C_Stop();
 	
 	return 1;
+#endif
 }
 
 
 int I2C_WriteByte(u8 SendByte, u16 WriteAddress, u8 DeviceAddress)
 {    
+#if I2C_HW_ENABLE
+	return HwI2C_Write(&SendByte, 1, WriteAddress, DeviceAddress);
+#else
 	int i;
 
 #if BOARD_GV3S_HONUE_QM
@@ -658,11 +675,15 @@ int I2C_WriteByte(u8 SendByte, u16 WriteAddress, u8 DeviceAddress)
 	I2C_Stop(); 
 
 	return 1;
+#endif
 }
 
 /* Note: can't stride page to write */
 int I2C_Write(u8 *pBuffer, u8 length, u16 WriteAddress, u8 DeviceAddress)
 {
+#if I2C_HW_ENABLE
+	return HwI2C_Write(pBuffer, length, WriteAddress, DeviceAddress);
+#else
 	int i;
 
 #if BOARD_GV3S_HONUE_QM
@@ -688,6 +709,7 @@ int I2C_Write(u8 *pBuffer, u8 length, u16 WriteAddress, u8 DeviceAddress)
 	TimerDelayMs(10);
 	
 	return 1;
+#endif
 }
 
 
@@ -40,7 +40,7 @@ void TIM3_IRQHandler(void)
 #if OBRING_DEV
 		//obring_timer_tick();
 #endif		
-		if(TrafficInterval > 5 * 1000) {
+		if(TrafficInterval >= 1000) {		/* HAL_TRAFFIC_SAMPLE_INTERVAL */
 			if(xSemTraffic != NULL)
 				xSemaphoreGiveFromISR(xSemTraffic, &xHigherPriorityTaskWoken);
 			TrafficInterval = 0;
@@ -13,6 +13,9 @@
 #include "FreeRTOS.h"
 #include "semphr.h"
 
+/* Standard includes */
+#include <string.h>
+
 /* BSP includes */
 #include "usart_if.h"
 
@@ -23,78 +26,286 @@ unsigned int uart_led_tim[COM_PORT_MAX] = {0};
 extern xSemaphoreHandle xSemUartTx[];
 extern xSemaphoreHandle xSemUartRx[];
 
+#if UART_DMA_ENABLE
+typedef struct {
+	u32					dmaClk;
+	u32					channel;
+	DMA_Stream_TypeDef*	rxStream;
+	IRQn_Type			rxIRQn;
+	u32					rxItHT;
+	u32					rxItTC;
+	DMA_Stream_TypeDef*	txStream;
+	IRQn_Type			txIRQn;
+	u32					txItTC;
+} uart_dma_map_t;
+
+static const uart_dma_map_t UartDmaMap[COM_PORT_MAX] = {
+	{COM_PORT0_DMA_CLK, COM_PORT0_DMA_CHANNEL,
+	 COM_PORT0_RX_DMA_STREAM, COM_PORT0_RX_DMA_IRQn, COM_PORT0_RX_DMA_IT_HT, COM_PORT0_RX_DMA_IT_TC,
+	 COM_PORT0_TX_DMA_STREAM, COM_PORT0_TX_DMA_IRQn, COM_PORT0_TX_DMA_IT_TC},
+	{COM_PORT1_DMA_CLK, COM_PORT1_DMA_CHANNEL,
+	 COM_PORT1_RX_DMA_STREAM, COM_PORT1_RX_DMA_IRQn, COM_PORT1_RX_DMA_IT_HT, COM_PORT1_RX_DMA_IT_TC,
+	 COM_PORT1_TX_DMA_STREAM, COM_PORT1_TX_DMA_IRQn, COM_PORT1_TX_DMA_IT_TC}
+};
+
+/* RX stream runs circular over rxBuf, the write index comes from NDTR.
+   Only the receive task moves rxPop, so no critical section is needed. */
+static u16 _uart_rx_span_dma(uart_dev_t *dev, u8 **pp)
+{
+	uart_fifo_t *pfifo = &dev->fifo;
+	u16 head, n;
+
+	head = pfifo->rxSize - (u16)DMA_GetCurrDataCounter(dev->dma.rxStream);
+	if(head >= pfifo->rxSize)
+		head = 0;
+	pfifo->rxPush = head;
+	
+	n = (head + pfifo->rxSize - pfifo->rxPop) % pfifo->rxSize;
+	if(n > dev->stat.rx_highwater)
+		dev->stat.rx_highwater = n;
+	if(n > pfifo->rxSize - pfifo->rxPop)
+		n = pfifo->rxSize - pfifo->rxPop;
+	*pp = &pfifo->rxBuf[pfifo->rxPop];
+	
+	return n;
+}
+
+static void _uart_rx_consume_dma(uart_dev_t *dev, u16 len)
+{
+	uart_fifo_t *pfifo = &dev->fifo;
+	
+	pfifo->rxPop += len;
+	if(pfifo->rxPop >= pfifo->rxSize)
+		pfifo->rxPop -= pfifo->rxSize;
+}
 
-static u16 _uart_read_isr(uart_fifo_t *pfifo, USART_TypeDef *uart, u8 *data, u16 len)
+/* One DMA transfer per call, the caller waits xSemUartTx (given on USART TC)
+   before the next one. */
+static u16 _uart_write_dma(uart_dev_t *dev, u8 *data, u16 len)
 {
-	u32 ie;
-	u16 n;
+	uart_fifo_t *pfifo = &dev->fifo;
+	DMA_Stream_TypeDef *stream = dev->dma.txStream;
 	
-	if(len == 0)
+	if((len == 0) || dev->dma.txBusy)
 		return 0;
 
-	for(n=0;n<len;n++) {
-		if(n < pfifo->rxCnt) {
-			*data++ = pfifo->rxBuf[pfifo->rxPop];
-			pfifo->rxPop += 1;
-			if(pfifo->rxPop>=pfifo->rxSize)
-				pfifo->rxPop = 0;
-		} else {
-			break;
-		}
-	}
-#if 1
-	portDISABLE_INTERRUPTS();
-	pfifo->rxCnt -= n;
-	portENABLE_INTERRUPTS();
+	if(len > pfifo->txSize)
+		len = pfifo->txSize;
+	memcpy(pfifo->txBuf, data, len);
+
+	dev->dma.txBusy = 1;
+	DMA_Cmd(stream, DISABLE);
+	while(DMA_GetCmdStatus(stream) != DISABLE) {}
+	DMA_ClearITPendingBit(stream, dev->dma.txItTC);
+	stream->M0AR = (u32)pfifo->txBuf;
+	DMA_SetCurrDataCounter(stream, len);
+	DMA_Cmd(stream, ENABLE);
+	
+	return len;
+}
+
+static void _uart_dma_init(u8 port)
+{
+	const uart_dma_map_t *map = &UartDmaMap[port];
+	uart_dev_t *dev = &UartDevice[port];
+	DMA_InitTypeDef DMA_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	RCC_AHB1PeriphClockCmd(map->dmaClk, ENABLE);
+
+	dev->dma.rxStream	= map->rxStream;
+	dev->dma.txStream	= map->txStream;
+	dev->dma.rxItHT		= map->rxItHT;
+	dev->dma.rxItTC		= map->rxItTC;
+	dev->dma.txItTC		= map->txItTC;
+	dev->dma.rxIdleCnt	= dev->dma.rxIdleSeen = 0;
+	dev->dma.txBusy		= 0;
+
+	/* RX: peripheral to memory, circular over the whole rx buffer */
+	DMA_DeInit(map->rxStream);
+	DMA_StructInit(&DMA_InitStructure);
+	DMA_InitStructure.DMA_Channel = map->channel;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (u32)&(dev->uart->DR);
+	DMA_InitStructure.DMA_Memory0BaseAddr = (u32)dev->fifo.rxBuf;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_BufferSize = dev->fifo.rxSize;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_MemoryInc = DMA_MemoryInc_Enable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Circular;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+	DMA_InitStructure.DMA_FIFOThreshold = DMA_FIFOThreshold_HalfFull;
+	DMA_InitStructure.DMA_MemoryBurst = DMA_MemoryBurst_Single;
+	DMA_InitStructure.DMA_PeripheralBurst = DMA_PeripheralBurst_Single;
+	DMA_Init(map->rxStream, &DMA_InitStructure);
+	DMA_ITConfig(map->rxStream, DMA_IT_HT | DMA_IT_TC, ENABLE);
+
+	/* TX: memory to peripheral, one shot per UartWrite */
+	DMA_DeInit(map->txStream);
+	DMA_InitStructure.DMA_Memory0BaseAddr = (u32)dev->fifo.txBuf;
+	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStructure.DMA_BufferSize = 1;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_Medium;
+	DMA_Init(map->txStream, &DMA_InitStructure);
+	DMA_ITConfig(map->txStream, DMA_IT_TC, ENABLE);
+
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 3;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStructure.NVIC_IRQChannel = map->rxIRQn;
+	NVIC_Init(&NVIC_InitStructure);
+	NVIC_InitStructure.NVIC_IRQChannel = map->txIRQn;
+	NVIC_Init(&NVIC_InitStructure);
+
+	USART_DMACmd(dev->uart, USART_DMAReq_Rx | USART_DMAReq_Tx, ENABLE);
+	DMA_Cmd(map->rxStream, ENABLE);
+}
+
+/* Returns 1 when the line went idle since the previous call */
+u8 UartRxIdle(u8 port)
+{
+	u8 cnt;
+	
+	if(port >= COM_PORT_MAX)
+		return 0;
+	cnt = UartDevice[port].dma.rxIdleCnt;
+	if(cnt == UartDevice[port].dma.rxIdleSeen)
+		return 0;
+	UartDevice[port].dma.rxIdleSeen = cnt;
+	return 1;
+}
+
+void UartSetFrameGap(u8 port, u16 gap_ms)
+{
+	if(port < COM_PORT_MAX)
+		UartDevice[port].dma.frameGap = gap_ms;
+}
+
+u16 UartGetFrameGap(u8 port)
+{
+	if(port >= COM_PORT_MAX)
+		return 0;
+	return UartDevice[port].dma.frameGap;
+}
 #else
-	ie = __get_PRIMASK();
-	__set_PRIMASK(1);
-	pfifo->rxCnt -= n;
-	__set_PRIMASK(ie);
+u8 UartRxIdle(u8 port)
+{
+	return 0;
+}
+
+void UartSetFrameGap(u8 port, u16 gap_ms)
+{
+}
+
+u16 UartGetFrameGap(u8 port)
+{
+	return UART_FRAME_TIMEOUT;
+}
+#endif /* UART_DMA_ENABLE */
+
+#if !UART_DMA_ENABLE
+/* Orders buffer accesses against the index the other side polls */
+#if defined(__ICCARM__)
+#include <intrinsics.h>
+#define UART_FIFO_BARRIER()		__DMB()
+#else
+#define UART_FIFO_BARRIER()		__asm volatile ("dmb" : : : "memory")
 #endif
+
+/* The isr only moves rxPush/txPop and the task only rxPop/txPush, so
+   neither side needs a critical section. */
+static u16 _uart_rx_span_isr(uart_dev_t *dev, u8 **pp)
+{
+	uart_fifo_t *pfifo = &dev->fifo;
+	u16 pop = pfifo->rxPop;
+	u16 off = pop & (pfifo->rxSize - 1);
+	u16 n = (u16)(pfifo->rxPush - pop);
+
+	/* rxPush is read before the bytes it covers */
+	UART_FIFO_BARRIER();
+	if(n > pfifo->rxSize - off)
+		n = pfifo->rxSize - off;
+	*pp = &pfifo->rxBuf[off];
+	
 	return n;
 }
 
-static u16 _uart_write_isr(uart_fifo_t *pfifo, USART_TypeDef *uart, u8 *data, u16 len)
+static void _uart_rx_consume_isr(uart_dev_t *dev, u16 len)
 {
-	u32 ie;
-	u16 n;
+	/* Bytes are copied out before the isr may reuse them */
+	UART_FIFO_BARRIER();
+	dev->fifo.rxPop += len;
+}
+
+static u16 _uart_write_isr(uart_dev_t *dev, u8 *data, u16 len)
+{
+	uart_fifo_t *pfifo = &dev->fifo;
+	u16 push = pfifo->txPush;
+	u16 off = push & (pfifo->txSize - 1);
+	u16 n, chunk;
 	
-	if(len == 0)
-		return 0;
+	n = pfifo->txSize - (u16)(push - pfifo->txPop);
+	if(n > len)
+		n = len;
+
+	chunk = pfifo->txSize - off;
+	if(chunk > n)
+		chunk = n;
+	memcpy(&pfifo->txBuf[off], data, chunk);
+	memcpy(pfifo->txBuf, data + chunk, n - chunk);
+
+	/* Data lands before the isr sees the new txPush */
+	UART_FIFO_BARRIER();
+	pfifo->txPush = push + n;
 	
-	for(n=0;n<len;n++) {
-		if((pfifo->txSize-n) > pfifo->txCnt) {
-			pfifo->txBuf[pfifo->txPush] = *data++;
-			pfifo->txPush += 1;
-			if(pfifo->txPush >= pfifo->txSize)
-				pfifo->txPush = 0;
-		} else {
-			break;
-		}
-	}
-#if 1
-	portDISABLE_INTERRUPTS();
-	pfifo->txCnt += n;
-	portENABLE_INTERRUPTS();
-	//__disable_interrupt();
-	//__enable_interrupt();
+	return n;
+}
+#endif
+
+/* Zero copy receive: points *pp at the longest contiguous run of received
+   bytes and returns its length, UartRxConsume then releases what was used */
+u16 UartRxSpan(u8 port, u8 **pp)
+{
+	if(port >= COM_PORT_MAX)
+		return 0;
+#if UART_DMA_ENABLE
+	return _uart_rx_span_dma(&UartDevice[port], pp);
 #else
-	ie = __get_PRIMASK();
-	__set_PRIMASK(1);
-	pfifo->txCnt += n;
-	__set_PRIMASK(ie);
+	return _uart_rx_span_isr(&UartDevice[port], pp);
+#endif
+}
+
+void UartRxConsume(u8 port, u16 len)
+{
+	if(port >= COM_PORT_MAX)
+		return;
+#if UART_DMA_ENABLE
+	_uart_rx_consume_dma(&UartDevice[port], len);
+#else
+	_uart_rx_consume_isr(&UartDevice[port], len);
 #endif
-	return n;
 }
 
 u16 UartRead(u8 port,u8 *data,u16 len)
 {
-	if(port >= COM_PORT_MAX) {
-		return 0;
-	} else {
-		return _uart_read_isr(&UartDevice[port].fifo, UartDevice[port].uart, data, len);
+	u16 n, total = 0;
+	u8 *p;
+
+	/* At most two spans, before and after the wrap */
+	while(total < len) {
+		n = UartRxSpan(port, &p);
+		if(n == 0)
+			break;
+		if(n > len - total)
+			n = len - total;
+		memcpy(data + total, p, n);
+		UartRxConsume(port, n);
+		total += n;
 	}
+	return total;
 }
 
 u16 UartWrite(u8 port,u8 *data,u16 len)
@@ -104,13 +315,12 @@ u16 UartWrite(u8 port,u8 *data,u16 len)
 	if(port >= COM_PORT_MAX) {
 		return 0;
 	} else {
-		USART_TypeDef *pUart = UartDevice[port].uart;
-		uart_fifo_t *pfifo = &UartDevice[port].fifo;
-		u8 c;
-		
-		tx_count = _uart_write_isr(&UartDevice[port].fifo, UartDevice[port].uart, data, len);
+#if UART_DMA_ENABLE
+		tx_count = _uart_write_dma(&UartDevice[port], data, len);
+#else
+		tx_count = _uart_write_isr(&UartDevice[port], data, len);
 		USART_ITConfig(UartDevice[port].uart, USART_IT_TXE, ENABLE);
-		
+#endif
 		return tx_count;
 	}
 }
@@ -208,9 +418,15 @@ void UartDevSetup(u8 port, uart_setup_t setup)
 {
 	UartDevice[port].uart 			= UartTable[port];
 	
-	UartDevice[port].fifo.rxCnt		= UartDevice[port].fifo.txCnt  = 0;
-	UartDevice[port].fifo.rxPush	= UartDevice[port].fifo.txPop  = 0;        
+	UartDevice[port].fifo.rxPush	= UartDevice[port].fifo.rxPop  = 0;
 	UartDevice[port].fifo.txPush	= UartDevice[port].fifo.txPop  = 0;
+#if !UART_DMA_ENABLE
+	/* Free running indices are masked, round the sizes down to a power of two */
+	while(setup.rxSize & (setup.rxSize - 1))
+		setup.rxSize &= setup.rxSize - 1;
+	while(setup.txSize & (setup.txSize - 1))
+		setup.txSize &= setup.txSize - 1;
+#endif
 	UartDevice[port].fifo.rxSize	= setup.rxSize;
 	UartDevice[port].fifo.rxBuf		= setup.rxBuf;
 	UartDevice[port].fifo.txSize	= setup.txSize;
@@ -225,6 +441,13 @@ void UartDevSetup(u8 port, uart_setup_t setup)
 	UartDevice[port].stat.count_overrun	= 0x00;
 	UartDevice[port].stat.count_tim_ethtx = 0x00;
 	UartDevice[port].stat.count_ovf_ethtx = 0x00;
+	UartDevice[port].stat.rx_highwater	= 0x00;
+	UartDevice[port].stat.count_rxdrop	= 0x00;
+	UartDevice[port].stat.count_dma_ht	= 0x00;
+	UartDevice[port].stat.count_dma_tc	= 0x00;
+#if UART_DMA_ENABLE
+	UartDevice[port].dma.frameGap		= UART_FRAME_GAP_DEFAULT;
+#endif
 }
 
 uart_dev_t *GetUartDev(u8 port)
@@ -271,8 +494,12 @@ void UartLowInit(u8 port, USART_InitTypeDef *pUSART_InitStructure)
 			NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
 			NVIC_Init( &NVIC_InitStructure );
 
+#if UART_DMA_ENABLE
+			_uart_dma_init(port);
+#else
 			/* Enable the USART interrupt */
 			USART_ITConfig(COM_PORT0, USART_IT_RXNE, ENABLE);
+#endif
 			/* Idle line detection interrupt */
 			USART_ITConfig(COM_PORT0, USART_IT_IDLE, ENABLE); 
 			
@@ -312,8 +539,12 @@ void UartLowInit(u8 port, USART_InitTypeDef *pUSART_InitStructure)
 			NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
 			NVIC_Init( &NVIC_InitStructure );
 
+#if UART_DMA_ENABLE
+			_uart_dma_init(port);
+#else
 			/* Enable the USART interrupt */
 			USART_ITConfig(COM_PORT1, USART_IT_RXNE, ENABLE);
+#endif
 			/* Idle line detection interrupt */
 			USART_ITConfig(COM_PORT1, USART_IT_IDLE, ENABLE); 
 			
@@ -327,164 +558,187 @@ void UartLowInit(u8 port, USART_InitTypeDef *pUSART_InitStructure)
 
 
 
-void USART1_IRQHandler(void)
+#if UART_DMA_ENABLE
+static void _uart_dma_usart_isr(u8 port)
 {
 	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-	USART_TypeDef *uart = UartDevice[COM_PORT_0].uart;
-	uart_fifo_t *pfifo = &UartDevice[COM_PORT_0].fifo;
-	u32 iflag;
-	u8 c,event = 0;
-	__disable_interrupt();
-	iflag = (uart->SR & (USART_FLAG_TXE | USART_FLAG_RXNE | USART_FLAG_IDLE));
-	__enable_interrupt();
-	if(iflag & USART_FLAG_IDLE) {
-		c = uart->DR;
-		if(pfifo->rxCnt <= (pfifo->rxSize >> 1)) {
-			event |=  UART_RX_IDLE;
-			UartDevice[COM_PORT_0].stat.count_rxidle++;
-		}
-	}
+	uart_dev_t *dev = &UartDevice[port];
+	USART_TypeDef *uart = dev->uart;
 	
-	if(iflag & USART_FLAG_RXNE) {
-		c = uart->DR;
-		if(pfifo->rxCnt < pfifo->rxSize) {
-			pfifo->rxBuf[pfifo->rxPush] = c;
-			pfifo->rxPush += 1;
-			if(pfifo->rxPush >= pfifo->rxSize)
-				pfifo->rxPush = 0;
-			pfifo->rxCnt += 1;
-			if(pfifo->rxCnt == pfifo->rxSize) {
-				event |= UART_RX_FULL;
-				UartDevice[COM_PORT_0].stat.count_rxfull++;
-			}
-			else if(pfifo->rxCnt > (pfifo->rxSize >> 1)) {
-				event |= UART_RX_OVF;
-				UartDevice[COM_PORT_0].stat.count_rxovf++;
-			}
-		}
+	if(USART_GetITStatus(uart, USART_IT_IDLE) == SET) {
+		/* SR then DR read clears IDLE, RXNE is always drained by DMA first */
+		(void)uart->DR;
+		dev->dma.rxIdleCnt++;
+		dev->stat.count_rxidle++;
+		xSemaphoreGiveFromISR(xSemUartRx[port], &xHigherPriorityTaskWoken);
 	}
 
-	if(iflag & USART_FLAG_TXE) {
-		uart->CR1 &= (uint16_t)~0x0080;
-		if(pfifo->txCnt) {
-			c = pfifo->txBuf[pfifo->txPop];
-			uart->DR = c;	
-			uart->CR1 |= (uint16_t)0x0080;
-			pfifo->txPop += 1;
-			if(pfifo->txPop >= pfifo->txSize)
-				pfifo->txPop = 0;
-			pfifo->txCnt -= 1;
-			if(pfifo->txCnt == 0) {
-				USART_ITConfig(uart, USART_IT_TXE, DISABLE);	
-				event |=  UART_TX_DONE;
-				UartDevice[COM_PORT_0].stat.count_txdone++;
-				#if 1
-				__disable_interrupt();
-				while (USART_GetFlagStatus(uart, USART_FLAG_TC) == RESET) {}
-				__enable_interrupt();
-				RS485RxEnable(COM_PORT_0);
-				#endif
-			}		
-		}
+	/* Last byte left the shift register, turn the RS485 transceiver round */
+	if(USART_GetITStatus(uart, USART_IT_TC) == SET) {
+		USART_ITConfig(uart, USART_IT_TC, DISABLE);
+		USART_ClearITPendingBit(uart, USART_IT_TC);
+		if(port == COM_PORT_0)
+			RS485RxEnable(port);
+		dev->dma.txBusy = 0;
+		dev->stat.count_txdone++;
+		xSemaphoreGiveFromISR(xSemUartTx[port], &xHigherPriorityTaskWoken);
 	}
 
-	if(USART_GetFlagStatus(UartTable[COM_PORT_0], USART_FLAG_ORE) == SET) {
-		UartDevice[COM_PORT_0].stat.count_overrun++;
-		USART_ClearFlag(UartTable[COM_PORT_0],USART_FLAG_ORE);
-		USART_ReceiveData(UartTable[COM_PORT_0]);	
+	if(USART_GetFlagStatus(uart, USART_FLAG_ORE) == SET) {
+		dev->stat.count_overrun++;
+		USART_ClearFlag(uart, USART_FLAG_ORE);
+		USART_ReceiveData(uart);	
 	}
 
-	if((event & UART_RX_OVF) || (event & UART_RX_FULL) || (event & UART_RX_IDLE)) {
-		xSemaphoreGiveFromISR(xSemUartRx[COM_PORT_0], &xHigherPriorityTaskWoken );
+	if( xHigherPriorityTaskWoken != pdFALSE ) {
+		portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
 	}
+}
 
-	if(event & UART_TX_DONE) {
-		xSemaphoreGiveFromISR(xSemUartTx[COM_PORT_0], &xHigherPriorityTaskWoken );
+/* Half/full transfer: wake the receive task so it drains before the stream laps */
+static void _uart_dma_rx_isr(u8 port)
+{
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+	uart_dev_t *dev = &UartDevice[port];
+
+	if(DMA_GetITStatus(dev->dma.rxStream, dev->dma.rxItHT) == SET) {
+		DMA_ClearITPendingBit(dev->dma.rxStream, dev->dma.rxItHT);
+		dev->stat.count_dma_ht++;
 	}
+	if(DMA_GetITStatus(dev->dma.rxStream, dev->dma.rxItTC) == SET) {
+		DMA_ClearITPendingBit(dev->dma.rxStream, dev->dma.rxItTC);
+		dev->stat.count_dma_tc++;
+	}
+	xSemaphoreGiveFromISR(xSemUartRx[port], &xHigherPriorityTaskWoken);
 
 	if( xHigherPriorityTaskWoken != pdFALSE ) {
 		portEND_SWITCHING_ISR( xHigherPriorityTaskWoken );
 	}
 }
 
+static void _uart_dma_tx_isr(u8 port)
+{
+	uart_dev_t *dev = &UartDevice[port];
+
+	if(DMA_GetITStatus(dev->dma.txStream, dev->dma.txItTC) == SET) {
+		DMA_ClearITPendingBit(dev->dma.txStream, dev->dma.txItTC);
+		/* Transfer done, wait the USART TC before releasing the line */
+		USART_ITConfig(dev->uart, USART_IT_TC, ENABLE);
+	}
+}
+
+void USART1_IRQHandler(void)
+{
+	_uart_dma_usart_isr(COM_PORT_0);
+}
+
 void USART2_IRQHandler(void)
+{
+	_uart_dma_usart_isr(COM_PORT_1);
+}
+
+void DMA2_Stream2_IRQHandler(void)
+{
+	_uart_dma_rx_isr(COM_PORT_0);
+}
+
+void DMA2_Stream7_IRQHandler(void)
+{
+	_uart_dma_tx_isr(COM_PORT_0);
+}
+
+void DMA1_Stream5_IRQHandler(void)
+{
+	_uart_dma_rx_isr(COM_PORT_1);
+}
+
+void DMA1_Stream6_IRQHandler(void)
+{
+	_uart_dma_tx_isr(COM_PORT_1);
+}
+
+#else
+
+static void _uart_isr(u8 port)
 {
 	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
-	USART_TypeDef *uart = UartDevice[COM_PORT_1].uart;
-	uart_fifo_t *pfifo = &UartDevice[COM_PORT_1].fifo;
-	u32 iflag,ie;
+	uart_dev_t *dev = &UartDevice[port];
+	uart_fifo_t *pfifo = &dev->fifo;
+	USART_TypeDef *uart = dev->uart;
+	u16 idx, n;
 	u8 c,event = 0;
-#if 1
-	__disable_interrupt();
-	iflag = (uart->SR & (USART_FLAG_TXE | USART_FLAG_RXNE | USART_FLAG_IDLE));
-	__enable_interrupt();
-#else
-	ie = __get_PRIMASK();
-	__set_PRIMASK(1);
-	iflag = (uart->CR1 & (USART_FLAG_TXE|USART_FLAG_TC|USART_FLAG_RXNE|USART_FLAG_IDLE) & uart->SR);
-	__set_PRIMASK(ie);
-#endif
 
-	//if(iflag & USART_FLAG_IDLE) {
 	if(USART_GetITStatus(uart, USART_IT_IDLE) == SET) {
 		c = uart->DR;
-		if(pfifo->rxCnt <= (pfifo->rxSize >> 1)) {
+		if((u16)(pfifo->rxPush - pfifo->rxPop) <= (pfifo->rxSize >> 1)) {
 			event |=  UART_RX_IDLE;
-			UartDevice[COM_PORT_1].stat.count_rxidle++;
+			dev->stat.count_rxidle++;
 		}
 	}
 	
-	//if(iflag & USART_FLAG_RXNE) {
 	if(USART_GetITStatus(uart, USART_IT_RXNE) == SET) {
 		c = uart->DR;
-		if(pfifo->rxCnt < pfifo->rxSize) {
-			pfifo->rxBuf[pfifo->rxPush] = c;
-			pfifo->rxPush += 1;
-			if(pfifo->rxPush >= pfifo->rxSize)
-				pfifo->rxPush = 0;
-			pfifo->rxCnt += 1;
-			if(pfifo->rxCnt == pfifo->rxSize) {
+		idx = pfifo->rxPush;
+		n = (u16)(idx - pfifo->rxPop);
+		if(n < pfifo->rxSize) {
+			pfifo->rxBuf[idx & (pfifo->rxSize - 1)] = c;
+			UART_FIFO_BARRIER();
+			pfifo->rxPush = idx + 1;
+			n += 1;
+			if(n > dev->stat.rx_highwater)
+				dev->stat.rx_highwater = n;
+			if(n == pfifo->rxSize) {
 				event |= UART_RX_FULL;
-				UartDevice[COM_PORT_1].stat.count_rxfull++;
+				dev->stat.count_rxfull++;
 			}
-			else if(pfifo->rxCnt > (pfifo->rxSize >> 1)) {
+			else if(n > (pfifo->rxSize >> 1)) {
 				event |= UART_RX_OVF;
-				UartDevice[COM_PORT_1].stat.count_rxovf++;
+				dev->stat.count_rxovf++;
 			}
+		} else {
+			dev->stat.count_rxdrop++;
 		}
 	}
 
-	//if(iflag & USART_FLAG_TXE) {
-	if( USART_GetITStatus(uart, USART_IT_TXE) == SET) {
-		uart->CR1 &= (uint16_t)~0x0080;
-		if(pfifo->txCnt) {
-			c = pfifo->txBuf[pfifo->txPop];
-			uart->DR = c;
-			uart->CR1 |= (uint16_t)0x0080;
-			pfifo->txPop += 1;
-			if(pfifo->txPop >= pfifo->txSize)
-				pfifo->txPop = 0;
-			pfifo->txCnt -= 1;
-			if(pfifo->txCnt == 0) {
-				USART_ITConfig(uart, USART_IT_TXE, DISABLE);
-				event |=  UART_TX_DONE;
-				UartDevice[COM_PORT_1].stat.count_txdone++;
-			}		
+	if(USART_GetITStatus(uart, USART_IT_TXE) == SET) {
+		idx = pfifo->txPop;
+		if(idx != pfifo->txPush) {
+			UART_FIFO_BARRIER();
+			uart->DR = pfifo->txBuf[idx & (pfifo->txSize - 1)];
+			UART_FIFO_BARRIER();
+			pfifo->txPop = idx + 1;
+		}
+		if(pfifo->txPop == pfifo->txPush) {
+			/* Last byte loaded, finish on TC rather than spinning here */
+			USART_ITConfig(uart, USART_IT_TXE, DISABLE);
+			USART_ITConfig(uart, USART_IT_TC, ENABLE);
 		}
 	}
 
-	if(USART_GetFlagStatus(UartTable[COM_PORT_1], USART_FLAG_ORE) == SET) {
-		USART_ClearFlag(UartTable[COM_PORT_1],USART_FLAG_ORE);
-		USART_ReceiveData(UartTable[COM_PORT_1]);	
-		UartDevice[COM_PORT_1].stat.count_overrun++;		
+	/* Last byte left the shift register, turn the RS485 transceiver round */
+	if(USART_GetITStatus(uart, USART_IT_TC) == SET) {
+		USART_ITConfig(uart, USART_IT_TC, DISABLE);
+		USART_ClearITPendingBit(uart, USART_IT_TC);
+		if(pfifo->txPop == pfifo->txPush) {
+			if(port == COM_PORT_0)
+				RS485RxEnable(port);
+			event |=  UART_TX_DONE;
+			dev->stat.count_txdone++;
+		}
 	}
-	
+
+	if(USART_GetFlagStatus(uart, USART_FLAG_ORE) == SET) {
+		dev->stat.count_overrun++;
+		USART_ClearFlag(uart, USART_FLAG_ORE);
+		USART_ReceiveData(uart);	
+	}
+
 	if((event & UART_RX_OVF) || (event & UART_RX_FULL) || (event & UART_RX_IDLE)) {
-		xSemaphoreGiveFromISR(xSemUartRx[COM_PORT_1], &xHigherPriorityTaskWoken );
+		xSemaphoreGiveFromISR(xSemUartRx[port], &xHigherPriorityTaskWoken );
 	}
 
 	if(event & UART_TX_DONE) {
-		xSemaphoreGiveFromISR(xSemUartTx[COM_PORT_1], &xHigherPriorityTaskWoken );
+		xSemaphoreGiveFromISR(xSemUartTx[port], &xHigherPriorityTaskWoken );
 	}
 
 	if( xHigherPriorityTaskWoken != pdFALSE ) {
@@ -492,6 +746,17 @@ void USART2_IRQHandler(void)
 	}
 }
 
+void USART1_IRQHandler(void)
+{
+	_uart_isr(COM_PORT_0);
+}
+
+void USART2_IRQHandler(void)
+{
+	_uart_isr(COM_PORT_1);
+}
+
+#endif /* UART_DMA_ENABLE */
 
 #endif
 
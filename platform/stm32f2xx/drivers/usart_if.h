@@ -22,6 +22,13 @@
 #define UART_RX_FULL  					0x04		/* Rx buffer is full */
 #define UART_TX_DONE  					0x08		/* Tx Buffer is empty */
 
+/* Move RX/TX through DMA streams, frames are closed by USART idle line */
+#define UART_DMA_ENABLE					1
+/* Inter-character gap (ms) that closes a frame, 0 means idle line only */
+#define UART_FRAME_GAP_DEFAULT			0
+/* Longest time (ms) a partial frame waits in the buffer */
+#define UART_FRAME_TIMEOUT				200
+
 /*************************************************************************
  * Definition for COM port0, connected to USART1                     
  * TX pin: PA9, RX pin: PA10 
@@ -39,6 +46,15 @@
 #define COM_PORT0_RX_SOURCE				GPIO_PinSource10
 #define COM_PORT0_RX_AF					GPIO_AF_USART1
 #define COM_PORT0_IRQn 					USART1_IRQn
+#define COM_PORT0_DMA_CLK				RCC_AHB1Periph_DMA2
+#define COM_PORT0_DMA_CHANNEL			DMA_Channel_4
+#define COM_PORT0_RX_DMA_STREAM			DMA2_Stream2
+#define COM_PORT0_RX_DMA_IRQn			DMA2_Stream2_IRQn
+#define COM_PORT0_RX_DMA_IT_HT			DMA_IT_HTIF2
+#define COM_PORT0_RX_DMA_IT_TC			DMA_IT_TCIF2
+#define COM_PORT0_TX_DMA_STREAM			DMA2_Stream7
+#define COM_PORT0_TX_DMA_IRQn			DMA2_Stream7_IRQn
+#define COM_PORT0_TX_DMA_IT_TC			DMA_IT_TCIF7
 
 /*************************************************************************
  * Definition for COM port1, connected to USART2                     
@@ -57,6 +73,15 @@
 #define COM_PORT1_RX_SOURCE             GPIO_PinSource6
 #define COM_PORT1_RX_AF                 GPIO_AF_USART2
 #define COM_PORT1_IRQn                  USART2_IRQn
+#define COM_PORT1_DMA_CLK               RCC_AHB1Periph_DMA1
+#define COM_PORT1_DMA_CHANNEL           DMA_Channel_4
+#define COM_PORT1_RX_DMA_STREAM         DMA1_Stream5
+#define COM_PORT1_RX_DMA_IRQn           DMA1_Stream5_IRQn
+#define COM_PORT1_RX_DMA_IT_HT          DMA_IT_HTIF5
+#define COM_PORT1_RX_DMA_IT_TC          DMA_IT_TCIF5
+#define COM_PORT1_TX_DMA_STREAM         DMA1_Stream6
+#define COM_PORT1_TX_DMA_IRQn           DMA1_Stream6_IRQn
+#define COM_PORT1_TX_DMA_IT_TC          DMA_IT_TCIF6
 
 /*************************************************************************
  * Definition for COM port1, connected to USART5                     
@@ -87,18 +112,20 @@ typedef __packed struct {
 } uart_setup_t;
 
 /* Private typedef */
-typedef __packed struct _uart_fifo {
+/* Not packed: the indices are shared with the isr without locking and must
+   stay single aligned halfword accesses. In isr mode each index is moved by
+   one side only and runs free, masked with Size - 1 (sizes are a power of
+   two). In dma mode rxPush/rxPop are plain offsets into rxBuf. */
+typedef struct _uart_fifo {
 	u8*		rxBuf;
 	u16		rxSize;
 	vu16	rxPush;
 	vu16	rxPop;
-	vu16	rxCnt;
 	
 	u8*		txBuf;
 	u16		txSize;
 	vu16	txPush;
 	vu16	txPop;
-	vu16	txCnt;
 } uart_fifo_t;
 
 typedef __packed struct _uart_property {
@@ -119,13 +146,32 @@ typedef struct _uart_stat {
 	u32	count_overrun;
 	u32	count_tim_ethtx;
 	u32	count_ovf_ethtx;
+	u32	rx_highwater;		/* Most bytes ever waiting in rxBuf */
+	u32	count_rxdrop;		/* Bytes lost to a full rxBuf */
+	u32	count_dma_ht;		/* Rx DMA half transfer, normal progress in circular mode */
+	u32	count_dma_tc;		/* Rx DMA transfer complete (buffer wrap) */
 } uart_stat_t;
 
+typedef struct _uart_dma {
+	DMA_Stream_TypeDef*	rxStream;
+	DMA_Stream_TypeDef*	txStream;
+	u32		rxItHT;
+	u32		rxItTC;
+	u32		txItTC;
+	vu8		rxIdleCnt;		/* Bumped by the USART isr on each idle line */
+	u8		rxIdleSeen;		/* Last rxIdleCnt consumed by the receive task */
+	vu8		txBusy;
+	u16		frameGap;		/* Inter-character gap (ms), 0 = idle line framing */
+} uart_dma_t;
+
 typedef struct _uart_dev {
 	USART_TypeDef*	uart;	
 	uart_fifo_t		fifo;
 	uart_stat_t		stat;
 	uart_property_t property;
+#if UART_DMA_ENABLE
+	uart_dma_t		dma;
+#endif
 } uart_dev_t;
 
 /* Exported functions ------------------------------------------------------- */
@@ -134,6 +180,11 @@ void UartDevSetup(u8 port, uart_setup_t setup);
 
 u16 UartRead(u8 port,u8 *data,u16 len);
 u16 UartWrite(u8 port,u8 *data,u16 len);
+u16 UartRxSpan(u8 port, u8 **pp);
+void UartRxConsume(u8 port, u16 len);
+u8 UartRxIdle(u8 port);
+void UartSetFrameGap(u8 port, u16 gap_ms);
+u16 UartGetFrameGap(u8 port);
 
 
 void UartLedOn(u8 port);
@@ -0,0 +1,58 @@
+/*******************************************************************************
+  * @file    ob_boot_slot.c
+  * @author  OB T&C Development Team
+  * @brief   A/B boot slot selection, the eeprom and flash access stay with
+  *          the bootloader
+  ******************************************************************************/
+
+/* Includes ------------------------------------------------------------------*/
+#include "ob_boot_slot.h"
+
+/**************************************************************************
+  * @brief  Select the slot to boot. The caller writes the new state back
+  *         when it changed, then clears the upgrade flag if one was set.
+  *         A power cut before the state write repeats the same decision,
+  *         one after it and before the flag clear retries the new slot.
+  * @param  pState: boot state from eeprom, updated to the state to write,
+  *         left alone when no slot is bootable
+  *         upgrade_flag: OB_UPGRADE_FLAG_xxx from eeprom
+  *         check: 0 if the slot can boot, full also checks the data CRC
+  * @retval Slot to boot, -1 if no slot is bootable
+  *************************************************************************/
+int OB_Boot_Slot_Select(unsigned char *pState, unsigned char upgrade_flag, int (*check)(unsigned char slot, int full))
+{
+	unsigned char state = *pState, slot, tries;
+
+	if(!OB_BOOT_STATE_VALID(state))
+		state = OB_BOOT_STATE(OB_SLOT_A, 0);
+	slot = OB_BOOT_STATE_SLOT(state);
+	tries = OB_BOOT_STATE_TRIES(state);
+
+	if((upgrade_flag == OB_UPGRADE_FLAG_SLOT_A) || (upgrade_flag == OB_UPGRADE_FLAG_SLOT_B)) {
+		slot = (upgrade_flag == OB_UPGRADE_FLAG_SLOT_B) ? OB_SLOT_B : OB_SLOT_A;
+		if(check(slot, 1) == 0) {
+			/* First trial boot of the new slot */
+			state = OB_BOOT_STATE(slot, 1);
+		} else {
+			slot = OB_BOOT_STATE_SLOT(state);
+		}
+	} else if(tries > 0) {
+		/* The application did not confirm the slot */
+		if(tries >= OB_BOOT_MAX_TRIES) {
+			slot ^= 1;
+			state = OB_BOOT_STATE(slot, 0);
+		} else {
+			state = OB_BOOT_STATE(slot, tries + 1);
+		}
+	}
+
+	if(check(slot, 0) != 0) {
+		slot ^= 1;
+		if(check(slot, 0) != 0)
+			return -1;
+		state = OB_BOOT_STATE(slot, 0);
+	}
+
+	*pState = state;
+	return slot;
+}
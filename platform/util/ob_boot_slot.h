@@ -0,0 +1,34 @@
+#ifndef __OB_BOOT_SLOT_H
+#define __OB_BOOT_SLOT_H
+
+/* Flash and eeprom layout of the A/B boot slots. The bootloader and the
+   firmware both include this file, so they always agree on it. */
+
+/* A/B boot slots (BOOT_AB_SLOT). Each slot starts with the image header,
+   the application is linked to run in place with its vector table at
+   OB_SLOT_VECTOR_OFFSET, VTOR needs 512 bytes alignment */
+#define OB_SLOT_A					0
+#define OB_SLOT_B					1
+#define OB_SLOT_A_ADDRESS			0x08010000
+#define OB_SLOT_B_ADDRESS			0x08080000
+#define OB_SLOT_A_SIZE				0x00070000
+#define OB_SLOT_B_SIZE				0x00080000
+#define OB_SLOT_VECTOR_OFFSET		0x200
+
+/* Upgrade flag in eeprom, the slot holding the new image */
+#define OB_UPGRADE_FLAG_NONE		0x00
+#define OB_UPGRADE_FLAG_SLOT_B		0x80			/* Also the flag of the copy install */
+#define OB_UPGRADE_FLAG_SLOT_A		0x81
+
+/* Boot state byte in eeprom, one byte so every update is atomic.
+   Bit0 is the active slot, bit6:4 the boots of a slot not yet confirmed
+   by the application, 0 when confirmed. 0xFF (blank) means slot A. */
+#define OB_BOOT_MAX_TRIES			3
+#define OB_BOOT_STATE(slot, tries)	((unsigned char)((((tries) & 0x7) << 4) | ((slot) & 0x1)))
+#define OB_BOOT_STATE_VALID(s)		(((s) & 0x8E) == 0)
+#define OB_BOOT_STATE_SLOT(s)		((s) & 0x1)
+#define OB_BOOT_STATE_TRIES(s)		(((s) >> 4) & 0x7)
+
+int OB_Boot_Slot_Select(unsigned char *pState, unsigned char upgrade_flag, int (*check)(unsigned char slot, int full));
+
+#endif	/* __OB_BOOT_SLOT_H */
@@ -31,6 +31,9 @@
 #define	IH_DATA_FORMAT_BIN			0x01			/* Binary */
 #define	IH_DATA_FORMAT_SREC			0x02			/* S-Record */
 
+/* A/B boot slots and boot state, shared with the bootloader */
+#include "ob_boot_slot.h"
+
 
 /* Exported types ------------------------------------------------------------*/
 
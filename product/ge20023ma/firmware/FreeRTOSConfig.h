@@ -98,6 +98,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskSuspend			1
 #define INCLUDE_vTaskDelayUntil			0
 #define INCLUDE_vTaskDelay		        1
+#define INCLUDE_xTaskGetSchedulerState	1
 
 /* This is the raw value as per the Cortex-M3 NVIC.  Values can be 255
 (lowest) to 0 (1?) (highest). */
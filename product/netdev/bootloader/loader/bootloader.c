@@ -30,6 +30,8 @@
 #define DEFAULT_APP_ENTRY_ADDRESS	((uint32_t)0x08010000)
 #define PRIMARY_PARTITION_ADDRESS	((uint32_t)0x08010000)
 #define SECOND_PARTITION_ADDRESS	((uint32_t)0x08080000)
+#define PRIMARY_PARTITION_SIZE		(SECOND_PARTITION_ADDRESS - PRIMARY_PARTITION_ADDRESS)
+#define INSTALL_CHUNK_SIZE			0x4000	/* CRC of the copy is updated per chunk */
 
 #define BootPrint(fmt, args...) do { if(gConsoleEnable) printf(fmt, ##args); } while(0)
 
@@ -180,15 +182,148 @@ void FPGA_LoadCheck(void)
     
 }
 
+#if BOOT_AB_SLOT
+static uint32_t SlotAddress(u8 slot)
+{
+	return (slot == OB_SLOT_B) ? OB_SLOT_B_ADDRESS : OB_SLOT_A_ADDRESS;
+}
+
+/**************************************************************************
+  * @brief  Check the image of a slot can run in place, the data CRC is
+  *         only checked when the slot is installed
+  * @param  slot, full: check data CRC too
+  * @retval 0: OK, -1: not bootable
+  *************************************************************************/
+static int SlotImageCheck(u8 slot, int full)
+{
+	unsigned int size, crc, load;
+	uint32_t base = SlotAddress(slot);
+
+	if(OB_Check_Image_Header(base, &size, &crc, &load) != IHCHK_OK)
+		return -1;
+	if((load != base + OB_SLOT_VECTOR_OFFSET) || (size + sizeof(OB_Image_Header_t) > ((slot == OB_SLOT_B) ? OB_SLOT_B_SIZE : OB_SLOT_A_SIZE)))
+		return -1;
+	if(full && (crc32(0, (unsigned char *)(base + sizeof(OB_Image_Header_t)), size) != crc))
+		return -1;
+	if(((*(__IO uint32_t*)load) & 0x2FFE0000 ) != 0x20000000)
+		return -1;
+	return 0;
+}
+
+/* OB_Boot_Slot_Select callback, reports what it finds */
+static int SlotCheck(unsigned char slot, int full)
+{
+	int ret;
+
+	if(full)
+		BootPrint("Verifing the image at 0x%08X ... ", SlotAddress(slot));
+	ret = SlotImageCheck(slot, full);
+	if(full)
+		BootPrint((ret == 0) ? "Passed\r\n" : "Failed\r\n");
+	else if(ret != 0)
+		BootPrint("Slot %c is not bootable\r\n", 'A' + slot);
+	return ret;
+}
+
+/**************************************************************************
+  * @brief  Select the slot to boot. Every eeprom update is one byte and
+  *         leaves a state which boots, so a power cut at any point is safe.
+  * @param  None
+  * @retval Vector table address, 0 if no slot is bootable
+  *************************************************************************/
+static uint32_t BootSlotSelect(void)
+{
+	unsigned char upgrade_flag, state, old_state;
+	int slot;
+
+	if(eeprom_read(EPROM_ADDR_BOOT_STATE, &old_state, 1) != I2C_SUCCESS)
+		old_state = OB_BOOT_STATE(OB_SLOT_A, 0);
+	if(eeprom_read(EPROM_ADDR_UPGRADE_FLAG, &upgrade_flag, 1) != I2C_SUCCESS)
+		upgrade_flag = OB_UPGRADE_FLAG_NONE;
+	if((upgrade_flag == OB_UPGRADE_FLAG_SLOT_A) || (upgrade_flag == OB_UPGRADE_FLAG_SLOT_B))
+		BootPrint("Detected upgrade flag bit\r\n");
+	else if(OB_BOOT_STATE_VALID(old_state) && (OB_BOOT_STATE_TRIES(old_state) >= OB_BOOT_MAX_TRIES))
+		BootPrint("Slot %c not confirmed after %d boots, fall back\r\n",
+			'A' + OB_BOOT_STATE_SLOT(old_state), OB_BOOT_STATE_TRIES(old_state));
+
+	state = old_state;
+	slot = OB_Boot_Slot_Select(&state, upgrade_flag, SlotCheck);
+
+	if(state != old_state) {
+		eeprom_write(EPROM_ADDR_BOOT_STATE, &state, 1);
+		TimerDelayMs(10);
+	}
+	if((upgrade_flag == OB_UPGRADE_FLAG_SLOT_A) || (upgrade_flag == OB_UPGRADE_FLAG_SLOT_B)) {
+		upgrade_flag = OB_UPGRADE_FLAG_NONE;
+		eeprom_write(EPROM_ADDR_UPGRADE_FLAG, &upgrade_flag, 1);
+		TimerDelayMs(10);
+	}
+	if(slot < 0)
+		return 0;
+
+	BootPrint("Boot slot %c\r\n", 'A' + slot);
+	return SlotAddress(slot) + OB_SLOT_VECTOR_OFFSET;
+}
+
+#else
+/**************************************************************************
+  * @brief  Install the image of the second partition to the primary one.
+  *         Only the sectors covered by the image are erased, and the CRC
+  *         of the copy is computed while it is written. The source data
+  *         was checked before the upgrade flag was set, so it is not read
+  *         twice. The upgrade flag stays set until the copy is verified,
+  *         a power cut repeats the install.
+  * @param  fmSize, fmCrc32: data size and CRC from the image header
+  * @retval 0: success, -1: failure
+  *************************************************************************/
+static int CopyInstall(unsigned int fmSize, unsigned int fmCrc32)
+{
+	unsigned int writeAddress, readAddress, offset, len;
+	unsigned long crc = 0;
+
+	if((fmSize == 0) || (fmSize > PRIMARY_PARTITION_SIZE))
+		return -1;
+
+	BootPrint("Erasing flash sector   ... ");
+	FLASH_If_Init();
+	if(FLASH_If_Erase(PRIMARY_PARTITION_ADDRESS, PRIMARY_PARTITION_ADDRESS + fmSize - 1) != 0) {
+		BootPrint("Failed\r\n");
+		return -1;
+	}
+	BootPrint("Done\r\n");
+
+	BootPrint("Upgrading firmware     ... ");
+	writeAddress = PRIMARY_PARTITION_ADDRESS;
+	readAddress = SECOND_PARTITION_ADDRESS + sizeof(OB_Image_Header_t);
+	for(offset = 0; offset < fmSize; offset += len) {
+		len = ((fmSize - offset) > INSTALL_CHUNK_SIZE) ? INSTALL_CHUNK_SIZE : (fmSize - offset);
+		if(FLASH_If_Write(&writeAddress, (uint32_t *)(readAddress + offset), len) != 0) {
+			BootPrint("Failed\r\n");
+			return -1;
+		}
+		crc = crc32(crc, (unsigned char *)(PRIMARY_PARTITION_ADDRESS + offset), len);
+	}
+	if(crc != fmCrc32) {
+		BootPrint("Failed, CRC-32 0x%08X\r\n", crc);
+		return -1;
+	}
+	BootPrint("Done\r\n");
+
+	return 0;
+}
+#endif
+
 void main(void) 
 {
 	int i, ret, loop; 
 	unsigned char bootdelay, console_enable, abort=0;
 	RCC_ClocksTypeDef rcc_clocks;
 	ManuInfo_t	DevManuInfo;
+#if !BOOT_AB_SLOT
 	unsigned char upgrade_flag=0;
 	unsigned int fmSize=0, fmCrc32=0;
-	unsigned int writeAddress, readAddress;
+#endif
+	uint32_t BootAddress;
 	char loader_ver[MAX_LOADER_VERSION_SIZE];
 	
 	TimerInit();
@@ -300,62 +435,50 @@ void main(void)
 		} 
 	}
 
+#if BOOT_AB_SLOT
+	if((BootAddress = BootSlotSelect()) == 0)
+		goto exit;
+#else
 	if(eeprom_read(EPROM_ADDR_UPGRADE_FLAG, &upgrade_flag, 1) == I2C_SUCCESS) {
-		if(upgrade_flag == 0x80) {
+		if(upgrade_flag == OB_UPGRADE_FLAG_SLOT_B) {
 			BootPrint("Detected upgrade flag bit\r\n");
-			BootPrint("Verifing the image at 0x08080000 ... ");
-			if(OB_Check_Upgrade_Image(0x8080000, &fmSize, &fmCrc32) == IHCHK_OK) {
+			BootPrint("Checking the image at 0x08080000 ... ");
+			if(OB_Check_Image_Header(SECOND_PARTITION_ADDRESS, &fmSize, &fmCrc32, NULL) == IHCHK_OK) {
 				BootPrint("Passed\r\n");
-				BootPrint("Erasing flash sector   ... ");
-				FLASH_If_Init();
-				FLASH_If_Erase(0x08010000, 0x0807FFFF);
-				BootPrint("Done\r\n");
-				BootPrint("Upgrading firmware     ... ");
-				writeAddress = PRIMARY_PARTITION_ADDRESS;
-				readAddress = SECOND_PARTITION_ADDRESS + sizeof(OB_Image_Header_t);
-				if(FLASH_If_Write(&writeAddress, (uint32_t *)readAddress, fmSize) != 0) {
-					BootPrint("Failed\r\n");
+				if(CopyInstall(fmSize, fmCrc32) != 0) {
 					NVIC_SystemReset();
 				} else {
-					BootPrint("Done\r\n");
-					BootPrint("Verifing the image at 0x08010000 ... ");
-					if(crc32(0, (unsigned char *)(PRIMARY_PARTITION_ADDRESS), fmSize) != fmCrc32) {
-						BootPrint("Failed\r\n");
+					BootPrint("Firmware size: %d bytes, CRC-32: 0x%08X\r\n", fmSize, fmCrc32);
+					
+					/* Store the Fimware size and crc value to eeprom */
+					fmSize = htonl(fmSize);
+					fmCrc32 = htonl(fmCrc32);
+					if(eeprom_write(EPROM_ADDR_FIRMWARE_SIZE, (u8 *)&fmSize, 4) == I2C_FAILURE) {
+						BootPrint("Error: i2c write failed\r\n");
+						NVIC_SystemReset();
+					}
+					TimerDelayMs(10);
+					if(eeprom_write(EPROM_ADDR_FIRMWARE_CRC32, (u8 *)&fmCrc32, 4) == I2C_FAILURE){
+						BootPrint("Error: i2c write failed\r\n");
+						NVIC_SystemReset();
+					}
+					TimerDelayMs(10);
+					
+					/* Clear upgrade flag */
+					BootPrint("Clear upgrade flag bit ... ");
+					upgrade_flag = OB_UPGRADE_FLAG_NONE;
+					if(eeprom_write(EPROM_ADDR_UPGRADE_FLAG, (u8 *)&upgrade_flag, 1) == I2C_FAILURE) {
+						BootPrint("Failed, i2c write failed\r\n");
 						NVIC_SystemReset();
-					} else {	
-						BootPrint("Passed\r\n");
-						BootPrint("Firmware size: %d bytes, CRC-32: 0x%08X\r\n", fmSize, fmCrc32);
-						
-						/* Store the Fimware size and crc value to eeprom */
-						fmSize = htonl(fmSize);
-						fmCrc32 = htonl(fmCrc32);
-						if(eeprom_write(EPROM_ADDR_FIRMWARE_SIZE, (u8 *)&fmSize, 4) == I2C_FAILURE) {
-							BootPrint("Error: i2c write failed\r\n");
-							NVIC_SystemReset();
-						}
-						TimerDelayMs(10);
-						if(eeprom_write(EPROM_ADDR_FIRMWARE_CRC32, (u8 *)&fmCrc32, 4) == I2C_FAILURE){
-							BootPrint("Error: i2c write failed\r\n");
-							NVIC_SystemReset();
-						}
-						TimerDelayMs(10);
-						
-						/* Clear upgrade flag */
-						BootPrint("Clear upgrade flag bit ... ");
-						upgrade_flag = 0x00;
-						if(eeprom_write(EPROM_ADDR_UPGRADE_FLAG, (u8 *)&upgrade_flag, 1) == I2C_FAILURE) {
-							BootPrint("Failed, i2c write failed\r\n");
-							NVIC_SystemReset();
-						} else {
-							BootPrint("Done\r\n");
-						}
+					} else {
+						BootPrint("Done\r\n");
 					}
 				}
 			} else {
 				BootPrint("Failed\r\n");
 				/* Clear upgrade flag */
 				BootPrint("Clear upgrade flag bit ... ");
-				upgrade_flag = 0x00;
+				upgrade_flag = OB_UPGRADE_FLAG_NONE;
 				if(eeprom_write(EPROM_ADDR_UPGRADE_FLAG, (u8 *)&upgrade_flag, 1) == I2C_FAILURE) {
 					BootPrint("Failed, i2c write failed\r\n");
 				} else {
@@ -365,18 +488,20 @@ void main(void)
 			}
 		}
 	}
+	BootAddress = DEFAULT_APP_ENTRY_ADDRESS;
+#endif
 	
-	BootPrint("Now start application at 0x08010000 ...\r\n");
+	BootPrint("Now start application at 0x%08X ...\r\n", BootAddress);
 
 	if(gConsoleEnable)
 		ConsoleDisable();
 	TimerDisable();
 	
     /* Check if valid stack address (RAM address) then jump to user application */
-    if (((*(__IO uint32_t*)DEFAULT_APP_ENTRY_ADDRESS) & 0x2FFE0000 ) != 0x20000000)
+    if (((*(__IO uint32_t*)BootAddress) & 0x2FFE0000 ) != 0x20000000)
         goto exit;
-	NVIC_SetVectorTable(NVIC_VectTab_FLASH , DEFAULT_APP_ENTRY_ADDRESS - NVIC_VectTab_FLASH);
-    StartApp(DEFAULT_APP_ENTRY_ADDRESS);
+	NVIC_SetVectorTable(NVIC_VectTab_FLASH , BootAddress - NVIC_VectTab_FLASH);
+    StartApp(BootAddress);
 
 exit:
 #if BOARD_GE22103MA || BOARD_GV3S_HONUE_QM || BOARD_GE11500MD
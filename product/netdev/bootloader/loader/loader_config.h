@@ -13,6 +13,10 @@
 
 #define LOADER_VERSION			"1.5"
 
+/* 1: boot the application in place from A/B slots with trial boot and
+   fallback (images linked per slot), 0: copy install to 0x08010000 */
+#define BOOT_AB_SLOT 0
+
 #define BOARD_GE22103MA			0
 #define BOARD_GE20023MA			0
 #define BOARD_GE11014MA			0
@@ -122,6 +122,30 @@ int OB_Check_Upgrade_Image(unsigned int address, unsigned int *datasize, unsigne
 	return IHCHK_OK;
 }
 
+/* Check the image header only, the data is checked by the caller while it is used */
+int OB_Check_Image_Header(unsigned int address, unsigned int *datasize, unsigned int *checksum, unsigned int *loadaddr)
+{
+	OB_Image_Header_t OBHeader;
+	unsigned long checksum_head;
 
+	memcpy(&OBHeader, (unsigned char *)address, sizeof(OB_Image_Header_t));
+	
+	if(ntohl(OBHeader.Magic) != IH_MAGIC)
+		return IHCHK_ERR_MAGIC;
+	
+	checksum_head = ntohl(OBHeader.HeaderCRC32);
+	OBHeader.HeaderCRC32 = 0;
 
+	if(crc32(0, (unsigned char *)&OBHeader, sizeof(OB_Image_Header_t)) != checksum_head)
+		return IHCHK_ERR_HCRC;
+
+	if(datasize != NULL)
+		*datasize = ntohl(OBHeader.DataSize);
+	if(checksum != NULL)
+		*checksum = ntohl(OBHeader.DataCRC32);
+	if(loadaddr != NULL)
+		*loadaddr = ntohl(OBHeader.LoadAddress);
+	
+	return IHCHK_OK;
+}
 
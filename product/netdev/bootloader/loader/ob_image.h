@@ -31,6 +31,9 @@
 #define	IH_DATA_FORMAT_BIN			0x01			/* Binary */
 #define	IH_DATA_FORMAT_SREC			0x02			/* S-Record */
 
+/* A/B boot slots and boot state, shared with the bootloader */
+#include "ob_boot_slot.h"
+
 
 /* Exported types ------------------------------------------------------------*/
 
@@ -64,6 +67,7 @@ typedef struct OB_Image_Header {
 /* Exported functions ------------------------------------------------------- */
 unsigned long crc32(unsigned long crc, const unsigned char *buf, unsigned int len);
 int OB_Check_Upgrade_Image(unsigned int address, unsigned int *datasize, unsigned int *crc32);
+int OB_Check_Image_Header(unsigned int address, unsigned int *datasize, unsigned int *crc32, unsigned int *loadaddr);
 
 #endif	/* __OB_IMAGE_H */
 
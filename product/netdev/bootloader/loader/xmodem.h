@@ -23,8 +23,24 @@
 #define ERR_FLASH_WRITE		-5
 #define ERR_CHECK_HEADER	-6
 
-int XmodemWrite(unsigned int write_address, int *receive_size);
+/* Transfer modes */
+#define XMODEM_1K			0
+#define YMODEM_G			1
+
+#define XMODEM_RETRY_MAX	10
+
+/* What the receiver needs from the board */
+typedef struct {
+	int  (*ReadByte)(int timeoutMs);	/* the next byte, ERR_TIMEOUT when none came */
+	void (*SendByte)(char data);
+	int  (*Write)(unsigned int address, unsigned char *pData, int len);	/* 0 when programmed */
+	int  (*CheckHeader)(unsigned char *pHeader, int *pImageSize);		/* < 0 when not an image */
+} xmodem_port_t;
+
+int XmodemReceive(const xmodem_port_t *pPort, unsigned int write_address, int *receive_size, int mode);
+int XmodemWrite(unsigned int write_address, int *receive_size, int mode);
 void CmdXmodem(int argc, char **argv);
+void CmdYmodem(int argc, char **argv);
 void RegisterXmodemCommand(void);
 #endif /* __XMODEM_H */
 
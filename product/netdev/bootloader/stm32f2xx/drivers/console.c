@@ -4,6 +4,7 @@
 /* BSP includes */
 #include "misc.h"
 #include "console.h"
+#include "timer.h"
 
 /* Other includes */
 #include "common.h"
@@ -12,6 +13,16 @@
 USART_TypeDef *ConsolePort = NULL;
 eComMode ConsoleMode;
 
+/* Interrupt driven receive ring, filled by the USART IRQ while the file
+   transfer programs the flash. Size is a power of 2 holding several 1K blocks */
+#define CONSOLE_RX_RING_SIZE	4096
+
+static unsigned char ConsoleRxRing[CONSOLE_RX_RING_SIZE];
+static volatile unsigned int ConsoleRxHead = 0;
+static volatile unsigned int ConsoleRxTail = 0;
+static volatile unsigned int ConsoleRxLost = 0;
+static volatile int ConsoleRxIntMode = 0;
+
 static void USART2_Init(unsigned int BaudRate)
 {
 	USART_InitTypeDef USART_InitStructure;
@@ -411,6 +422,100 @@ void ConsoleEnable(void)
 }		
 
 
+/*******************************************************************************
+ * @brief  Switch the console receiver between polling and the RX ring.
+ *         Enabling flushes the ring and the pending data register.
+ ******************************************************************************/
+void ConsoleRxIntEnable(int enable)
+{
+	if(enable) {
+		ConsoleRxHead = 0;
+		ConsoleRxTail = 0;
+		ConsoleRxLost = 0;
+		(void)ConsolePort->SR;
+		(void)ConsolePort->DR;
+		ConsoleRxIntMode = 1;
+		USART_ITConfig(ConsolePort, USART_IT_RXNE, ENABLE);
+	} else {
+		USART_ITConfig(ConsolePort, USART_IT_RXNE, DISABLE);
+		ConsoleRxIntMode = 0;
+	}
+}
+
+/*******************************************************************************
+ * @brief  Read one byte from the RX ring, wait up to timeoutMs.
+ * @retval The byte, or -1 on timeout
+ ******************************************************************************/
+int ConsoleRxRead(unsigned int timeoutMs)
+{
+	unsigned int start = TimerGetMsTick();
+	unsigned char c;
+
+	while(ConsoleRxHead == ConsoleRxTail) {
+		if((TimerGetMsTick() - start) >= timeoutMs)
+			return -1;
+	}
+	c = ConsoleRxRing[ConsoleRxTail & (CONSOLE_RX_RING_SIZE - 1)];
+	ConsoleRxTail++;
+
+	return c;
+}
+
+/*******************************************************************************
+ * @brief  Return and clear the number of bytes lost by ring or UART overrun.
+ ******************************************************************************/
+unsigned int ConsoleRxLostCount(void)
+{
+	unsigned int lost;
+
+	__disable_irq();
+	lost = ConsoleRxLost;
+	ConsoleRxLost = 0;
+	__enable_irq();
+
+	return lost;
+}
+
+static void ConsoleRxIRQHandler(USART_TypeDef *port)
+{
+	uint16_t sr = port->SR;
+	unsigned char c;
+
+	if(sr & (USART_SR_RXNE | USART_SR_ORE)) {
+		/* SR then DR read clears both RXNE and ORE */
+		c = (unsigned char)port->DR;
+		if((port != ConsolePort) || !ConsoleRxIntMode)
+			return;
+		if(sr & USART_SR_ORE)
+			ConsoleRxLost++;
+		if((ConsoleRxHead - ConsoleRxTail) < CONSOLE_RX_RING_SIZE) {
+			ConsoleRxRing[ConsoleRxHead & (CONSOLE_RX_RING_SIZE - 1)] = c;
+			ConsoleRxHead++;
+		} else
+			ConsoleRxLost++;
+	}
+}
+
+void USART2_IRQHandler(void)
+{
+	ConsoleRxIRQHandler(USART2);
+}
+
+void USART3_IRQHandler(void)
+{
+	ConsoleRxIRQHandler(USART3);
+}
+
+void UART5_IRQHandler(void)
+{
+	ConsoleRxIRQHandler(UART5);
+}
+
+void USART6_IRQHandler(void)
+{
+	ConsoleRxIRQHandler(USART6);
+}
+
 #ifdef __GNUC__
   #define PUTCHAR_PROTOTYPE int __io_putchar(int ch)
 #else
@@ -107,6 +107,9 @@ char ConsoleGetChar(void);
 void ConsoleDisable(void);
 void ConsoleEnable(void);
 int ConsoleCheckRxChar(char c);
+void ConsoleRxIntEnable(int enable);
+int ConsoleRxRead(unsigned int timeoutMs);
+unsigned int ConsoleRxLostCount(void);
 
 #endif
 
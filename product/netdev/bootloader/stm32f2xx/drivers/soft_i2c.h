@@ -20,6 +20,7 @@
 #define EPROM_ADDR_UPGRADE_FLAG			0x40
 #define EPROM_ADDR_BOOT_DELAY			0x41
 #define EPROM_ADDR_CONSOLE_ENABLE		0x42
+#define EPROM_ADDR_BOOT_STATE			0x44
 #define EPROM_ADDR_LOADER_VERSION		0x48
 #define EPROM_ADDR_FIRMWARE_SIZE		0x50
 #define EPROM_ADDR_FIRMWARE_CRC32		0x54	
@@ -82,6 +82,7 @@
 #define configUSE_RECURSIVE_MUTEXES		1
 #define configUSE_COUNTING_SEMAPHORES   1
 #define configUSE_MALLOC_FAILED_HOOK    0
+#define configUSE_APPLICATION_TASK_TAG  1	/* lwIP port keeps per-thread timeouts in the tag */
 
 
 /* Co-routine definitions. */
@@ -98,6 +99,7 @@ to exclude the API function. */
 #define INCLUDE_vTaskSuspend			1
 #define INCLUDE_vTaskDelayUntil			1
 #define INCLUDE_vTaskDelay		        1
+#define INCLUDE_xTaskGetSchedulerState	1
 
 /* This is the raw value as per the Cortex-M3 NVIC.  Values can be 255
 (lowest) to 0 (1?) (highest). */
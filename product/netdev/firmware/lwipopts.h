@@ -97,6 +97,36 @@ a lot of data that needs to be copied, this should be set high. */
 #define LWIP_TCP                1
 #define TCP_TTL                 255
 
+/* TCP profile
+   0: 150 byte segments, each one fits a single pool pbuf
+   1: full size segments, received into pool pbufs chained by the driver */
+#define TCP_PROFILE_THROUGHPUT  1
+
+#if TCP_PROFILE_THROUGHPUT
+/* Controls if TCP should queue segments that arrive out of
+   order. Define to 0 if your device is low on memory. */
+#define TCP_QUEUE_OOSEQ         1
+
+/* Out of order segments of all connections together may hold this many
+   pool pbufs, the tail of the queue that grew is dropped beyond it. */
+#define TCP_OOSEQ_MAX_PBUFS     (PBUF_POOL_SIZE / 3)
+
+/* TCP Maximum segment size. */
+#define TCP_MSS                 (1500 - 40)	  /* TCP_MSS = (Ethernet MTU - IP header size - TCP header size) */
+
+/* TCP sender buffer space (bytes), about the heap share the small
+   profile used per connection. */
+#define TCP_SND_BUF             (2* TCP_MSS)
+
+/* TCP sender buffer space (pbufs). This must be at least = 2 *
+   TCP_SND_BUF/TCP_MSS for things to work. Extra entries leave room for
+   the short writes of telnet echo and uart_server. */
+#define TCP_SND_QUEUELEN        (8* TCP_SND_BUF/TCP_MSS)
+
+/* TCP receive window, 4 segments so a single loss still produces the
+   3 duplicate ACKs for fast retransmit. */
+#define TCP_WND                 (4* TCP_MSS)
+#else
 /* Controls if TCP should queue segments that arrive out of
    order. Define to 0 if your device is low on memory. */
 #define TCP_QUEUE_OOSEQ         0
@@ -113,6 +143,7 @@ a lot of data that needs to be copied, this should be set high. */
 
 /* TCP receive window. */
 #define TCP_WND                 (20* TCP_MSS)
+#endif
 
 
 /* ---------- ICMP options ---------- */
@@ -132,6 +163,7 @@ a lot of data that needs to be copied, this should be set high. */
 #if MODULE_SNMP
 #define LWIP_SNMP				1
 #define SNMP_PRIVATE_MIB        1
+#define SNMP_V2C                1
 #endif
 #define UDP_TTL                 255
 
@@ -262,6 +294,21 @@ The STM32F2x7 allows computing and verifying the IP, UDP, TCP and ICMP checksums
 #define DEFAULT_THREAD_STACKSIZE        500
 #endif
 #define TCPIP_THREAD_PRIO               (configMAX_PRIORITIES - 2)
+
+/* LWIP_TCPIP_CORE_LOCKING==1: socket/netconn calls take the stack lock and
+ * run in the calling task instead of posting to tcpip_thread and waiting for
+ * its reply (two context switches per send/recv). Needs configUSE_MUTEXES
+ * for the priority inheriting lock created by the port. */
+#define LWIP_TCPIP_CORE_LOCKING         1
+
+/* LWIP_API_STACK_EXTRA: words added to every task using sockets, for
+ * lwip_send/lwip_connect down through tcp_output, ip_output, etharp and
+ * the Ethernet driver now run on that task (about 600 bytes) */
+#define LWIP_API_STACK_EXTRA            192
+
+/* TCPIP_MBOX_BATCH: messages handled by tcpip_thread per wakeup (bursts of
+ * received frames are queued back to back by the Ethernet rx task) */
+#define TCPIP_MBOX_BATCH                8
 #endif /* __LWIPOPTS_H__ */
 
 /******************* (C) COPYRIGHT 2011 STMicroelectronics *****END OF FILE****/
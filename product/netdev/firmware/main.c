@@ -29,6 +29,7 @@
 /* Other includes */
 #include "netconf.h"
 #include "conf_global.h"
+#include "conf_sys.h"
 
 #if MODULE_OBNMS
 #include "nms_if.h"
@@ -92,8 +93,10 @@ void main(void)
 	extern tConsoleDev *pConsoleDev;
 	extern void cli_main(void);
 
-	/* Set Vector Table */
+#if !BOOT_AB_SLOT
+	/* Set Vector Table, with A/B slots the bootloader set the running slot */
 	NVIC_SetVectorTable(NVIC_VectTab_FLASH, VectTab_Offset);
+#endif
 
 	/* Configure Timer  */
 	TimerInit();
@@ -142,6 +145,11 @@ void main(void)
 	/* Initialize the LwIP stack */
 	LwIP_Init();
 
+#if BOOT_AB_SLOT
+	/* Came up, keep booting this slot */
+	conf_confirm_boot();
+#endif
+
 	/* Start the CLI */
 	cli_main();
 #if BOARD_GE220044MD
@@ -155,7 +163,11 @@ void main(void)
 #if (BOARD_GE1040PU || BOARD_GE204P0U)
 	xTaskCreate(combo_led_control_task,	"tCombo",	configMINIMAL_STACK_SIZE*2, NULL, tskIDLE_PRIORITY + 2, NULL);
 #endif
+	hal_swif_trap_entry();
 	hal_swif_traffic_entry();
+#if (BOARD_FEATURE & L2_LINK_AGGREGATION)
+	hal_swif_aggr_entry();
+#endif
 	
 #if (BOARD_FEATURE & L2_OBRING)	
 	//Ring_Start();
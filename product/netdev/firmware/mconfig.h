@@ -10,6 +10,10 @@
 #define MODULE_SNMP_TRAP        0
 #define MODULE_UDP_TCP_ECHO     0
 
+/* Must match BOOT_AB_SLOT of the bootloader, the firmware is then linked
+   per slot (lcf/stm32f2xx_flash_slot_a.icf, stm32f2xx_flash_slot_b.icf) */
+#define BOOT_AB_SLOT			0
+
 /***************************************************************
 	Serial Port Define
  ***************************************************************/
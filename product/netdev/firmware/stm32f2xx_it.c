@@ -263,14 +263,15 @@ void EXTI9_5_IRQHandler(void)
 	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 	extern xSemaphoreHandle EXTI9_5_Semaphore;
 
-#if 0// BOARD_GE22103MA
+#if BOARD_GE22103MA
+	extern void hal_swif_aggr_link_isr(portBASE_TYPE *pxHigherPriorityTaskWoken);
+
 	if(EXTI_GetITStatus(EXTI_Line8) != RESET) {
 		/* Clear interrupt pending bit */
 		EXTI_ClearITPendingBit(EXTI_Line8);
 		
-	    /* Give the semaphore to wakeup LwIP task */
-		if(EXTI9_5_Semaphore != NULL)
-	    	xSemaphoreGiveFromISR(EXTI9_5_Semaphore, &xHigherPriorityTaskWoken); 
+	    /* Switch INTn, wake the trunk failover task */
+		hal_swif_aggr_link_isr(&xHigherPriorityTaskWoken);
 	}
 #else
 	if(EXTI_GetITStatus(EXTI_Line9) != RESET) {
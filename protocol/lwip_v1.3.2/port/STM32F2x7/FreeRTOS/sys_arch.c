@@ -51,6 +51,15 @@ struct timeoutlist
 /* This is the number of threads that can be started with sys_thread_new() */
 #define SYS_THREAD_MAX 10
 
+/* With configUSE_APPLICATION_TASK_TAG the timeout list of each lwIP thread is
+   kept in its FreeRTOS task tag, so sys_arch_timeouts() reads it straight from
+   the TCB instead of scanning s_timeoutlist[] on every call. */
+#if ( configUSE_APPLICATION_TASK_TAG == 1 )
+#define SYS_ARCH_TIMEOUTS_IN_TAG	1
+#else
+#define SYS_ARCH_TIMEOUTS_IN_TAG	0
+#endif
+
 static struct timeoutlist s_timeoutlist[SYS_THREAD_MAX];
 static u16_t s_nextthread = 0;
 
@@ -341,6 +350,10 @@ void sys_init(void)
 */
 struct sys_timeouts *sys_arch_timeouts(void)
 {
+#if SYS_ARCH_TIMEOUTS_IN_TAG
+	// Tasks not created by sys_thread_new() carry a NULL tag
+	return ( struct sys_timeouts * ) xTaskGetApplicationTaskTag( NULL );
+#else
 int i;
 xTaskHandle pid;
 struct timeoutlist *tl;
@@ -359,6 +372,7 @@ struct timeoutlist *tl;
 
 	// Error
 	return NULL;
+#endif
 }
 
 /*-----------------------------------------------------------------------------------*/
@@ -376,16 +390,36 @@ sys_thread_t sys_thread_new(char *name, void (* thread)(void *arg), void *arg, i
 xTaskHandle CreatedTask;
 int result;
 
+#if SYS_ARCH_TIMEOUTS_IN_TAG
+   // Keep the new task from running before its tag is set: a higher priority
+   // thread such as tcpip_thread arms its timers as soon as it starts.
+   vTaskSuspendAll();
+   result = xTaskCreate( thread, ( signed portCHAR * ) name, stacksize, arg, prio, &CreatedTask );
+   if ( result == pdPASS )
+   {
+	   // Threads beyond SYS_THREAD_MAX still run, only without lwIP timeouts,
+	   // the same as any task created directly with xTaskCreate().
+	   // This scheme doesn't allow for threads to be deleted
+	   if ( s_nextthread < SYS_THREAD_MAX )
+	   {
+		   s_timeoutlist[s_nextthread].pid = CreatedTask;
+		   vTaskSetApplicationTaskTag( CreatedTask, ( pdTASK_HOOK_CODE ) &( s_timeoutlist[s_nextthread].timeouts ) );
+		   s_nextthread++;
+	   }
+   }
+   xTaskResumeAll();
+
+   return ( result == pdPASS ) ? CreatedTask : NULL;
+#else
    if ( s_nextthread < SYS_THREAD_MAX )
    {
       result = xTaskCreate( thread, ( signed portCHAR * ) name, stacksize, arg, prio, &CreatedTask );
 
-	   // For each task created, store the task handle (pid) in the timers array.
-	   // This scheme doesn't allow for threads to be deleted
-	   s_timeoutlist[s_nextthread++].pid = CreatedTask;
-
 	   if(result == pdPASS)
 	   {
+		   // For each task created, store the task handle (pid) in the timers array.
+		   // This scheme doesn't allow for threads to be deleted
+		   s_timeoutlist[s_nextthread++].pid = CreatedTask;
 		   return CreatedTask;
 	   }
 	   else
@@ -397,6 +431,46 @@ int result;
    {
       return NULL;
    }
+#endif
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+  Returns the id of the running thread, also for tasks not created by
+  sys_thread_new().
+*/
+sys_thread_t sys_thread_self(void)
+{
+	return xTaskGetCurrentTaskHandle();
+}
+
+/*-----------------------------------------------------------------------------------*/
+/*
+  Creates the lock taken by LOCK_TCPIP_CORE(). A FreeRTOS mutex is used rather
+  than a binary semaphore so that a low priority task holding the stack
+  inherits the priority of tcpip_thread while it runs lwIP code.
+*/
+sys_sem_t sys_core_lock_new(void)
+{
+	xSemaphoreHandle xMutex;
+
+	xMutex = xSemaphoreCreateMutex();
+	if( xMutex == NULL )
+	{
+#if SYS_STATS
+		++lwip_stats.sys.sem.err;
+#endif /* SYS_STATS */
+		return SYS_SEM_NULL;
+	}
+
+#if SYS_STATS
+	++lwip_stats.sys.sem.used;
+	if (lwip_stats.sys.sem.max < lwip_stats.sys.sem.used) {
+		lwip_stats.sys.sem.max = lwip_stats.sys.sem.used;
+	}
+#endif /* SYS_STATS */
+
+	return xMutex;
 }
 
 /*
@@ -60,6 +60,14 @@ typedef struct _sys_arch_state_t
 //void sys_set_default_state();
 //void sys_set_state(signed char *pTaskName, unsigned short nStackSize);
 
+/* Priority inheriting lock for LWIP_TCPIP_CORE_LOCKING (see tcpip.c) */
+sys_sem_t sys_core_lock_new(void);
+#define sys_core_lock_new	sys_core_lock_new
+
+/* The running thread, tcpip.c keeps core timers on tcpip_thread with it */
+sys_thread_t sys_thread_self(void);
+#define sys_thread_self		sys_thread_self
+
 /* Message queue constants. */
 #define archMESG_QUEUE_LENGTH	( 16 )
 #endif /* __SYS_RTXC_H__ */
@@ -74,6 +74,8 @@ struct lwip_socket {
   u16_t flags;
   /** last error that occurred on this socket */
   int err;
+  /** signalled on each receive event, see lwip_socket_notify() */
+  sys_sem_t rcvsem;
 };
 
 /** Description for a task waiting in select */
@@ -90,6 +92,8 @@ struct lwip_select_cb {
   int sem_signalled;
   /** semaphore to wake up a task waiting for select */
   sys_sem_t sem;
+  /** lwip_select_wakeup() target this select waits on, NULL if none */
+  struct lwip_select_waker *waker;
 };
 
 /** This struct is used to pass data to the set/getsockopt_internal
@@ -230,6 +234,7 @@ alloc_socket(struct netconn *newconn)
       sockets[i].sendevent  = 1; /* TCP send buf is empty */
       sockets[i].flags      = 0;
       sockets[i].err        = 0;
+      sockets[i].rcvsem     = SYS_SEM_NULL;
       sys_sem_signal(socksem);
       return i;
     }
@@ -384,6 +389,7 @@ lwip_close(int s)
   sock->lastdata   = NULL;
   sock->lastoffset = 0;
   sock->conn       = NULL;
+  sock->rcvsem     = SYS_SEM_NULL;
   sock_set_errno(sock, 0);
   sys_sem_signal(socksem);
   return 0;
@@ -710,13 +716,21 @@ lwip_sendto(int s, const void *data, size_t size, int flags,
       p->payload = (void*)data;
       p->len = p->tot_len = short_size;
       
-      remote_addr.addr = ((const struct sockaddr_in *)to)->sin_addr.s_addr;
-      
       LOCK_TCPIP_CORE();
-      if (sock->conn->type==NETCONN_RAW) {
-        err = sock->conn->err = raw_sendto(sock->conn->pcb.raw, p, &remote_addr);
+      if (to == NULL) {
+        /* lwip_send() on a connected socket: use the pcb's remote address */
+        if (sock->conn->type==NETCONN_RAW) {
+          err = sock->conn->err = raw_send(sock->conn->pcb.raw, p);
+        } else {
+          err = sock->conn->err = udp_send(sock->conn->pcb.udp, p);
+        }
       } else {
-        err = sock->conn->err = udp_sendto(sock->conn->pcb.udp, p, &remote_addr, ntohs(((const struct sockaddr_in *)to)->sin_port));
+        remote_addr.addr = ((const struct sockaddr_in *)to)->sin_addr.s_addr;
+        if (sock->conn->type==NETCONN_RAW) {
+          err = sock->conn->err = raw_sendto(sock->conn->pcb.raw, p, &remote_addr);
+        } else {
+          err = sock->conn->err = udp_sendto(sock->conn->pcb.udp, p, &remote_addr, ntohs(((const struct sockaddr_in *)to)->sin_port));
+        }
       }
       UNLOCK_TCPIP_CORE();
       
@@ -882,10 +896,12 @@ lwip_selscan(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset)
 
 /**
  * Processing exceptset is not yet implemented.
+ * With waker set, a wakeup of it that happened after gen was sampled makes
+ * the call return 0 at once instead of suspending.
  */
-int
-lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
-               struct timeval *timeout)
+static int
+lwip_select_common(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
+               struct timeval *timeout, struct lwip_select_waker *waker, u32_t gen)
 {
   int i;
   int nready;
@@ -904,6 +920,7 @@ lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
   select_cb.writeset = writeset;
   select_cb.exceptset = exceptset;
   select_cb.sem_signalled = 0;
+  select_cb.waker = waker;
 
   /* Protect ourselves searching through the list */
   sys_sem_wait(selectsem);
@@ -927,7 +944,8 @@ lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
 
   /* If we don't have any current events, then suspend if we are supposed to */
   if (!nready) {
-    if (timeout && timeout->tv_sec == 0 && timeout->tv_usec == 0) {
+    if ((timeout && timeout->tv_sec == 0 && timeout->tv_usec == 0) ||
+        (waker && (waker->gen != gen))) {
       sys_sem_signal(selectsem);
       if (readset)
         FD_ZERO(readset);
@@ -1038,6 +1056,84 @@ lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
   return nready;
 }
 
+int
+lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
+               struct timeval *timeout)
+{
+  return lwip_select_common(maxfdp1, readset, writeset, exceptset, timeout, NULL, 0);
+}
+
+/**
+ * Wakeup generation of waker, sample it before building the fd sets that
+ * are passed to lwip_select_since().
+ */
+u32_t
+lwip_select_generation(struct lwip_select_waker *waker)
+{
+  u32_t gen;
+
+  sys_sem_wait(selectsem);
+  gen = waker->gen;
+  sys_sem_signal(selectsem);
+  return gen;
+}
+
+/**
+ * lwip_select() that can be ended by lwip_select_wakeup(waker), and does
+ * not suspend if that ran since gen was sampled, so a change made while
+ * the caller was building its fd sets is not lost.
+ */
+int
+lwip_select_since(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
+               struct timeval *timeout, struct lwip_select_waker *waker, u32_t gen)
+{
+  return lwip_select_common(maxfdp1, readset, writeset, exceptset, timeout, waker, gen);
+}
+
+/**
+ * Wake up the tasks blocked in lwip_select_since() on waker without a
+ * socket event, so they can rebuild their fd sets. A woken select rescans
+ * its sets and returns the number of ready sockets (usually 0). Other
+ * selects are left alone.
+ */
+void
+lwip_select_wakeup(struct lwip_select_waker *waker)
+{
+  struct lwip_select_cb *scb;
+
+  sys_sem_wait(selectsem);
+  waker->gen++;
+  for (scb = select_cb_list; scb; scb = scb->next) {
+    if ((scb->waker == waker) && (scb->sem_signalled == 0)) {
+      scb->sem_signalled = 1;
+      sys_sem_signal(scb->sem);
+    }
+  }
+  sys_sem_signal(selectsem);
+}
+
+/**
+ * Signal sem on every receive event of socket s, besides waking the selects
+ * waiting for it. A task can then sleep on one semaphore for both its socket
+ * and events of its own, which may be given from an ISR. SYS_SEM_NULL stops
+ * it, so does closing the socket.
+ */
+int
+lwip_socket_notify(int s, sys_sem_t sem)
+{
+  struct lwip_socket *sock;
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  sys_sem_wait(selectsem);
+  sock->rcvsem = sem;
+  sys_sem_signal(selectsem);
+  return 0;
+}
+
 /**
  * Callback registered in the netconn layer for each socket-netconn.
  * Processes recvevent (data available) and wakes up tasks waiting for select.
@@ -1048,6 +1144,7 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
   int s;
   struct lwip_socket *sock;
   struct lwip_select_cb *scb;
+  sys_sem_t rcvsem = SYS_SEM_NULL;
 
   LWIP_UNUSED_ARG(len);
 
@@ -1085,6 +1182,7 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
   switch (evt) {
     case NETCONN_EVT_RCVPLUS:
       sock->rcvevent++;
+      rcvsem = sock->rcvsem;
       break;
     case NETCONN_EVT_RCVMINUS:
       sock->rcvevent--;
@@ -1101,6 +1199,10 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
   }
   sys_sem_signal(selectsem);
 
+  if (rcvsem != SYS_SEM_NULL) {
+    sys_sem_signal(rcvsem);
+  }
+
   /* Now decide if anyone is waiting for this socket */
   /* NOTE: This code is written this way to protect the select link list
      but to avoid a deadlock situation by releasing socksem before
@@ -62,6 +62,10 @@ static sys_mbox_t mbox = SYS_MBOX_NULL;
 #if LWIP_TCPIP_CORE_LOCKING
 /** The global semaphore to lock the stack. */
 sys_sem_t lock_tcpip_core;
+#ifdef sys_thread_self
+/** tcpip_thread, the only thread whose timeout list runs with the core lock */
+static sys_thread_t tcpip_thread_id;
+#endif
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 
 #if LWIP_TCP
@@ -103,6 +107,21 @@ tcp_timer_needed(void)
   if (!tcpip_tcp_timer_active && (tcp_active_pcbs || tcp_tw_pcbs)) {
     /* enable and start timer */
     tcpip_tcp_timer_active = 1;
+#if LWIP_TCPIP_CORE_LOCKING
+    /* A core locked API call (lwip_connect, lwip_listen...) runs in the
+       calling task. sys_timeout() would put the timer on that task's list,
+       where it runs without the core lock or not at all, so it is handed
+       to tcpip_thread instead. */
+#ifdef sys_thread_self
+    if (sys_thread_self() != tcpip_thread_id)
+#endif
+    {
+      if (tcpip_timeout(TCP_TMR_INTERVAL, tcpip_tcp_timer, NULL) != ERR_OK) {
+        tcpip_tcp_timer_active = 0;
+      }
+      return;
+    }
+#endif /* LWIP_TCPIP_CORE_LOCKING */
     sys_timeout(TCP_TMR_INTERVAL, tcpip_tcp_timer, NULL);
   }
 }
@@ -219,6 +238,63 @@ dns_timer(void *arg)
 }
 #endif /* LWIP_DNS */
 
+/**
+ * Process one message taken from the tcpip_thread mailbox.
+ *
+ * @param msg the message to dispatch
+ */
+static void
+tcpip_thread_handle_msg(struct tcpip_msg *msg)
+{
+  switch (msg->type) {
+#if LWIP_NETCONN
+  case TCPIP_MSG_API:
+    LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: API message %p\n", (void *)msg));
+    msg->msg.apimsg->function(&(msg->msg.apimsg->msg));
+    break;
+#endif /* LWIP_NETCONN */
+
+  case TCPIP_MSG_INPKT:
+    LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: PACKET %p\n", (void *)msg));
+#if LWIP_ARP
+    if (msg->msg.inp.netif->flags & NETIF_FLAG_ETHARP) {
+      ethernet_input(msg->msg.inp.p, msg->msg.inp.netif);
+    } else
+#endif /* LWIP_ARP */
+    { ip_input(msg->msg.inp.p, msg->msg.inp.netif);
+    }
+    memp_free(MEMP_TCPIP_MSG_INPKT, msg);
+    break;
+
+#if LWIP_NETIF_API
+  case TCPIP_MSG_NETIFAPI:
+    LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: Netif API message %p\n", (void *)msg));
+    msg->msg.netifapimsg->function(&(msg->msg.netifapimsg->msg));
+    break;
+#endif /* LWIP_NETIF_API */
+
+  case TCPIP_MSG_CALLBACK:
+    LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: CALLBACK %p\n", (void *)msg));
+    msg->msg.cb.f(msg->msg.cb.ctx);
+    memp_free(MEMP_TCPIP_MSG_API, msg);
+    break;
+
+  case TCPIP_MSG_TIMEOUT:
+    LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: TIMEOUT %p\n", (void *)msg));
+    sys_timeout(msg->msg.tmo.msecs, msg->msg.tmo.h, msg->msg.tmo.arg);
+    memp_free(MEMP_TCPIP_MSG_API, msg);
+    break;
+  case TCPIP_MSG_UNTIMEOUT:
+    LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: UNTIMEOUT %p\n", (void *)msg));
+    sys_untimeout(msg->msg.tmo.h, msg->msg.tmo.arg);
+    memp_free(MEMP_TCPIP_MSG_API, msg);
+    break;
+
+  default:
+    break;
+  }
+}
+
 /**
  * The main lwIP thread. This thread has exclusive access to lwIP core functions
  * (unless access to them is not locked). Other threads communicate with this
@@ -233,8 +309,12 @@ static void
 tcpip_thread(void *arg)
 {
   struct tcpip_msg *msg;
+  u16_t batch;
   LWIP_UNUSED_ARG(arg);
 
+#if LWIP_TCPIP_CORE_LOCKING && defined(sys_thread_self)
+  tcpip_thread_id = sys_thread_self();
+#endif
 #if IP_REASSEMBLY
   sys_timeout(IP_TMR_INTERVAL, ip_reass_timer, NULL);
 #endif /* IP_REASSEMBLY */
@@ -262,53 +342,11 @@ tcpip_thread(void *arg)
   LOCK_TCPIP_CORE();
   while (1) {                          /* MAIN Loop */
     sys_mbox_fetch(mbox, (void *)&msg);
-    switch (msg->type) {
-#if LWIP_NETCONN
-    case TCPIP_MSG_API:
-      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: API message %p\n", (void *)msg));
-      msg->msg.apimsg->function(&(msg->msg.apimsg->msg));
-      break;
-#endif /* LWIP_NETCONN */
-
-    case TCPIP_MSG_INPKT:
-      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: PACKET %p\n", (void *)msg));
-#if LWIP_ARP
-      if (msg->msg.inp.netif->flags & NETIF_FLAG_ETHARP) {
-        ethernet_input(msg->msg.inp.p, msg->msg.inp.netif);
-      } else
-#endif /* LWIP_ARP */
-      { ip_input(msg->msg.inp.p, msg->msg.inp.netif);
-      }
-      memp_free(MEMP_TCPIP_MSG_INPKT, msg);
-      break;
-
-#if LWIP_NETIF_API
-    case TCPIP_MSG_NETIFAPI:
-      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: Netif API message %p\n", (void *)msg));
-      msg->msg.netifapimsg->function(&(msg->msg.netifapimsg->msg));
-      break;
-#endif /* LWIP_NETIF_API */
-
-    case TCPIP_MSG_CALLBACK:
-      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: CALLBACK %p\n", (void *)msg));
-      msg->msg.cb.f(msg->msg.cb.ctx);
-      memp_free(MEMP_TCPIP_MSG_API, msg);
-      break;
-
-    case TCPIP_MSG_TIMEOUT:
-      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: TIMEOUT %p\n", (void *)msg));
-      sys_timeout(msg->msg.tmo.msecs, msg->msg.tmo.h, msg->msg.tmo.arg);
-      memp_free(MEMP_TCPIP_MSG_API, msg);
-      break;
-    case TCPIP_MSG_UNTIMEOUT:
-      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: UNTIMEOUT %p\n", (void *)msg));
-      sys_untimeout(msg->msg.tmo.h, msg->msg.tmo.arg);
-      memp_free(MEMP_TCPIP_MSG_API, msg);
-      break;
-
-    default:
-      break;
-    }
+    batch = 0;
+    do {
+      tcpip_thread_handle_msg(msg);
+    } while ((++batch < TCPIP_MBOX_BATCH) &&
+             (sys_arch_mbox_tryfetch(mbox, (void *)&msg) != SYS_MBOX_EMPTY));
   }
 }
 
@@ -549,7 +587,11 @@ tcpip_init(void (* initfunc)(void *), void *arg)
   tcpip_init_done_arg = arg;
   mbox = sys_mbox_new(TCPIP_MBOX_SIZE);
 #if LWIP_TCPIP_CORE_LOCKING
+#ifdef sys_core_lock_new
+  lock_tcpip_core = sys_core_lock_new();
+#else
   lock_tcpip_core = sys_sem_new(1);
+#endif
 #endif /* LWIP_TCPIP_CORE_LOCKING */
 
   sys_thread_new(TCPIP_THREAD_NAME, tcpip_thread, NULL, TCPIP_THREAD_STACKSIZE, TCPIP_THREAD_PRIO);
@@ -1,6 +1,6 @@
 /**
  * @file
- * SNMP input message processing (RFC1157).
+ * SNMP input message processing (RFC1157, RFC1901/RFC3416 GetBulk).
  */
 
 /*
@@ -108,6 +108,134 @@ snmp_error_response(struct snmp_msg_pstat *msg_ps, u8_t error)
   msg_ps->state = SNMP_MSG_EMPTY;
 }
 
+#if SNMP_V2C
+/**
+ * Appends a SNMPv2 exception (noSuchObject, noSuchInstance, endOfMibView)
+ * for the name of src to the output list.
+ */
+static err_t
+snmp_msg_exception_add(struct snmp_msg_pstat *msg_ps, struct snmp_varbind *src, u8_t exception)
+{
+  struct snmp_obj_id oid;
+  struct snmp_varbind *vb;
+  u8_t i;
+
+  oid.len = (src->ident_len < LWIP_SNMP_OBJ_ID_LEN) ? src->ident_len : LWIP_SNMP_OBJ_ID_LEN;
+  for (i = 0; i < oid.len; i++)
+  {
+    oid.id[i] = src->ident[i];
+  }
+  vb = snmp_varbind_alloc(&oid, (SNMP_ASN1_CONTXT | SNMP_ASN1_PRIMIT | exception), 0);
+  if (vb == NULL)
+  {
+    return ERR_MEM;
+  }
+  snmp_varbind_tail_add(&msg_ps->outvb, vb);
+  return ERR_OK;
+}
+#endif
+
+/**
+ * Answers a Get for an unknown object. SNMPv1 fails the whole request with
+ * noSuchName, SNMPv2c returns the exception for this varbind and continues.
+ */
+static void
+snmp_msg_get_nosuch(struct snmp_msg_pstat *msg_ps, u8_t exception)
+{
+#if SNMP_V2C
+  if (msg_ps->version == SNMP_VERSION_2c)
+  {
+    if (snmp_msg_exception_add(msg_ps, msg_ps->vb_ptr, exception) == ERR_OK)
+    {
+      msg_ps->state = SNMP_MSG_SEARCH_OBJ;
+      msg_ps->vb_idx += 1;
+    }
+    else
+    {
+      snmp_error_response(msg_ps,SNMP_ES_TOOBIG);
+    }
+    return;
+  }
+#endif
+  LWIP_UNUSED_ARG(exception);
+  snmp_error_response(msg_ps,SNMP_ES_NOSUCHNAME);
+}
+
+/**
+ * Completes one GetNext/GetBulk output varbind. GetBulk stops repeating
+ * once every repeater of a repetition ran into endOfMibView.
+ */
+static void
+snmp_msg_getnext_advance(struct snmp_msg_pstat *msg_ps, u8_t eomv)
+{
+  msg_ps->state = SNMP_MSG_SEARCH_OBJ;
+  msg_ps->vb_idx += 1;
+#if SNMP_V2C
+  if ((msg_ps->rt == SNMP_ASN1_PDU_GET_BULK_REQ) &&
+      (msg_ps->vb_idx > msg_ps->non_repeaters))
+  {
+    u8_t repeaters;
+
+    repeaters = msg_ps->invb.count - msg_ps->non_repeaters;
+    msg_ps->bulk_eomv += eomv;
+    if (((msg_ps->vb_idx - msg_ps->non_repeaters) % repeaters) == 0)
+    {
+      if (msg_ps->bulk_eomv == repeaters)
+      {
+        msg_ps->vb_total = msg_ps->vb_idx;
+      }
+      msg_ps->bulk_eomv = 0;
+    }
+  }
+#else
+  LWIP_UNUSED_ARG(eomv);
+#endif
+}
+
+/**
+ * GetNext/GetBulk ran out of memory for an output varbind. GetBulk
+ * repetitions return the varbinds collected so far, otherwise tooBig.
+ */
+static void
+snmp_msg_getnext_nomem(struct snmp_msg_pstat *msg_ps)
+{
+#if SNMP_V2C
+  if ((msg_ps->rt == SNMP_ASN1_PDU_GET_BULK_REQ) &&
+      (msg_ps->vb_idx >= msg_ps->invb.count))
+  {
+    msg_ps->state = SNMP_MSG_SEARCH_OBJ;
+    msg_ps->vb_total = msg_ps->vb_idx;
+    return;
+  }
+#endif
+  snmp_error_response(msg_ps,SNMP_ES_TOOBIG);
+}
+
+#if SNMP_V2C
+/**
+ * Clamps the GetBulk fields and sets the number of varbinds to return:
+ * non-repeaters once, plus max-repetitions rounds over the repeaters.
+ */
+static void
+snmp_msg_bulk_init(struct snmp_msg_pstat *msg_ps)
+{
+  u32_t total;
+
+  if (msg_ps->non_repeaters > msg_ps->invb.count)
+  {
+    msg_ps->non_repeaters = msg_ps->invb.count;
+  }
+  total = msg_ps->non_repeaters +
+          (u32_t)(msg_ps->invb.count - msg_ps->non_repeaters) * msg_ps->max_repetitions;
+  if (total > SNMP_GETBULK_MAX_VARBINDS)
+  {
+    total = SNMP_GETBULK_MAX_VARBINDS;
+  }
+  msg_ps->vb_total = (u8_t)total;
+  msg_ps->bulk_eomv = 0;
+}
+#endif
+
 static void
 snmp_ok_response(struct snmp_msg_pstat *msg_ps)
 {
@@ -159,7 +287,7 @@ snmp_msg_get_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
     {
       en->get_object_def_pc(request_id, np.ident_len, np.ident);
       /* search failed, object id points to unknown object (nosuchname) */
-      snmp_error_response(msg_ps,SNMP_ES_NOSUCHNAME);
+      snmp_msg_get_nosuch(msg_ps, SNMP_ASN1_NOSUCHINSTANCE);
     }
   }
   else if (msg_ps->state == SNMP_MSG_EXTERNAL_GET_VALUE)
@@ -233,6 +361,7 @@ snmp_msg_get_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
   {
     struct mib_node *mn;
     struct snmp_name_ptr np;
+    u8_t exception = SNMP_ASN1_NOSUCHOBJECT;
 
     if (msg_ps->vb_idx == 0)
     {
@@ -276,6 +405,7 @@ snmp_msg_get_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
           {
             /* search failed, object id points to unknown object (nosuchname) */
             mn =  NULL;
+            exception = SNMP_ASN1_NOSUCHINSTANCE;
           }
           if (mn != NULL)
           {
@@ -344,7 +474,7 @@ snmp_msg_get_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
     if (mn == NULL)
     {
       /* mn == NULL, noSuchName */
-      snmp_error_response(msg_ps,SNMP_ES_NOSUCHNAME);
+      snmp_msg_get_nosuch(msg_ps, exception);
     }
   }
   if ((msg_ps->state == SNMP_MSG_SEARCH_OBJ) &&
@@ -355,7 +485,9 @@ snmp_msg_get_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
 }
 
 /**
- * Service an internal or external event for SNMP GETNEXT.
+ * Service an internal or external event for SNMP GETNEXT and GETBULK.
+ * GetBulk runs the GetNext engine vb_total times; after the first pass over
+ * the input list each repeater continues from its own previous result.
  *
  * @param request_id identifies requests from 0 to (SNMP_CONCURRENT_REQUESTS-1)
  * @param msg_ps points to the assosicated message process state
@@ -401,19 +533,18 @@ snmp_msg_getnext_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
     {
       en->get_value_a(request_id, &msg_ps->ext_object_def, vb->value_len, vb->value);
       snmp_varbind_tail_add(&msg_ps->outvb, vb);
-      msg_ps->state = SNMP_MSG_SEARCH_OBJ;
-      msg_ps->vb_idx += 1;
+      snmp_msg_getnext_advance(msg_ps, 0);
     }
     else
     {
       en->get_value_pc(request_id, &msg_ps->ext_object_def);
       LWIP_DEBUGF(SNMP_MSG_DEBUG, ("snmp_msg_getnext_event: couldn't allocate outvb space\n"));
-      snmp_error_response(msg_ps,SNMP_ES_TOOBIG);
+      snmp_msg_getnext_nomem(msg_ps);
     }
   }
 
   while ((msg_ps->state == SNMP_MSG_SEARCH_OBJ) &&
-         (msg_ps->vb_idx < msg_ps->invb.count))
+         (msg_ps->vb_idx < msg_ps->vb_total))
   {
     struct mib_node *mn;
     struct snmp_obj_id oid;
@@ -422,6 +553,19 @@ snmp_msg_getnext_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
     {
       msg_ps->vb_ptr = msg_ps->invb.head;
     }
+#if SNMP_V2C
+    else if (msg_ps->vb_idx == msg_ps->invb.count)
+    {
+      u8_t i;
+
+      /* first GetBulk repetition, continue from the repeaters' results */
+      msg_ps->vb_ptr = msg_ps->outvb.head;
+      for (i = 0; i < msg_ps->non_repeaters; i++)
+      {
+        msg_ps->vb_ptr = msg_ps->vb_ptr->next;
+      }
+    }
+#endif
     else
     {
       msg_ps->vb_ptr = msg_ps->vb_ptr->next;
@@ -474,24 +618,40 @@ snmp_msg_getnext_event(u8_t request_id, struct snmp_msg_pstat *msg_ps)
           msg_ps->state = SNMP_MSG_INTERNAL_GET_VALUE;
           mn->get_value(&object_def, object_def.v_len, vb->value);
           snmp_varbind_tail_add(&msg_ps->outvb, vb);
-          msg_ps->state = SNMP_MSG_SEARCH_OBJ;
-          msg_ps->vb_idx += 1;
+          snmp_msg_getnext_advance(msg_ps, 0);
         }
         else
         {
           LWIP_DEBUGF(SNMP_MSG_DEBUG, ("snmp_recv couldn't allocate outvb space\n"));
-          snmp_error_response(msg_ps,SNMP_ES_TOOBIG);
+          snmp_msg_getnext_nomem(msg_ps);
         }
       }
     }
     if (mn == NULL)
     {
-      /* mn == NULL, noSuchName */
-      snmp_error_response(msg_ps,SNMP_ES_NOSUCHNAME);
+#if SNMP_V2C
+      if (msg_ps->version == SNMP_VERSION_2c)
+      {
+        /* end of the MIB, v2c reports endOfMibView and carries on */
+        if (snmp_msg_exception_add(msg_ps, msg_ps->vb_ptr, SNMP_ASN1_ENDOFMIBVIEW) == ERR_OK)
+        {
+          snmp_msg_getnext_advance(msg_ps, 1);
+        }
+        else
+        {
+          snmp_msg_getnext_nomem(msg_ps);
+        }
+      }
+      else
+#endif
+      {
+        /* mn == NULL, noSuchName */
+        snmp_error_response(msg_ps,SNMP_ES_NOSUCHNAME);
+      }
     }
   }
   if ((msg_ps->state == SNMP_MSG_SEARCH_OBJ) &&
-      (msg_ps->vb_idx == msg_ps->invb.count))
+      (msg_ps->vb_idx == msg_ps->vb_total))
   {
     snmp_ok_response(msg_ps);
   }
@@ -770,7 +930,8 @@ snmp_msg_event(u8_t request_id)
   if (request_id < SNMP_CONCURRENT_REQUESTS)
   {
     msg_ps = &msg_input_list[request_id];
-    if (msg_ps->rt == SNMP_ASN1_PDU_GET_NEXT_REQ)
+    if ((msg_ps->rt == SNMP_ASN1_PDU_GET_NEXT_REQ) ||
+        (msg_ps->rt == SNMP_ASN1_PDU_GET_BULK_REQ))
     {
       snmp_msg_getnext_event(request_id, msg_ps);
     }
@@ -841,6 +1002,7 @@ snmp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, struct ip_addr *addr,
       err_ret = snmp_pdu_header_check(p, payload_ofs, payload_len, &varbind_ofs, msg_ps);
       if (((msg_ps->rt == SNMP_ASN1_PDU_GET_REQ) ||
            (msg_ps->rt == SNMP_ASN1_PDU_GET_NEXT_REQ) ||
+           (msg_ps->rt == SNMP_ASN1_PDU_GET_BULK_REQ) ||
            (msg_ps->rt == SNMP_ASN1_PDU_SET_REQ)) &&
           ((msg_ps->error_status == SNMP_ES_NOERROR) &&
            (msg_ps->error_index == 0)) )
@@ -871,6 +1033,17 @@ snmp_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p, struct ip_addr *addr,
           msg_ps->state = SNMP_MSG_SEARCH_OBJ;
           /* first variable binding from list to inspect */
           msg_ps->vb_idx = 0;
+          msg_ps->vb_total = msg_ps->invb.count;
+#if SNMP_V2C
+          if (msg_ps->rt == SNMP_ASN1_PDU_GET_BULK_REQ)
+          {
+            snmp_msg_bulk_init(msg_ps);
+          }
+#endif
+#if SNMP_PRIVATE_MIB
+          /* start a new request context in the private MIB */
+          SNMP_PRIVATE_MIB_PDU_BEGIN();
+#endif
 
           LWIP_DEBUGF(SNMP_MSG_DEBUG, ("snmp_recv varbind cnt=%"U16_F"\n",(u16_t)msg_ps->invb.count));
 
@@ -954,12 +1127,17 @@ snmp_pdu_header_check(struct pbuf *p, u16_t ofs, u16_t pdu_len, u16_t *ofs_ret,
     snmp_inc_snmpinasnparseerrs();
     return ERR_ARG;
   }
-  if (version != 0)
+#if SNMP_V2C
+  if ((version != SNMP_VERSION_1) && (version != SNMP_VERSION_2c))
+#else
+  if (version != SNMP_VERSION_1)
+#endif
   {
-    /* not version 1 */
+    /* not version 1 (or 2c) */
     snmp_inc_snmpinbadversions();
     return ERR_ARG;
   }
+  m_stat->version = version;
   ofs += (1 + len_octets + len);
   snmp_asn1_dec_type(p, ofs, &type);
   derr = snmp_asn1_dec_length(p, ofs+1, &len_octets, &len);
@@ -1007,6 +1185,18 @@ snmp_pdu_header_check(struct pbuf *p, u16_t ofs, u16_t pdu_len, u16_t *ofs_ret,
       snmp_inc_snmpingetnexts();
       derr = ERR_OK;
       break;
+#if SNMP_V2C
+    case (SNMP_ASN1_CONTXT | SNMP_ASN1_CONSTR | SNMP_ASN1_PDU_GET_BULK_REQ):
+      /* GetBulkRequest PDU, SNMPv2c only */
+      if (m_stat->version != SNMP_VERSION_2c)
+      {
+        snmp_inc_snmpinasnparseerrs();
+        return ERR_ARG;
+      }
+      snmp_inc_snmpingetnexts();
+      derr = ERR_OK;
+      break;
+#endif
     case (SNMP_ASN1_CONTXT | SNMP_ASN1_CONSTR | SNMP_ASN1_PDU_GET_RESP):
       /* GetResponse PDU */
       snmp_inc_snmpingetresponses();
@@ -1080,7 +1270,7 @@ snmp_pdu_header_check(struct pbuf *p, u16_t ofs, u16_t pdu_len, u16_t *ofs_ret,
     snmp_inc_snmpinasnparseerrs();
     return ERR_ARG;
   }
-  switch (m_stat->error_status)
+  switch ((m_stat->rt != SNMP_ASN1_PDU_GET_BULK_REQ) ? m_stat->error_status : SNMP_ES_NOERROR)
   {
     case SNMP_ES_TOOBIG:
       snmp_inc_snmpintoobigs();
@@ -1116,6 +1306,19 @@ snmp_pdu_header_check(struct pbuf *p, u16_t ofs, u16_t pdu_len, u16_t *ofs_ret,
     snmp_inc_snmpinasnparseerrs();
     return ERR_ARG;
   }
+#if SNMP_V2C
+  if (m_stat->rt == SNMP_ASN1_PDU_GET_BULK_REQ)
+  {
+    /* GetBulk carries non-repeaters and max-repetitions in these fields */
+    m_stat->non_repeaters = (m_stat->error_status < 0) ? 0 :
+                            (m_stat->error_status > 255) ? 255 : (u8_t)m_stat->error_status;
+    m_stat->max_repetitions = (m_stat->error_index < 0) ? 0 :
+                              (m_stat->error_index > SNMP_GETBULK_MAX_REPETITIONS) ?
+                              SNMP_GETBULK_MAX_REPETITIONS : (u8_t)m_stat->error_index;
+    m_stat->error_status = SNMP_ES_NOERROR;
+    m_stat->error_index = 0;
+  }
+#endif
   ofs += (1 + len_octets + len);
   *ofs_ret = ofs;
   return ERR_OK;
@@ -67,6 +67,9 @@ struct snmp_msg_trap trap_msg;
 static u16_t snmp_resp_header_sum(struct snmp_msg_pstat *m_stat, u16_t vb_len);
 static u16_t snmp_trap_header_sum(struct snmp_msg_trap *m_trap, u16_t vb_len);
 static u16_t snmp_varbind_list_sum(struct snmp_varbind_root *root);
+#if SNMP_V2C
+static u16_t snmp_varbind_list_trim(struct snmp_msg_pstat *m_stat, u16_t tot_len);
+#endif
 
 static u16_t snmp_resp_header_enc(struct snmp_msg_pstat *m_stat, struct pbuf *p);
 static u16_t snmp_trap_header_enc(struct snmp_msg_trap *m_trap, struct pbuf *p);
@@ -120,6 +123,12 @@ snmp_send_response(struct snmp_msg_pstat *m_stat)
   /* pass 0, calculate length fields */
   tot_len = snmp_varbind_list_sum(&m_stat->outvb);
   tot_len = snmp_resp_header_sum(m_stat, tot_len);
+#if SNMP_V2C
+  if (m_stat->rt == SNMP_ASN1_PDU_GET_BULK_REQ)
+  {
+    tot_len = snmp_varbind_list_trim(m_stat, tot_len);
+  }
+#endif
 
   /* try allocating pbuf(s) for complete response */
   p = pbuf_alloc(PBUF_TRANSPORT, tot_len, PBUF_POOL);
@@ -345,7 +354,7 @@ snmp_resp_header_sum(struct snmp_msg_pstat *m_stat, u16_t vb_len)
   snmp_asn1_enc_length_cnt(rhl->comlen, &rhl->comlenlen);
   tot_len += 1 + rhl->comlenlen + rhl->comlen;
 
-  snmp_asn1_enc_s32t_cnt(snmp_version, &rhl->verlen);
+  snmp_asn1_enc_s32t_cnt(m_stat->version, &rhl->verlen);
   snmp_asn1_enc_length_cnt(rhl->verlen, &rhl->verlenlen);
   tot_len += 1 + rhl->verlen + rhl->verlenlen;
 
@@ -412,6 +421,34 @@ snmp_trap_header_sum(struct snmp_msg_trap *m_trap, u16_t vb_len)
   return tot_len;
 }
 
+#if SNMP_V2C
+/**
+ * Drops trailing varbinds of a GetBulk response until the encoded
+ * message fits in SNMP_GETBULK_MAX_RESPONSE_LEN (RFC3416 4.2.3).
+ *
+ * @param m_stat points to the current message request state
+ * @param tot_len the required message length before trimming
+ * @return the required message length after trimming
+ */
+static u16_t
+snmp_varbind_list_trim(struct snmp_msg_pstat *m_stat, u16_t tot_len)
+{
+  struct snmp_varbind_root *root;
+  struct snmp_varbind *vb;
+
+  root = &m_stat->outvb;
+  while ((tot_len > SNMP_GETBULK_MAX_RESPONSE_LEN) && (root->count > 1))
+  {
+    vb = snmp_varbind_tail_remove(root);
+    root->seqlen -= 1 + vb->seqlenlen + vb->seqlen;
+    snmp_varbind_free(vb);
+    snmp_asn1_enc_length_cnt(root->seqlen, &root->seqlenlen);
+    tot_len = snmp_resp_header_sum(m_stat, 1 + root->seqlenlen + root->seqlen);
+  }
+  return tot_len;
+}
+#endif
+
 /**
  * Sums varbind lengths from tail to head and
  * annotates lengths in varbind for second encoding pass.
@@ -500,7 +537,7 @@ snmp_resp_header_enc(struct snmp_msg_pstat *m_stat, struct pbuf *p)
   ofs += 1;
   snmp_asn1_enc_length(p, ofs, m_stat->rhl.verlen);
   ofs += m_stat->rhl.verlenlen;
-  snmp_asn1_enc_s32t(p, ofs, m_stat->rhl.verlen, snmp_version);
+  snmp_asn1_enc_s32t(p, ofs, m_stat->rhl.verlen, m_stat->version);
   ofs += m_stat->rhl.verlen;
 
   snmp_asn1_enc_type(p, ofs, (SNMP_ASN1_UNIV | SNMP_ASN1_PRIMIT | SNMP_ASN1_OC_STR));
@@ -773,6 +773,45 @@ tcp_oos_insert_segment(struct tcp_seg *cseg, struct tcp_seg *next)
   }
   cseg->next = next;
 }
+
+#if TCP_OOSEQ_MAX_PBUFS
+/**
+ * Keep the ooseq queues of all connections within TCP_OOSEQ_MAX_PBUFS pool
+ * pbufs together. Each insert trims its own queue, so the other queues are
+ * already within the budget and only the data just queued can exceed it.
+ * The tail goes first, the sender will fill the hole in front of it before
+ * resending it.
+ *
+ * Called from tcp_receive()
+ */
+static void
+tcp_oos_limit(struct tcp_pcb *pcb)
+{
+  struct tcp_pcb *apcb;
+  struct tcp_seg *seg, *prev;
+  u16_t total = 0;
+
+  for (apcb = tcp_active_pcbs; apcb != NULL; apcb = apcb->next) {
+    for (seg = apcb->ooseq; seg != NULL; seg = seg->next) {
+      total += pbuf_clen(seg->p);
+    }
+  }
+
+  while ((total > TCP_OOSEQ_MAX_PBUFS) && (pcb->ooseq != NULL)) {
+    prev = NULL;
+    for (seg = pcb->ooseq; seg->next != NULL; seg = seg->next) {
+      prev = seg;
+    }
+    if (prev != NULL) {
+      prev->next = NULL;
+    } else {
+      pcb->ooseq = NULL;
+    }
+    total -= pbuf_clen(seg->p);
+    tcp_seg_free(seg);
+  }
+}
+#endif /* TCP_OOSEQ_MAX_PBUFS */
 #endif
 
 /**
@@ -1399,6 +1438,9 @@ tcp_receive(struct tcp_pcb *pcb)
             prev = next;
           }
         }
+#if TCP_OOSEQ_MAX_PBUFS
+        tcp_oos_limit(pcb);
+#endif /* TCP_OOSEQ_MAX_PBUFS */
 #endif /* TCP_QUEUE_OOSEQ */
 
       }
@@ -625,6 +625,39 @@
 #define SNMP_SAFE_REQUESTS              1
 #endif
 
+/**
+ * SNMP_V2C==1: Also accept community based SNMPv2c (RFC1901) requests,
+ * including GetBulkRequest. Responses use the v2 exception values
+ * (noSuchObject, noSuchInstance, endOfMibView) for v2c requests.
+ */
+#ifndef SNMP_V2C
+#define SNMP_V2C                        0
+#endif
+
+/**
+ * SNMP_GETBULK_MAX_REPETITIONS: Upper bound for the max-repetitions field
+ * of an incoming GetBulkRequest.
+ */
+#ifndef SNMP_GETBULK_MAX_REPETITIONS
+#define SNMP_GETBULK_MAX_REPETITIONS    32
+#endif
+
+/**
+ * SNMP_GETBULK_MAX_VARBINDS: Maximum number of variable bindings returned
+ * in one GetBulk response (at most 255).
+ */
+#ifndef SNMP_GETBULK_MAX_VARBINDS
+#define SNMP_GETBULK_MAX_VARBINDS       64
+#endif
+
+/**
+ * SNMP_GETBULK_MAX_RESPONSE_LEN: GetBulk responses are truncated from the
+ * tail until the encoded message fits in this many octets.
+ */
+#ifndef SNMP_GETBULK_MAX_RESPONSE_LEN
+#define SNMP_GETBULK_MAX_RESPONSE_LEN   1400
+#endif
+
 /*
    ----------------------------------
    ---------- IGMP options ----------
@@ -784,6 +817,14 @@
 #define TCP_QUEUE_OOSEQ                 (LWIP_TCP)
 #endif
 
+/**
+ * TCP_OOSEQ_MAX_PBUFS: The maximum number of pbufs queued on ooseq by all
+ * pcbs together. Only valid for TCP_QUEUE_OOSEQ==1. Define to 0 for no limit.
+ */
+#ifndef TCP_OOSEQ_MAX_PBUFS
+#define TCP_OOSEQ_MAX_PBUFS             0
+#endif
+
 /**
  * TCP_MSS: TCP Maximum segment size. (default is 536, a conservative default,
  * you might want to increase this.)
@@ -1058,6 +1099,25 @@
 #define TCPIP_MBOX_SIZE                 0
 #endif
 
+/**
+ * TCPIP_MBOX_BATCH: The maximum number of messages tcpip_thread takes from
+ * its mailbox per wakeup. Messages already queued behind the first one are
+ * handled without going back through the timeout check (and, with
+ * LWIP_TCPIP_CORE_LOCKING, without releasing the core lock in between).
+ */
+#ifndef TCPIP_MBOX_BATCH
+#define TCPIP_MBOX_BATCH                1
+#endif
+
+/**
+ * LWIP_API_STACK_EXTRA: Stack (in sys_thread_new() units) to add to a task
+ * that calls the socket or netconn API. With LWIP_TCPIP_CORE_LOCKING the API
+ * and the output path down to the netif run on the calling task's stack.
+ */
+#ifndef LWIP_API_STACK_EXTRA
+#define LWIP_API_STACK_EXTRA            0
+#endif
+
 /**
  * SLIPIF_THREAD_NAME: The name assigned to the slipif_loop thread.
  */
@@ -73,6 +73,12 @@ extern "C" {
 #define SNMP_ASN1_PDU_GET_RESP 2
 #define SNMP_ASN1_PDU_SET_REQ 3
 #define SNMP_ASN1_PDU_TRAP 4
+#define SNMP_ASN1_PDU_GET_BULK_REQ 5
+
+/* SNMPv2 varbind exceptions (context specific, primitive, empty) */
+#define SNMP_ASN1_NOSUCHOBJECT 0
+#define SNMP_ASN1_NOSUCHINSTANCE 1
+#define SNMP_ASN1_ENDOFMIBVIEW 2
 
 err_t snmp_asn1_dec_type(struct pbuf *p, u16_t ofs, u8_t *type);
 err_t snmp_asn1_dec_length(struct pbuf *p, u16_t ofs, u8_t *octets_used, u16_t *length);
@@ -67,6 +67,10 @@ extern "C" {
 #define SNMP_ES_READONLY 4
 #define SNMP_ES_GENERROR 5
 
+/* message version field values */
+#define SNMP_VERSION_1  0
+#define SNMP_VERSION_2c 1
+
 #define SNMP_GENTRAP_COLDSTART 0
 #define SNMP_GENTRAP_WARMSTART 1
 #define SNMP_GENTRAP_AUTHFAIL 4
@@ -224,6 +228,8 @@ struct snmp_msg_pstat
   u16_t sp;
   /* request type */
   u8_t rt;
+  /* message version, echoed in the response */
+  s32_t version;
   /* request ID */
   s32_t rid;
   /* error status */
@@ -243,7 +249,17 @@ struct snmp_msg_pstat
   struct snmp_obj_id ext_oid;
   /* index into input variable binding list */
   u8_t vb_idx;
-  /* ptr into input variable binding list */
+  /* number of output variable bindings to produce (GetNext/GetBulk) */
+  u8_t vb_total;
+#if SNMP_V2C
+  /* GetBulk non-repeaters and (clamped) max-repetitions */
+  u8_t non_repeaters;
+  u8_t max_repetitions;
+  /* endOfMibView results seen in the current GetBulk repetition */
+  u8_t bulk_eomv;
+#endif
+  /* ptr into input variable binding list,
+     for GetBulk repetitions a ptr into the output list */
   struct snmp_varbind *vb_ptr;
   /* list of variable bindings from input */
   struct snmp_varbind_root invb;
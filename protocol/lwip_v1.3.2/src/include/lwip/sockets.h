@@ -42,6 +42,7 @@
 
 #include "lwip/ip_addr.h"
 #include "lwip/inet.h"
+#include "lwip/sys.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -296,6 +297,11 @@ struct timeval {
 };
 #endif /* LWIP_TIMEVAL_PRIVATE */
 
+/** Target of lwip_select_wakeup(), owned by the task that selects on it */
+struct lwip_select_waker {
+  u32_t gen;          /* wakeups so far, protected by the select lock */
+};
+
 void lwip_socket_init(void);
 
 int lwip_accept(int s, struct sockaddr *addr, socklen_t *addrlen);
@@ -319,6 +325,11 @@ int lwip_socket(int domain, int type, int protocol);
 int lwip_write(int s, const void *dataptr, size_t size);
 int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
                 struct timeval *timeout);
+u32_t lwip_select_generation(struct lwip_select_waker *waker);
+int lwip_select_since(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptset,
+                struct timeval *timeout, struct lwip_select_waker *waker, u32_t gen);
+void lwip_select_wakeup(struct lwip_select_waker *waker);
+int lwip_socket_notify(int s, sys_sem_t sem);
 int lwip_ioctl(int s, long cmd, void *argp);
 
 #if LWIP_COMPAT_SOCKETS
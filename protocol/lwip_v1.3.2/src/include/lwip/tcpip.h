@@ -50,7 +50,9 @@ extern "C" {
 #if LWIP_TCPIP_CORE_LOCKING
 /** The global semaphore to lock the stack. */
 extern sys_sem_t lock_tcpip_core;
-#define LOCK_TCPIP_CORE()     sys_sem_wait(lock_tcpip_core)
+/* sys_arch_sem_wait() rather than sys_sem_wait(): timeouts must not be
+   processed by tcpip_thread while it does not hold the lock */
+#define LOCK_TCPIP_CORE()     sys_arch_sem_wait(lock_tcpip_core, 0)
 #define UNLOCK_TCPIP_CORE()   sys_sem_signal(lock_tcpip_core)
 #define TCPIP_APIMSG(m)       tcpip_apimsg_lock(m)
 #define TCPIP_APIMSG_ACK(m)
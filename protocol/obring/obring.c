@@ -1140,44 +1140,40 @@ void obring_trap_ring_change(void)
 	
 
 	if((gTrapInfo.FeatureEnable == HAL_TRUE) && (gTrapInfo.GateMask & TRAP_MASK_RING_STATUS)) {
-		gTrapInfo.SendEnable[TRAP_INDEX_RING_STATUS] = HAL_TRUE;
-		gTrapInfo.RequestID[TRAP_INDEX_RING_STATUS]++;
-		
-		if(gTrapInfo.SendEnable[TRAP_INDEX_PORT_STATUS] == HAL_TRUE) {
-			memset(&TrapRingStatus, 0, sizeof(hal_trap_ring_status));
-			TrapRingStatus.TrapIndex = TRAP_INDEX_RING_STATUS;
-			TrapRingStatus.RingPairNum = RingInfo.GlobalConfig.ucRecordNum;
-
-			for(RingIndex=0; RingIndex<TrapRingStatus.RingPairNum; RingIndex++) {
-				pRingConfig = &(pRingInfo->RingConfig[RingIndex]);
-				pRingState = &(pRingInfo->DevState[RingIndex]);
-
-				for(RingPortIndex=0; RingPortIndex<2; RingPortIndex++) {
-					if(pRingState->PortState[RingPortIndex].LinkState == LINK_DOWN) {
-						RingPortStatus = 0x01;
-					} else {
-						if(pRingState->PortState[RingPortIndex].StpState == FORWARDING)
-							RingPortStatus = 0x3;
-						else if(pRingState->PortState[RingPortIndex].StpState == BLOCKING)
-							RingPortStatus = 0x2;
-						else
-							RingPortStatus = 0x0;
-					}
-					
-					if(pRingConfig->ucEnable == 0x01)
-						RingPortStatus |= 0x80;
-					if(pRingState->RingState == RING_HEALTH)
-						RingPortStatus |= 0x40;	
-					if(pRingState->NodeType == NODE_TYPE_MASTER)
-						RingPortStatus |= 0x20;	
-					
-					TrapRingStatus.RingPairStatus[2*RingIndex + RingPortIndex].Flag = RingPortStatus;
-					memcpy(TrapRingStatus.RingPairStatus[2*RingIndex + RingPortIndex].ExtNeighborMac, pRingState->PortState[RingPortIndex].NeighborMac, MAC_LEN);
-					TrapRingStatus.RingPairStatus[2*RingIndex + RingPortIndex].ExtNeighborPortNo = pRingState->PortState[RingPortIndex].NeighborPortNo;
+		memset(&TrapRingStatus, 0, sizeof(hal_trap_ring_status));
+		TrapRingStatus.TrapIndex = TRAP_INDEX_RING_STATUS;
+		TrapRingStatus.RingPairNum = RingInfo.GlobalConfig.ucRecordNum;
+
+		for(RingIndex=0; RingIndex<TrapRingStatus.RingPairNum; RingIndex++) {
+			pRingConfig = &(pRingInfo->RingConfig[RingIndex]);
+			pRingState = &(pRingInfo->DevState[RingIndex]);
+
+			for(RingPortIndex=0; RingPortIndex<2; RingPortIndex++) {
+				if(pRingState->PortState[RingPortIndex].LinkState == LINK_DOWN) {
+					RingPortStatus = 0x01;
+				} else {
+					if(pRingState->PortState[RingPortIndex].StpState == FORWARDING)
+						RingPortStatus = 0x3;
+					else if(pRingState->PortState[RingPortIndex].StpState == BLOCKING)
+						RingPortStatus = 0x2;
+					else
+						RingPortStatus = 0x0;
 				}
+				
+				if(pRingConfig->ucEnable == 0x01)
+					RingPortStatus |= 0x80;
+				if(pRingState->RingState == RING_HEALTH)
+					RingPortStatus |= 0x40;	
+				if(pRingState->NodeType == NODE_TYPE_MASTER)
+					RingPortStatus |= 0x20;	
+				
+				TrapRingStatus.RingPairStatus[2*RingIndex + RingPortIndex].Flag = RingPortStatus;
+				memcpy(TrapRingStatus.RingPairStatus[2*RingIndex + RingPortIndex].ExtNeighborMac, pRingState->PortState[RingPortIndex].NeighborMac, MAC_LEN);
+				TrapRingStatus.RingPairStatus[2*RingIndex + RingPortIndex].ExtNeighborPortNo = pRingState->PortState[RingPortIndex].NeighborPortNo;
 			}
-			hal_swif_trap_send(gTrapInfo.ServerMac, (uint8 *)&TrapRingStatus, sizeof(hal_trap_ring_status), gTrapInfo.RequestID[TRAP_INDEX_RING_STATUS]);
 		}
+		/* Replaces a ring trap still waiting for its response */
+		hal_swif_trap_post((uint8 *)&TrapRingStatus, sizeof(hal_trap_ring_status));
 	}
 #endif
 }
@@ -2789,7 +2785,7 @@ void obring_poll_task(void *arg)
 			pRingConfig = &(pRingInfo->RingConfig[RingIndex]);
 			pRingState = &(pRingInfo->DevState[RingIndex]);
 			
-			if(hal_swif_port_get_link_state(pRingConfig->ucPrimaryPort, &PrimaryPortLinkState) == HAL_SWIF_SUCCESS) {
+			if(hal_swif_port_get_dampened_link_state(pRingConfig->ucPrimaryPort, &PrimaryPortLinkState) == HAL_SWIF_SUCCESS) {
 				if(PrimaryPortLinkState == LINK_UP) {
 					CurrRingLinkMap[RingIndex] |= 0x01;
 				} else {
@@ -2797,7 +2793,7 @@ void obring_poll_task(void *arg)
 				}
 			} 
 
-			if(hal_swif_port_get_link_state(pRingConfig->ucSecondaryPort, &SecondaryPortLinkState) == HAL_SWIF_SUCCESS) {
+			if(hal_swif_port_get_dampened_link_state(pRingConfig->ucSecondaryPort, &SecondaryPortLinkState) == HAL_SWIF_SUCCESS) {
 				if(SecondaryPortLinkState == LINK_UP) {
 					CurrRingLinkMap[RingIndex] |= 0x02;
 				} else {
@@ -0,0 +1,36 @@
+/*************************************************************
+ * Filename     : host_test.h
+ * Description  : minimal checks for the host side unit tests
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#ifndef _HOST_TEST_H
+#define _HOST_TEST_H
+
+#include <stdio.h>
+
+static int host_test_fail;
+
+/* Report a failed condition and keep going, main returns the count */
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		host_test_fail++; \
+	} \
+} while (0)
+
+#define CHECK_EQ(a, b) do { \
+	unsigned long _a = (unsigned long)(a), _b = (unsigned long)(b); \
+	if (_a != _b) { \
+		printf("%s:%d: check failed: %s == %s (0x%lx != 0x%lx)\n", \
+			__FILE__, __LINE__, #a, #b, _a, _b); \
+		host_test_fail++; \
+	} \
+} while (0)
+
+#define HOST_TEST_DONE(name) do { \
+	printf("%s: %s\n", name, host_test_fail ? "FAIL" : "ok"); \
+	return host_test_fail ? 1 : 0; \
+} while (0)
+
+#endif /* _HOST_TEST_H */
@@ -0,0 +1,2 @@
+/* Host stand-in for the kernel header, the RLI os layer only names the
+   semaphore type */
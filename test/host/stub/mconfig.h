@@ -0,0 +1,16 @@
+/* Host stand-in for the board configuration, enough for the hal_switch
+   headers used by the host tests */
+#ifndef __MCONFIG_H
+#define __MCONFIG_H
+
+#define __packed
+
+#define OB_NMS_PROTOCOL_VERSION	2
+#define MODULE_OBNMS			0
+#define SWITCH_CHIP_88E6095		1
+#define MAX_PORT_NUM			10
+
+#define L2_PORT_RATE_CTRL		0x00000008
+#define BOARD_FEATURE			L2_PORT_RATE_CTRL
+
+#endif
@@ -0,0 +1,12 @@
+/* Host stand-in for the device header, only the integer types */
+#ifndef __STM32F2xx_H
+#define __STM32F2xx_H
+
+#include <stdint.h>
+
+typedef unsigned int	u32;
+typedef unsigned short	u16;
+typedef unsigned char	u8;
+typedef int				s32;
+
+#endif
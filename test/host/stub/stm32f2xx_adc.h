@@ -0,0 +1 @@
+/* Host stand-in for the ADC driver header, nothing is used from it */
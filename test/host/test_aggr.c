@@ -0,0 +1,159 @@
+/*************************************************************
+ * Filename     : test_aggr.c
+ * Description  : host test of the trunk select table and bucket
+ *                masks in hal_swif_aggr_select.c, members go down
+ *                and come back up at random
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "mconfig.h"
+#include "stm32f2xx.h"
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_port.h"
+#include "hal_swif_aggregation.h"
+#include "host_test.h"
+
+#define ALL_PORTS	0x7FF
+
+static u32 select_table[AGGR_SELECT_TABLE_SIZE];
+
+static u8 bucket_sel(u8 n, u16 live, u8 k)
+{
+	return (u8)((select_table[AGGR_SELECT_BASE(n) + live] >> (k * 4)) & 0x0F);
+}
+
+static void test_select_table(void)
+{
+	u8 n, k, sel, spilled[MAX_AGGREGATION_GROUP_PORT_NUM], lo, hi;
+	u16 live;
+
+	memset(select_table, 0xAA, sizeof(select_table));
+	hal_swif_aggr_build_select(select_table);
+
+	for (n = 1; n <= MAX_AGGREGATION_GROUP_PORT_NUM; n++) {
+		for (live = 0; live < (1 << n); live++) {
+			memset(spilled, 0, sizeof(spilled));
+			for (k = 0; k < AGGR_HASH_BUCKETS; k++) {
+				sel = bucket_sel(n, live, k);
+				if (live == 0) {
+					CHECK_EQ(sel, AGGR_SELECT_NONE);
+					continue;
+				}
+				/* always a live member of this trunk */
+				CHECK(sel < n);
+				CHECK(live & (1 << sel));
+				/* a bucket of a live member stays with it */
+				if (live & (1 << (k % n)))
+					CHECK_EQ(sel, k % n);
+				else
+					spilled[sel]++;
+			}
+
+			/* the buckets of down members are shared out evenly */
+			lo = 0xFF;
+			hi = 0;
+			for (k = 0; k < n; k++) {
+				if (!(live & (1 << k)))
+					continue;
+				if (spilled[k] < lo)
+					lo = spilled[k];
+				if (spilled[k] > hi)
+					hi = spilled[k];
+			}
+			if (live != 0)
+				CHECK(hi - lo <= 1);
+		}
+	}
+}
+
+static void trunk(aggr_rec *pRec, u8 count, const u8 *hport)
+{
+	memset(pRec, 0, sizeof(*pRec));
+	pRec->PortNumber = count;
+	memcpy(pRec->HwPort, hport, count);
+	pRec->LiveMask = (1 << count) - 1;
+}
+
+/* Members of one trunk present in a bucket mask, as a live mask */
+static u8 members_in(const aggr_rec *pRec, u32 mask)
+{
+	u8 i, in = 0;
+
+	for (i = 0; i < pRec->PortNumber; i++) {
+		if (mask & (1 << pRec->HwPort[i]))
+			in |= 1 << i;
+	}
+	return in;
+}
+
+static void test_failover(void)
+{
+	static const u8 ports_a[] = { 0, 1, 2 };
+	static const u8 ports_b[] = { 4, 5, 6, 7, 8 };
+	aggr_info_t info;
+	u32 base, mask[AGGR_HASH_BUCKETS], first[AGGR_HASH_BUCKETS], prev;
+	u8 t, k, m, in, was, home;
+	int step;
+
+	memset(&info, 0, sizeof(info));
+	info.AggrCount = 2;
+	trunk(&info.AggrGroupRec[0], 3, ports_a);
+	trunk(&info.AggrGroupRec[1], 5, ports_b);
+	base = ALL_PORTS & ~0x1F7;
+	for (k = 0; k < AGGR_HASH_BUCKETS; k++)
+		first[k] = mask[k] = hal_swif_aggr_bucket_mask(select_table, &info, base, k);
+
+	srand(1);
+	for (step = 0; step < 5000; step++) {
+		aggr_rec *pRec = &info.AggrGroupRec[rand() % 2];
+
+		/* one member goes down or comes back up */
+		m = rand() % pRec->PortNumber;
+		pRec->LiveMask ^= 1 << m;
+
+		for (k = 0; k < AGGR_HASH_BUCKETS; k++) {
+			prev = mask[k];
+			mask[k] = hal_swif_aggr_bucket_mask(select_table, &info, base, k);
+			CHECK_EQ(mask[k] & base, base);
+
+			for (t = 0; t < info.AggrCount; t++) {
+				aggr_rec *pTrunk = &info.AggrGroupRec[t];
+
+				/* exactly one member, and a live one, or none at all */
+				in = members_in(pTrunk, mask[k]);
+				if (pTrunk->LiveMask == 0) {
+					CHECK_EQ(in, 0);
+				} else {
+					CHECK(in != 0);
+					CHECK_EQ(in & (in - 1), 0);
+					CHECK(in & pTrunk->LiveMask);
+				}
+
+				/* a live member keeps its own buckets, the other trunk
+				   does not move at all */
+				was = members_in(pTrunk, prev);
+				home = k % pTrunk->PortNumber;
+				if (pTrunk->LiveMask & (1 << home))
+					CHECK_EQ(in, 1 << home);
+				if (pTrunk != pRec)
+					CHECK_EQ(in, was);
+			}
+		}
+
+		/* all members back, all buckets back where they started */
+		if ((info.AggrGroupRec[0].LiveMask == 0x07) && (info.AggrGroupRec[1].LiveMask == 0x1F)) {
+			for (k = 0; k < AGGR_HASH_BUCKETS; k++)
+				CHECK_EQ(mask[k], first[k]);
+		}
+	}
+}
+
+int main(void)
+{
+	test_select_table();
+	test_failover();
+	HOST_TEST_DONE("aggr");
+}
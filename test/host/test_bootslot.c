@@ -0,0 +1,158 @@
+/*************************************************************
+ * Filename     : test_bootslot.c
+ * Description  : host test of the A/B boot slot selection in
+ *                ob_boot_slot.c
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include "ob_boot_slot.h"
+#include "host_test.h"
+
+/* Image check stand-in: bootable[] for the header check, verified[] for
+   the data CRC of an installed slot */
+static int bootable[2], verified[2];
+static int full_checks;
+
+static int check(unsigned char slot, int full)
+{
+	if (full) {
+		full_checks++;
+		if (!verified[slot])
+			return -1;
+	}
+	return bootable[slot] ? 0 : -1;
+}
+
+static void slots(int a, int b)
+{
+	bootable[OB_SLOT_A] = verified[OB_SLOT_A] = a;
+	bootable[OB_SLOT_B] = verified[OB_SLOT_B] = b;
+	full_checks = 0;
+}
+
+/* One power on as the bootloader runs it, the application confirming or
+   not. Returns the slot booted. */
+static int boot(unsigned char *state, unsigned char *flag, int confirm)
+{
+	int slot = OB_Boot_Slot_Select(state, *flag, check);
+
+	*flag = OB_UPGRADE_FLAG_NONE;
+	if ((slot >= 0) && confirm)
+		*state = OB_BOOT_STATE(OB_BOOT_STATE_SLOT(*state), 0);
+	return slot;
+}
+
+static void test_upgrade_confirmed(void)
+{
+	unsigned char state = OB_BOOT_STATE(OB_SLOT_A, 0), flag = OB_UPGRADE_FLAG_SLOT_B;
+
+	slots(1, 1);
+	CHECK_EQ(OB_Boot_Slot_Select(&state, flag, check), OB_SLOT_B);
+	CHECK_EQ(full_checks, 1);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_B, 1));
+
+	/* the application confirms, later boots stay on B */
+	state = OB_BOOT_STATE(OB_SLOT_B, 0);
+	flag = OB_UPGRADE_FLAG_NONE;
+	CHECK_EQ(boot(&state, &flag, 0), OB_SLOT_B);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_B, 0));
+	CHECK_EQ(full_checks, 1);
+}
+
+static void test_upgrade_verify_fail(void)
+{
+	unsigned char state = OB_BOOT_STATE(OB_SLOT_A, 0);
+
+	/* a bad data CRC keeps the running slot and its state */
+	slots(1, 1);
+	verified[OB_SLOT_B] = 0;
+	CHECK_EQ(OB_Boot_Slot_Select(&state, OB_UPGRADE_FLAG_SLOT_B, check), OB_SLOT_A);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_A, 0));
+
+	/* also when a trial was running */
+	state = OB_BOOT_STATE(OB_SLOT_B, 2);
+	verified[OB_SLOT_A] = 0;
+	CHECK_EQ(OB_Boot_Slot_Select(&state, OB_UPGRADE_FLAG_SLOT_A, check), OB_SLOT_B);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_B, 2));
+}
+
+static void test_fallback(void)
+{
+	unsigned char state = OB_BOOT_STATE(OB_SLOT_A, 0), flag = OB_UPGRADE_FLAG_SLOT_B;
+	int i;
+
+	/* the new slot boots but never confirms, OB_BOOT_MAX_TRIES boots are
+	   given to it and the next one goes back to A for good */
+	slots(1, 1);
+	for (i = 1; i <= OB_BOOT_MAX_TRIES; i++) {
+		CHECK_EQ(boot(&state, &flag, 0), OB_SLOT_B);
+		CHECK_EQ(OB_BOOT_STATE_TRIES(state), i);
+	}
+	CHECK_EQ(boot(&state, &flag, 0), OB_SLOT_A);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_A, 0));
+	CHECK_EQ(boot(&state, &flag, 0), OB_SLOT_A);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_A, 0));
+
+	/* a confirm during the trial stops the count */
+	state = OB_BOOT_STATE(OB_SLOT_A, 0);
+	flag = OB_UPGRADE_FLAG_SLOT_B;
+	CHECK_EQ(boot(&state, &flag, 0), OB_SLOT_B);
+	CHECK_EQ(boot(&state, &flag, 1), OB_SLOT_B);
+	for (i = 0; i < 2 * OB_BOOT_MAX_TRIES; i++)
+		CHECK_EQ(boot(&state, &flag, 0), OB_SLOT_B);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_B, 0));
+}
+
+static void test_not_bootable(void)
+{
+	unsigned char state;
+
+	/* the active slot got erased, the other one takes over confirmed */
+	slots(1, 0);
+	state = OB_BOOT_STATE(OB_SLOT_B, 0);
+	CHECK_EQ(OB_Boot_Slot_Select(&state, OB_UPGRADE_FLAG_NONE, check), OB_SLOT_A);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_A, 0));
+
+	/* the fallback target is broken, the trial slot is kept */
+	slots(0, 1);
+	state = OB_BOOT_STATE(OB_SLOT_B, OB_BOOT_MAX_TRIES);
+	CHECK_EQ(OB_Boot_Slot_Select(&state, OB_UPGRADE_FLAG_NONE, check), OB_SLOT_B);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_B, 0));
+
+	/* nothing to boot, the state is left for the next power on */
+	slots(0, 0);
+	state = OB_BOOT_STATE(OB_SLOT_B, 1);
+	CHECK_EQ(OB_Boot_Slot_Select(&state, OB_UPGRADE_FLAG_SLOT_A, check), -1);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_B, 1));
+}
+
+static void test_invalid_state(void)
+{
+	unsigned char state;
+
+	/* a blank or corrupt eeprom byte boots slot A */
+	slots(1, 1);
+	state = 0xFF;
+	CHECK(!OB_BOOT_STATE_VALID(state));
+	CHECK_EQ(OB_Boot_Slot_Select(&state, OB_UPGRADE_FLAG_NONE, check), OB_SLOT_A);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_A, 0));
+
+	state = 0x81;
+	CHECK_EQ(OB_Boot_Slot_Select(&state, OB_UPGRADE_FLAG_NONE, check), OB_SLOT_A);
+	CHECK_EQ(state, OB_BOOT_STATE(OB_SLOT_A, 0));
+
+	/* an unknown flag value is no upgrade */
+	state = OB_BOOT_STATE(OB_SLOT_A, 0);
+	CHECK_EQ(OB_Boot_Slot_Select(&state, 0x55, check), OB_SLOT_A);
+	CHECK_EQ(full_checks, 0);
+}
+
+int main(void)
+{
+	test_upgrade_confirmed();
+	test_upgrade_verify_fail();
+	test_fallback();
+	test_not_bootable();
+	test_invalid_state();
+	HOST_TEST_DONE("bootslot");
+}
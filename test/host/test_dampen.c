@@ -0,0 +1,175 @@
+/*************************************************************
+ * Filename     : test_dampen.c
+ * Description  : host test of the link flap dampening in
+ *                hal_swif_dampen.c, flap sequences are replayed
+ *                and the suppress and reuse times checked
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <string.h>
+#include "mconfig.h"
+#include "stm32f2xx.h"
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_port.h"
+#include "host_test.h"
+
+/* The link task samples every 100 ms */
+#define SAMPLE_MS	100
+
+static hal_port_dampen_t dampen;
+static uint32 now;
+
+static HAL_PORT_LINK_STATE sample(HAL_PORT_LINK_STATE raw)
+{
+	HAL_PORT_LINK_STATE out = hal_swif_dampen_update(&dampen, raw, now);
+
+	now += SAMPLE_MS;
+	return out;
+}
+
+static void start(uint32 tick)
+{
+	memset(&dampen, 0, sizeof(dampen));
+	now = tick;
+	sample(LINK_UP);
+}
+
+/* Hold the raw state for ms, returns the ms until the output follows it,
+   -1 if it never does. Once it follows it must keep doing so. */
+static int hold(HAL_PORT_LINK_STATE raw, int ms)
+{
+	int t, follow = -1;
+
+	for (t = 0; t < ms; t += SAMPLE_MS) {
+		if (sample(raw) == raw) {
+			if (follow < 0)
+				follow = t;
+		} else {
+			CHECK(follow < 0);
+		}
+	}
+	return follow;
+}
+
+static void test_single_flap(void)
+{
+	start(0);
+	/* a down goes through at once, one flap is not enough to suppress */
+	CHECK_EQ(hold(LINK_DOWN, 500), 0);
+	CHECK_EQ(dampen.Penalty, HAL_DAMPEN_PENALTY);
+	CHECK_EQ(hold(LINK_UP, 500), 0);
+	CHECK_EQ(dampen.Suppressed, 0);
+	CHECK_EQ(dampen.FlapCount, 1);
+
+	/* a second one a half life later is not either */
+	hold(LINK_UP, HAL_DAMPEN_HALF_LIFE * 1000);
+	CHECK_EQ(hold(LINK_DOWN, 1000), 0);
+	CHECK(dampen.Penalty < HAL_DAMPEN_SUPPRESS);
+	CHECK_EQ(hold(LINK_UP, 1000), 0);
+	CHECK_EQ(dampen.SuppressCount, 0);
+}
+
+static void test_suppress_reuse(void)
+{
+	int up;
+
+	/* two flaps within a second suppress the port */
+	start(0);
+	hold(LINK_DOWN, 200);
+	hold(LINK_UP, 200);
+	CHECK_EQ(hold(LINK_DOWN, 200), 0);
+	CHECK_EQ(dampen.Suppressed, 1);
+	CHECK_EQ(dampen.SuppressCount, 1);
+
+	/* the up is held back until 2000 decayed below 750, 21.2 s at a
+	   15 s half life */
+	up = hold(LINK_UP, 30000);
+	CHECK((up >= 20000) && (up <= 22000));
+	CHECK_EQ(dampen.Suppressed, 0);
+	CHECK(dampen.Penalty < HAL_DAMPEN_REUSE);
+	CHECK(dampen.SuppressTime >= 20);
+
+	/* a down while suppressed still goes through and keeps it held */
+	start(0);
+	hold(LINK_DOWN, 200);
+	hold(LINK_UP, 200);
+	hold(LINK_DOWN, 200);
+	CHECK_EQ(hold(LINK_UP, 5000), -1);
+	CHECK_EQ(hold(LINK_DOWN, 200), 0);
+	CHECK_EQ(dampen.SuppressCount, 1);
+	CHECK(dampen.Penalty >= HAL_DAMPEN_SUPPRESS);
+}
+
+static void test_storm(void)
+{
+	int i, up;
+
+	/* a port flapping once a second for minutes is held the whole time */
+	start(0);
+	for (i = 0; i < 300; i++) {
+		CHECK_EQ(hold(LINK_DOWN, 500), 0);
+		if (i == 2)
+			CHECK_EQ(dampen.Suppressed, 1);
+		if (dampen.Suppressed)
+			CHECK_EQ(hold(LINK_UP, 500), -1);
+		else
+			hold(LINK_UP, 500);
+	}
+	CHECK_EQ(dampen.FlapCount, 300);
+	CHECK_EQ(dampen.SuppressCount, 1);
+	CHECK(dampen.Penalty <= HAL_DAMPEN_PENALTY_MAX);
+
+	/* once it stops the hold ends within HAL_DAMPEN_MAX_SUPPRESS */
+	up = hold(LINK_UP, 2 * HAL_DAMPEN_MAX_SUPPRESS * 1000);
+	CHECK(up >= 0);
+	CHECK(up <= HAL_DAMPEN_MAX_SUPPRESS * 1000);
+	CHECK(up >= (HAL_DAMPEN_MAX_SUPPRESS - HAL_DAMPEN_HALF_LIFE) * 1000);
+}
+
+static void test_decay(void)
+{
+	hal_port_dampen_t odd;
+	uint32 t;
+
+	/* sampled every 100 ms or every 700 ms, the parts of a second carry
+	   over and the penalty is the same whenever both sample */
+	start(0);
+	hold(LINK_DOWN, 100);
+	odd = dampen;
+	for (t = 0; t <= 70000; t += SAMPLE_MS) {
+		hold(LINK_DOWN, SAMPLE_MS);
+		if (t % 700 == 0)
+			hal_swif_dampen_update(&odd, LINK_DOWN, now - SAMPLE_MS);
+		if (t % 7000 == 0)
+			CHECK_EQ(odd.Penalty, dampen.Penalty);
+		if (t == HAL_DAMPEN_HALF_LIFE * 1000)
+			CHECK((dampen.Penalty >= HAL_DAMPEN_PENALTY / 2 - 10) &&
+				(dampen.Penalty <= HAL_DAMPEN_PENALTY / 2 + 10));
+	}
+	CHECK(dampen.Penalty < HAL_DAMPEN_PENALTY / 8);
+}
+
+static void test_tick_wrap(void)
+{
+	int up;
+
+	/* the ms tick wraps in the middle of a hold */
+	start(0xffffffff - 10000);
+	hold(LINK_DOWN, 200);
+	hold(LINK_UP, 200);
+	hold(LINK_DOWN, 200);
+	CHECK_EQ(dampen.Suppressed, 1);
+	up = hold(LINK_UP, 30000);
+	CHECK((up >= 20000) && (up <= 22000));
+}
+
+int main(void)
+{
+	test_single_flap();
+	test_suppress_reuse();
+	test_storm();
+	test_decay();
+	test_tick_wrap();
+	HOST_TEST_DONE("dampen");
+}
@@ -0,0 +1,141 @@
+/*************************************************************
+ * Filename     : test_fifo.c
+ * Description  : host test of the isr/task byte ring in fifo.c
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include "fifo.h"
+#include "host_test.h"
+
+#define STRESS_BYTES	(4 * 1024 * 1024)
+
+static fifo_t fifo;
+
+static void test_basic(void)
+{
+	unsigned char in[FIFOSIZE + 16], out[FIFOSIZE + 16];
+	unsigned int i;
+
+	for (i = 0; i < sizeof(in); i++)
+		in[i] = (unsigned char)i;
+
+	Fifo_Init(&fifo);
+	CHECK_EQ(Fifo_Used(&fifo), 0);
+	CHECK_EQ(Fifo_Room(&fifo), FIFOSIZE);
+	CHECK_EQ(Fifo_Read(&fifo, out, 1), 0);
+
+	/* a full ring drops the excess and counts it */
+	CHECK_EQ(Fifo_Write(&fifo, in, sizeof(in)), FIFOSIZE);
+	CHECK_EQ(fifo.overrun, 16);
+	CHECK_EQ(fifo.highwater, FIFOSIZE);
+	CHECK_EQ(Fifo_Room(&fifo), 0);
+	CHECK_EQ(Fifo_Read(&fifo, out, sizeof(out)), FIFOSIZE);
+	CHECK(memcmp(in, out, FIFOSIZE) == 0);
+
+	/* wrap across the end of the buffer */
+	Fifo_Init(&fifo);
+	fifo.head = fifo.tail = FIFOSIZE - 3;
+	CHECK_EQ(Fifo_Write(&fifo, in, 10), 10);
+	memset(out, 0, sizeof(out));
+	CHECK_EQ(Fifo_Read(&fifo, out, 10), 10);
+	CHECK(memcmp(in, out, 10) == 0);
+
+	/* free running indices survive the unsigned wrap */
+	Fifo_Init(&fifo);
+	fifo.head = fifo.tail = 0xfffffffe;
+	CHECK_EQ(Fifo_Write(&fifo, in, 5), 5);
+	CHECK_EQ(Fifo_Used(&fifo), 5);
+	CHECK_EQ(Fifo_Read(&fifo, out, 5), 5);
+	CHECK(memcmp(in, out, 5) == 0);
+}
+
+static void test_span(void)
+{
+	unsigned char *p;
+	unsigned int n;
+
+	Fifo_Init(&fifo);
+	fifo.head = fifo.tail = FIFOSIZE - 4;
+
+	/* the write span stops at the end of the buffer */
+	n = Fifo_WriteSpan(&fifo, &p);
+	CHECK_EQ(n, 4);
+	CHECK(p == &fifo.buff[FIFOSIZE - 4]);
+	memset(p, 0xa5, n);
+	Fifo_WriteCommit(&fifo, n);
+	n = Fifo_WriteSpan(&fifo, &p);
+	CHECK_EQ(n, FIFOSIZE - 4);
+	CHECK(p == &fifo.buff[0]);
+	Fifo_WriteCommit(&fifo, 2);
+
+	n = Fifo_ReadSpan(&fifo, &p);
+	CHECK_EQ(n, 4);
+	CHECK_EQ(p[0], 0xa5);
+	Fifo_ReadCommit(&fifo, n);
+	n = Fifo_ReadSpan(&fifo, &p);
+	CHECK_EQ(n, 2);
+	Fifo_ReadCommit(&fifo, n);
+	CHECK_EQ(Fifo_Used(&fifo), 0);
+}
+
+/* producer thread stands in for the uart isr */
+static void *producer(void *arg)
+{
+	unsigned char buf[97];
+	unsigned int sent = 0, seq = 0, n, i, w;
+
+	(void)arg;
+	while (sent < STRESS_BYTES)
+	{
+		n = 1 + (sent * 7) % sizeof(buf);
+		if (n > STRESS_BYTES - sent)
+			n = STRESS_BYTES - sent;
+		for (i = 0; i < n; i++)
+			buf[i] = (unsigned char)(seq + i);
+		/* the isr drops on overrun, here the writer waits for room */
+		while (Fifo_Room(&fifo) < n)
+			sched_yield();
+		w = Fifo_Write(&fifo, buf, n);
+		seq += w;
+		sent += w;
+	}
+	return NULL;
+}
+
+static void test_stress(void)
+{
+	pthread_t tid;
+	unsigned char buf[61];
+	unsigned int got = 0, n, i, bad = 0;
+
+	Fifo_Init(&fifo);
+	CHECK(pthread_create(&tid, NULL, producer, NULL) == 0);
+	while (got < STRESS_BYTES)
+	{
+		n = Fifo_Read(&fifo, buf, 1 + got % sizeof(buf));
+		if (n == 0)
+			sched_yield();
+		for (i = 0; i < n; i++)
+		{
+			if (buf[i] != (unsigned char)(got + i))
+				bad++;
+		}
+		got += n;
+	}
+	pthread_join(tid, NULL);
+	CHECK_EQ(bad, 0);
+	CHECK_EQ(fifo.overrun, 0);
+	CHECK(fifo.highwater <= FIFOSIZE);
+	CHECK_EQ(Fifo_Used(&fifo), 0);
+}
+
+int main(void)
+{
+	test_basic();
+	test_span();
+	test_stress();
+	HOST_TEST_DONE("fifo");
+}
@@ -0,0 +1,231 @@
+/*************************************************************
+ * Filename     : test_rccdb.c
+ * Description  : host test of the keyword index in rcc_db.c,
+ *                random tokens are matched through the index and
+ *                through the linear walk it replaces
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+
+/* DB_NodeMatch is static, so the file is built in here. The functions it
+   does not reach are dropped at link time, see the Makefile. */
+#include "rcc_db.c"
+
+#define TREE_DEPTH	3
+#define TREE_FANOUT	40
+#define QUERIES		4000
+#define KEY_LEN		5
+
+sbyte4 STRCMP(sbyte *pStr1, sbyte *pStr2)
+{
+	return strcmp(pStr1, pStr2);
+}
+
+sbyte4 STRNCMP(sbyte *pStr1, sbyte *pStr2, sbyte4 Len)
+{
+	return strncmp(pStr1, pStr2, Len);
+}
+
+void *RC_MALLOC(Length memSize)
+{
+	return malloc(memSize);
+}
+
+/* the command tree, RCC_DB_GetRootNode() returns it */
+cmdNode mRootCmdNode;
+
+static environment env;
+static cli_info info;
+static paramList params;
+static tokenTable tokens;
+
+/* One lookup as the parser does it, and what it left behind */
+struct result {
+	cmdNode *pNode;
+	sbyte4 count;
+	sbyte *matches[kRCC_MATCH_LIST_SIZE];
+};
+
+struct query {
+	cmdNode *pParent;
+	char key[KEY_LEN + 1];
+	Boolean global, exact;
+	sbyte4 flags;
+	Access level;
+	struct result linear;
+};
+
+static struct query queries[QUERIES];
+/* the nodes above the leaves, the parents of the lookups */
+static cmdNode *nodes[1024];
+static int node_count;
+
+/* Short keywords over three letters, so there are plenty of shared
+   prefixes, duplicates and keywords that are a prefix of another */
+static void random_key(char *key)
+{
+	int i, len = 1 + rand() % (KEY_LEN - 1);
+
+	for (i = 0; i < len; i++)
+		key[i] = "abc"[rand() % 3];
+	key[len] = 0;
+}
+
+static void build(cmdNode *pNode, int depth)
+{
+	char key[KEY_LEN + 1];
+	int i;
+
+	if (depth == TREE_DEPTH)
+		return;
+	if (node_count < (int)(sizeof(nodes) / sizeof(nodes[0])))
+		nodes[node_count++] = pNode;
+
+	pNode->numChildren = (sbyte2)(rand() % TREE_FANOUT);
+	pNode->pChildren = calloc(pNode->numChildren + 1, sizeof(cmdNode));
+	if (rand() % 8 == 0)
+		pNode->flags |= kRCC_COMMAND_EXACT_NODE;
+
+	for (i = 0; i < pNode->numChildren; i++) {
+		cmdNode *pChild = &pNode->pChildren[i];
+
+		/* a few parameter-only children have no keyword */
+		if (rand() % 16) {
+			random_key(key);
+			pChild->pKeyword = strdup(key);
+		}
+		if (rand() % 4 == 0)
+			pChild->flags |= kRCC_COMMAND_GLOBAL;
+		pChild->accessLvl = rand() % 4;
+		build(pChild, depth + 1);
+	}
+}
+
+static void lookup(struct query *q, struct result *r)
+{
+	sbyte4 count = -1;
+
+	memset(&tokens, 0, sizeof(tokens));
+	strcpy(tokens.buffer, q->key);
+	tokens.tokens[0].pStart = tokens.buffer;
+	tokens.tokens[0].length = (EditType)strlen(q->key);
+	tokens.numTokens = 1;
+	tokens.flags = q->flags;
+	memset(info.matches, 0, sizeof(info.matches));
+	env.UserLevel = q->level;
+
+	r->pNode = DB_NodeMatch(&env, q->pParent, q->global, q->exact, &count);
+	r->count = count;
+	memcpy(r->matches, info.matches, sizeof(r->matches));
+}
+
+static void test_replay(void)
+{
+	struct result indexed;
+	int i, j, indexes = 0, hits = 0;
+
+	srand(1);
+	build(&mRootCmdNode, 0);
+	env.pConsumer = &info;
+	info.pParamRoot = &params;
+	params.pTokens = &tokens;
+
+	for (i = 0; i < QUERIES; i++) {
+		struct query *q = &queries[i];
+		cmdNode *pParent = nodes[rand() % node_count];
+
+		/* an existing keyword, a prefix of one or anything */
+		q->pParent = pParent;
+		if ((pParent->numChildren > 0) && (rand() % 3)) {
+			sbyte *pKeyword = pParent->pChildren[rand() % pParent->numChildren].pKeyword;
+
+			strcpy(q->key, pKeyword ? pKeyword : "a");
+			if (rand() % 2)
+				q->key[1 + rand() % strlen(q->key)] = 0;
+		} else {
+			random_key(q->key);
+		}
+		q->global = (rand() % 4 == 0);
+		q->exact = rand() % 2;
+		q->flags = (rand() % 2) ? kRCC_PFLAG_NEW_LINE : 0;
+		q->level = rand() % 4;
+	}
+
+	/* the linear walk first, no node has an index yet */
+	for (i = 0; i < QUERIES; i++)
+		lookup(&queries[i], &queries[i].linear);
+
+	CHECK_EQ(RCC_DB_IndexTree(), OK);
+	for (i = 0; i < node_count; i++) {
+		if (nodes[i]->pIndex != NULL)
+			indexes++;
+		else
+			CHECK(nodes[i]->numChildren < kRCC_NODE_INDEX_MIN);
+	}
+	CHECK(indexes > 0);
+
+	for (i = 0; i < QUERIES; i++) {
+		struct query *q = &queries[i];
+
+		lookup(q, &indexed);
+		CHECK(indexed.pNode == q->linear.pNode);
+		CHECK_EQ(indexed.count, q->linear.count);
+		for (j = 0; j < kRCC_MATCH_LIST_SIZE; j++)
+			CHECK(indexed.matches[j] == q->linear.matches[j]);
+		if (indexed.pNode != NULL)
+			hits++;
+	}
+	/* the replay must not be all misses */
+	CHECK(hits > QUERIES / 4);
+}
+
+static void test_ties(void)
+{
+	static sbyte *keys[] = { "show", "set", "show", "save", "sh", "show" };
+	cmdNode children[6], parent;
+	struct query q;
+	struct result r;
+	int i;
+
+	memset(children, 0, sizeof(children));
+	memset(&parent, 0, sizeof(parent));
+	for (i = 0; i < 6; i++)
+		children[i].pKeyword = keys[i];
+	children[0].accessLvl = 3;
+	parent.numChildren = 6;
+	parent.pChildren = children;
+	CHECK_EQ(DB_IndexNode(&parent, 0), OK);
+	CHECK_EQ(parent.pIndex[0], 6);
+
+	/* the first "show" in declaration order the user may reach wins */
+	memset(&q, 0, sizeof(q));
+	q.pParent = &parent;
+	strcpy(q.key, "show");
+	q.exact = TRUE;
+	q.level = 0;
+	lookup(&q, &r);
+	CHECK(r.pNode == &children[2]);
+	CHECK_EQ(r.count, 1);
+	q.level = 3;
+	lookup(&q, &r);
+	CHECK(r.pNode == &children[0]);
+
+	/* partial matches leave out the exact one, last one is returned */
+	strcpy(q.key, "sh");
+	q.exact = FALSE;
+	lookup(&q, &r);
+	CHECK_EQ(r.count, 3);
+	CHECK(r.pNode == &children[5]);
+	CHECK(r.matches[0] == keys[0]);
+	CHECK(r.matches[1] == NULL);
+}
+
+int main(void)
+{
+	test_replay();
+	test_ties();
+	HOST_TEST_DONE("rccdb");
+}
@@ -0,0 +1,347 @@
+/*************************************************************
+ * Filename     : test_tftp.c
+ * Description  : host test of the TFTP download window and resume
+ *                in tftp_rx.c, against a simulated RFC 7440 server
+ *                on a line that drops, duplicates and reorders
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "tftp_rx.h"
+#include "host_test.h"
+
+#define LIMIT			(1024 * 1024)
+#define SECTOR			0x20000
+#define QUEUE_SIZE		4096
+#define TIMEOUT_MAX		5		/* TFTP_RETRY_MAX */
+
+static unsigned char image[LIMIT + 1024];
+static unsigned int image_size;
+
+/* Flash stand-in, committed as the writer task keeps it */
+static unsigned char flash[LIMIT];
+static unsigned int committed, post_fail_at, posts;
+static unsigned int base;
+
+/* DATA packets on the line, by full block number */
+static unsigned int queue[QUEUE_SIZE];
+static int q_head, q_tail;
+
+/* Server */
+static unsigned int blksize, windowsize, blocks, next, stop_at;
+static int loss_pct, dup_pct, swap_pct, ack_loss_pct, server_done;
+
+/* Receiver */
+static tftp_rx_t rx;
+static unsigned char stage[2 * 1024 * 8];
+static int acks;
+
+static void line_put(unsigned int block)
+{
+	if (rand() % 100 < loss_pct)
+		return;
+	CHECK(q_tail < QUEUE_SIZE);
+	if (q_tail >= QUEUE_SIZE)
+		return;
+	queue[q_tail++] = block;
+	if ((q_tail - q_head >= 2) && (rand() % 100 < swap_pct)) {
+		queue[q_tail - 1] = queue[q_tail - 2];
+		queue[q_tail - 2] = block;
+	}
+	if ((q_tail < QUEUE_SIZE) && (rand() % 100 < dup_pct))
+		queue[q_tail++] = block;
+}
+
+static void send_window(void)
+{
+	unsigned int b;
+
+	if (q_head == q_tail)
+		q_head = q_tail = 0;
+	for (b = next; (b < next + windowsize) && (b <= blocks) && (b < stop_at); b++)
+		line_put(b);
+}
+
+/* The server gets an ACK, the window goes on after it */
+static void server_ack(unsigned short ack)
+{
+	unsigned int full;
+
+	if (rand() % 100 < ack_loss_pct)
+		return;
+	/* the block of the window with these low 16 bits */
+	full = (next - 1) + (unsigned short)(ack - (unsigned short)(next - 1));
+	if (full > next - 1 + windowsize)
+		return;		/* stale */
+	next = full + 1;
+	if (next > blocks)
+		server_done = 1;
+	else
+		send_window();
+}
+
+static int rx_verify(unsigned int offset, const unsigned char *pData, unsigned int len)
+{
+	CHECK(offset + len <= base);
+	return memcmp(&flash[offset], pData, len);
+}
+
+static int rx_post(unsigned char *pBuf, unsigned int offset, unsigned int len)
+{
+	if (posts++ == post_fail_at)
+		return -1;
+	/* each byte once, in order and never below the resume point */
+	CHECK_EQ(offset, committed);
+	CHECK(offset >= base);
+	CHECK(offset + len <= LIMIT);
+	memcpy(&flash[offset], pBuf, len);
+	committed = offset + len;
+	return 0;
+}
+
+static const tftp_rx_port_t port = { rx_verify, rx_post };
+
+static void new_image(unsigned int size)
+{
+	unsigned int i;
+
+	for (i = 0; i < size; i++)
+		image[i] = (unsigned char)rand();
+	image_size = size;
+	memset(flash, 0xFF, sizeof(flash));
+	committed = 0;
+}
+
+/* One RRQ as tftp_session runs it, from block 1 with what is in flash */
+static int session(unsigned int blk, unsigned int win)
+{
+	unsigned short ack;
+	unsigned int block, offset, len, timeouts = 0;
+	int ret;
+
+	blksize = blk;
+	windowsize = win;
+	blocks = image_size / blksize + 1;
+	next = 1;
+	server_done = 0;
+	q_head = q_tail = 0;
+	acks = 0;
+	posts = 0;
+	base = committed;
+
+	tftp_rx_start(&rx, stage, blksize * windowsize, base, LIMIT);
+	tftp_rx_options(&rx, blksize, windowsize);
+	send_window();
+	for (;;) {
+		if (q_head == q_tail) {
+			if (++timeouts > TIMEOUT_MAX) {
+				ret = 1;
+				break;
+			}
+			ack = tftp_rx_timeout(&rx);
+			server_ack(ack);
+			continue;
+		}
+		timeouts = 0;
+		block = queue[q_head++];
+		offset = (block - 1) * blksize;
+		len = (offset + blksize <= image_size) ? blksize : image_size - offset;
+		ret = tftp_rx_data(&rx, &port, (unsigned short)block, &image[offset], len, &ack);
+		if (ret < 0)
+			return ret;
+		if ((ret == TFTP_RX_RESYNC) || (ret == TFTP_RX_ACK) || (ret == TFTP_RX_LAST)) {
+			acks++;
+			server_ack(ack);
+		}
+		if (ret == TFTP_RX_LAST) {
+			CHECK_EQ(block, blocks);
+			ret = 0;
+			break;
+		}
+	}
+	if (tftp_rx_flush(&rx, &port) != 0)
+		return TFTP_RX_ERR_FLASH;
+	return ret;
+}
+
+static int flash_is_image(void)
+{
+	return (committed == image_size) && (memcmp(flash, image, image_size) == 0);
+}
+
+static void test_erase_size(void)
+{
+	CHECK_EQ(tftp_rx_erase_size(0, 7 * SECTOR, SECTOR), 7 * SECTOR);
+	CHECK_EQ(tftp_rx_erase_size(1, 7 * SECTOR, SECTOR), SECTOR);
+	CHECK_EQ(tftp_rx_erase_size(SECTOR, 7 * SECTOR, SECTOR), SECTOR);
+	CHECK_EQ(tftp_rx_erase_size(SECTOR + 1, 7 * SECTOR, SECTOR), 2 * SECTOR);
+	CHECK_EQ(tftp_rx_erase_size(8 * SECTOR, 7 * SECTOR, SECTOR), 7 * SECTOR);
+	CHECK_EQ(tftp_rx_erase_size(7 * SECTOR - 5, 7 * SECTOR - 4, SECTOR), 7 * SECTOR - 4);
+}
+
+static void test_clean(void)
+{
+	static const unsigned int sizes[] = { 0, 1, 1023, 1024, 1025, 4096, 4097, 100000 };
+	static const unsigned int wins[] = { 1, 2, 4 };
+	unsigned int i, w, n;
+
+	/* only the last block of each window is ACKed */
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		for (w = 0; w < sizeof(wins) / sizeof(wins[0]); w++) {
+			new_image(sizes[i]);
+			CHECK_EQ(session(1024, wins[w]), 0);
+			CHECK(flash_is_image());
+			CHECK(server_done);
+			n = sizes[i] / 1024 + 1;
+			CHECK_EQ(acks, (int)((n + wins[w] - 1) / wins[w]));
+			CHECK_EQ(rx.received, sizes[i]);
+		}
+	}
+
+	/* plain RFC 1350 until the server takes the options */
+	tftp_rx_start(&rx, stage, 512, 0, LIMIT);
+	CHECK_EQ(rx.blksize, 512);
+	CHECK_EQ(rx.windowsize, 1);
+}
+
+static void test_one_loss(void)
+{
+	unsigned short ack;
+
+	/* a block lost in a window costs one ACK for the rest of it, not one
+	   per block that follows */
+	new_image(8 * 1024 + 100);
+	base = 0;
+	tftp_rx_start(&rx, stage, 4096, 0, LIMIT);
+	tftp_rx_options(&rx, 1024, 4);
+	CHECK_EQ(tftp_rx_data(&rx, &port, 1, &image[0], 1024, &ack), TFTP_RX_ACCEPT);
+	CHECK_EQ(tftp_rx_data(&rx, &port, 3, &image[2048], 1024, &ack), TFTP_RX_RESYNC);
+	CHECK_EQ(ack, 1);
+	CHECK_EQ(tftp_rx_data(&rx, &port, 4, &image[3072], 1024, &ack), TFTP_RX_IGNORE);
+	/* the server starts over at 2 */
+	CHECK_EQ(tftp_rx_data(&rx, &port, 2, &image[1024], 1024, &ack), TFTP_RX_ACCEPT);
+	CHECK_EQ(tftp_rx_data(&rx, &port, 3, &image[2048], 1024, &ack), TFTP_RX_ACCEPT);
+	CHECK_EQ(tftp_rx_data(&rx, &port, 4, &image[3072], 1024, &ack), TFTP_RX_ACCEPT);
+	CHECK_EQ(tftp_rx_data(&rx, &port, 5, &image[4096], 1024, &ack), TFTP_RX_ACK);
+	CHECK_EQ(ack, 5);
+	/* a loss in a later window is answered again */
+	CHECK_EQ(tftp_rx_data(&rx, &port, 7, &image[6144], 1024, &ack), TFTP_RX_RESYNC);
+	CHECK_EQ(ack, 5);
+	/* and a timeout ACKs the last block in order again */
+	CHECK_EQ(tftp_rx_timeout(&rx), 5);
+}
+
+static void test_lossy(void)
+{
+	int round, ret;
+
+	for (round = 0; round < 300; round++) {
+		new_image(rand() % 200000);
+		loss_pct = rand() % 20;
+		dup_pct = rand() % 10;
+		swap_pct = rand() % 10;
+		ack_loss_pct = rand() % 20;
+		stop_at = ~0u;
+		/* retried from what is in flash until it gets through */
+		do {
+			ret = session(1024, 1 + rand() % 4);
+			CHECK(ret >= 0);
+		} while (ret == 1);
+		CHECK(flash_is_image());
+	}
+	loss_pct = dup_pct = swap_pct = ack_loss_pct = 0;
+}
+
+static void test_resume(void)
+{
+	unsigned int cut;
+
+	/* the server goes away, the next request verifies what is in flash
+	   and programs only the rest */
+	new_image(300000);
+	stop_at = 100;
+	CHECK_EQ(session(1024, 4), 1);
+	cut = committed;
+	CHECK_EQ(cut, 99 * 1024);
+	CHECK(memcmp(flash, image, cut) == 0);
+
+	stop_at = ~0u;
+	CHECK_EQ(session(1024, 4), 0);
+	CHECK_EQ(base, cut);
+	CHECK(flash_is_image());
+
+	/* resumed with another block size, the resume point inside a block */
+	new_image(300000);
+	stop_at = 50;
+	CHECK_EQ(session(1024, 2), 1);
+	stop_at = ~0u;
+	CHECK_EQ(session(1000, 3), 0);
+	CHECK(flash_is_image());
+
+	/* the image changed on the server meanwhile */
+	new_image(300000);
+	stop_at = 60;
+	CHECK_EQ(session(1024, 4), 1);
+	image[1000] ^= 1;
+	stop_at = ~0u;
+	CHECK_EQ(session(1024, 4), TFTP_RX_ERR_CHANGED);
+}
+
+static void test_errors(void)
+{
+	unsigned short ack;
+	unsigned int b;
+	int ret = TFTP_RX_ACCEPT;
+
+	/* beyond the upgrade area */
+	new_image(20000);
+	base = 0;
+	tftp_rx_start(&rx, stage, 4096, 0, 10000);
+	tftp_rx_options(&rx, 1024, 4);
+	for (b = 1; (b <= 20) && (ret >= 0); b++)
+		ret = tftp_rx_data(&rx, &port, (unsigned short)b, &image[(b - 1) * 1024], 1024, &ack);
+	CHECK_EQ(ret, TFTP_RX_ERR_SIZE);
+	CHECK_EQ(b - 1, 10);
+
+	/* the writer failed */
+	new_image(20000);
+	post_fail_at = 2;
+	stop_at = ~0u;
+	CHECK_EQ(session(1024, 4), TFTP_RX_ERR_FLASH);
+	CHECK_EQ(committed, 2 * 4096);
+	post_fail_at = ~0u;
+}
+
+static void test_wrap(void)
+{
+	/* more than 65535 blocks, the 16 bit block number wraps */
+	new_image(600000);
+	stop_at = ~0u;
+	CHECK_EQ(session(8, 4), 0);
+	CHECK(blocks > 65536);
+	CHECK(flash_is_image());
+
+	new_image(600000);
+	loss_pct = 5;
+	ack_loss_pct = 5;
+	while (session(8, 2) == 1)
+		;
+	CHECK(flash_is_image());
+	loss_pct = ack_loss_pct = 0;
+}
+
+int main(void)
+{
+	srand(1);
+	post_fail_at = ~0u;
+	stop_at = ~0u;
+	test_erase_size();
+	test_clean();
+	test_one_loss();
+	test_lossy();
+	test_resume();
+	test_errors();
+	test_wrap();
+	HOST_TEST_DONE("tftp");
+}
@@ -0,0 +1,209 @@
+/*************************************************************
+ * Filename     : test_traffic.c
+ * Description  : host test of the traffic averages, traffic over
+ *                hysteresis and storm state in hal_swif_traffic.c
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <string.h>
+#include "mconfig.h"
+#include "stm32f2xx.h"
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_port.h"
+#include "hal_swif_rate_ctrl.h"
+#include "host_test.h"
+
+#define RATE(x)		((uint32)(x) << HAL_TRAFFIC_RATE_SHIFT)
+
+/* storm limit stand-in for hal_swif_rate_ctrl.c */
+static int storm_calls, storm_fail;
+static HAL_BOOL storm_on;
+
+int hal_swif_storm_ctrl_set(uint8 lport, HAL_BOOL enable)
+{
+	(void)lport;
+	if (storm_fail)
+		return HAL_SWIF_FAILURE;
+	storm_calls++;
+	storm_on = enable;
+	return HAL_SWIF_SUCCESS;
+}
+
+static hal_port_traffic_info_t info;
+static hal_port_counters_t counter;
+
+static void port_reset(void)
+{
+	memset(&info, 0, sizeof(info));
+	memset(&counter, 0, sizeof(counter));
+	info.StormState = STORM_IDLE;
+	info.StormHoldTime = HAL_STORM_HOLD_MIN;
+	info.StormQuiet = HAL_STORM_HOLD_MAX;
+	storm_calls = 0;
+	storm_fail = 0;
+	storm_on = HAL_FALSE;
+}
+
+/* One second sample of bcast broadcast packets, as the traffic task does */
+static uint8 sample(uint32 bcast)
+{
+	counter.RxBroadcastPkts += bcast;
+	hal_swif_traffic_update(&info, &counter, 1000);
+	if (info.SampleState < 2)
+		return 0;
+	return hal_swif_storm_check(1, &info);
+}
+
+static void test_average(void)
+{
+	int i;
+
+	port_reset();
+	hal_swif_traffic_update(&info, &counter, 1000);
+	CHECK_EQ(info.SampleState, 1);
+
+	/* the first rate seeds every window */
+	counter.RxGoodOctetsLo += 1000;
+	hal_swif_traffic_update(&info, &counter, 1000);
+	CHECK_EQ(info.SampleState, 2);
+	for (i = 0; i < TRAFFIC_WIN_NUM; i++)
+		CHECK_EQ(info.Rate[TRAFFIC_RX_OCTETS][i], RATE(1000));
+
+	/* R += (S - R) / N per window */
+	counter.RxGoodOctetsLo += 2000;
+	hal_swif_traffic_update(&info, &counter, 1000);
+	CHECK_EQ(info.Rate[TRAFFIC_RX_OCTETS][TRAFFIC_WIN_SHORT], RATE(2000));
+	CHECK_EQ(info.Rate[TRAFFIC_RX_OCTETS][TRAFFIC_WIN_MEDIUM], RATE(1000) + RATE(1000) / HAL_TRAFFIC_WIN_MEDIUM);
+	CHECK_EQ(info.Rate[TRAFFIC_RX_OCTETS][TRAFFIC_WIN_LONG], RATE(1000) + RATE(1000) / HAL_TRAFFIC_WIN_LONG);
+
+	/* a steady rate converges in every window, the integer step stops
+	   short by less than N fraction units */
+	for (i = 0; i < 40 * HAL_TRAFFIC_WIN_LONG; i++)
+	{
+		counter.RxGoodOctetsLo += 2000;
+		hal_swif_traffic_update(&info, &counter, 1000);
+	}
+	for (i = 0; i < TRAFFIC_WIN_NUM; i++)
+		CHECK(RATE(2000) - info.Rate[TRAFFIC_RX_OCTETS][i] < hal_swif_traffic_window_get(i));
+
+	/* rates are per second whatever the sample spacing */
+	counter.RxGoodOctetsLo += 1000;
+	hal_swif_traffic_update(&info, &counter, 500);
+	CHECK_EQ(info.Rate[TRAFFIC_RX_OCTETS][TRAFFIC_WIN_SHORT], RATE(2000));
+}
+
+static void test_wrap(void)
+{
+	port_reset();
+	counter.TxOctetsLo = 0xffffff00;
+	hal_swif_traffic_update(&info, &counter, 1000);
+	counter.TxOctetsLo = 0x100;
+	hal_swif_traffic_update(&info, &counter, 1000);
+	CHECK_EQ(info.Rate[TRAFFIC_TX_OCTETS][TRAFFIC_WIN_SHORT], RATE(0x200));
+
+	/* the totals carry into the high word */
+	info.Total[TRAFFIC_TX_OCTETS].u64_w[0] = 0xfffffff0;
+	counter.TxOctetsLo += 0x20;
+	hal_swif_traffic_update(&info, &counter, 1000);
+	CHECK_EQ(u64_H(info.Total[TRAFFIC_TX_OCTETS]), 1);
+	CHECK_EQ(u64_L(info.Total[TRAFFIC_TX_OCTETS]), 0x10);
+}
+
+static void test_window_set(void)
+{
+	CHECK_EQ(hal_swif_traffic_window_set(TRAFFIC_WIN_NUM, 5), HAL_SWIF_FAILURE);
+	CHECK_EQ(hal_swif_traffic_window_set(TRAFFIC_WIN_MEDIUM, 0), HAL_SWIF_FAILURE);
+	CHECK_EQ(hal_swif_traffic_window_set(TRAFFIC_WIN_MEDIUM, 4), HAL_SWIF_SUCCESS);
+	CHECK_EQ(hal_swif_traffic_window_get(TRAFFIC_WIN_MEDIUM), 4);
+
+	port_reset();
+	hal_swif_traffic_update(&info, &counter, 1000);
+	hal_swif_traffic_update(&info, &counter, 1000);
+	counter.RxGoodOctetsLo += 4000;
+	hal_swif_traffic_update(&info, &counter, 1000);
+	CHECK_EQ(info.Rate[TRAFFIC_RX_OCTETS][TRAFFIC_WIN_MEDIUM], RATE(1000));
+
+	hal_swif_traffic_window_set(TRAFFIC_WIN_MEDIUM, HAL_TRAFFIC_WIN_MEDIUM);
+}
+
+static void test_over(void)
+{
+	uint8 over = 0;
+	uint32 thr = 800;
+
+	CHECK_EQ(hal_swif_traffic_over(&over, thr - 1, thr), 0);
+	CHECK_EQ(hal_swif_traffic_over(&over, thr, thr), 1);
+	/* left only below threshold - threshold / HAL_TRAFFIC_HYSTERESIS */
+	CHECK_EQ(hal_swif_traffic_over(&over, thr - thr / HAL_TRAFFIC_HYSTERESIS, thr), 1);
+	CHECK_EQ(hal_swif_traffic_over(&over, thr - thr / HAL_TRAFFIC_HYSTERESIS - 1, thr), 0);
+	CHECK_EQ(hal_swif_traffic_over(&over, thr - 1, thr), 0);
+}
+
+static void test_storm(void)
+{
+	int i, n;
+
+	port_reset();
+	sample(0);
+	sample(0);
+
+	/* a single burst sample does not limit */
+	CHECK_EQ(sample(2 * HAL_STORM_ON_PPS), 0);
+	CHECK_EQ(sample(0), 0);
+	CHECK_EQ(storm_calls, 0);
+
+	/* HAL_STORM_ON_SAMPLES in a row apply the limit */
+	for (i = 1; i < HAL_STORM_ON_SAMPLES; i++)
+		CHECK_EQ(sample(2 * HAL_STORM_ON_PPS), 0);
+	CHECK_EQ(sample(2 * HAL_STORM_ON_PPS), 1);
+	CHECK_EQ(info.StormState, STORM_LIMITED);
+	CHECK(storm_on == HAL_TRUE);
+	CHECK_EQ(info.StormCount, 1);
+
+	/* released once the hold is over and the medium window is quiet */
+	n = 1;
+	while (sample(0) == 0)
+		n++;
+	CHECK(n > HAL_STORM_HOLD_MIN);
+	CHECK(((info.Rate[TRAFFIC_RX_BCAST][TRAFFIC_WIN_MEDIUM] >> HAL_TRAFFIC_RATE_SHIFT) < HAL_STORM_OFF_PPS));
+	CHECK_EQ(info.StormState, STORM_IDLE);
+	CHECK(storm_on == HAL_FALSE);
+	CHECK_EQ(storm_calls, 2);
+
+	/* a storm back within the hold time is held twice as long */
+	for (i = 0; i < HAL_STORM_ON_SAMPLES; i++)
+		sample(2 * HAL_STORM_ON_PPS);
+	CHECK_EQ(info.StormState, STORM_LIMITED);
+	CHECK_EQ(info.StormHoldTime, 2 * HAL_STORM_HOLD_MIN);
+
+	/* the hold keeps the limit even when the traffic stops at once */
+	for (i = 0; i < 2 * HAL_STORM_HOLD_MIN; i++)
+		CHECK_EQ(sample(0), 0);
+	CHECK_EQ(info.StormState, STORM_LIMITED);
+}
+
+static void test_storm_fail(void)
+{
+	int i;
+
+	/* the state only moves when the switch took the setting */
+	port_reset();
+	sample(0);
+	storm_fail = 1;
+	for (i = 0; i < 2 * HAL_STORM_ON_SAMPLES; i++)
+		CHECK_EQ(sample(2 * HAL_STORM_ON_PPS), 0);
+	CHECK_EQ(info.StormState, STORM_IDLE);
+	CHECK_EQ(info.StormCount, 0);
+}
+
+int main(void)
+{
+	test_average();
+	test_wrap();
+	test_window_set();
+	test_over();
+	test_storm();
+	test_storm_fail();
+	HOST_TEST_DONE("traffic");
+}
@@ -0,0 +1,99 @@
+/*************************************************************
+ * Filename     : test_trapq.c
+ * Description  : host test of the trap queue in hal_swif_trapq.c
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include "hal_swif_trapq.h"
+#include "host_test.h"
+
+#define RETRY	100
+
+static hal_trapq_t q;
+
+/* a link flap storm leaves one pending trap per index */
+static void test_coalesce(void)
+{
+	uint16 id;
+	int slot, i;
+
+	hal_trapq_init(&q);
+	slot = hal_trapq_post(&q, 1, 1, 0);
+	CHECK(slot >= 0);
+	for (id = 2; id <= 1000; id++)
+		CHECK_EQ(hal_trapq_post(&q, 1, id, 0), slot);
+	CHECK_EQ(q.Stats.Posted, 1000);
+	CHECK_EQ(q.Stats.Coalesced, 999);
+
+	/* a late ack of a replaced trap is ignored, the current one clears */
+	CHECK_EQ(hal_trapq_ack(&q, 1, 999), 0);
+	CHECK_EQ(hal_trapq_ack(&q, 2, 1000), 0);
+	CHECK_EQ(hal_trapq_ack(&q, 1, 1000), 1);
+	CHECK_EQ(q.Stats.Acked, 1);
+	for (i = 0; i < HAL_TRAP_QUEUE_SIZE; i++)
+		CHECK_EQ(hal_trapq_poll(&q, i, 0, RETRY), HAL_TRAPQ_IDLE);
+}
+
+static void test_overflow(void)
+{
+	int i;
+
+	hal_trapq_init(&q);
+	for (i = 0; i < HAL_TRAP_QUEUE_SIZE; i++)
+		CHECK_EQ(hal_trapq_post(&q, i, 1, 0), i);
+	CHECK_EQ(hal_trapq_post(&q, HAL_TRAP_QUEUE_SIZE, 1, 0), -1);
+	CHECK_EQ(q.Stats.Overflow, 1);
+
+	/* an index already queued still coalesces into its slot */
+	CHECK_EQ(hal_trapq_post(&q, 3, 2, 0), 3);
+
+	/* a freed slot is reused */
+	CHECK_EQ(hal_trapq_ack(&q, 5, 1), 1);
+	CHECK_EQ(hal_trapq_post(&q, HAL_TRAP_QUEUE_SIZE, 1, 0), 5);
+}
+
+/* every entry runs its own timer, across the tick counter wrap */
+static void test_retransmit(void)
+{
+	uint32 now = 0xffffff00;
+	int a, b, n;
+
+	hal_trapq_init(&q);
+	a = hal_trapq_post(&q, 0, 1, now);
+	CHECK_EQ(hal_trapq_poll(&q, a, now, RETRY), HAL_TRAPQ_SEND);
+	CHECK_EQ(hal_trapq_poll(&q, a, now + RETRY - 1, RETRY), HAL_TRAPQ_IDLE);
+
+	b = hal_trapq_post(&q, 1, 1, now + 50);
+	CHECK_EQ(hal_trapq_poll(&q, b, now + 50, RETRY), HAL_TRAPQ_SEND);
+	CHECK_EQ(hal_trapq_poll(&q, a, now + RETRY, RETRY), HAL_TRAPQ_SEND);
+	CHECK_EQ(hal_trapq_poll(&q, b, now + RETRY, RETRY), HAL_TRAPQ_IDLE);
+	CHECK_EQ(hal_trapq_poll(&q, b, now + 50 + RETRY, RETRY), HAL_TRAPQ_SEND);
+	CHECK_EQ(q.Stats.Sent, 2);
+	CHECK_EQ(q.Stats.Retransmitted, 2);
+
+	/* b is answered, a is given up after HAL_TRAP_RETRY_MAX resends */
+	CHECK_EQ(hal_trapq_ack(&q, 1, 1), 1);
+	n = 2;
+	now += 2 * RETRY;
+	while (hal_trapq_poll(&q, a, now, RETRY) == HAL_TRAPQ_SEND)
+	{
+		n++;
+		now += RETRY;
+	}
+	CHECK_EQ(n, HAL_TRAP_RETRY_MAX + 1);
+	CHECK_EQ(q.Stats.Expired, 1);
+	CHECK_EQ(hal_trapq_poll(&q, a, now, RETRY), HAL_TRAPQ_IDLE);
+
+	/* a new post restarts the count */
+	a = hal_trapq_post(&q, 0, 2, now);
+	CHECK_EQ(hal_trapq_poll(&q, a, now, RETRY), HAL_TRAPQ_SEND);
+	CHECK_EQ(q.Stats.Sent, 3);
+}
+
+int main(void)
+{
+	test_coalesce();
+	test_overflow();
+	test_retransmit();
+	HOST_TEST_DONE("trapq");
+}
@@ -0,0 +1,148 @@
+/*************************************************************
+ * Filename     : test_tsensor.c
+ * Description  : host test of the ADC scan filter and threshold
+ *                latch in tsensor_filter.c, half buffers are fed
+ *                as the DMA interrupt hands them over
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "tsensor.h"
+#include "host_test.h"
+
+static tsensorstate st[TS_CHAN_NUM];
+static volatile u16 half[TS_MEDIAN_LEN][TS_CHAN_NUM];
+
+static u16 value(int ch)
+{
+	return (u16)(st[ch].filt >> TS_IIR_FRAC);
+}
+
+/* One half buffer, every scan of the temperature slot at temp */
+static u32 feed(u16 temp, int noise)
+{
+	int j;
+
+	for (j = 0; j < TS_MEDIAN_LEN; j++) {
+		half[j][TS_IDX_TEMP] = (u16)(temp + (noise ? rand() % (2 * noise + 1) - noise : 0));
+		half[j][1] = 1500;
+	}
+	return TSensorFilter(st, half);
+}
+
+static void reset(void)
+{
+	memset(st, 0, sizeof(st));
+}
+
+static void test_filter(void)
+{
+	int i, j, last;
+
+	/* the first half seeds the filter */
+	reset();
+	CHECK_EQ(feed(1000, 0), 0);
+	CHECK_EQ(value(TS_IDX_TEMP), 1000);
+	CHECK_EQ(value(1), 1500);
+
+	/* a step is followed a quarter at a time, without overshoot */
+	last = 1000;
+	for (i = 0; i < 40; i++) {
+		feed(1400, 0);
+		CHECK(value(TS_IDX_TEMP) >= last);
+		CHECK(value(TS_IDX_TEMP) <= 1400);
+		last = value(TS_IDX_TEMP);
+		if (i == 0)
+			CHECK_EQ(last, 1100);
+	}
+	CHECK(1400 - last <= 1);
+
+	/* spikes in under half the scans of a half buffer never get through */
+	for (i = 0; i < 200; i++) {
+		for (j = 0; j < TS_MEDIAN_LEN; j++)
+			half[j][TS_IDX_TEMP] = last;
+		for (j = 0; j < TS_MEDIAN_LEN / 2; j++)
+			half[rand() % TS_MEDIAN_LEN][TS_IDX_TEMP] = (rand() % 2) ? 4095 : 0;
+		TSensorFilter(st, half);
+		CHECK_EQ(value(TS_IDX_TEMP), last);
+	}
+}
+
+static void test_threshold(void)
+{
+	u16 high = TS_TEMP_RAW(TS_TEMP_HIGH), low = TS_TEMP_RAW(TS_TEMP_LOW);
+	u32 ev, evs;
+	int i, highs, lows;
+
+	CHECK(low < high);
+
+	/* no threshold, no events */
+	reset();
+	feed(TS_TEMP_RAW(25), 0);
+	for (i = 0; i < 50; i++)
+		CHECK_EQ(feed(TS_TEMP_RAW(100), 0), 0);
+
+	/* a rise over high latches one event, staying there none */
+	reset();
+	st[TS_IDX_TEMP].high = high;
+	st[TS_IDX_TEMP].low = low;
+	feed(TS_TEMP_RAW(25), 0);
+	for (i = 0, evs = 0; i < 50; i++) {
+		ev = feed(TS_TEMP_RAW(90), 0);
+		if (ev) {
+			CHECK_EQ(ev, TS_EVT_HIGH(TS_IDX_TEMP));
+			CHECK(value(TS_IDX_TEMP) >= high);
+			evs++;
+		}
+	}
+	CHECK_EQ(evs, 1);
+	CHECK_EQ(st[TS_IDX_TEMP].alarm, 1);
+
+	/* between low and high it stays raised */
+	for (i = 0; i < 50; i++)
+		CHECK_EQ(feed((high + low) / 2, 0), 0);
+
+	/* back to low clears it once */
+	for (i = 0, evs = 0; i < 50; i++) {
+		ev = feed(TS_TEMP_RAW(40), 0);
+		if (ev) {
+			CHECK_EQ(ev, TS_EVT_LOW(TS_IDX_TEMP));
+			CHECK(value(TS_IDX_TEMP) <= low);
+			evs++;
+		}
+	}
+	CHECK_EQ(evs, 1);
+	CHECK_EQ(st[TS_IDX_TEMP].alarm, 0);
+
+	/* noise around high raises it once and never chatters */
+	reset();
+	st[TS_IDX_TEMP].high = high;
+	st[TS_IDX_TEMP].low = low;
+	feed(high, 0);
+	for (i = 0, highs = lows = 0; i < 5000; i++) {
+		ev = feed(high, (high - low) / 2);
+		highs += (ev & TS_EVT_HIGH(TS_IDX_TEMP)) != 0;
+		lows += (ev & TS_EVT_LOW(TS_IDX_TEMP)) != 0;
+	}
+	CHECK(highs <= 1);
+	CHECK_EQ(lows, 0);
+
+	/* the other slot has its own events */
+	reset();
+	st[1].high = 2000;
+	st[1].low = 1000;
+	for (i = 0; i < TS_MEDIAN_LEN; i++) {
+		half[i][TS_IDX_TEMP] = 100;
+		half[i][1] = 2500;
+	}
+	CHECK_EQ(TSensorFilter(st, half), TS_EVT_HIGH(1));
+}
+
+int main(void)
+{
+	srand(1);
+	test_filter();
+	test_threshold();
+	HOST_TEST_DONE("tsensor");
+}
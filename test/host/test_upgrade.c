@@ -0,0 +1,163 @@
+/*************************************************************
+ * Filename     : test_upgrade.c
+ * Description  : host test of the delta upgrade block sums in
+ *                upgrade_blk.c against a flash image in memory
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "upgrade.h"
+#include "spi_flash.h"
+#include "ob_image.h"
+#include "misc_drv.h"
+#include "host_test.h"
+
+/* ob_image.c refers to it for the image name check */
+dev_base_info_t DeviceBaseInfo;
+
+/* SPI flash stand-in, the crc runs over SPI3_FLASH_CRC_CHUNK reads as
+   the DMA version does. A read at or past fail_addr times out. */
+static unsigned char flash[GOLDEN_ADDRESS];
+static uint32_t fail_addr = 0xffffffff;
+
+int SPI3_FLASH_Crc(uint32_t ReadAddr, uint32_t NumByteToRead, uint32_t *pCrc)
+{
+	uint32_t count;
+
+	while (NumByteToRead) {
+		if (ReadAddr >= fail_addr)
+			return -1;
+		count = (NumByteToRead > SPI3_FLASH_CRC_CHUNK) ? SPI3_FLASH_CRC_CHUNK : NumByteToRead;
+		*pCrc = crc32(*pCrc, flash + ReadAddr, count);
+		ReadAddr += count;
+		NumByteToRead -= count;
+	}
+	return 0;
+}
+
+static void test_crc32(void)
+{
+	static const unsigned char check[] = "123456789";
+	unsigned long crc;
+
+	CHECK_EQ(crc32(0, check, 9), 0xCBF43926);
+	/* a running crc carries across split reads */
+	crc = crc32(0, check, 4);
+	CHECK_EQ(crc32(crc, check + 4, 5), 0xCBF43926);
+}
+
+static void test_put_get(void)
+{
+	unsigned char b[4];
+
+	UpgradePut32(b, 0x12345678);
+	CHECK_EQ(b[0], 0x12);
+	CHECK_EQ(b[1], 0x34);
+	CHECK_EQ(b[2], 0x56);
+	CHECK_EQ(b[3], 0x78);
+	CHECK_EQ(UpgradeGet32(b), 0x12345678);
+}
+
+static void test_range(void)
+{
+	CHECK_EQ(FUPBLKNUM, 15);
+	CHECK(FUPBLKVALID(0, 1));
+	CHECK(FUPBLKVALID(0, FUPBLKNUM));
+	CHECK(FUPBLKVALID(FUPBLKNUM - 1, 1));
+	CHECK(!FUPBLKVALID(0, 0));
+	CHECK(!FUPBLKVALID(FUPBLKNUM, 1));
+	CHECK(!FUPBLKVALID(1, FUPBLKNUM));
+	/* a huge count must not wrap around the end check */
+	CHECK(!FUPBLKVALID(2, 0xffffffff));
+	CHECK(!FUPBLKVALID(0xffffffff, 2));
+}
+
+/* What the host side does: the block crc of the new image padded with the
+   0xFF an erased sector reads */
+static uint32_t host_blk_crc(const unsigned char *img, unsigned int size, unsigned int blk)
+{
+	static unsigned char buf[FUPBLKSIZE];
+	unsigned int offs = blk * FUPBLKSIZE, len = 0;
+
+	memset(buf, 0xFF, sizeof(buf));
+	if (offs < size)
+		len = (size - offs > FUPBLKSIZE) ? FUPBLKSIZE : size - offs;
+	memcpy(buf, img + offs, len);
+	return crc32(0, buf, FUPBLKSIZE);
+}
+
+static void flash_write(const unsigned char *img, unsigned int size)
+{
+	memset(flash, 0xFF, sizeof(flash));
+	memcpy(flash + PRIMARY_ADDRESS, img, size);
+}
+
+static void test_delta(void)
+{
+	enum { OLD_SIZE = 0x4B000, NEW_SIZE = 0x52800 };
+	static unsigned char oldimg[NEW_SIZE], newimg[NEW_SIZE];
+	unsigned char sums[FUPBLKNUM * 4];
+	unsigned int i, blk, offs, changed = 0;
+	uint32_t crc;
+
+	srand(1);
+	for (i = 0; i < NEW_SIZE; i++)
+		oldimg[i] = (unsigned char)rand();
+	memcpy(newimg, oldimg, NEW_SIZE);
+	newimg[1 * FUPBLKSIZE + 0x1234] ^= 0x5A;
+	newimg[3 * FUPBLKSIZE + FUPBLKSIZE - 1] ^= 0x01;
+	flash_write(oldimg, OLD_SIZE);
+
+	/* blocks 1 and 3 are edited, 4 and 5 see the image grow */
+	CHECK_EQ(UpgradeBlkSum(0, FUPBLKNUM, sums), FUPBLKNUM);
+	for (blk = 0; blk < FUPBLKNUM; blk++) {
+		if (UpgradeGet32(sums + blk * 4) != host_blk_crc(newimg, NEW_SIZE, blk))
+			changed |= 1 << blk;
+	}
+	CHECK_EQ(changed, (1 << 1) | (1 << 3) | (1 << 4) | (1 << 5));
+
+	/* FUPBLKSEL erases the block, FUPCONTENT writes it from its start */
+	for (blk = 0; blk < FUPBLKNUM; blk++) {
+		if (!(changed & (1 << blk)))
+			continue;
+		offs = blk * FUPBLKSIZE;
+		memset(flash + PRIMARY_ADDRESS + offs, 0xFF, FUPBLKSIZE);
+		i = (NEW_SIZE - offs > FUPBLKSIZE) ? FUPBLKSIZE : NEW_SIZE - offs;
+		memcpy(flash + PRIMARY_ADDRESS + offs, newimg + offs, i);
+	}
+
+	/* a partial request answers from its first block */
+	CHECK_EQ(UpgradeBlkSum(2, 4, sums), 4);
+	for (i = 0; i < 4; i++)
+		CHECK_EQ(UpgradeGet32(sums + i * 4), host_blk_crc(newimg, NEW_SIZE, 2 + i));
+
+	/* FUPVERIFY: the crc over the file size is the one of the new image */
+	crc = 0;
+	CHECK_EQ(SPI3_FLASH_Crc(PRIMARY_ADDRESS, NEW_SIZE, &crc), 0);
+	CHECK_EQ(crc, crc32(0, newimg, NEW_SIZE));
+}
+
+static void test_read_error(void)
+{
+	unsigned char sums[FUPBLKNUM * 4];
+
+	memset(flash, 0xFF, sizeof(flash));
+	memset(sums, 0, sizeof(sums));
+	fail_addr = PRIMARY_ADDRESS + 2 * FUPBLKSIZE + 100;
+	/* the blocks read before the error are answered, erased ones here */
+	CHECK_EQ(UpgradeBlkSum(0, 5, sums), 2);
+	CHECK_EQ(UpgradeGet32(sums + 4), host_blk_crc(flash, 0, 0));
+	CHECK_EQ(UpgradeGet32(sums + 8), 0);
+	fail_addr = 0xffffffff;
+}
+
+int main(void)
+{
+	test_crc32();
+	test_put_get();
+	test_range();
+	test_delta();
+	test_read_error();
+	HOST_TEST_DONE("upgrade");
+}
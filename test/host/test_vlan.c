@@ -0,0 +1,263 @@
+/*************************************************************
+ * Filename     : test_vlan.c
+ * Description  : host test of the differential VTU apply and its
+ *                rollback in hal_swif_vlan_diff.c, against a VTU
+ *                kept in memory
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "mconfig.h"
+#include "stm32f2xx.h"
+#include "hal_swif_error.h"
+#include "hal_swif_types.h"
+#include "hal_swif_vlan.h"
+#include "host_test.h"
+
+#define VID_POOL	24
+#define OP_MAX		(MAX_8021Q_VLAN_RECORD_COUNT * 2)
+
+/* VTU stand-in, members of each vid two bits per port as in the record */
+static struct {
+	u8 valid;
+	u8 member[MAX_PORT_NUM];
+} vtu[4096];
+
+/* The operations seen, a load is +vid and a purge -vid. The one numbered
+   fail_at fails. */
+static int ops[OP_MAX * 2], op_count, fail_at = -1;
+
+static int vtu_load(const hal_8021q_vlan_record_t *rec, u8 port_num)
+{
+	u16 vid = hal_swif_vlan_rec_vid(rec);
+	int i;
+
+	if (op_count++ == fail_at)
+		return HAL_SWIF_FAILURE;
+	ops[op_count - 1] = vid;
+	vtu[vid].valid = 1;
+	memset(vtu[vid].member, 0, sizeof(vtu[vid].member));
+	for (i = 0; i < port_num; i++)
+		vtu[vid].member[i] = hal_swif_vlan_rec_member(rec, i);
+	return HAL_SWIF_SUCCESS;
+}
+
+static int vtu_purge(u16 vid)
+{
+	if (op_count++ == fail_at)
+		return HAL_SWIF_FAILURE;
+	ops[op_count - 1] = -vid;
+	vtu[vid].valid = 0;
+	return HAL_SWIF_SUCCESS;
+}
+
+static void vtu_reset(void)
+{
+	memset(vtu, 0, sizeof(vtu));
+	op_count = 0;
+	fail_at = -1;
+}
+
+/* The VTU holds exactly the records */
+static int vtu_is(const hal_8021q_vlan_conf_t *cfg, const hal_8021q_vlan_record_t *rec)
+{
+	int vid, i, n = 0;
+
+	for (i = 0; i < cfg->TotalRecordCount; i++) {
+		vid = hal_swif_vlan_rec_vid(&rec[i]);
+		if (!vtu[vid].valid)
+			return 0;
+		for (n = 0; n < cfg->PortNum; n++) {
+			if (vtu[vid].member[n] != hal_swif_vlan_rec_member(&rec[i], n))
+				return 0;
+		}
+	}
+	for (vid = 0, n = 0; vid < 4096; vid++)
+		n += vtu[vid].valid;
+	return n == cfg->TotalRecordCount;
+}
+
+static void rec_set(hal_8021q_vlan_record_t *rec, u16 vid)
+{
+	int i;
+
+	rec->VLanID[0] = (u8)(vid >> 8);
+	rec->VLanID[1] = (u8)vid;
+	for (i = 0; i < (int)sizeof(rec->VLanName); i++)
+		rec->VLanName[i] = 'a' + rand() % 26;
+	for (i = 0; i < (int)sizeof(rec->VLanSetting); i++)
+		rec->VLanSetting[i] = (u8)rand();
+}
+
+/* A random set of distinct vids from a small pool, so old and new overlap */
+static void random_set(hal_8021q_vlan_conf_t *cfg, hal_8021q_vlan_record_t *rec)
+{
+	u8 used[VID_POOL + 1];
+	u16 vid;
+	int i;
+
+	memset(used, 0, sizeof(used));
+	cfg->PortNum = MAX_PORT_NUM;
+	cfg->TotalRecordCount = rand() % VID_POOL;
+	for (i = 0; i < cfg->TotalRecordCount; i++) {
+		do {
+			vid = 1 + rand() % VID_POOL;
+		} while (used[vid]);
+		used[vid] = 1;
+		rec_set(&rec[i], vid == VID_POOL ? 4095 : vid);
+	}
+}
+
+/* The new set as an edit of the old one */
+static void edit_set(const hal_8021q_vlan_conf_t *old_cfg, const hal_8021q_vlan_record_t *old_rec,
+					 hal_8021q_vlan_conf_t *cfg, hal_8021q_vlan_record_t *rec)
+{
+	hal_8021q_vlan_record_t tmp;
+	int i, j;
+
+	random_set(cfg, rec);
+	for (i = 0; i < cfg->TotalRecordCount; i++) {
+		j = hal_swif_vlan_rec_find(old_rec, old_cfg->TotalRecordCount, hal_swif_vlan_rec_vid(&rec[i]));
+		if ((j < 0) || (rand() % 3 == 0))
+			continue;
+		/* kept, or only renamed */
+		tmp = old_rec[j];
+		if (rand() % 2)
+			tmp.VLanName[0] ^= 0x20;
+		rec[i] = tmp;
+	}
+}
+
+/* Vids the apply has to touch */
+static int expected_ops(const hal_8021q_vlan_conf_t *old_cfg, const hal_8021q_vlan_record_t *old_rec,
+						const hal_8021q_vlan_conf_t *cfg, const hal_8021q_vlan_record_t *rec)
+{
+	int i, j, k, n = 0;
+
+	for (i = 0; i < cfg->TotalRecordCount; i++) {
+		j = hal_swif_vlan_rec_find(old_rec, old_cfg->TotalRecordCount, hal_swif_vlan_rec_vid(&rec[i]));
+		if (j < 0) {
+			n++;
+			continue;
+		}
+		for (k = 0; k < cfg->PortNum; k++) {
+			if (hal_swif_vlan_rec_member(&rec[i], k) != hal_swif_vlan_rec_member(&old_rec[j], k)) {
+				n++;
+				break;
+			}
+		}
+	}
+	for (j = 0; j < old_cfg->TotalRecordCount; j++) {
+		if (hal_swif_vlan_rec_find(rec, cfg->TotalRecordCount, hal_swif_vlan_rec_vid(&old_rec[j])) < 0)
+			n++;
+	}
+	return n;
+}
+
+static hal_8021q_vlan_conf_t run_cfg, old_cfg, new_cfg;
+static hal_8021q_vlan_record_t run_rec[MAX_8021Q_VLAN_RECORD_COUNT];
+static hal_8021q_vlan_record_t old_rec[MAX_8021Q_VLAN_RECORD_COUNT];
+static hal_8021q_vlan_record_t new_rec[MAX_8021Q_VLAN_RECORD_COUNT];
+
+/* The VTU and the running records as after a boot with old */
+static void boot_with_old(void)
+{
+	int i;
+
+	vtu_reset();
+	for (i = 0; i < old_cfg.TotalRecordCount; i++)
+		vtu_load(&old_rec[i], old_cfg.PortNum);
+	op_count = 0;
+	run_cfg = old_cfg;
+	memcpy(run_rec, old_rec, sizeof(run_rec));
+}
+
+static void test_record(void)
+{
+	hal_8021q_vlan_record_t rec;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.VLanID[0] = 0x0F;
+	rec.VLanID[1] = 0xFE;
+	rec.VLanSetting[0] = 0xE4;	/* port 1..4: UM NA UT TG */
+	rec.VLanSetting[2] = 0x80;	/* port 12: UT */
+	CHECK_EQ(hal_swif_vlan_rec_vid(&rec), 0xFFE);
+	CHECK_EQ(hal_swif_vlan_rec_member(&rec, 0), 0);
+	CHECK_EQ(hal_swif_vlan_rec_member(&rec, 1), 1);
+	CHECK_EQ(hal_swif_vlan_rec_member(&rec, 2), 2);
+	CHECK_EQ(hal_swif_vlan_rec_member(&rec, 3), 3);
+	CHECK_EQ(hal_swif_vlan_rec_member(&rec, 11), 2);
+	CHECK_EQ(hal_swif_vlan_rec_find(&rec, 1, 0xFFE), 0);
+	CHECK_EQ(hal_swif_vlan_rec_find(&rec, 1, 0xFFF), -1);
+}
+
+static void test_apply(void)
+{
+	int round, i, n, purged;
+
+	srand(1);
+	for (round = 0; round < 500; round++) {
+		random_set(&old_cfg, old_rec);
+		edit_set(&old_cfg, old_rec, &new_cfg, new_rec);
+		n = expected_ops(&old_cfg, old_rec, &new_cfg, new_rec);
+
+		boot_with_old();
+		CHECK_EQ(hal_swif_vlan_diff_apply(&run_cfg, run_rec, &new_cfg, new_rec, vtu_load, vtu_purge), HAL_SWIF_SUCCESS);
+		CHECK(vtu_is(&new_cfg, new_rec));
+		CHECK_EQ(op_count, n);
+		CHECK(op_count <= old_cfg.TotalRecordCount + new_cfg.TotalRecordCount);
+		CHECK_EQ(run_cfg.TotalRecordCount, new_cfg.TotalRecordCount);
+		CHECK(memcmp(run_rec, new_rec, new_cfg.TotalRecordCount * sizeof(new_rec[0])) == 0);
+
+		/* every load comes before the first purge */
+		for (i = 0, purged = 0; i < op_count; i++) {
+			if (ops[i] < 0)
+				purged = 1;
+			else
+				CHECK(!purged);
+		}
+
+		/* a failure at any step leaves the VTU and the running records */
+		for (i = 0; i < n; i++) {
+			boot_with_old();
+			fail_at = i;
+			CHECK_EQ(hal_swif_vlan_diff_apply(&run_cfg, run_rec, &new_cfg, new_rec, vtu_load, vtu_purge), HAL_SWIF_FAILURE);
+			CHECK(vtu_is(&old_cfg, old_rec));
+			CHECK_EQ(run_cfg.TotalRecordCount, old_cfg.TotalRecordCount);
+			CHECK(memcmp(run_rec, old_rec, sizeof(run_rec)) == 0);
+		}
+	}
+}
+
+static void test_rename_only(void)
+{
+	int i;
+
+	srand(2);
+	random_set(&old_cfg, old_rec);
+	new_cfg = old_cfg;
+	memcpy(new_rec, old_rec, sizeof(new_rec));
+	for (i = 0; i < new_cfg.TotalRecordCount; i++)
+		new_rec[i].VLanName[7] ^= 0x01;
+
+	boot_with_old();
+	CHECK_EQ(hal_swif_vlan_diff_apply(&run_cfg, run_rec, &new_cfg, new_rec, vtu_load, vtu_purge), HAL_SWIF_SUCCESS);
+	CHECK_EQ(op_count, 0);
+	CHECK(memcmp(run_rec, new_rec, sizeof(new_rec)) == 0);
+
+	/* a new port count reloads every vid */
+	boot_with_old();
+	new_cfg.PortNum = MAX_PORT_NUM - 2;
+	CHECK_EQ(hal_swif_vlan_diff_apply(&run_cfg, run_rec, &new_cfg, new_rec, vtu_load, vtu_purge), HAL_SWIF_SUCCESS);
+	CHECK_EQ(op_count, new_cfg.TotalRecordCount);
+	CHECK(vtu_is(&new_cfg, new_rec));
+}
+
+int main(void)
+{
+	test_record();
+	test_apply();
+	test_rename_only();
+	HOST_TEST_DONE("vlan");
+}
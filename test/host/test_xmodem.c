@@ -0,0 +1,407 @@
+/*************************************************************
+ * Filename     : test_xmodem.c
+ * Description  : host test of the XMODEM-1K/YMODEM-G receiver in
+ *                xmodem_rx.c against a simulated sender on a line
+ *                that corrupts, truncates and drops
+ * Copyright    : OB Telecom Electronics Co.
+ *************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "xmodem.h"
+#include "host_test.h"
+
+#define FLASH_BASE		0x08080000
+#define FLASH_SIZE		(64 * 1024)
+#define SENDER_TIMEOUT	3000	/* ms the sender waits for an answer */
+#define LINE_SIZE		(64 * 1024)
+
+/* Image, first 4 bytes its total size big-endian */
+static unsigned char image[FLASH_SIZE];
+static int image_size;
+
+/* Flash stand-in */
+static unsigned char flash[FLASH_SIZE];
+static unsigned int next_write;
+static int write_fail_at, writes;
+
+/* Line from the sender to the receiver */
+static unsigned char line[LINE_SIZE];
+static int line_head, line_tail;
+static unsigned int now, sent_at;
+
+/* Sender */
+enum { WAIT_START, WAIT_BLOCK, WAIT_EOT, Y_WAIT_HDR, Y_WAIT_EOT, Y_WAIT_G, Y_WAIT_END, DONE };
+static int mode, state, block, blocks, cancels, naks;
+static int corrupt_pct, drop_pct, skip_block, file_size, no_batch_end;
+
+static void put(unsigned char c)
+{
+	if (line_head == line_tail)
+		line_head = line_tail = 0;
+	CHECK(line_tail < LINE_SIZE);
+	line[line_tail++] = c;
+}
+
+static unsigned short crc16(const unsigned char *p, int len)
+{
+	unsigned short crc = 0;
+	int i;
+
+	while (len--) {
+		crc ^= (unsigned short)(*p++ << 8);
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (unsigned short)((crc << 1) ^ 0x1021) : (unsigned short)(crc << 1);
+	}
+	return crc;
+}
+
+/* A block as it goes on the line, damaged now and then. Blocks of 1024
+   and the last one as 128 when it fits. */
+static void send_block(int n, const unsigned char *data, int len)
+{
+	static const unsigned char noise[] = { SOH, STX, EOT, CAN, 0x00, 0xFF };
+	unsigned char buf[1029 + 8];
+	int size = (len <= 128) ? 128 : 1024, total, damage, at;
+
+	buf[0] = (size == 128) ? SOH : STX;
+	buf[1] = (unsigned char)n;
+	buf[2] = (unsigned char)~n;
+	memset(&buf[3], 0x1A, size);
+	memcpy(&buf[3], data, len);
+	buf[3 + size] = (unsigned char)(crc16(&buf[3], size) >> 8);
+	buf[4 + size] = (unsigned char)crc16(&buf[3], size);
+	total = size + 5;
+
+	damage = (rand() % 100 < corrupt_pct) ? 1 + rand() % 4 : 0;
+	if (damage == 1)
+		buf[3 + rand() % size] ^= 0x55;		/* bad CRC */
+	else if (damage == 2)
+		buf[2] ^= 0x01;						/* bad complement */
+	else if (damage == 3)
+		total = 1 + rand() % (total - 1);	/* line went quiet */
+	else if (damage == 4) {
+		/* noise bytes in the block, what is left over after it must not
+		   be taken for the next block */
+		for (n = 1 + rand() % 8; n > 0; n--, total++) {
+			at = 1 + rand() % total;
+			memmove(&buf[at + 1], &buf[at], total - at);
+			buf[at] = noise[rand() % sizeof(noise)];
+		}
+	}
+	for (n = 0; n < total; n++)
+		put(buf[n]);
+	sent_at = now;
+}
+
+static void send_data(int n)
+{
+	int off = (n - 1) * 1024, len = image_size - off;
+
+	send_block(n, &image[off], (len > 1024) ? 1024 : len);
+}
+
+static void send_header(void)
+{
+	unsigned char hdr[128];
+	int len;
+
+	memset(hdr, 0, sizeof(hdr));
+	len = sprintf((char *)hdr, "fw.bin");
+	sprintf((char *)&hdr[len + 1], "%d 0 0", file_size);
+	send_block(0, hdr, 128);
+}
+
+static void send_next(void)
+{
+	if (block > blocks) {
+		put(EOT);
+		sent_at = now;
+		state = (mode == YMODEM_G) ? Y_WAIT_EOT : WAIT_EOT;
+		return;
+	}
+	if (block == skip_block)
+		block++;
+	send_data(block);
+}
+
+/* The sender gets a byte from the receiver */
+static void sender_rx(unsigned char c)
+{
+	if (c == CAN) {
+		cancels++;
+		state = DONE;
+		return;
+	}
+
+	switch (state) {
+	case WAIT_START:
+		if (c == 'C') {
+			state = WAIT_BLOCK;
+			block = 1;
+			send_next();
+		} else if (c == 'G') {
+			state = Y_WAIT_HDR;
+			send_header();
+		}
+		break;
+	case WAIT_BLOCK:
+		if (c == ACK) {
+			block++;
+			send_next();
+		} else if (c == NAK) {
+			naks++;
+			send_data(block);
+		}
+		break;
+	case WAIT_EOT:
+		if (c == ACK)
+			state = DONE;
+		else if (c == NAK)
+			put(EOT);
+		break;
+	case Y_WAIT_HDR:
+		/* streams the whole file */
+		if (c == 'G') {
+			for (block = 1; block <= blocks; block++)
+				send_next();
+			send_next();
+		}
+		break;
+	case Y_WAIT_EOT:
+		if (c == ACK)
+			state = Y_WAIT_G;
+		break;
+	case Y_WAIT_G:
+		if ((c == 'G') && !no_batch_end) {
+			unsigned char empty[128];
+
+			memset(empty, 0, sizeof(empty));
+			send_block(0, empty, 128);
+			state = Y_WAIT_END;
+		}
+		break;
+	case Y_WAIT_END:
+		if (c == ACK)
+			state = DONE;
+		break;
+	}
+}
+
+static void rx_send(char data)
+{
+	unsigned char c = (unsigned char)data;
+
+	/* the answers to XMODEM-1K blocks get lost now and then */
+	if (((c == ACK) || (c == NAK)) && (rand() % 100 < drop_pct))
+		return;
+	sender_rx(c);
+}
+
+static int rx_read(int timeoutMs)
+{
+	if (line_head == line_tail) {
+		/* nothing on the line, the sender repeats once its wait is over */
+		if (((state == WAIT_BLOCK) || (state == WAIT_EOT)) &&
+			(sent_at + SENDER_TIMEOUT <= now + timeoutMs)) {
+			if (now < sent_at + SENDER_TIMEOUT)
+				now = sent_at + SENDER_TIMEOUT;
+			if (state == WAIT_BLOCK) {
+				send_data(block);
+			} else {
+				put(EOT);
+				sent_at = now;
+			}
+		} else {
+			now += timeoutMs;
+			return ERR_TIMEOUT;
+		}
+	}
+	return line[line_head++];
+}
+
+static int rx_write(unsigned int address, unsigned char *pData, int len)
+{
+	if (writes++ == write_fail_at)
+		return -1;
+	/* every byte once and in order */
+	CHECK_EQ(address, next_write);
+	CHECK(address + len <= FLASH_BASE + FLASH_SIZE);
+	memcpy(&flash[address - FLASH_BASE], pData, len);
+	next_write = address + len;
+	return 0;
+}
+
+static int rx_check_header(unsigned char *pHeader, int *pImageSize)
+{
+	if (memcmp(&pHeader[4], "OBIM", 4) != 0)
+		return -1;
+	*pImageSize = (pHeader[0] << 24) | (pHeader[1] << 16) | (pHeader[2] << 8) | pHeader[3];
+	return 0;
+}
+
+static const xmodem_port_t port = { rx_read, rx_send, rx_write, rx_check_header };
+
+static void setup(int m, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		image[i] = (unsigned char)rand();
+	image[0] = (unsigned char)(size >> 24);
+	image[1] = (unsigned char)(size >> 16);
+	image[2] = (unsigned char)(size >> 8);
+	image[3] = (unsigned char)size;
+	memcpy(&image[4], "OBIM", 4);
+	image_size = size;
+	blocks = (size + 1023) / 1024;
+
+	memset(flash, 0xFF, sizeof(flash));
+	next_write = FLASH_BASE;
+	write_fail_at = -1;
+	writes = 0;
+	line_head = line_tail = 0;
+	now = sent_at = 0;
+	mode = m;
+	state = WAIT_START;
+	cancels = naks = 0;
+	corrupt_pct = drop_pct = 0;
+	skip_block = -1;
+	file_size = size;
+	no_batch_end = 0;
+}
+
+static int receive(int *size)
+{
+	*size = -1;
+	return XmodemReceive(&port, FLASH_BASE, size, mode);
+}
+
+static int flash_is_image(void)
+{
+	int i;
+
+	if (memcmp(flash, image, image_size) != 0)
+		return 0;
+	/* the padding of the last block is not written */
+	for (i = image_size; i < FLASH_SIZE; i++) {
+		if (flash[i] != 0xFF)
+			return 0;
+	}
+	return 1;
+}
+
+static void test_xmodem_clean(void)
+{
+	static const int sizes[] = { 8, 128, 129, 1000, 1024, 1025, 1100, 5000, 40000 };
+	int i, size;
+
+	for (i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++) {
+		setup(XMODEM_1K, sizes[i]);
+		CHECK_EQ(receive(&size), XMODEM_SUCCESS);
+		CHECK_EQ(size, sizes[i]);
+		CHECK(flash_is_image());
+		CHECK_EQ(state, DONE);
+		CHECK_EQ(naks, 0);
+	}
+}
+
+static void test_xmodem_noisy(void)
+{
+	int round, size;
+
+	/* blocks damaged and answers lost, every block lands once */
+	for (round = 0; round < 300; round++) {
+		setup(XMODEM_1K, 8 + rand() % 40000);
+		corrupt_pct = rand() % 25;
+		drop_pct = rand() % 25;
+		CHECK_EQ(receive(&size), XMODEM_SUCCESS);
+		CHECK_EQ(size, image_size);
+		CHECK(flash_is_image());
+		CHECK_EQ(cancels, 0);
+		if (corrupt_pct == 0)
+			CHECK_EQ(naks, 0);
+	}
+}
+
+static void test_xmodem_errors(void)
+{
+	int size;
+
+	/* a block that never gets through is given up after the retries */
+	setup(XMODEM_1K, 5000);
+	corrupt_pct = 100;
+	CHECK(receive(&size) < 0);
+	CHECK_EQ(naks, XMODEM_RETRY_MAX);
+	CHECK(cancels > 0);
+
+	/* a block missing from the sequence ends the transfer */
+	setup(XMODEM_1K, 5000);
+	skip_block = 3;
+	CHECK_EQ(receive(&size), ERR_SEQ_NUM);
+	CHECK_EQ(size, 2 * 1024);
+	CHECK(cancels > 0);
+
+	/* so does a failed write */
+	setup(XMODEM_1K, 5000);
+	write_fail_at = 2;
+	CHECK_EQ(receive(&size), ERR_FLASH_WRITE);
+	CHECK_EQ(size, 2 * 1024);
+	CHECK(cancels > 0);
+
+	/* and a first block which is no image */
+	setup(XMODEM_1K, 5000);
+	image[4] = 'X';
+	CHECK_EQ(receive(&size), ERR_CHECK_HEADER);
+	CHECK_EQ(writes, 0);
+
+	/* a sender which ends before the image is complete */
+	setup(XMODEM_1K, 5000);
+	blocks = 3;
+	CHECK_EQ(receive(&size), ERR_CHECK_HEADER);
+	CHECK_EQ(size, 3 * 1024);
+}
+
+static void test_ymodem_g(void)
+{
+	int round, size;
+
+	for (round = 0; round < 50; round++) {
+		setup(YMODEM_G, 8 + rand() % 40000);
+		CHECK_EQ(receive(&size), XMODEM_SUCCESS);
+		CHECK_EQ(size, image_size);
+		CHECK(flash_is_image());
+		CHECK_EQ(state, DONE);
+	}
+
+	/* no retries, the first bad block cancels */
+	setup(YMODEM_G, 20000);
+	corrupt_pct = 100;
+	CHECK(receive(&size) < 0);
+	CHECK(cancels > 0);
+	CHECK_EQ(writes, 0);
+
+	/* a sender which never closes the batch, the file is complete */
+	setup(YMODEM_G, 20000);
+	no_batch_end = 1;
+	CHECK_EQ(receive(&size), XMODEM_SUCCESS);
+	CHECK(flash_is_image());
+	CHECK_EQ(cancels, 0);
+
+	/* the file size of block 0 must hold the image */
+	setup(YMODEM_G, 20000);
+	file_size = 10000;
+	CHECK_EQ(receive(&size), ERR_CHECK_HEADER);
+	CHECK(cancels > 0);
+}
+
+int main(void)
+{
+	srand(1);
+	test_xmodem_clean();
+	test_xmodem_noisy();
+	test_xmodem_errors();
+	test_ymodem_g();
+	HOST_TEST_DONE("xmodem");
+}